@@ -35,6 +35,7 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_inlines.h"
 #include "util/u_helpers.h"
 #include "util/u_prim.h"
@@ -56,6 +57,8 @@ draw_get_option_use_llvm(void)
 {
    return debug_get_bool_option("DRAW_USE_LLVM", TRUE);
 }
+
+DEBUG_GET_ONCE_NUM_OPTION(draw_vs_threads, "DRAW_VS_THREADS", 0)
 #else
 boolean
 draw_get_option_use_llvm(void)
@@ -92,6 +95,16 @@ draw_create_context(struct pipe_context *pipe, void *context,
    if (try_llvm && draw_get_option_use_llvm()) {
       draw->llvm = draw_llvm_create(draw, (LLVMContextRef)context);
    }
+
+   if (draw->llvm) {
+      unsigned num_threads = MIN2(debug_get_option_draw_vs_threads(),
+                                  DRAW_MAX_VS_THREADS);
+
+      if (num_threads > 1 &&
+          util_queue_init(&draw->vs_queue, "draw_vs", DRAW_MAX_VS_THREADS,
+                          num_threads - 1, 0, NULL))
+         draw->num_vs_threads = num_threads;
+   }
 #endif
 
    draw->pipe = pipe;
@@ -234,6 +247,8 @@ void draw_destroy( struct draw_context *draw )
    draw_vs_destroy( draw );
    draw_gs_destroy( draw );
 #ifdef DRAW_LLVM_AVAILABLE
+   if (util_queue_is_initialized(&draw->vs_queue))
+      util_queue_destroy(&draw->vs_queue);
    if (draw->llvm)
       draw_llvm_destroy( draw->llvm );
 #endif
@@ -1351,6 +1366,17 @@ draw_set_disk_cache_callbacks(struct draw_context *draw,
    draw->disk_cache_cookie = data_cookie;
 }
 
+/**
+ * Have the LLVM shader variants count against, and be evicted by, a JIT
+ * code budget shared with the driver's own variants.
+ */
+void
+draw_set_variant_budget(struct draw_context *draw,
+                        struct gallivm_variant_budget *budget)
+{
+   draw->variant_budget = budget;
+}
+
 void draw_set_constant_buffer_stride(struct draw_context *draw, unsigned num_bytes)
 {
    draw->constant_buffer_stride = num_bytes;
@@ -330,6 +330,9 @@ void draw_vbo(struct draw_context *draw,
               const struct pipe_draw_start_count_bias *draws,
               unsigned num_draws);
 
+void draw_precompile(struct draw_context *draw,
+                     enum pipe_prim_type prim);
+
 
 /*******************************************************************************
  * Driver backend interface 
@@ -371,6 +374,7 @@ boolean
 draw_get_option_use_llvm(void);
 
 struct lp_cached_code;
+struct gallivm_variant_budget;
 void
 draw_set_disk_cache_callbacks(struct draw_context *draw,
                               void *data_cookie,
@@ -380,4 +384,8 @@ draw_set_disk_cache_callbacks(struct draw_context *draw,
                               void (*insert_shader)(void *cookie,
                                                     struct lp_cached_code *cache,
                                                     unsigned char ir_sha1_cache_key[20]));
+
+void
+draw_set_variant_budget(struct draw_context *draw,
+                        struct gallivm_variant_budget *budget);
 #endif /* DRAW_CONTEXT_H */
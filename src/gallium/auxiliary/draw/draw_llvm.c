@@ -912,6 +912,7 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
 
    if (needs_caching)
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
@@ -2658,12 +2659,37 @@ draw_llvm_destroy_variant(struct draw_llvm_variant *variant)
 
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
-   remove_from_list(&variant->list_item_global);
-   llvm->nr_variants--;
+   /* precompiled variants may not have been adopted by a context yet */
+   if (!is_empty_list(&variant->list_item_global)) {
+      remove_from_list(&variant->list_item_global);
+      llvm->nr_variants--;
+      gallivm_budget_add(llvm->draw->variant_budget,
+                         -(int64_t)variant->code_size);
+   }
    FREE(variant);
 }
 
 
+/**
+ * Take the most recently used vertex shader variant off this context's LRU
+ * list, leaving it only on its shader's list.  The next context to look it
+ * up there adopts it, see llvm_middle_end_prepare().
+ */
+void
+draw_llvm_orphan_current_variant(struct draw_llvm *llvm)
+{
+   struct draw_llvm_variant_list_item *li = first_elem(&llvm->vs_variants_list);
+
+   if (at_end(&llvm->vs_variants_list, li))
+      return;
+
+   remove_from_list(li);
+   llvm->nr_variants--;
+   gallivm_budget_add(llvm->draw->variant_budget,
+                      -(int64_t)li->base->code_size);
+}
+
+
 /**
  * Create LLVM types for various structures.
  */
@@ -2946,6 +2972,7 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->jit_func = (draw_gs_jit_func)
          gallivm_jit_function(variant->gallivm, variant->function);
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
 
    if (needs_caching)
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
@@ -2977,6 +3004,8 @@ draw_gs_llvm_destroy_variant(struct draw_gs_llvm_variant *variant)
    variant->shader->variants_cached--;
    remove_from_list(&variant->list_item_global);
    llvm->nr_gs_variants--;
+   gallivm_budget_add(llvm->draw->variant_budget,
+                      -(int64_t)variant->code_size);
    FREE(variant);
 }
 
@@ -3604,6 +3633,7 @@ draw_tcs_llvm_create_variant(struct draw_llvm *llvm,
    lp_build_coro_add_malloc_hooks(variant->gallivm);
    variant->jit_func = (draw_tcs_jit_func)
       gallivm_jit_function(variant->gallivm, variant->function);
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
 
    if (needs_caching)
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
@@ -3635,6 +3665,8 @@ draw_tcs_llvm_destroy_variant(struct draw_tcs_llvm_variant *variant)
    variant->shader->variants_cached--;
    remove_from_list(&variant->list_item_global);
    llvm->nr_tcs_variants--;
+   gallivm_budget_add(llvm->draw->variant_budget,
+                      -(int64_t)variant->code_size);
    FREE(variant);
 }
 
@@ -4123,6 +4155,7 @@ draw_tes_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->jit_func = (draw_tes_jit_func)
       gallivm_jit_function(variant->gallivm, variant->function);
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
 
    if (needs_caching)
       llvm->draw->disk_cache_insert_shader(llvm->draw->disk_cache_cookie,
@@ -4154,6 +4187,8 @@ draw_tes_llvm_destroy_variant(struct draw_tes_llvm_variant *variant)
    variant->shader->variants_cached--;
    remove_from_list(&variant->list_item_global);
    llvm->nr_tes_variants--;
+   gallivm_budget_add(llvm->draw->variant_budget,
+                      -(int64_t)variant->code_size);
    FREE(variant);
 }
 
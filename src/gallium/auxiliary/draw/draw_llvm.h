@@ -661,6 +661,9 @@ struct draw_llvm_variant
 
    struct llvm_vertex_shader *shader;
 
+   /* Bytes of JIT code, counted against the draw's variant budget */
+   size_t code_size;
+
    struct draw_llvm *llvm;
    struct draw_llvm_variant_list_item list_item_global;
    struct draw_llvm_variant_list_item list_item_local;
@@ -687,6 +690,9 @@ struct draw_gs_llvm_variant
 
    struct llvm_geometry_shader *shader;
 
+   /* Bytes of JIT code, counted against the draw's variant budget */
+   size_t code_size;
+
    struct draw_llvm *llvm;
    struct draw_gs_llvm_variant_list_item list_item_global;
    struct draw_gs_llvm_variant_list_item list_item_local;
@@ -712,6 +718,9 @@ struct draw_tcs_llvm_variant
 
    struct llvm_tess_ctrl_shader *shader;
 
+   /* Bytes of JIT code, counted against the draw's variant budget */
+   size_t code_size;
+
    struct draw_llvm *llvm;
    struct draw_tcs_llvm_variant_list_item list_item_global;
    struct draw_tcs_llvm_variant_list_item list_item_local;
@@ -738,6 +747,9 @@ struct draw_tes_llvm_variant
 
    struct llvm_tess_eval_shader *shader;
 
+   /* Bytes of JIT code, counted against the draw's variant budget */
+   size_t code_size;
+
    struct draw_llvm *llvm;
    struct draw_tes_llvm_variant_list_item list_item_global;
    struct draw_tes_llvm_variant_list_item list_item_local;
@@ -845,6 +857,9 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 void
 draw_llvm_destroy_variant(struct draw_llvm_variant *variant);
 
+void
+draw_llvm_orphan_current_variant(struct draw_llvm *llvm);
+
 struct draw_llvm_variant_key *
 draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store);
 
@@ -46,6 +46,8 @@
 
 #include "tgsi/tgsi_scan.h"
 
+#include "util/u_queue.h"
+
 #ifdef DRAW_LLVM_AVAILABLE
 struct gallivm_state;
 #endif
@@ -69,6 +71,12 @@ struct gallivm_state;
  */
 #define DRAW_MAX_EXTRA_SHADER_OUTPUTS 32
 
+/**
+ * Maximum number of threads (including the calling thread) the LLVM
+ * middle end splits a vertex shader run over, see DRAW_VS_THREADS.
+ */
+#define DRAW_MAX_VS_THREADS 16
+
 /**
  * Despite some efforts to determine the number of extra shader outputs ahead
  * of time, the matter of fact is that this number will vary as primitives
@@ -103,6 +111,7 @@ struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
 struct lp_cached_code;
+struct gallivm_variant_budget;
 
 /**
  * Represents the mapped vertex buffer.
@@ -400,6 +409,13 @@ struct draw_context
    unsigned constant_buffer_stride;
    struct draw_llvm *llvm;
 
+   /** Worker threads shading chunks of large vertex runs in parallel.
+    * num_vs_threads counts the calling thread too, so the queue is only
+    * initialized when it is greater than one.
+    */
+   struct util_queue vs_queue;
+   unsigned num_vs_threads;
+
    /** Texture sampler and sampler view state.
     * Note that we have arrays indexed by shader type.  At this time
     * we only handle vertex and geometry shaders in the draw module, but
@@ -422,6 +438,9 @@ struct draw_context
 
    struct draw_assembler *ia;
 
+   /* Optional JIT code budget shared with the driver's shader variants */
+   struct gallivm_variant_budget *variant_budget;
+
    void *disk_cache_cookie;
    void (*disk_cache_find_shader)(void *cookie,
                                   struct lp_cached_code *cache,
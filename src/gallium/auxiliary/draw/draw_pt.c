@@ -37,6 +37,9 @@
 #include "draw/draw_pt.h"
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vs.h"
+#ifdef DRAW_LLVM_AVAILABLE
+#include "draw/draw_llvm.h"
+#endif
 #include "tgsi/tgsi_dump.h"
 #include "util/u_math.h"
 #include "util/u_prim.h"
@@ -53,14 +56,15 @@ DEBUG_GET_ONCE_BOOL_OPTION(draw_no_fse, "DRAW_NO_FSE", FALSE)
  *     - pipeline -- the prim pipeline: clipping, wide lines, etc 
  *     - backend  -- the vbuf_render provided by the driver.
  */
-static boolean
-draw_pt_arrays(struct draw_context *draw,
-               unsigned prim,
-               bool index_bias_varies,
-               const struct pipe_draw_start_count_bias *draw_info,
-               unsigned num_draws)
+
+
+/**
+ * Pick the middle end and pipeline options for drawing prim with the
+ * current state.
+ */
+static struct draw_pt_middle_end *
+draw_pt_choose_middle(struct draw_context *draw, unsigned prim, unsigned *popt)
 {
-   struct draw_pt_front_end *frontend = NULL;
    struct draw_pt_middle_end *middle = NULL;
    unsigned opt = PT_SHADE;
 
@@ -96,6 +100,21 @@ draw_pt_arrays(struct draw_context *draw,
          middle = draw->pt.middle.general;
    }
 
+   *popt = opt;
+   return middle;
+}
+
+static boolean
+draw_pt_arrays(struct draw_context *draw,
+               unsigned prim,
+               bool index_bias_varies,
+               const struct pipe_draw_start_count_bias *draw_info,
+               unsigned num_draws)
+{
+   struct draw_pt_front_end *frontend = NULL;
+   unsigned opt;
+   struct draw_pt_middle_end *middle = draw_pt_choose_middle(draw, prim, &opt);
+
    frontend = draw->pt.frontend;
 
    if (frontend) {
@@ -179,6 +198,36 @@ void draw_pt_flush( struct draw_context *draw, unsigned flags )
 }
 
 
+/**
+ * Compile the vertex shader variant a draw of prim would use with the
+ * current state, without fetching or emitting any vertices.
+ *
+ * The variant is taken off this context's LRU list afterwards so that the
+ * context which draws with it first adopts it.  Only the plain vertex
+ * shader path is handled, geometry and tessellation variants stay lazy.
+ */
+void
+draw_precompile(struct draw_context *draw, enum pipe_prim_type prim)
+{
+#ifdef DRAW_LLVM_AVAILABLE
+   struct draw_pt_middle_end *middle;
+   unsigned opt, max_vertices = 4096;
+
+   if (!draw->llvm || !draw->vs.vertex_shader ||
+       draw->gs.geometry_shader || draw->tes.tess_eval_shader)
+      return;
+
+   /* make the next real draw prepare the whole pipeline again */
+   draw_do_flush(draw, DRAW_FLUSH_STATE_CHANGE);
+
+   middle = draw_pt_choose_middle(draw, prim, &opt);
+   middle->prepare(middle, prim, opt, &max_vertices);
+
+   draw_llvm_orphan_current_variant(draw->llvm);
+#endif
+}
+
+
 
 boolean draw_pt_init( struct draw_context *draw )
 {
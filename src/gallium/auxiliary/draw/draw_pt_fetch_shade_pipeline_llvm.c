@@ -28,6 +28,8 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_tess.h"
@@ -39,6 +41,7 @@
 #include "draw/draw_llvm.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_debug.h"
+#include "nir.h"
 
 
 struct llvm_middle_end {
@@ -104,7 +107,8 @@ llvm_middle_end_prepare_gs(struct llvm_middle_end *fpme)
       /* First check if we've created too many variants.  If so, free
        * 3.125% of the LRU to avoid using too much memory.
        */
-      if (llvm->nr_gs_variants >= DRAW_MAX_SHADER_VARIANTS) {
+      if (llvm->nr_gs_variants >= DRAW_MAX_SHADER_VARIANTS ||
+          gallivm_budget_exceeded(llvm->draw->variant_budget)) {
          if (gallivm_debug & GALLIVM_DEBUG_PERF) {
             debug_printf("Evicting GS: %u gs variants,\t%u total variants\n",
                       shader->variants_cached, llvm->nr_gs_variants);
@@ -132,6 +136,7 @@ llvm_middle_end_prepare_gs(struct llvm_middle_end *fpme)
          insert_at_head(&llvm->gs_variants_list,
                         &variant->list_item_global);
          llvm->nr_gs_variants++;
+         gallivm_budget_add(llvm->draw->variant_budget, variant->code_size);
          shader->variants_cached++;
       }
    }
@@ -174,7 +179,8 @@ llvm_middle_end_prepare_tcs(struct llvm_middle_end *fpme)
       /* First check if we've created too many variants.  If so, free
        * 3.125% of the LRU to avoid using too much memory.
        */
-      if (llvm->nr_tcs_variants >= DRAW_MAX_SHADER_VARIANTS) {
+      if (llvm->nr_tcs_variants >= DRAW_MAX_SHADER_VARIANTS ||
+          gallivm_budget_exceeded(llvm->draw->variant_budget)) {
          if (gallivm_debug & GALLIVM_DEBUG_PERF) {
             debug_printf("Evicting TCS: %u tcs variants,\t%u total variants\n",
                       shader->variants_cached, llvm->nr_tcs_variants);
@@ -202,6 +208,7 @@ llvm_middle_end_prepare_tcs(struct llvm_middle_end *fpme)
          insert_at_head(&llvm->tcs_variants_list,
                         &variant->list_item_global);
          llvm->nr_tcs_variants++;
+         gallivm_budget_add(llvm->draw->variant_budget, variant->code_size);
          shader->variants_cached++;
       }
    }
@@ -244,7 +251,8 @@ llvm_middle_end_prepare_tes(struct llvm_middle_end *fpme)
       /* First check if we've created too many variants.  If so, free
        * 3.125% of the LRU to avoid using too much memory.
        */
-      if (llvm->nr_tes_variants >= DRAW_MAX_SHADER_VARIANTS) {
+      if (llvm->nr_tes_variants >= DRAW_MAX_SHADER_VARIANTS ||
+          gallivm_budget_exceeded(llvm->draw->variant_budget)) {
          if (gallivm_debug & GALLIVM_DEBUG_PERF) {
             debug_printf("Evicting TES: %u tes variants,\t%u total variants\n",
                       shader->variants_cached, llvm->nr_tes_variants);
@@ -272,6 +280,7 @@ llvm_middle_end_prepare_tes(struct llvm_middle_end *fpme)
          insert_at_head(&llvm->tes_variants_list,
                         &variant->list_item_global);
          llvm->nr_tes_variants++;
+         gallivm_budget_add(llvm->draw->variant_budget, variant->code_size);
          shader->variants_cached++;
       }
    }
@@ -366,6 +375,12 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
       }
 
       if (variant) {
+         /* a precompiled variant is not on any context's list yet */
+         if (is_empty_list(&variant->list_item_global)) {
+            variant->llvm = llvm;
+            llvm->nr_variants++;
+            gallivm_budget_add(llvm->draw->variant_budget, variant->code_size);
+         }
          /* found the variant, move to head of global list (for LRU) */
          move_to_head(&llvm->vs_variants_list, &variant->list_item_global);
       }
@@ -375,7 +390,8 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
          /* First check if we've created too many variants.  If so, free
           * 3.125% of the LRU to avoid using too much memory.
           */
-         if (llvm->nr_variants >= DRAW_MAX_SHADER_VARIANTS) {
+         if (llvm->nr_variants >= DRAW_MAX_SHADER_VARIANTS ||
+             gallivm_budget_exceeded(llvm->draw->variant_budget)) {
             if (gallivm_debug & GALLIVM_DEBUG_PERF) {
                debug_printf("Evicting VS: %u vs variants,\t%u total variants\n",
                          shader->variants_cached, llvm->nr_variants);
@@ -403,6 +419,7 @@ llvm_middle_end_prepare( struct draw_pt_middle_end *middle,
             insert_at_head(&llvm->vs_variants_list,
                            &variant->list_item_global);
             llvm->nr_variants++;
+            gallivm_budget_add(llvm->draw->variant_budget, variant->code_size);
             shader->variants_cached++;
          }
       }
@@ -560,6 +577,150 @@ emit(struct pt_emit *emit,
 }
 
 
+/* Don't split vertex shader runs into chunks smaller than this. */
+#define LLVM_VS_MIN_CHUNK 256
+
+struct llvm_vs_job {
+   struct llvm_middle_end *fpme;
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+   boolean clipped;
+   struct util_queue_fence fence;
+};
+
+
+static boolean
+llvm_vs_run(struct llvm_vs_job *job)
+{
+   struct llvm_middle_end *fpme = job->fpme;
+   struct draw_context *draw = fpme->draw;
+
+   return fpme->current_variant->jit_func(&fpme->llvm->jit_context,
+                                          job->verts,
+                                          draw->pt.user.vbuffer,
+                                          job->count,
+                                          job->start_or_maxelt,
+                                          fpme->vertex_size,
+                                          draw->pt.vertex_buffer,
+                                          draw->instance_id,
+                                          job->vid_base,
+                                          draw->start_instance,
+                                          job->elts, draw->pt.user.drawid,
+                                          draw->pt.user.viewid);
+}
+
+
+static void
+llvm_vs_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct llvm_vs_job *job = (struct llvm_vs_job *)data;
+   unsigned fpstate = util_fpstate_get();
+
+   /* Match the denorm handling draw_vbo() set up on the calling thread. */
+   util_fpstate_set_denorms_to_zero(fpstate);
+   job->clipped = llvm_vs_run(job);
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Whether a vertex run can be split into chunks. For linear draws each
+ * chunk gets its own start, which the shader would see as first vertex.
+ */
+static boolean
+llvm_vs_can_split(const struct draw_context *draw,
+                  const struct draw_fetch_info *fetch_info)
+{
+   const struct draw_vertex_shader *vs = draw->vs.vertex_shader;
+
+   if (fetch_info->linear && vs->state.type == PIPE_SHADER_IR_NIR &&
+       vs->state.ir.nir) {
+      const nir_shader *nir = (const nir_shader *)vs->state.ir.nir;
+
+      return !BITSET_TEST(nir->info.system_values_read,
+                          SYSTEM_VALUE_FIRST_VERTEX);
+   }
+   return TRUE;
+}
+
+
+/**
+ * Fetch and shade the vertices, splitting the run over the draw worker
+ * threads when it is large enough. Each chunk writes a disjoint range of
+ * verts, so primitive order is unaffected.
+ */
+static boolean
+llvm_pipeline_run_vs(struct llvm_middle_end *fpme,
+                     struct vertex_header *verts,
+                     const struct draw_fetch_info *fetch_info)
+{
+   struct draw_context *draw = fpme->draw;
+   struct llvm_vs_job jobs[DRAW_MAX_VS_THREADS];
+   unsigned num_chunks = 1, chunk_size, i;
+   boolean clipped = FALSE;
+
+   jobs[0].fpme = fpme;
+   jobs[0].verts = verts;
+   jobs[0].count = fetch_info->count;
+   if (fetch_info->linear) {
+      jobs[0].start_or_maxelt = fetch_info->start;
+      jobs[0].vid_base = draw->start_index;
+      jobs[0].elts = NULL;
+   }
+   else {
+      jobs[0].start_or_maxelt = draw->pt.user.eltMax;
+      jobs[0].vid_base = draw->pt.user.eltBias;
+      jobs[0].elts = fetch_info->elts;
+   }
+
+   if (draw->num_vs_threads > 1 && llvm_vs_can_split(draw, fetch_info))
+      num_chunks = MIN2(draw->num_vs_threads,
+                        fetch_info->count / LLVM_VS_MIN_CHUNK);
+
+   if (num_chunks <= 1)
+      return llvm_vs_run(&jobs[0]);
+
+   /* The shader writes whole vectors of vertices, so only the last chunk
+    * may end inside one (covered by the padding of the vertex buffer).
+    */
+   chunk_size = align(DIV_ROUND_UP(fetch_info->count, num_chunks),
+                      lp_native_vector_width / 32);
+   num_chunks = DIV_ROUND_UP(fetch_info->count, chunk_size);
+   jobs[0].count = chunk_size;
+
+   for (i = 1; i < num_chunks; i++) {
+      unsigned offset = i * chunk_size;
+      struct llvm_vs_job *job = &jobs[i];
+
+      *job = jobs[0];
+      job->verts = (struct vertex_header *)
+         ((char *)verts + offset * fpme->vertex_size);
+      job->count = MIN2(chunk_size, fetch_info->count - offset);
+      if (job->elts)
+         job->elts += offset;
+      else
+         job->start_or_maxelt += offset;
+
+      util_queue_fence_init(&job->fence);
+      util_queue_add_job(&draw->vs_queue, job, &job->fence,
+                         llvm_vs_job_execute, NULL, 0);
+   }
+
+   clipped = llvm_vs_run(&jobs[0]);
+
+   for (i = 1; i < num_chunks; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+      clipped |= jobs[i].clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -584,8 +745,6 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
    boolean free_prim_info = FALSE;
    unsigned opt = fpme->opt;
    boolean clipped = 0;
-   unsigned start_or_maxelt, vid_base;
-   const unsigned *elts;
    ushort *tes_elts_out = NULL;
 
    memset(&gs_vert_info, 0, sizeof(struct draw_vertex_info) * TGSI_MAX_VERTEX_STREAMS);
@@ -612,28 +771,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear) {
-      start_or_maxelt = fetch_info->start;
-      vid_base = draw->start_index;
-      elts = NULL;
-   }
-   else {
-      start_or_maxelt = draw->pt.user.eltMax;
-      vid_base = draw->pt.user.eltBias;
-      elts = fetch_info->elts;
-   }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts, draw->pt.user.drawid,
-                                             draw->pt.user.viewid);
+   clipped = llvm_pipeline_run_vs(fpme, llvm_vert_info.verts, fetch_info);
 
    /* Finished with fetch and vs:
     */
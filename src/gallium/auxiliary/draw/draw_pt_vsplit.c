@@ -30,8 +30,15 @@
 #include "draw/draw_private.h"
 #include "draw/draw_pt.h"
 
+#include "util/u_sse.h"
+
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/* Post-transform cache: MAP_SETS sets of MAP_WAYS entries each, so a
+ * whole segment fits even with poor index locality.
+ */
+#define MAP_SETS     256
+#define MAP_WAYS     4
 
 /* The largest possible index within an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -54,9 +61,12 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      unsigned fetches[MAP_SETS][MAP_WAYS];
+      ushort draws[MAP_SETS][MAP_WAYS];
+      /* number of valid ways in each set, counting up to 2 * MAP_WAYS - 1
+       * once full to pick the next way to replace
+       */
+      ubyte fill[MAP_SETS];
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +77,7 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   memset(vsplit->cache.fill, 0, sizeof(vsplit->cache.fill));
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -81,29 +90,63 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
 }
 
+/**
+ * Return the way of the set holding fetch, or -1 if it is not cached.
+ * Only the first "valid" ways are considered.
+ */
+static inline int
+vsplit_cache_probe(const unsigned *ways, unsigned valid, unsigned fetch)
+{
+#if defined(PIPE_ARCH_SSE) && MAP_WAYS == 4
+   /* The frontend is not allocated with any particular alignment. */
+   __m128i cmp = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) ways),
+                                 _mm_set1_epi32(fetch));
+   unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(cmp)) &
+                   ((1u << valid) - 1);
+
+   return mask ? (int) u_bit_scan(&mask) : -1;
+#else
+   unsigned i;
+
+   for (i = 0; i < valid; i++) {
+      if (ways[i] == fetch)
+         return i;
+   }
+   return -1;
+#endif
+}
+
 /**
  * Add a fetch element and add it to the draw elements.
  */
 static inline void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch)
 {
-   unsigned hash;
-
-   hash = fetch % MAP_SIZE;
-
-   /* If the value isn't in the cache or it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   unsigned set = fetch % MAP_SETS;
+   unsigned fill = vsplit->cache.fill[set];
+   int way;
+
+   way = vsplit_cache_probe(vsplit->cache.fetches[set], MIN2(fill, MAP_WAYS),
+                            fetch);
+   if (way < 0) {
+      /* update cache, replacing ways round-robin once the set is full */
+      if (fill < MAP_WAYS) {
+         way = fill;
+         vsplit->cache.fill[set] = fill + 1;
+      } else {
+         way = fill - MAP_WAYS;
+         vsplit->cache.fill[set] = MAP_WAYS + (way + 1) % MAP_WAYS;
+      }
+      vsplit->cache.fetches[set][way] = fetch;
+      vsplit->cache.draws[set][way] = vsplit->cache.num_fetch_elts;
 
       /* add fetch */
       assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
       vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
    }
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+      vsplit->cache.draws[set][way];
 }
 
 /**
@@ -125,12 +168,6 @@ vsplit_add_cache_ubyte(struct vsplit_frontend *vsplit, const ubyte *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -142,12 +179,6 @@ vsplit_add_cache_ushort(struct vsplit_frontend *vsplit, const ushort *elts,
    unsigned elt_idx;
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* unlike the uint case this can only happen with elt_bias */
-   if (elt_bias && elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
@@ -167,13 +198,6 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
     */
    elt_idx = vsplit_get_base_idx(start, fetch);
    elt_idx = (unsigned)((int)(DRAW_GET_IDX(elts, elt_idx)) + elt_bias);
-   /* Take care for DRAW_MAX_FETCH_IDX (since cache is initialized to -1). */
-   if (elt_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = elt_idx % MAP_SIZE;
-      /* force update - any value will do except DRAW_MAX_FETCH_IDX */
-      vsplit->cache.fetches[hash] = 0;
-      vsplit->cache.has_max_fetch = TRUE;
-   }
    vsplit_add_cache(vsplit, elt_idx);
 }
 
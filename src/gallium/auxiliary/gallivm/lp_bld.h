@@ -87,4 +87,9 @@
 #define GALLIVM_HAVE_CORO 0
 #endif
 
+/* Set by the llvm-orcjit build option. */
+#ifndef GALLIVM_USE_ORCJIT
+#define GALLIVM_USE_ORCJIT 0
+#endif
+
 #endif /* LP_BLD_H */
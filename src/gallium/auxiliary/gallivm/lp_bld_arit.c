@@ -1926,6 +1926,20 @@ lp_build_iround_nearest_sse2(struct lp_build_context *bld,
       if (type.width* type.length == 128) {
          intrinsic = "llvm.x86.sse2.cvtps2dq";
       }
+      else if (type.width*type.length == 512) {
+         LLVMValueRef args[4];
+
+         assert(util_get_cpu_caps()->has_avx512f);
+
+         /* No mask, current rounding direction. */
+         args[0] = a;
+         args[1] = LLVMGetUndef(ret_type);
+         args[2] = LLVMConstInt(LLVMInt16TypeInContext(bld->gallivm->context),
+                                0xffff, 0);
+         args[3] = LLVMConstInt(i32t, 4, 0);
+         return lp_build_intrinsic(builder, "llvm.x86.avx512.mask.cvtps2dq.512",
+                                   ret_type, args, 4, 0);
+      }
       else {
          assert(type.width*type.length == 256);
          assert(util_get_cpu_caps()->has_avx);
@@ -2348,7 +2362,8 @@ lp_build_iround(struct lp_build_context *bld,
 
    if ((util_get_cpu_caps()->has_sse2 &&
        ((type.width == 32) && (type.length == 1 || type.length == 4))) ||
-       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8)) {
+       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8) ||
+       (util_get_cpu_caps()->has_avx512f && type.width == 32 && type.length == 16)) {
       return lp_build_iround_nearest_sse2(bld, a);
    }
    if (arch_rounding_available(type)) {
@@ -2754,7 +2769,8 @@ lp_build_fast_rsqrt_available(struct lp_type type)
    assert(type.floating);
 
    if ((util_get_cpu_caps()->has_sse && type.width == 32 && type.length == 4) ||
-       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8)) {
+       (util_get_cpu_caps()->has_avx && type.width == 32 && type.length == 8) ||
+       (util_get_cpu_caps()->has_avx512f && type.width == 32 && type.length == 16)) {
       return true;
    }
    return false;
@@ -2782,6 +2798,17 @@ lp_build_fast_rsqrt(struct lp_build_context *bld,
       if (type.length == 4) {
          intrinsic = "llvm.x86.sse.rsqrt.ps";
       }
+      else if (type.length == 16) {
+         LLVMValueRef args[3];
+
+         /* rsqrt14 only comes in a masked flavour. */
+         args[0] = a;
+         args[1] = bld->undef;
+         args[2] = LLVMConstInt(LLVMInt16TypeInContext(bld->gallivm->context),
+                                0xffff, 0);
+         return lp_build_intrinsic(builder, "llvm.x86.avx512.rsqrt14.ps.512",
+                                   bld->vec_type, args, 3, 0);
+      }
       else {
          intrinsic = "llvm.x86.avx.rsqrt.ps.256";
       }
@@ -28,6 +28,7 @@
 
 #include "pipe/p_config.h"
 #include "pipe/p_compiler.h"
+#include "util/u_atomic.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
@@ -105,8 +106,8 @@ enum LLVM_CodeGenOpt_Level {
 
 
 /**
- * Create the LLVM (optimization) pass manager and install
- * relevant optimization passes.
+ * Create the LLVM (optimization) pass manager.  The optimization passes
+ * are installed by add_optimization_passes().
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
@@ -146,7 +147,19 @@ create_pass_manager(struct gallivm_state *gallivm)
    LLVMAddCoroElidePass(gallivm->cgpassmgr);
 #endif
 
-   if ((gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
+   return TRUE;
+}
+
+
+/**
+ * Install the IR optimization passes.  This is deferred until the module
+ * is compiled so that the caller can still pick the fast_compile tier.
+ */
+static void
+add_optimization_passes(struct gallivm_state *gallivm)
+{
+   if (!gallivm->fast_compile &&
+       (gallivm_perf & GALLIVM_PERF_NO_OPT) == 0) {
       /*
        * TODO: Evaluate passes some more - keeping in mind
        * both quality of generated code and compile times.
@@ -186,8 +199,6 @@ create_pass_manager(struct gallivm_state *gallivm)
 #if GALLIVM_HAVE_CORO
    LLVMAddCoroCleanupPass(gallivm->passmgr);
 #endif
-
-   return TRUE;
 }
 
 
@@ -250,10 +261,15 @@ gallivm_free_code(struct gallivm_state *gallivm)
 {
    assert(!gallivm->module);
    assert(!gallivm->engine);
+#if GALLIVM_USE_ORCJIT
+   lp_orc_free_module(gallivm->orc);
+   gallivm->orc = NULL;
+#else
    lp_free_generated_code(gallivm->code);
    gallivm->code = NULL;
    lp_free_memory_manager(gallivm->memorymgr);
    gallivm->memorymgr = NULL;
+#endif
 }
 
 
@@ -265,13 +281,20 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       char *error = NULL;
       int ret;
 
-      if (gallivm_perf & GALLIVM_PERF_NO_OPT) {
+      if ((gallivm_perf & GALLIVM_PERF_NO_OPT) || gallivm->fast_compile) {
          optlevel = None;
       }
       else {
          optlevel = Default;
       }
 
+#if GALLIVM_USE_ORCJIT
+      ret = lp_orc_add_module(&gallivm->orc,
+                              gallivm->cache,
+                              gallivm->module,
+                              (unsigned) optlevel,
+                              &error);
+#else
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     &gallivm->code,
                                                     gallivm->cache,
@@ -279,6 +302,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
                                                     gallivm->memorymgr,
                                                     (unsigned) optlevel,
                                                     &error);
+#endif
       if (ret) {
          _debug_printf("%s\n", error);
          LLVMDisposeMessage(error);
@@ -286,7 +310,7 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       }
    }
 
-   if (0) {
+   if (0 && gallivm->engine) {
        /*
         * Dump the data layout strings.
         */
@@ -355,9 +379,11 @@ init_gallivm_state(struct gallivm_state *gallivm, const char *name,
    if (!gallivm->builder)
       goto fail;
 
+#if !GALLIVM_USE_ORCJIT
    gallivm->memorymgr = lp_get_default_memory_manager();
    if (!gallivm->memorymgr)
       goto fail;
+#endif
 
    /* FIXME: MC-JIT only allows compiling one module at a time, and it must be
     * complete when MC-JIT is created. So defer the MC-JIT engine creation for
@@ -447,10 +473,23 @@ lp_build_init(void)
       util_cpu_caps.has_avx2 = 0;
       util_cpu_caps.has_f16c = 0;
       util_cpu_caps.has_fma = 0;
+      util_cpu_caps.has_avx512f = 0;
+      util_cpu_caps.has_avx512dq = 0;
+      util_cpu_caps.has_avx512bw = 0;
+      util_cpu_caps.has_avx512vl = 0;
    }
 #endif
 
-   if (util_get_cpu_caps()->has_avx2 || util_get_cpu_caps()->has_avx) {
+   if (LLVM_VERSION_MAJOR >= 10 &&
+       util_get_cpu_caps()->has_avx512f &&
+       util_get_cpu_caps()->has_avx512dq &&
+       util_get_cpu_caps()->has_avx512bw &&
+       util_get_cpu_caps()->has_avx512vl) {
+      /* Skylake-SP and later: shade 16 pixels (a whole 4x4 stamp) per op.
+       * Older LLVM versions generate rather poor 512-bit code.
+       */
+      lp_native_vector_width = 512;
+   } else if (util_get_cpu_caps()->has_avx2 || util_get_cpu_caps()->has_avx) {
       lp_native_vector_width = 256;
    } else {
       /* Leave it at 128, even when no SIMD extensions are available.
@@ -566,6 +605,74 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Make \p sym of a compiled module resolve to \p addr.  Must be called
+ * before any function of the module is looked up.
+ */
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm,
+                           LLVMValueRef sym, void *addr)
+{
+#if GALLIVM_USE_ORCJIT
+   assert(gallivm->orc);
+   lp_orc_add_symbol(gallivm->orc, LLVMGetValueName(sym), addr);
+#else
+   assert(gallivm->engine);
+   LLVMAddGlobalMapping(gallivm->engine, sym, addr);
+#endif
+}
+
+
+/**
+ * Get the machine code of a function of a compiled module.
+ */
+static void *
+get_function_code(struct gallivm_state *gallivm, LLVMValueRef func)
+{
+#if GALLIVM_USE_ORCJIT
+   assert(gallivm->orc);
+   return lp_orc_lookup(gallivm->orc, LLVMGetValueName(func));
+#else
+   assert(gallivm->engine);
+   return LLVMGetPointerToGlobal(gallivm->engine, func);
+#endif
+}
+
+
+/**
+ * Bytes of code and data the compiled module keeps alive.  With MCJIT this
+ * is only known once functions have been looked up.
+ */
+size_t
+gallivm_get_code_size(const struct gallivm_state *gallivm)
+{
+#if GALLIVM_USE_ORCJIT
+   return lp_orc_module_size(gallivm->orc);
+#else
+   return lp_generated_code_size(gallivm->code);
+#endif
+}
+
+
+/**
+ * Account variant code entering (size > 0) or leaving a cache.  The budget
+ * may be shared between threads.
+ */
+void
+gallivm_budget_add(struct gallivm_variant_budget *budget, int64_t size)
+{
+   if (budget)
+      p_atomic_add(&budget->used, size);
+}
+
+
+boolean
+gallivm_budget_exceeded(const struct gallivm_variant_budget *budget)
+{
+   return budget && p_atomic_read(&budget->used) > budget->max;
+}
+
+
 /**
  * Compile a module.
  * This does IR optimization on all functions in the module.
@@ -610,6 +717,7 @@ gallivm_compile_module(struct gallivm_state *gallivm)
    LLVMRunPassManager(gallivm->cgpassmgr, gallivm->module);
 #endif
    /* Run optimization passes */
+   add_optimization_passes(gallivm);
    LLVMInitializeFunctionPassManager(gallivm->passmgr);
    func = LLVMGetFirstFunction(gallivm->module);
    while (func) {
@@ -655,17 +763,28 @@ gallivm_compile_module(struct gallivm_state *gallivm)
     * lp_build_create_jit_compiler_for_module()
     */
  skip_cached:
+#if GALLIVM_USE_ORCJIT
+   /* The module is compiled with the JIT's own data layout, see
+    * lp_orc_add_module().
+    */
+   assert(!gallivm->orc);
+   if (!init_gallivm_engine(gallivm)) {
+      assert(0);
+   }
+   assert(gallivm->orc);
+#else
    LLVMSetDataLayout(gallivm->module, "");
    assert(!gallivm->engine);
    if (!init_gallivm_engine(gallivm)) {
       assert(0);
    }
    assert(gallivm->engine);
+#endif
 
    ++gallivm->compiled;
 
    if (gallivm->debug_printf_hook)
-      LLVMAddGlobalMapping(gallivm->engine, gallivm->debug_printf_hook, debug_printf);
+      gallivm_add_global_mapping(gallivm, gallivm->debug_printf_hook, debug_printf);
 
    if (gallivm_debug & GALLIVM_DEBUG_ASM) {
       LLVMValueRef llvm_func = LLVMGetFirstFunction(gallivm->module);
@@ -677,8 +796,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
           * LLVMGetPointerToGlobal() will abort otherwise.
           */
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
-            lp_disassemble(llvm_func, func_code);
+            void *func_code = get_function_code(gallivm, llvm_func);
+            if (func_code)
+               lp_disassemble(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
       }
@@ -690,8 +810,9 @@ gallivm_compile_module(struct gallivm_state *gallivm)
 
       while (llvm_func) {
          if (!LLVMIsDeclaration(llvm_func)) {
-            void *func_code = LLVMGetPointerToGlobal(gallivm->engine, llvm_func);
-            lp_profile(llvm_func, func_code);
+            void *func_code = get_function_code(gallivm, llvm_func);
+            if (func_code)
+               lp_profile(llvm_func, func_code);
          }
          llvm_func = LLVMGetNextFunction(llvm_func);
       }
@@ -710,12 +831,11 @@ gallivm_jit_function(struct gallivm_state *gallivm,
    int64_t time_begin = 0;
 
    assert(gallivm->compiled);
-   assert(gallivm->engine);
 
    if (gallivm_debug & GALLIVM_DEBUG_PERF)
       time_begin = os_time_get();
 
-   code = LLVMGetPointerToGlobal(gallivm->engine, func);
+   code = get_function_code(gallivm, func);
    assert(code);
    jit_func = pointer_to_func(code);
 
@@ -40,6 +40,19 @@ extern "C" {
 #endif
 
 struct lp_cached_code;
+struct lp_orc_module;
+
+/**
+ * JIT memory budget shared by several caches of compiled shader variants.
+ * Each cache adds the code size of the variants on its LRU list to \c used
+ * and evicts its least recently used variants while it exceeds \c max.
+ */
+struct gallivm_variant_budget
+{
+   uint64_t used;
+   uint64_t max;
+};
+
 struct gallivm_state
 {
    char *module_name;
@@ -52,8 +65,11 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_orc_module *orc;
    struct lp_cached_code *cache;
    unsigned compiled;
+   /** Trade code quality for compile time, set before compiling. */
+   boolean fast_compile;
    LLVMValueRef coro_malloc_hook;
    LLVMValueRef coro_free_hook;
    LLVMValueRef debug_printf_hook;
@@ -85,6 +101,19 @@ func_pointer
 gallivm_jit_function(struct gallivm_state *gallivm,
                      LLVMValueRef func);
 
+void
+gallivm_add_global_mapping(struct gallivm_state *gallivm,
+                           LLVMValueRef sym, void *addr);
+
+size_t
+gallivm_get_code_size(const struct gallivm_state *gallivm);
+
+void
+gallivm_budget_add(struct gallivm_variant_budget *budget, int64_t size);
+
+boolean
+gallivm_budget_exceeded(const struct gallivm_variant_budget *budget);
+
 unsigned gallivm_get_perf_flags(void);
 
 #ifdef __cplusplus
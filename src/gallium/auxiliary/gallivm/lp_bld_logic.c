@@ -321,7 +321,9 @@ lp_build_select(struct lp_build_context *bld,
       res = LLVMBuildSelect(builder, mask, a, b, "");
    }
    else if (LLVMIsConstant(mask) ||
-            LLVMGetInstructionOpcode(mask) == LLVMSExt) {
+            LLVMGetInstructionOpcode(mask) == LLVMSExt ||
+            (util_get_cpu_caps()->has_avx512f &&
+             type.width * type.length == 512)) {
       /* Generate a vector select.
        *
        * Using vector selects should avoid emitting intrinsics hence avoid
@@ -330,6 +332,8 @@ lp_build_select(struct lp_build_context *bld,
        * the mask is not the result of a comparison.
        * XXX: Even if the instruction was an SExt, this may still produce
        * terrible code. Try piglit stencil-twoside.
+       * With AVX-512 any mask can be moved into a k-register and used by a
+       * masked move, so always do this for 512-bit vectors.
        */
 
       /* Convert the mask to a vector of booleans.
@@ -64,6 +64,13 @@
 #include <llvm/Support/PrettyStackTrace.h>
 #include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/Support/TargetSelect.h>
+#if GALLIVM_USE_ORCJIT
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
+#include <llvm/Support/Memory.h>
+#endif
 
 #if LLVM_VERSION_MAJOR < 11
 #include <llvm/IR/CallSite.h>
@@ -87,6 +94,18 @@
 #include "pipe/p_config.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_math.h"
+
+#if GALLIVM_USE_ORCJIT
+#include <atomic>
+#include <mutex>
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#include "util/anon_file.h"
+#include "util/vma.h"
+#endif
+#endif
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
@@ -246,9 +265,11 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
       typedef std::vector<void *> Vec;
       Vec FunctionBody, ExceptionTable;
       BaseMemoryManager *TheMM;
+      size_t Size;
 
       GeneratedCode(BaseMemoryManager *MM) {
          TheMM = MM;
+         Size = 0;
       }
 
       ~GeneratedCode() {
@@ -283,6 +304,29 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
          delete (GeneratedCode *) code;
       }
 
+      static size_t getGeneratedCodeSize(struct lp_generated_code *code) {
+         return ((GeneratedCode *) code)->Size;
+      }
+
+      virtual uint8_t *allocateCodeSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+                                           llvm::StringRef SectionName) {
+         code->Size += Size;
+         return DelegatingJITMemoryManager::allocateCodeSection(
+            Size, Alignment, SectionID, SectionName);
+      }
+
+      virtual uint8_t *allocateDataSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+                                           llvm::StringRef SectionName,
+                                           bool IsReadOnly) {
+         code->Size += Size;
+         return DelegatingJITMemoryManager::allocateDataSection(
+            Size, Alignment, SectionID, SectionName, IsReadOnly);
+      }
+
       virtual void deallocateFunctionBody(void *Body) {
          // remember for later deallocation
          code->FunctionBody.push_back(Body);
@@ -321,61 +365,15 @@ public:
 };
 
 /**
- * Same as LLVMCreateJITCompilerForModule, but:
- * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
- *
- * See also:
- * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
- * - llvm/tools/lli/lli.cpp
- * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ * Host CPU name and feature attributes to generate code for, i.e. what
+ * would be passed to llc as -mcpu and -mattr.
  */
-extern "C"
-LLVMBool
-lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
-                                        lp_generated_code **OutCode,
-                                        struct lp_cached_code *cache_out,
-                                        LLVMModuleRef M,
-                                        LLVMMCJITMemoryManagerRef CMM,
-                                        unsigned OptLevel,
-                                        char **OutError)
+static void
+lp_build_host_target(llvm::StringRef &MCPU,
+                     llvm::SmallVector<std::string, 16> &MAttrs)
 {
    using namespace llvm;
 
-   std::string Error;
-   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
-
-   /**
-    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
-    * friends for configuring code generation options, like stack alignment.
-    */
-   TargetOptions options;
-#if defined(PIPE_ARCH_X86) && LLVM_VERSION_MAJOR < 13
-   options.StackAlignmentOverride = 4;
-#endif
-
-   builder.setEngineKind(EngineKind::JIT)
-          .setErrorStr(&Error)
-          .setTargetOptions(options)
-          .setOptLevel((CodeGenOpt::Level)OptLevel);
-
-#ifdef _WIN32
-    /*
-     * MCJIT works on Windows, but currently only through ELF object format.
-     *
-     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
-     * different strings for MinGW/MSVC, so better play it safe and be
-     * explicit.
-     */
-#  ifdef _WIN64
-    LLVMSetTarget(M, "x86_64-pc-win32-elf");
-#  else
-    LLVMSetTarget(M, "i686-pc-win32-elf");
-#  endif
-#endif
-
-   llvm::SmallVector<std::string, 16> MAttrs;
-
 #if LLVM_VERSION_MAJOR >= 4 && (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64) || defined(PIPE_ARCH_ARM))
    /* llvm-3.3+ implements sys::getHostCPUFeatures for Arm
     * and llvm-3.7+ for x86, which allows us to enable/disable
@@ -464,7 +462,6 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 #endif
 #endif
 
-   builder.setMAttrs(MAttrs);
 
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       int n = MAttrs.size();
@@ -476,7 +473,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       }
    }
 
-   StringRef MCPU = llvm::sys::getHostCPUName();
+   MCPU = llvm::sys::getHostCPUName();
    /*
     * The cpu bits are no longer set automatically, so need to set mcpu manually.
     * Note that the MAttrs set above will be sort of ignored (since we should
@@ -490,19 +487,7 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
     * can't handle. Not entirely sure if we really need to do anything yet.
     */
 
-#ifdef PIPE_ARCH_PPC_64
-   /*
-    * Large programs, e.g. gnome-shell and firefox, may tax the addressability
-    * of the Medium code model once dynamically generated JIT-compiled shader
-    * programs are linked in and relocated.  Yet the default code model as of
-    * LLVM 8 is Medium or even Small.
-    * The cost of changing from Medium to Large is negligible:
-    * - an additional 8-byte pointer stored immediately before the shader entrypoint;
-    * - change an add-immediate (addis) instruction to a load (ld).
-    */
-   builder.setCodeModel(CodeModel::Large);
-
-#if UTIL_ARCH_LITTLE_ENDIAN
+#if defined(PIPE_ARCH_PPC_64) && UTIL_ARCH_LITTLE_ENDIAN
    /*
     * Versions of LLVM prior to 4.0 lacked a table entry for "POWER8NVL",
     * resulting in (big-endian) "generic" being returned on
@@ -515,11 +500,85 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    if (MCPU == "generic")
       MCPU = "pwr8";
 #endif
-#endif
-   builder.setMCPU(MCPU);
    if (gallivm_debug & (GALLIVM_DEBUG_IR | GALLIVM_DEBUG_ASM | GALLIVM_DEBUG_DUMP_BC)) {
       debug_printf("llc -mcpu option: %s\n", MCPU.str().c_str());
    }
+}
+
+
+/**
+ * Same as LLVMCreateJITCompilerForModule, but:
+ * - allows using MCJIT and enabling AVX feature where available.
+ * - set target options
+ *
+ * See also:
+ * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
+ * - llvm/tools/lli/lli.cpp
+ * - http://markmail.org/message/ttkuhvgj4cxxy2on#query:+page:1+mid:aju2dggerju3ivd3+state:results
+ */
+extern "C"
+LLVMBool
+lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
+                                        lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
+                                        LLVMModuleRef M,
+                                        LLVMMCJITMemoryManagerRef CMM,
+                                        unsigned OptLevel,
+                                        char **OutError)
+{
+   using namespace llvm;
+
+   std::string Error;
+   EngineBuilder builder(std::unique_ptr<Module>(unwrap(M)));
+
+   /**
+    * LLVM 3.1+ haven't more "extern unsigned llvm::StackAlignmentOverride" and
+    * friends for configuring code generation options, like stack alignment.
+    */
+   TargetOptions options;
+#if defined(PIPE_ARCH_X86) && LLVM_VERSION_MAJOR < 13
+   options.StackAlignmentOverride = 4;
+#endif
+
+   builder.setEngineKind(EngineKind::JIT)
+          .setErrorStr(&Error)
+          .setTargetOptions(options)
+          .setOptLevel((CodeGenOpt::Level)OptLevel);
+
+#ifdef _WIN32
+    /*
+     * MCJIT works on Windows, but currently only through ELF object format.
+     *
+     * XXX: We could use `LLVM_HOST_TRIPLE "-elf"` but LLVM_HOST_TRIPLE has
+     * different strings for MinGW/MSVC, so better play it safe and be
+     * explicit.
+     */
+#  ifdef _WIN64
+    LLVMSetTarget(M, "x86_64-pc-win32-elf");
+#  else
+    LLVMSetTarget(M, "i686-pc-win32-elf");
+#  endif
+#endif
+
+   llvm::SmallVector<std::string, 16> MAttrs;
+   StringRef MCPU;
+
+   lp_build_host_target(MCPU, MAttrs);
+   builder.setMAttrs(MAttrs);
+
+#ifdef PIPE_ARCH_PPC_64
+   /*
+    * Large programs, e.g. gnome-shell and firefox, may tax the addressability
+    * of the Medium code model once dynamically generated JIT-compiled shader
+    * programs are linked in and relocated.  Yet the default code model as of
+    * LLVM 8 is Medium or even Small.
+    * The cost of changing from Medium to Large is negligible:
+    * - an additional 8-byte pointer stored immediately before the shader entrypoint;
+    * - change an add-immediate (addis) instruction to a load (ld).
+    */
+   builder.setCodeModel(CodeModel::Large);
+#endif
+   builder.setMCPU(MCPU);
 
    ShaderMemoryManager *MM = NULL;
    BaseMemoryManager* JMM = reinterpret_cast<BaseMemoryManager*>(CMM);
@@ -562,6 +621,16 @@ lp_free_generated_code(struct lp_generated_code *code)
    ShaderMemoryManager::freeGeneratedCode(code);
 }
 
+/**
+ * Bytes of code and data sections allocated for the module so far.
+ */
+extern "C"
+size_t
+lp_generated_code_size(struct lp_generated_code *code)
+{
+   return code ? ShaderMemoryManager::getGeneratedCodeSize(code) : 0;
+}
+
 extern "C"
 LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager()
@@ -605,3 +674,475 @@ lp_set_module_stack_alignment_override(LLVMModuleRef MRef, unsigned align)
    M->setOverrideStackAlignment(align);
 #endif
 }
+
+
+#if GALLIVM_USE_ORCJIT
+
+#if defined(__linux__)
+
+/*
+ * Code memory shared by all modules of the process.
+ *
+ * A SectionMemoryManager maps at least one page per kind of section for
+ * every module, so thousands of small shader variants mostly waste their
+ * code pages.  Here modules are packed into large chunks instead.  Every
+ * chunk is an anonymous file mapped twice: the linker writes through the
+ * read/write view while the code runs from the read/execute view, so no
+ * page is ever both writable and executable and modules can be added and
+ * freed while others are running.
+ */
+class CodeArena {
+   static const uint64_t ChunkSize = 2 * 1024 * 1024;
+   static const uint64_t MinAlign = 16;
+
+   struct Chunk {
+      uint8_t *rw, *rx;
+      uint64_t size;
+   };
+
+   std::mutex mutex;
+   std::vector<Chunk> chunks;
+   struct util_vma_heap heap;
+
+   /* Chunk i occupies [(i + 1) << 32, ...) of the heap's address space, so
+    * the free ranges of different chunks never get merged.
+    */
+   static uint64_t chunkBase(unsigned i) {
+      return (uint64_t)(i + 1) << 32;
+   }
+
+   bool addChunk(uint64_t size) {
+      int fd = os_create_anonymous_file(size, "mesa-jit");
+      if (fd < 0)
+         return false;
+
+      void *rw = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      void *rx = mmap(NULL, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+      close(fd);
+      if (rw == MAP_FAILED || rx == MAP_FAILED) {
+         if (rw != MAP_FAILED)
+            munmap(rw, size);
+         if (rx != MAP_FAILED)
+            munmap(rx, size);
+         return false;
+      }
+
+      Chunk chunk = { (uint8_t *)rw, (uint8_t *)rx, size };
+      chunks.push_back(chunk);
+      if (chunks.size() == 1) {
+         util_vma_heap_init(&heap, chunkBase(0), size);
+         heap.alloc_high = false;
+      } else {
+         util_vma_heap_free(&heap, chunkBase(chunks.size() - 1), size);
+      }
+      return true;
+   }
+
+public:
+   struct Block {
+      uint64_t addr, size;
+      uint8_t *rw, *rx;
+   };
+
+   /* Whether executable shared mappings work at all here. */
+   bool usable() {
+      std::lock_guard<std::mutex> guard(mutex);
+      return !chunks.empty() || addChunk(ChunkSize);
+   }
+
+   bool alloc(uint64_t size, uint64_t align, Block &block) {
+      std::lock_guard<std::mutex> guard(mutex);
+
+      size = align64(MAX2(size, 1), MinAlign);
+      align = MAX2(align, MinAlign);
+
+      uint64_t addr = chunks.empty() ? 0 :
+                      util_vma_heap_alloc(&heap, size, align);
+      if (!addr) {
+         if (!addChunk(align64(size + align, ChunkSize)))
+            return false;
+         addr = util_vma_heap_alloc(&heap, size, align);
+         if (!addr)
+            return false;
+      }
+
+      const Chunk &chunk = chunks[(addr >> 32) - 1];
+      uint64_t offset = addr & 0xffffffff;
+      block.addr = addr;
+      block.size = size;
+      block.rw = chunk.rw + offset;
+      block.rx = chunk.rx + offset;
+      return true;
+   }
+
+   void free(const Block &block) {
+      std::lock_guard<std::mutex> guard(mutex);
+
+      /* Give whole pages back to the system. */
+      const uint64_t page = getpagesize();
+      uintptr_t start = align64((uintptr_t)block.rw, page);
+      uintptr_t end = ((uintptr_t)block.rw + block.size) & ~(page - 1);
+      if (end > start)
+         madvise((void *)start, end - start, MADV_REMOVE);
+
+      util_vma_heap_free(&heap, block.addr, block.size);
+   }
+};
+
+
+/*
+ * Memory manager for one object, allocating its sections from the shared
+ * arena.  Code and read-only data are relocated to their executable view.
+ */
+class ArenaMemoryManager : public llvm::RTDyldMemoryManager {
+   struct Section {
+      CodeArena::Block block;
+      bool writable;
+      bool code;
+   };
+
+   CodeArena &arena;
+   std::vector<Section> sections;
+
+   uint8_t *allocate(uintptr_t size, unsigned align, bool writable, bool code) {
+      Section section;
+      if (!arena.alloc(size, align, section.block))
+         return NULL;
+      section.writable = writable;
+      section.code = code;
+      sections.push_back(section);
+      return section.block.rw;
+   }
+
+public:
+   ArenaMemoryManager(CodeArena &arena) : arena(arena) {
+   }
+
+   virtual ~ArenaMemoryManager() {
+      deregisterEHFrames();
+      for (unsigned i = 0; i < sections.size(); i++)
+         arena.free(sections[i].block);
+   }
+
+   virtual uint8_t *allocateCodeSection(uintptr_t Size,
+                                        unsigned Alignment,
+                                        unsigned SectionID,
+                                        llvm::StringRef SectionName) {
+      return allocate(Size, Alignment, false, true);
+   }
+
+   virtual uint8_t *allocateDataSection(uintptr_t Size,
+                                        unsigned Alignment,
+                                        unsigned SectionID,
+                                        llvm::StringRef SectionName,
+                                        bool IsReadOnly) {
+      return allocate(Size, Alignment, !IsReadOnly, false);
+   }
+
+   virtual void notifyObjectLoaded(llvm::RuntimeDyld &RTDyld,
+                                   const llvm::object::ObjectFile &Obj) {
+      for (unsigned i = 0; i < sections.size(); i++) {
+         if (!sections[i].writable)
+            RTDyld.mapSectionAddress(sections[i].block.rw,
+                                     (uintptr_t)sections[i].block.rx);
+      }
+   }
+
+   virtual bool finalizeMemory(std::string *ErrMsg = 0) {
+      for (unsigned i = 0; i < sections.size(); i++) {
+         if (sections[i].code)
+            llvm::sys::Memory::InvalidateInstructionCache(
+               sections[i].block.rx, sections[i].block.size);
+      }
+      return false;
+   }
+};
+
+#endif /* __linux__ */
+
+
+/*
+ * One ORC LLJIT instance for the whole process.  Every gallivm module is
+ * compiled to an object by the calling thread, with a target machine
+ * reused between modules, and then added to a JITDylib of its own, which
+ * is linked on the first lookup of one of its symbols and removed again
+ * with the module.
+ */
+class LPJit {
+   std::mutex mutex;
+   std::vector<std::unique_ptr<llvm::TargetMachine>> idle_tms;
+   std::atomic<unsigned> next_id;
+
+public:
+   std::unique_ptr<llvm::orc::LLJIT> lljit;
+   llvm::orc::JITTargetMachineBuilder jtmb;
+#if defined(__linux__)
+   CodeArena arena;
+#endif
+
+   LPJit(llvm::orc::JITTargetMachineBuilder builder)
+      : next_id(0), jtmb(builder) {
+   }
+
+   std::unique_ptr<llvm::TargetMachine> takeTargetMachine() {
+      {
+         std::lock_guard<std::mutex> guard(mutex);
+         if (!idle_tms.empty()) {
+            std::unique_ptr<llvm::TargetMachine> tm = std::move(idle_tms.back());
+            idle_tms.pop_back();
+            return tm;
+         }
+      }
+
+      llvm::Expected<std::unique_ptr<llvm::TargetMachine>> tm =
+         jtmb.createTargetMachine();
+      if (!tm) {
+         llvm::consumeError(tm.takeError());
+         return NULL;
+      }
+      return std::move(*tm);
+   }
+
+   void returnTargetMachine(std::unique_ptr<llvm::TargetMachine> tm) {
+      std::lock_guard<std::mutex> guard(mutex);
+      idle_tms.push_back(std::move(tm));
+   }
+
+   std::string uniqueName(const char *name) {
+      return std::string(name ? name : "module") + "." +
+             std::to_string(next_id++);
+   }
+};
+
+static LPJit *lp_jit;
+static std::once_flag lp_jit_once_flag;
+
+static void
+lp_jit_create(unsigned OptLevel)
+{
+   using namespace llvm;
+   using namespace llvm::orc;
+
+   llvm::SmallVector<std::string, 16> MAttrs;
+   StringRef MCPU;
+
+   call_once(&init_native_targets_once_flag, init_native_targets);
+
+   lp_build_host_target(MCPU, MAttrs);
+
+   Triple TT(sys::getProcessTriple());
+#ifdef _WIN32
+   /* Same as for MCJIT, see lp_build_create_jit_compiler_for_module(). */
+   TT.setObjectFormat(Triple::ELF);
+#endif
+
+   JITTargetMachineBuilder JTMB(TT);
+   JTMB.setCPU(MCPU.str());
+   JTMB.addFeatures(std::vector<std::string>(MAttrs.begin(), MAttrs.end()));
+   JTMB.setCodeGenOptLevel((CodeGenOpt::Level)OptLevel);
+#ifdef PIPE_ARCH_PPC_64
+   JTMB.setCodeModel(CodeModel::Large);
+#endif
+
+   LPJit *jit = new LPJit(JTMB);
+
+   LLJITBuilder builder;
+   builder.setJITTargetMachineBuilder(JTMB);
+#if defined(__linux__)
+   if (jit->arena.usable()) {
+      builder.setObjectLinkingLayerCreator(
+         [jit](ExecutionSession &ES, const Triple &TT)
+            -> Expected<std::unique_ptr<ObjectLayer>> {
+            return std::make_unique<RTDyldObjectLinkingLayer>(ES,
+#if LLVM_VERSION_MAJOR >= 17
+               [jit](const MemoryBuffer &) {
+#else
+               [jit]() {
+#endif
+                  return std::make_unique<ArenaMemoryManager>(jit->arena);
+               });
+         });
+   }
+#endif
+
+   Expected<std::unique_ptr<LLJIT>> lljit = builder.create();
+   if (!lljit) {
+      debug_printf("gallivm: failed to create ORC JIT: %s\n",
+                   toString(lljit.takeError()).c_str());
+      delete jit;
+      return;
+   }
+   jit->lljit = std::move(*lljit);
+
+   /* Resolve libc/libm calls of the generated code. */
+   Expected<std::unique_ptr<DynamicLibrarySearchGenerator>> generator =
+      DynamicLibrarySearchGenerator::GetForCurrentProcess(
+         jit->lljit->getDataLayout().getGlobalPrefix());
+   if (!generator) {
+      consumeError(generator.takeError());
+      delete jit;
+      return;
+   }
+   jit->lljit->getMainJITDylib().addGenerator(std::move(*generator));
+
+   lp_jit = jit;
+}
+
+
+struct lp_orc_module {
+   llvm::orc::JITDylib *JD;
+   size_t size;
+};
+
+
+/**
+ * Compile a module to an object (or take it from the shader cache) and
+ * make it available for lookups.  The module itself stays with the caller.
+ */
+extern "C" int
+lp_orc_add_module(struct lp_orc_module **OutModule,
+                  struct lp_cached_code *cache_out,
+                  LLVMModuleRef M,
+                  unsigned OptLevel,
+                  char **OutError)
+{
+   using namespace llvm;
+
+   std::call_once(lp_jit_once_flag, lp_jit_create, OptLevel);
+   if (!lp_jit) {
+      *OutError = strdup("ORC JIT unavailable");
+      return 1;
+   }
+
+   Module *Mod = unwrap(M);
+   std::unique_ptr<MemoryBuffer> Obj;
+
+   if (cache_out && cache_out->data_size) {
+      Obj = MemoryBuffer::getMemBufferCopy(
+         StringRef((const char *)cache_out->data, cache_out->data_size),
+         Mod->getModuleIdentifier());
+   } else {
+      std::unique_ptr<TargetMachine> TM = lp_jit->takeTargetMachine();
+      if (!TM) {
+         *OutError = strdup("failed to create target machine");
+         return 1;
+      }
+      /* The pool is shared by all tiers, see gallivm_state::fast_compile. */
+      TM->setOptLevel((CodeGenOpt::Level)OptLevel);
+
+      Mod->setDataLayout(TM->createDataLayout());
+      Mod->setTargetTriple(TM->getTargetTriple().str());
+
+      Expected<std::unique_ptr<MemoryBuffer>> Res =
+         orc::SimpleCompiler(*TM)(*Mod);
+      lp_jit->returnTargetMachine(std::move(TM));
+      if (!Res) {
+         *OutError = strdup(toString(Res.takeError()).c_str());
+         return 1;
+      }
+      Obj = std::move(*Res);
+
+      if (cache_out) {
+         cache_out->data = malloc(Obj->getBufferSize());
+         if (cache_out->data) {
+            cache_out->data_size = Obj->getBufferSize();
+            memcpy(cache_out->data, Obj->getBufferStart(), cache_out->data_size);
+         }
+      }
+   }
+
+   size_t ObjSize = Obj->getBufferSize();
+   orc::LLJIT &lljit = *lp_jit->lljit;
+   Expected<orc::JITDylib &> JD =
+      lljit.createJITDylib(lp_jit->uniqueName(Mod->getModuleIdentifier().c_str()));
+   if (!JD) {
+      *OutError = strdup(toString(JD.takeError()).c_str());
+      return 1;
+   }
+   JD->addToLinkOrder(lljit.getMainJITDylib());
+
+   if (Error Err = lljit.addObjectFile(*JD, std::move(Obj))) {
+      *OutError = strdup(toString(std::move(Err)).c_str());
+      consumeError(lljit.getExecutionSession().removeJITDylib(*JD));
+      return 1;
+   }
+
+   *OutModule = new lp_orc_module;
+   (*OutModule)->JD = &*JD;
+   (*OutModule)->size = ObjSize;
+   return 0;
+}
+
+
+/**
+ * Size of the module's object, which is close to what linking it takes.
+ */
+extern "C" size_t
+lp_orc_module_size(struct lp_orc_module *module)
+{
+   return module ? module->size : 0;
+}
+
+
+/**
+ * Define a symbol the module references.  Must happen before the first
+ * lookup.
+ */
+extern "C" void
+lp_orc_add_symbol(struct lp_orc_module *module, const char *name, void *addr)
+{
+   using namespace llvm;
+   using namespace llvm::orc;
+
+   orc::LLJIT &lljit = *lp_jit->lljit;
+   SymbolMap symbols;
+#if LLVM_VERSION_MAJOR >= 17
+   symbols[lljit.mangleAndIntern(name)] =
+      ExecutorSymbolDef(ExecutorAddr::fromPtr(addr), JITSymbolFlags::Exported);
+#else
+   symbols[lljit.mangleAndIntern(name)] =
+      JITEvaluatedSymbol(pointerToJITTargetAddress(addr),
+                         JITSymbolFlags::Exported);
+#endif
+
+   if (Error Err = module->JD->define(absoluteSymbols(std::move(symbols)))) {
+      debug_printf("gallivm: failed to define %s: %s\n", name,
+                   toString(std::move(Err)).c_str());
+   }
+}
+
+
+extern "C" void *
+lp_orc_lookup(struct lp_orc_module *module, const char *name)
+{
+   using namespace llvm;
+
+   auto Sym = lp_jit->lljit->lookup(*module->JD, name);
+   if (!Sym) {
+      consumeError(Sym.takeError());
+      return NULL;
+   }
+#if LLVM_VERSION_MAJOR >= 15
+   return Sym->toPtr<void *>();
+#else
+   return jitTargetAddressToPointer<void *>(Sym->getAddress());
+#endif
+}
+
+
+extern "C" void
+lp_orc_free_module(struct lp_orc_module *module)
+{
+   if (!module)
+      return;
+
+   llvm::Error Err =
+      lp_jit->lljit->getExecutionSession().removeJITDylib(*module->JD);
+   if (Err) {
+      debug_printf("gallivm: failed to free module: %s\n",
+                   llvm::toString(std::move(Err)).c_str());
+   }
+   delete module;
+}
+
+#endif /* GALLIVM_USE_ORCJIT */
@@ -77,6 +77,9 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
 extern void
 lp_free_generated_code(struct lp_generated_code *code);
 
+extern size_t
+lp_generated_code_size(struct lp_generated_code *code);
+
 extern LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager();
 
@@ -94,6 +97,29 @@ lp_free_objcache(void *objcache);
 
 void
 lp_set_module_stack_alignment_override(LLVMModuleRef M, unsigned align);
+
+#if GALLIVM_USE_ORCJIT
+struct lp_orc_module;
+
+extern int
+lp_orc_add_module(struct lp_orc_module **OutModule,
+                  struct lp_cached_code *cache_out,
+                  LLVMModuleRef M,
+                  unsigned OptLevel,
+                  char **OutError);
+
+extern void
+lp_orc_add_symbol(struct lp_orc_module *module, const char *name, void *addr);
+
+extern void *
+lp_orc_lookup(struct lp_orc_module *module, const char *name);
+
+extern void
+lp_orc_free_module(struct lp_orc_module *module);
+
+extern size_t
+lp_orc_module_size(struct lp_orc_module *module);
+#endif
 #ifdef __cplusplus
 }
 #endif
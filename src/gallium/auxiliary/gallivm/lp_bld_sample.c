@@ -2060,16 +2060,59 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Compute the partial offset of a texel in a texture whose 2D images are
+ * stored in 4x4 texel tiles (lp_static_texture_state::tiled).
+ *
+ * Tiles are laid out row by row, and so are the texels within a tile, which
+ * keeps the offset separable:
+ *   x part: ((x & ~3) * 4 + (x & 3)) * texel_size
+ *   y part: (y & ~3) * row_stride + (y & 3) * 4 * texel_size
+ *
+ * @param texel_size  texel size in bytes
+ * @param coord       coordinate in texels
+ * @param row_stride  row stride in bytes for the y part, NULL for the x part
+ */
+LLVMValueRef
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_size,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef row_stride)
+{
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef tile_mask = lp_build_const_int_vec(bld->gallivm, bld->type, ~3);
+   LLVMValueRef texel_mask = lp_build_const_int_vec(bld->gallivm, bld->type, 3);
+   LLVMValueRef tile, texel;
+
+   tile = LLVMBuildAnd(builder, coord, tile_mask, "");
+   texel = LLVMBuildAnd(builder, coord, texel_mask, "");
+
+   if (row_stride) {
+      tile = lp_build_mul(bld, tile, row_stride);
+      texel = lp_build_mul_imm(bld, texel, 4 * texel_size);
+      return lp_build_add(bld, tile, texel);
+   }
+   else {
+      tile = lp_build_shl_imm(bld, tile, 2);
+      texel = LLVMBuildOr(builder, tile, texel, "");
+      return lp_build_mul_imm(bld, texel, texel_size);
+   }
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
  * x, y, z, y_stride, z_stride are vectors, and they refer to pixels.
+ * If tiled is set the x and y offsets follow the 4x4 tiled layout, which is
+ * only used for formats with 1x1 pixel blocks.
  *
  * Returns the relative offset and i,j sub-block coordinates
  */
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2082,6 +2125,28 @@ lp_build_sample_offset(struct lp_build_context *bld,
    LLVMValueRef x_stride;
    LLVMValueRef offset;
 
+   if (tiled) {
+      unsigned texel_size = format_desc->block.bits/8;
+
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+
+      offset = lp_build_sample_tiled_partial_offset(bld, texel_size, x, NULL);
+      if (y && y_stride) {
+         offset = lp_build_add(bld, offset,
+                               lp_build_sample_tiled_partial_offset(bld,
+                                                                    texel_size,
+                                                                    y, y_stride));
+      }
+      if (z && z_stride) {
+         offset = lp_build_add(bld, offset, lp_build_mul(bld, z, z_stride));
+      }
+
+      *out_offset = offset;
+      *out_i = bld->zero;
+      *out_j = bld->zero;
+      return;
+   }
+
    x_stride = lp_build_const_vec(bld->gallivm, bld->type,
                                  format_desc->block.bits/8);
 
@@ -174,6 +174,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< 2D images stored in 4x4 texel tiles */
 };
 
 
@@ -664,9 +665,17 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+LLVMValueRef
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_size,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef row_stride);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -59,9 +59,41 @@
 #include "lp_bld_quad.h"
 
 
+/**
+ * Compute the partial offset of a pixel block along one coordinate axis.
+ * The s and t axes of tiled textures follow the 4x4 tiled layout, where the
+ * stride of the t axis is the row stride.
+ * \param axis  0, 1 or 2 for the s, t or r coordinate
+ */
+static void
+lp_build_sample_axis_offset(struct lp_build_sample_context *bld,
+                            unsigned axis,
+                            unsigned block_length,
+                            LLVMValueRef coord,
+                            LLVMValueRef stride,
+                            LLVMValueRef *out_offset,
+                            LLVMValueRef *out_i)
+{
+   struct lp_build_context *int_coord_bld = &bld->int_coord_bld;
+
+   if (bld->static_texture_state->tiled && axis < 2) {
+      *out_offset = lp_build_sample_tiled_partial_offset(int_coord_bld,
+                                                         bld->format_desc->block.bits/8,
+                                                         coord,
+                                                         axis ? stride : NULL);
+      *out_i = int_coord_bld->zero;
+   }
+   else {
+      lp_build_sample_partial_offset(int_coord_bld, block_length, coord, stride,
+                                     out_offset, out_i);
+   }
+}
+
+
 /**
  * Build LLVM code for texture coord wrapping, for nearest filtering,
  * for scaled integer texcoords.
+ * \param axis  0, 1 or 2 for the s, t or r coordinate
  * \param block_length  is the length of the pixel block along the
  *                      coordinate axis
  * \param coord  the incoming texcoord (s,t or r) scaled to the texture size
@@ -76,6 +108,7 @@
  */
 static void
 lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
+                                 unsigned axis,
                                  unsigned block_length,
                                  LLVMValueRef coord,
                                  LLVMValueRef coord_f,
@@ -126,8 +159,8 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
       assert(0);
    }
 
-   lp_build_sample_partial_offset(int_coord_bld, block_length, coord, stride,
-                                  out_offset, out_i);
+   lp_build_sample_axis_offset(bld, axis, block_length, coord, stride,
+                               out_offset, out_i);
 }
 
 
@@ -212,6 +245,7 @@ lp_build_coord_repeat_npot_linear_int(struct lp_build_sample_context *bld,
  */
 static void
 lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
+                                unsigned axis,
                                 unsigned block_length,
                                 LLVMValueRef coord0,
                                 LLVMValueRef *weight_i,
@@ -232,15 +266,16 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
    LLVMValueRef lmask, umask, mask;
 
    /*
-    * If the pixel block covers more than one pixel then there is no easy
-    * way to calculate offset1 relative to offset0. Instead, compute them
-    * independently. Otherwise, try to compute offset0 and offset1 with
-    * a single stride multiplication.
+    * If the pixel block covers more than one pixel, or the texture is tiled,
+    * then there is no easy way to calculate offset1 relative to offset0.
+    * Instead, compute them independently. Otherwise, try to compute offset0
+    * and offset1 with a single stride multiplication.
     */
 
    length_minus_one = lp_build_sub(int_coord_bld, length, int_coord_bld->one);
 
-   if (block_length != 1) {
+   if (block_length != 1 ||
+       (bld->static_texture_state->tiled && axis < 2)) {
       LLVMValueRef coord1;
       switch(wrap_mode) {
       case PIPE_TEX_WRAP_REPEAT:
@@ -289,10 +324,10 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
          coord1 = int_coord_bld->zero;
          break;
       }
-      lp_build_sample_partial_offset(int_coord_bld, block_length, coord0, stride,
-                                     offset0, i0);
-      lp_build_sample_partial_offset(int_coord_bld, block_length, coord1, stride,
-                                     offset1, i1);
+      lp_build_sample_axis_offset(bld, axis, block_length, coord0, stride,
+                                  offset0, i0);
+      lp_build_sample_axis_offset(bld, axis, block_length, coord1, stride,
+                                  offset1, i1);
       return;
    }
 
@@ -506,6 +541,7 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
 
    /* Do texcoord wrapping, compute texel offset */
    lp_build_sample_wrap_nearest_int(bld,
+                                    0,
                                     bld->format_desc->block.width,
                                     s_ipart, s_float,
                                     width_vec, x_stride, offsets[0],
@@ -516,6 +552,7 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
    if (dims >= 2) {
       LLVMValueRef y_offset;
       lp_build_sample_wrap_nearest_int(bld,
+                                       1,
                                        bld->format_desc->block.height,
                                        t_ipart, t_float,
                                        height_vec, row_stride_vec, offsets[1],
@@ -526,6 +563,7 @@ lp_build_sample_image_nearest(struct lp_build_sample_context *bld,
       if (dims >= 3) {
          LLVMValueRef z_offset;
          lp_build_sample_wrap_nearest_int(bld,
+                                          2,
                                           1, /* block length (depth) */
                                           r_ipart, r_float,
                                           depth_vec, img_stride_vec, offsets[2],
@@ -872,6 +910,7 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
 
    /* do texcoord wrapping and compute texel offsets */
    lp_build_sample_wrap_linear_int(bld,
+                                   0,
                                    bld->format_desc->block.width,
                                    s_ipart, &s_fpart, s_float,
                                    width_vec, x_stride, offsets[0],
@@ -902,6 +941,7 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
 
    if (dims >= 2) {
       lp_build_sample_wrap_linear_int(bld,
+                                      1,
                                       bld->format_desc->block.height,
                                       t_ipart, &t_fpart, t_float,
                                       height_vec, y_stride, offsets[1],
@@ -922,6 +962,7 @@ lp_build_sample_image_linear(struct lp_build_sample_context *bld,
 
    if (dims >= 3) {
       lp_build_sample_wrap_linear_int(bld,
+                                      2,
                                       1, /* block length (depth) */
                                       r_ipart, &r_fpart, r_float,
                                       depth_vec, z_stride, offsets[2],
@@ -32,11 +32,26 @@
 #include "pipe/p_defines.h"
 #include "util/u_inlines.h"
 #include "pipe/p_context.h"
+#include "pipe/p_screen.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 
 #include "u_upload_mgr.h"
 
+/* Number of outstanding fences tracked in ring mode. Older fences are
+ * merged once this is exceeded.
+ */
+#define U_UPLOAD_RING_MAX_FENCES 16
+
+/* Ring mode doubles the buffer when it runs out of reclaimable space,
+ * up to this size.
+ */
+#define U_UPLOAD_RING_MAX_SIZE (64 * 1024 * 1024)
+
+struct u_upload_ring_fence {
+   struct pipe_fence_handle *fence;
+   uint64_t end;    /* Ring position following the last byte it covers. */
+};
 
 struct u_upload_mgr {
    struct pipe_context *pipe;
@@ -55,6 +70,18 @@ struct u_upload_mgr {
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
    int buffer_private_refcount;
+
+   /* Ring mode. Positions are monotonic byte counts: the buffer offset
+    * of a position is (position - ring_base).
+    */
+   boolean ring;
+   uint64_t ring_base;   /* Position of offset 0 in the current lap. */
+   uint64_t ring_tail;   /* Oldest position that may still be in use. */
+   struct u_upload_ring_fence ring_fences[U_UPLOAD_RING_MAX_FENCES];
+   unsigned ring_first_fence;
+   unsigned ring_num_fences;
+
+   struct u_upload_stats stats;
 };
 
 
@@ -109,6 +136,8 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload)
                                                  upload->flags);
    if (!upload->map_persistent && result->map_persistent)
       u_upload_disable_persistent(result);
+   if (upload->ring)
+      u_upload_enable_ring(result);
 
    return result;
 }
@@ -119,6 +148,135 @@ u_upload_disable_persistent(struct u_upload_mgr *upload)
    upload->map_persistent = FALSE;
    upload->map_flags &= ~(PIPE_MAP_COHERENT | PIPE_MAP_PERSISTENT);
    upload->map_flags |= PIPE_MAP_FLUSH_EXPLICIT;
+   /* The ring relies on the buffer staying mapped across wrap-arounds. */
+   upload->ring = FALSE;
+}
+
+void
+u_upload_enable_ring(struct u_upload_mgr *upload)
+{
+   if (upload->map_persistent)
+      upload->ring = TRUE;
+}
+
+void
+u_upload_get_stats(const struct u_upload_mgr *upload,
+                   struct u_upload_stats *stats)
+{
+   *stats = upload->stats;
+}
+
+void
+u_upload_reset_stats(struct u_upload_mgr *upload)
+{
+   memset(&upload->stats, 0, sizeof(upload->stats));
+}
+
+static void
+u_upload_ring_release_fences(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   while (upload->ring_num_fences) {
+      struct u_upload_ring_fence *f =
+         &upload->ring_fences[upload->ring_first_fence];
+
+      screen->fence_reference(screen, &f->fence, NULL);
+      upload->ring_first_fence =
+         (upload->ring_first_fence + 1) % U_UPLOAD_RING_MAX_FENCES;
+      upload->ring_num_fences--;
+   }
+   upload->ring_first_fence = 0;
+}
+
+/* Advance the ring tail past every region whose fence has signalled. */
+static void
+u_upload_ring_reclaim(struct u_upload_mgr *upload)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+
+   while (upload->ring_num_fences) {
+      struct u_upload_ring_fence *f =
+         &upload->ring_fences[upload->ring_first_fence];
+
+      if (!screen->fence_finish(screen, NULL, f->fence, 0))
+         break;
+
+      upload->ring_tail = f->end;
+      screen->fence_reference(screen, &f->fence, NULL);
+      upload->ring_first_fence =
+         (upload->ring_first_fence + 1) % U_UPLOAD_RING_MAX_FENCES;
+      upload->ring_num_fences--;
+   }
+}
+
+void
+u_upload_fence(struct u_upload_mgr *upload, struct pipe_fence_handle *fence)
+{
+   struct pipe_screen *screen = upload->pipe->screen;
+   uint64_t head = upload->ring_base + upload->offset;
+   struct u_upload_ring_fence *last = NULL;
+
+   if (!upload->ring || !upload->buffer || !fence)
+      return;
+
+   if (upload->ring_num_fences) {
+      last = &upload->ring_fences[(upload->ring_first_fence +
+                                   upload->ring_num_fences - 1) %
+                                  U_UPLOAD_RING_MAX_FENCES];
+      if (last->end == head)
+         return;
+   } else if (upload->ring_tail == head) {
+      return;
+   }
+
+   if (upload->ring_num_fences == U_UPLOAD_RING_MAX_FENCES) {
+      /* Fences signal in submission order, so the newest fence also
+       * covers the region of the one it replaces.
+       */
+      screen->fence_reference(screen, &last->fence, fence);
+      last->end = head;
+      return;
+   }
+
+   last = &upload->ring_fences[(upload->ring_first_fence +
+                                upload->ring_num_fences) %
+                               U_UPLOAD_RING_MAX_FENCES];
+   last->fence = NULL;
+   screen->fence_reference(screen, &last->fence, fence);
+   last->end = head;
+   upload->ring_num_fences++;
+}
+
+/* Find room for a sub-allocation in the ring, wrapping around if needed.
+ * Return the buffer offset, or ~0 if the in-flight data leaves no room.
+ */
+static unsigned
+u_upload_ring_alloc(struct u_upload_mgr *upload, unsigned min_out_offset,
+                    unsigned size, unsigned alignment)
+{
+   uint64_t base = upload->ring_base;
+   unsigned offset = align(MAX2(min_out_offset, upload->offset), alignment);
+
+   if (offset + size > upload->buffer_size) {
+      base += upload->buffer_size;
+      offset = align(min_out_offset, alignment);
+      if (offset + size > upload->buffer_size)
+         return ~0u;
+   }
+
+   /* The new end must not lap data the GPU may still read. */
+   if (base + offset + size - upload->ring_tail > upload->buffer_size) {
+      u_upload_ring_reclaim(upload);
+      if (base + offset + size - upload->ring_tail > upload->buffer_size)
+         return ~0u;
+   }
+
+   if (base != upload->ring_base) {
+      upload->ring_base = base;
+      upload->stats.num_ring_wraps++;
+   }
+   return offset;
 }
 
 static void
@@ -163,6 +321,13 @@ u_upload_release_buffer(struct u_upload_mgr *upload)
    }
    pipe_resource_reference(&upload->buffer, NULL);
    upload->buffer_size = 0;
+
+   /* Data in flight keeps the old buffer referenced, so a new one starts
+    * with an empty ring.
+    */
+   u_upload_ring_release_fences(upload);
+   upload->ring_base = 0;
+   upload->ring_tail = 0;
 }
 
 
@@ -179,7 +344,11 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
 {
    struct pipe_screen *screen = upload->pipe->screen;
    struct pipe_resource buffer;
-   unsigned size;
+   unsigned size = MAX2(upload->default_size, min_size);
+
+   /* A ring that filled up is too small for the in-flight data, grow it. */
+   if (upload->ring && upload->buffer_size)
+      size = MAX2(size, MIN2(upload->buffer_size * 2, U_UPLOAD_RING_MAX_SIZE));
 
    /* Release the old buffer, if present:
     */
@@ -187,7 +356,7 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
 
    /* Allocate a new one:
     */
-   size = align(MAX2(upload->default_size, min_size), 4096);
+   size = align(size, 4096);
 
    memset(&buffer, 0, sizeof buffer);
    buffer.target = PIPE_BUFFER;
@@ -209,6 +378,8 @@ u_upload_alloc_buffer(struct u_upload_mgr *upload, unsigned min_size)
    if (upload->buffer == NULL)
       return 0;
 
+   upload->stats.num_buffer_allocs++;
+
    /* Since atomic operations are very very slow when 2 threads are not
     * sharing the same L3 cache (which happens on AMD Zen), eliminate all
     * atomics in u_upload_alloc as follows:
@@ -260,14 +431,18 @@ u_upload_alloc(struct u_upload_mgr *upload,
                void **ptr)
 {
    unsigned buffer_size = upload->buffer_size;
-   unsigned offset = MAX2(min_out_offset, upload->offset);
+   unsigned offset;
 
-   offset = align(offset, alignment);
+   if (upload->ring && buffer_size) {
+      offset = u_upload_ring_alloc(upload, min_out_offset, size, alignment);
+   } else {
+      offset = align(MAX2(min_out_offset, upload->offset), alignment);
+   }
 
    /* Make sure we have enough space in the upload buffer
     * for the sub-allocation.
     */
-   if (unlikely(offset + size > buffer_size)) {
+   if (unlikely(offset == ~0u || offset + size > buffer_size)) {
       /* Allocate a new buffer and set the offset to the smallest one. */
       offset = align(min_out_offset, alignment);
       buffer_size = u_upload_alloc_buffer(upload, offset + size);
@@ -308,11 +483,21 @@ u_upload_alloc(struct u_upload_mgr *upload,
    if (*outbuf != upload->buffer) {
       pipe_resource_reference(outbuf, NULL);
       *outbuf = upload->buffer;
+
+      /* A ring buffer can hand out more than "size" references over its
+       * lifetime, so refill the private references when they run out.
+       */
+      if (upload->ring && unlikely(!upload->buffer_private_refcount)) {
+         upload->buffer_private_refcount = buffer_size;
+         p_atomic_add(&upload->buffer->reference.count,
+                      upload->buffer_private_refcount);
+      }
       assert (upload->buffer_private_refcount > 0);
       upload->buffer_private_refcount--;
    }
 
    upload->offset = offset + size;
+   upload->stats.bytes_uploaded += size;
 }
 
 void
@@ -37,11 +37,22 @@
 
 struct pipe_context;
 struct pipe_resource;
+struct pipe_fence_handle;
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * Upload counters, accumulated since creation or the last
+ * u_upload_reset_stats() call.
+ */
+struct u_upload_stats {
+   unsigned num_buffer_allocs; /**< upload buffers created */
+   unsigned num_ring_wraps;    /**< ring mode: wrap-arounds to offset 0 */
+   uint64_t bytes_uploaded;    /**< bytes returned by u_upload_alloc */
+};
+
 /**
  * Create the upload manager.
  *
@@ -73,6 +84,31 @@ u_upload_clone(struct pipe_context *pipe, struct u_upload_mgr *upload);
 void
 u_upload_disable_persistent(struct u_upload_mgr *upload);
 
+/**
+ * Reuse a single persistently mapped upload buffer as a ring instead of
+ * allocating a new buffer whenever the current one is full.
+ *
+ * Space is only reclaimed once the fences passed to u_upload_fence() have
+ * signalled; if the ring runs out of reclaimable space, a larger buffer is
+ * allocated. This is a no-op if persistent mappings are unavailable.
+ */
+void
+u_upload_enable_ring(struct u_upload_mgr *upload);
+
+/**
+ * Ring mode: mark everything sub-allocated so far as being in use until
+ * "fence" signals. The caller typically passes the fence of a flush.
+ */
+void
+u_upload_fence(struct u_upload_mgr *upload, struct pipe_fence_handle *fence);
+
+void
+u_upload_get_stats(const struct u_upload_mgr *upload,
+                   struct u_upload_stats *stats);
+
+void
+u_upload_reset_stats(struct u_upload_mgr *upload);
+
 /**
  * Destroy the upload manager.
  */
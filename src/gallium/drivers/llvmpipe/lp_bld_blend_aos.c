@@ -370,7 +370,16 @@ lp_build_blend_aos(struct gallivm_state *gallivm,
    } else if (!state->blend_enable) {
       result = src;
    } else {
-      boolean rgb_alpha_same = (state->rgb_src_factor == state->rgb_dst_factor &&
+      /*
+       * The factors are the same across all channels if rgb and alpha use
+       * the same ones.  Equal src and dst factors per channel are also good
+       * enough for the optimisations lp_build_blend() does.  The former
+       * lets the common SRC_ALPHA, INV_SRC_ALPHA blend of unorm8 targets
+       * become a single lerp instead of two multiplies and an add.
+       */
+      boolean rgb_alpha_same = (state->rgb_src_factor == state->alpha_src_factor &&
+                                state->rgb_dst_factor == state->alpha_dst_factor) ||
+                               (state->rgb_src_factor == state->rgb_dst_factor &&
                                 state->alpha_src_factor == state->alpha_dst_factor) ||
                                nr_channels == 1;
       boolean alpha_only = nr_channels == 1 && alpha_swizzle == PIPE_SWIZZLE_X;
@@ -458,6 +458,17 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
                                        LLVMInt32TypeInContext(context), bits);
       count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
    }
+   else if(util_get_cpu_caps()->has_avx512f && type.length == 16) {
+      /* The compare lands in a k-register, popcount it straight from there. */
+      LLVMTypeRef i16t = LLVMInt16TypeInContext(context);
+      LLVMValueRef bits = LLVMBuildBitCast(builder, maskvalue,
+                                           lp_build_int_vec_type(gallivm, type), "");
+      bits = LLVMBuildICmp(builder, LLVMIntNE, bits,
+                           lp_build_const_int_vec(gallivm, type, 0), "");
+      bits = LLVMBuildBitCast(builder, bits, i16t, "");
+      count = lp_build_intrinsic_unary(builder, "llvm.ctpop.i16", i16t, bits);
+      count = LLVMBuildZExt(builder, count, LLVMIntTypeInContext(context, 64), "");
+   }
    else {
       unsigned i;
       LLVMValueRef countv = LLVMBuildAnd(builder, maskvalue, countmask, "countv");
@@ -516,6 +527,26 @@ lp_build_occlusion_count(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Concatenate two vectors of the same type into one twice as long.
+ */
+static LLVMValueRef
+lp_build_concat_pair(struct gallivm_state *gallivm,
+                     LLVMValueRef lo,
+                     LLVMValueRef hi)
+{
+   LLVMValueRef shuffles[LP_MAX_VECTOR_LENGTH];
+   unsigned length = LLVMGetVectorSize(LLVMTypeOf(lo));
+   unsigned i;
+
+   for (i = 0; i < 2 * length; i++) {
+      shuffles[i] = lp_build_const_int32(gallivm, i);
+   }
+   return LLVMBuildShuffleVector(gallivm->builder, lo, hi,
+                                 LLVMConstVector(shuffles, 2 * length), "");
+}
+
+
 /**
  * Load depth/stencil values.
  * The stored values are linear, swizzle them.
@@ -550,6 +581,28 @@ lp_build_depth_stencil_load_swizzled(struct gallivm_state *gallivm,
    struct lp_type zs_type = lp_depth_type(format_desc, z_src_type.length);
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /*
+       * A 16-wide vector covers the whole 4x4 block, in the same order as
+       * the two 4x2 halves the 8-wide path handles, so just do it twice.
+       */
+      struct lp_type half_type = z_src_type;
+      LLVMValueRef z_half[2], s_half[2];
+      unsigned i;
+
+      assert(!is_1d);
+      half_type.length = 8;
+      for (i = 0; i < 2; i++) {
+         lp_build_depth_stencil_load_swizzled(gallivm, half_type, format_desc,
+                                              FALSE, depth_ptr, depth_stride,
+                                              &z_half[i], &s_half[i],
+                                              lp_build_const_int32(gallivm, i));
+      }
+      *z_fb = lp_build_concat_pair(gallivm, z_half[0], z_half[1]);
+      *s_fb = lp_build_concat_pair(gallivm, s_half[0], s_half[1]);
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
@@ -694,6 +747,27 @@ lp_build_depth_stencil_write_swizzled(struct gallivm_state *gallivm,
    struct lp_type z_type = zs_type;
    struct lp_type zs_load_type = zs_type;
 
+   if (z_src_type.length == 16) {
+      /* See lp_build_depth_stencil_load_swizzled. */
+      struct lp_type half_type = z_src_type;
+      unsigned i;
+
+      assert(!is_1d);
+      half_type.length = 8;
+      for (i = 0; i < 2; i++) {
+         lp_build_depth_stencil_write_swizzled(
+            gallivm, half_type, format_desc, FALSE,
+            mask_value ? lp_build_extract_range(gallivm, mask_value, i * 8, 8) : NULL,
+            lp_build_extract_range(gallivm, z_fb, i * 8, 8),
+            lp_build_extract_range(gallivm, s_fb, i * 8, 8),
+            lp_build_const_int32(gallivm, i),
+            depth_ptr, depth_stride,
+            lp_build_extract_range(gallivm, z_value, i * 8, 8),
+            lp_build_extract_range(gallivm, s_value, i * 8, 8));
+      }
+      return;
+   }
+
    zs_load_type.length = zs_load_type.length / 2;
    load_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, zs_load_type), 0);
 
@@ -67,8 +67,12 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       util_blitter_destroy(llvmpipe->blitter);
    }
 
-   if (llvmpipe->pipe.stream_uploader)
+   if (llvmpipe->pipe.stream_uploader) {
       u_upload_destroy(llvmpipe->pipe.stream_uploader);
+      llvmpipe->pipe.stream_uploader = NULL;
+   }
+
+   llvmpipe_finish_fs_tier_jobs(llvmpipe);
 
    /* This will also destroy llvmpipe->setup:
     */
@@ -189,6 +193,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    memset(llvmpipe, 0, sizeof *llvmpipe);
 
    make_empty_list(&llvmpipe->fs_variants_list);
+   list_inithead(&llvmpipe->fs_tier_jobs);
 
    make_empty_list(&llvmpipe->setup_variants_list);
 
@@ -196,6 +201,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
 
    llvmpipe->pipe.screen = screen;
    llvmpipe->pipe.priv = priv;
+   llvmpipe->variant_budget = &llvmpipe_screen(screen)->variant_budget;
 
    /* Init the pipe context methods */
    llvmpipe->pipe.destroy = llvmpipe_destroy;
@@ -247,6 +253,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
                                  lp_draw_disk_cache_insert_shader);
 
    draw_set_constant_buffer_stride(llvmpipe->draw, lp_get_constant_buffer_stride(screen));
+   draw_set_variant_budget(llvmpipe->draw, llvmpipe->variant_budget);
 
    /* FIXME: devise alternative to draw_texture_samplers */
 
@@ -261,6 +268,8 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe->pipe.stream_uploader = u_upload_create_default(&llvmpipe->pipe);
    if (!llvmpipe->pipe.stream_uploader)
       goto fail;
+   /* Buffers stay mapped, so reuse one instead of reallocating when full. */
+   u_upload_enable_ring(llvmpipe->pipe.stream_uploader);
    llvmpipe->pipe.const_uploader = llvmpipe->pipe.stream_uploader;
 
    llvmpipe->blitter = util_blitter_create(&llvmpipe->pipe);
@@ -35,6 +35,7 @@
 
 #include "draw/draw_vertex.h"
 #include "util/u_blitter.h"
+#include "util/list.h"
 
 #include "lp_tex_sample.h"
 #include "lp_jit.h"
@@ -54,6 +55,7 @@ struct lp_blend_state;
 struct lp_setup_context;
 struct lp_setup_variant;
 struct lp_velems_state;
+struct gallivm_variant_budget;
 
 struct llvmpipe_context {
    struct pipe_context pipe;  /**< base class */
@@ -156,6 +158,15 @@ struct llvmpipe_context {
    unsigned nr_fs_variants;
    unsigned nr_fs_instrs;
 
+   /** Fragment shader variants being recompiled optimized */
+   struct list_head fs_tier_jobs;
+
+   /** Set while building variants ahead of the first draw */
+   boolean precompiling;
+
+   /** The screen's JIT code budget, for evicting fs and cs variants */
+   struct gallivm_variant_budget *variant_budget;
+
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
 
@@ -58,6 +58,13 @@
 #define PERF_NO_BLEND       0x20  	/* disable blending */
 #define PERF_NO_DEPTH       0x40  	/* disable depth buffering entirely */
 #define PERF_NO_ALPHATEST   0x80  	/* disable alpha testing */
+#define PERF_NO_HIZ         0x100 	/* disable coarse depth rejection */
+#define PERF_TILED_TEX      0x200 	/* sample from 4x4 tiled texture copies */
+#define PERF_NO_FASTBLIT    0x400 	/* no 8-bit blit path for simple draws */
+#define PERF_NO_TIERED      0x800 	/* compile fs variants optimized right away */
+#define PERF_NO_DEFER_CLEAR 0x1000	/* write tile clears to memory right away */
+#define PERF_TILE_RESIDENT  0x2000	/* rasterize tiles in thread-local copies */
+#define PERF_NO_MS_UNIFORM  0x4000	/* write every sample of multisampled pixels */
 
 
 extern int LP_PERF;
@@ -43,6 +43,92 @@
 #include "draw/draw_context.h"
 
 
+/* Number of indirect draws handed to the draw module per call */
+#define LP_INDIRECT_BATCH 64
+
+/**
+ * Read back the draw count and map the indirect arguments.  Mapping goes
+ * through the transfer path so that pending rendering writes to the
+ * buffers land first.  Returns NULL when there is nothing to draw.
+ */
+static const uint32_t *
+llvmpipe_map_indirect(struct pipe_context *pipe,
+                      const struct pipe_draw_info *info,
+                      const struct pipe_draw_indirect_info *indirect,
+                      unsigned *stride,
+                      unsigned *draw_count,
+                      struct pipe_transfer **transfer)
+{
+   unsigned num_params = info->index_size ? 5 : 4;
+   unsigned count = indirect->draw_count;
+   unsigned size;
+
+   if (indirect->indirect_draw_count) {
+      struct pipe_transfer *dc_transfer;
+      const uint32_t *dc_param = pipe_buffer_map_range(pipe,
+                                                       indirect->indirect_draw_count,
+                                                       indirect->indirect_draw_count_offset,
+                                                       4, PIPE_MAP_READ, &dc_transfer);
+      if (!dc_transfer)
+         return NULL;
+      count = MIN2(count, dc_param[0]);
+      pipe_buffer_unmap(pipe, dc_transfer);
+   }
+
+   if (!count)
+      return NULL;
+
+   *stride = indirect->stride ? indirect->stride / 4 : num_params;
+   *draw_count = count;
+   size = ((count - 1) * *stride + num_params) * sizeof(uint32_t);
+   return pipe_buffer_map_range(pipe, indirect->buffer, indirect->offset,
+                                size, PIPE_MAP_READ, transfer);
+}
+
+
+/**
+ * Feed indirect draws to the draw module with the state set up once.
+ * Consecutive draws sharing the same instancing go down as one
+ * multi-draw.
+ */
+static void
+llvmpipe_draw_indirect(struct draw_context *draw,
+                       const struct pipe_draw_info *info_in,
+                       const uint32_t *params,
+                       unsigned stride,
+                       unsigned draw_count)
+{
+   struct pipe_draw_start_count_bias draws[LP_INDIRECT_BATCH];
+   struct pipe_draw_info info = *info_in;
+   bool indexed = info.index_size != 0;
+   unsigned n = 0;
+
+   info.increment_draw_id = true;
+   info.index_bias_varies = indexed;
+
+   for (unsigned i = 0; i < draw_count; i++, params += stride) {
+      unsigned instance_count = params[1];
+      unsigned start_instance = indexed ? params[4] : params[3];
+
+      if (n && (n == LP_INDIRECT_BATCH ||
+                instance_count != info.instance_count ||
+                start_instance != info.start_instance)) {
+         draw_vbo(draw, &info, i - n, NULL, draws, n);
+         n = 0;
+      }
+
+      info.instance_count = instance_count;
+      info.start_instance = start_instance;
+      draws[n].count = params[0];
+      draws[n].start = params[2];
+      draws[n].index_bias = indexed ? (int)params[3] : 0;
+      n++;
+   }
+
+   if (n)
+      draw_vbo(draw, &info, draw_count - n, NULL, draws, n);
+}
+
 
 /**
  * Draw vertex arrays, with optional indexing, optional instancing.
@@ -63,19 +149,28 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
    struct llvmpipe_context *lp = llvmpipe_context(pipe);
    struct draw_context *draw = lp->draw;
    const void *mapped_indices = NULL;
+   struct pipe_transfer *indirect_transfer = NULL;
+   const uint32_t *indirect_params = NULL;
+   unsigned indirect_stride = 0, indirect_count = 0;
    unsigned i;
 
    if (!llvmpipe_check_render_cond(lp))
       return;
 
    if (indirect && indirect->buffer) {
-      util_draw_indirect(pipe, info, indirect);
-      return;
+      indirect_params = llvmpipe_map_indirect(pipe, info, indirect,
+                                              &indirect_stride,
+                                              &indirect_count,
+                                              &indirect_transfer);
+      if (!indirect_params)
+         return;
    }
 
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
+   llvmpipe_update_fs_tier(lp);
+
    /*
     * Map vertex buffers
     */
@@ -146,7 +241,11 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
                                      !lp->queries_disabled);
 
    /* draw! */
-   draw_vbo(draw, info, drawid_offset, indirect, draws, num_draws);
+   if (indirect_params)
+      llvmpipe_draw_indirect(draw, info, indirect_params,
+                             indirect_stride, indirect_count);
+   else
+      draw_vbo(draw, info, drawid_offset, indirect, draws, num_draws);
 
    /*
     * unmap vertex/index buffers
@@ -176,6 +275,9 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
    llvmpipe_cleanup_stage_images(lp, PIPE_SHADER_TESS_CTRL);
    llvmpipe_cleanup_stage_images(lp, PIPE_SHADER_TESS_EVAL);
 
+   if (indirect_transfer)
+      pipe_buffer_unmap(pipe, indirect_transfer);
+
    /*
     * TODO: Flush only when a user vertex/index buffer is present
     * (or even better, modify draw module to do this
@@ -185,8 +287,34 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info,
 }
 
 
+/**
+ * Build the fragment and vertex shader variants for the bound state ahead
+ * of the first draw.  They are handed over to whichever context draws with
+ * them first instead of staying on this context's LRU lists.
+ */
+static void
+llvmpipe_precompile_shader_variants(struct pipe_context *pipe,
+                                    enum pipe_prim_type mode)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+
+   if (!lp->fs || !lp->vs || !lp->rasterizer)
+      return;
+
+   /* make sure the variant lookup runs so the one we want is at the head */
+   lp->dirty |= LP_NEW_FS;
+   lp->precompiling = TRUE;
+   llvmpipe_update_derived(lp);
+   lp->precompiling = FALSE;
+   llvmpipe_orphan_current_fs_variant(lp);
+
+   draw_precompile(lp->draw, mode);
+}
+
+
 void
 llvmpipe_init_draw_funcs(struct llvmpipe_context *llvmpipe)
 {
    llvmpipe->pipe.draw_vbo = llvmpipe_draw_vbo;
+   llvmpipe->pipe.precompile_shader_variants = llvmpipe_precompile_shader_variants;
 }
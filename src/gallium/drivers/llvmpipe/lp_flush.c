@@ -34,6 +34,7 @@
 #include "pipe/p_screen.h"
 #include "util/u_debug_image.h"
 #include "util/u_string.h"
+#include "util/u_upload_mgr.h"
 #include "draw/draw_context.h"
 #include "lp_flush.h"
 #include "lp_context.h"
@@ -49,11 +50,18 @@ llvmpipe_flush( struct pipe_context *pipe,
                 const char *reason)
 {
    struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct pipe_fence_handle *upload_fence = NULL;
 
    draw_flush(llvmpipe->draw);
 
    /* ask the setup module to flush */
-   lp_setup_flush(llvmpipe->setup, fence, reason);
+   lp_setup_flush(llvmpipe->setup, fence ? fence : &upload_fence, reason);
+
+   /* Uploads so far may be overwritten once the flushed scenes are done. */
+   if (pipe->stream_uploader)
+      u_upload_fence(pipe->stream_uploader, fence ? *fence : upload_fence);
+   if (upload_fence)
+      pipe->screen->fence_reference(pipe->screen, &upload_fence, NULL);
 
    /* Enable to dump BMPs of the color/depth buffers each frame */
    if (0) {
@@ -81,10 +81,11 @@
 #define LP_MAX_SHADER_VARIANTS 1024
 
 /**
- * Max number of instructions (for all fragment shaders combined per context)
- * that will be kept around (counted in terms of llvm ir).
+ * Default size in MB of the JIT code of all shader variants (fragment,
+ * compute and draw module ones, for all contexts combined per screen) that
+ * will be kept around.  Can be changed with LP_VARIANT_BUDGET_MB.
  */
-#define LP_MAX_SHADER_INSTRUCTIONS (2048 * LP_MAX_SHADER_VARIANTS)
+#define LP_DEFAULT_VARIANT_BUDGET_MB 128
 
 /**
  * Max number of setup variants that will be kept around.
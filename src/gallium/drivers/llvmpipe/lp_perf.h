@@ -57,6 +57,7 @@ struct lp_counters
    unsigned nr_partially_covered_4;
    unsigned nr_non_empty_4;
    unsigned nr_llvm_compiles;
+   unsigned nr_llvm_tier_ups;  /**< fast variants recompiled optimized */
    int64_t llvm_compile_time;  /**< total, in microseconds */
 
    unsigned nr_color_tile_clear;
@@ -87,6 +87,186 @@ lp_rast_end( struct lp_rasterizer *rast )
 }
 
 
+static void
+lp_rast_hiz_clear(struct lp_rasterizer_task *task,
+                  uint64_t clear_value64, uint64_t clear_mask64);
+
+
+/**
+ * Deferred clear state of the current tile in a bound surface, if any.
+ */
+static inline struct llvmpipe_tile_clear *
+tile_clear_entry(const struct lp_rasterizer_task *task,
+                 const struct lp_scene_surface *ssurf)
+{
+   const struct llvmpipe_resource *lpr = ssurf->deferred_clears;
+
+   if (!lpr)
+      return NULL;
+
+   return &lpr->tile_clears[(task->y / TILE_SIZE) * lpr->tile_clears_stride +
+                            task->x / TILE_SIZE];
+}
+
+
+/**
+ * Does the bin begin by clearing all of a buffer, so that its old contents
+ * need not be loaded?
+ * \param cbuf  color buffer index, or -1 for the depth/stencil buffer
+ */
+static boolean
+bin_starts_with_clear(const struct lp_scene *scene,
+                      const struct cmd_bin *bin, int cbuf)
+{
+   const struct cmd_block *block = bin->head;
+   unsigned k;
+
+   if (!block)
+      return FALSE;
+
+   for (k = 0; k < block->count; k++) {
+      const union lp_rast_cmd_arg arg = block->arg[k];
+
+      if (block->cmd[k] == LP_RAST_OP_CLEAR_COLOR) {
+         if ((int)arg.clear_rb->cbuf == cbuf)
+            return TRUE;
+      }
+      else if (block->cmd[k] == LP_RAST_OP_CLEAR_ZSTENCIL) {
+         const uint64_t full_mask64 =
+            util_pack64_mask_z_stencil(scene->fb.zsbuf->format,
+                                       0xffffffff, 0xff);
+         if (cbuf < 0 &&
+             (arg.clear_zstencil.mask & full_mask64) == full_mask64)
+            return TRUE;
+      }
+      else {
+         break;
+      }
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Copy the current tile into the thread's own buffers and rasterize it
+ * there, so that blending and depth testing don't go out to memory.
+ * Buffers holding a deferred clear, or cleared first thing in the bin,
+ * are not loaded.
+ */
+static void
+lp_rast_tile_load(struct lp_rasterizer_task *task,
+                  const struct cmd_bin *bin)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   /* Either all buffers are resident or none, so give up on failure. */
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] && !task->resident_color[i]) {
+         task->resident_color[i] = align_malloc(LP_RESIDENT_TILE_SIZE, 64);
+         if (!task->resident_color[i])
+            return;
+      }
+   }
+   if (scene->fb.zsbuf && !task->resident_depth) {
+      task->resident_depth = align_malloc(LP_RESIDENT_TILE_SIZE, 64);
+      if (!task->resident_depth)
+         return;
+   }
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i]) {
+         const unsigned stride = TILE_SIZE * scene->cbufs[i].format_bytes;
+
+         if (!(task->color_clear[i] && task->color_clear[i]->pending) &&
+             !bin_starts_with_clear(scene, bin, i)) {
+            util_copy_rect(task->resident_color[i],
+                           scene->fb.cbufs[i]->format, stride, 0, 0,
+                           task->width, task->height,
+                           task->color_tiles[i], task->color_stride[i],
+                           0, 0);
+         }
+         task->color_tiles[i] = task->resident_color[i];
+         task->color_stride[i] = stride;
+      }
+   }
+
+   if (scene->fb.zsbuf) {
+      const unsigned stride = TILE_SIZE * scene->zsbuf.format_bytes;
+
+      if (!(task->zs_clear && task->zs_clear->pending) &&
+          !bin_starts_with_clear(scene, bin, -1)) {
+         util_copy_rect(task->resident_depth, scene->fb.zsbuf->format,
+                        stride, 0, 0, task->width, task->height,
+                        task->depth_tile, task->depth_stride, 0, 0);
+      }
+      task->depth_tile = task->resident_depth;
+      task->depth_stride = stride;
+   }
+
+   task->resident = TRUE;
+   task->resident_dirty = FALSE;
+}
+
+
+/**
+ * Write the thread's copy of the current tile back to the framebuffer.
+ */
+static void
+lp_rast_tile_store(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i]) {
+         util_copy_rect(scene->cbufs[i].map, scene->fb.cbufs[i]->format,
+                        scene->cbufs[i].stride, task->x, task->y,
+                        task->width, task->height,
+                        task->color_tiles[i], task->color_stride[i], 0, 0);
+      }
+   }
+
+   if (scene->fb.zsbuf) {
+      util_copy_rect(scene->zsbuf.map, scene->fb.zsbuf->format,
+                     scene->zsbuf.stride, task->x, task->y,
+                     task->width, task->height,
+                     task->depth_tile, task->depth_stride, 0, 0);
+   }
+}
+
+
+/**
+ * Can the blocks of the tile whose samples are all equal be tracked?  Only
+ * if every multisampled color buffer has deferred clear state, otherwise
+ * all samples of the tile are written out.
+ */
+static void
+lp_rast_tile_begin_uniform(struct lp_rasterizer_task *task)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   if (!(LP_PERF & PERF_NO_MS_UNIFORM)) {
+      for (i = 0; i < scene->fb.nr_cbufs; i++) {
+         if (scene->cbufs[i].nr_samples > 1 && !task->color_clear[i])
+            break;
+      }
+      if (i == scene->fb.nr_cbufs)
+         return;
+   }
+
+   task->ms_uniform = FALSE;
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct llvmpipe_tile_clear *clear = task->color_clear[i];
+      if (clear && clear->uniform && !clear->pending)
+         llvmpipe_resource_expand_tile(scene->cbufs[i].deferred_clears,
+                                       clear, task->x, task->y);
+   }
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -112,18 +292,156 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
 
    task->thread_data.vis_counter = 0;
    task->thread_data.ps_invocations = 0;
+   task->clears_pending = FALSE;
+
+   /* Nothing is known about the depth values until the tile is cleared. */
+   for (i = 0; i < LP_HIZ_BLOCKS; i++) {
+      unsigned j;
+      for (j = 0; j < LP_HIZ_BLOCKS; j++) {
+         task->hiz_zmin[i][j] = -FLT_MAX;
+         task->hiz_zmax[i][j] = FLT_MAX;
+      }
+   }
 
+   task->ms_uniform = FALSE;
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
+      task->color_clear[i] = NULL;
       if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
                                 scene->cbufs[i].stride * task->y +
                                 scene->cbufs[i].format_bytes * task->x;
+         task->color_stride[i] = scene->cbufs[i].stride;
+         task->color_clear[i] = tile_clear_entry(task, &scene->cbufs[i]);
+         if (task->color_clear[i] && task->color_clear[i]->pending)
+            task->clears_pending = TRUE;
+         if (scene->cbufs[i].nr_samples > 1)
+            task->ms_uniform = TRUE;
       }
    }
+   if (task->ms_uniform)
+      lp_rast_tile_begin_uniform(task);
+   task->zs_clear = NULL;
    if (task->scene->fb.zsbuf) {
+      const struct util_format_description *desc =
+         util_format_description(scene->fb.zsbuf->format);
+      const int c = desc->swizzle[0];
+
       task->depth_tile = scene->zsbuf.map +
                          scene->zsbuf.stride * task->y +
                          scene->zsbuf.format_bytes * task->x;
+      task->depth_stride = scene->zsbuf.stride;
+
+      task->hiz_eps = 0.0f;
+      if (c < 4 && desc->channel[c].type == UTIL_FORMAT_TYPE_UNSIGNED)
+         task->hiz_eps = 1.0f / (float)((1ull << desc->channel[c].size) - 1);
+
+      task->zs_clear = tile_clear_entry(task, &scene->zsbuf);
+      if (task->zs_clear && task->zs_clear->pending) {
+         /* The tile still holds a whole clear from an earlier scene. */
+         task->clears_pending = TRUE;
+         lp_rast_hiz_clear(task, task->zs_clear->value.zs,
+                           util_pack64_mask_z_stencil(scene->fb.zsbuf->format,
+                                                      0xffffffff, 0xff));
+      }
+   }
+
+   if (scene->tile_resident)
+      lp_rast_tile_load(task, bin);
+}
+
+
+/**
+ * Set the depth bounds of the whole tile after a depth clear.
+ */
+static void
+lp_rast_hiz_clear(struct lp_rasterizer_task *task,
+                  uint64_t clear_value64, uint64_t clear_mask64)
+{
+   const enum pipe_format format = task->scene->fb.zsbuf->format;
+   const uint64_t depth_mask64 = util_pack64_mask_z(format, 0xffffffff);
+   float zmin = -FLT_MAX, zmax = FLT_MAX;
+   unsigned i, j;
+
+   if (!util_format_has_depth(util_format_description(format)) ||
+       !(clear_mask64 & depth_mask64))
+      return;
+
+   if ((clear_mask64 & depth_mask64) == depth_mask64) {
+      union {
+         uint16_t u16;
+         uint32_t u32;
+         uint64_t u64;
+      } packed;
+      float z;
+
+      switch (util_format_get_blocksize(format)) {
+      case 2:
+         packed.u16 = (uint16_t)clear_value64;
+         break;
+      case 4:
+         packed.u32 = (uint32_t)clear_value64;
+         break;
+      default:
+         packed.u64 = clear_value64;
+         break;
+      }
+      util_format_unpack_z_float(format, &z, &packed, 1);
+      zmin = zmax = z;
+   }
+
+   for (i = 0; i < LP_HIZ_BLOCKS; i++) {
+      for (j = 0; j < LP_HIZ_BLOCKS; j++) {
+         task->hiz_zmin[i][j] = zmin;
+         task->hiz_zmax[i][j] = zmax;
+      }
+   }
+}
+
+
+static void
+write_color_tile(struct lp_rasterizer_task *task, unsigned cbuf,
+                 union util_color *uc, unsigned nr_samples)
+{
+   const struct lp_scene *scene = task->scene;
+
+   for (unsigned s = 0; s < nr_samples; s++) {
+      void *map = task->color_tiles[cbuf] + scene->cbufs[cbuf].sample_stride * s;
+      util_fill_box(map,
+                    scene->fb.cbufs[cbuf]->format,
+                    task->color_stride[cbuf],
+                    scene->cbufs[cbuf].layer_stride,
+                    0,
+                    0,
+                    0,
+                    task->width,
+                    task->height,
+                    scene->fb_max_layer + 1,
+                    uc);
+   }
+
+   task->resident_dirty = TRUE;
+}
+
+
+/**
+ * Mark all 4x4 blocks of the current color tile as storing sample 0 only.
+ */
+static void
+set_uniform_tile(struct lp_rasterizer_task *task, unsigned cbuf)
+{
+   struct llvmpipe_tile_clear *clear = task->color_clear[cbuf];
+   const uint64_t row_bits = BITFIELD64_MASK(DIV_ROUND_UP(task->width, 4));
+   unsigned y;
+
+   memset(clear->uniform_blocks, 0, sizeof clear->uniform_blocks);
+   for (y = 0; y < DIV_ROUND_UP(task->height, 4); y++) {
+      const unsigned block = y * (TILE_SIZE / 4);
+      clear->uniform_blocks[block / 64] |= row_bits << (block % 64);
+   }
+
+   if (!clear->uniform) {
+      clear->uniform = TRUE;
+      p_atomic_inc(&task->scene->cbufs[cbuf].deferred_clears->num_uniform_tiles);
    }
 }
 
@@ -156,19 +474,18 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
    LP_DBG(DEBUG_RAST, "%s clear value (target format %d) raw 0x%x,0x%x,0x%x,0x%x\n",
           __FUNCTION__, format, uc.ui[0], uc.ui[1], uc.ui[2], uc.ui[3]);
 
-   for (unsigned s = 0; s < scene->cbufs[cbuf].nr_samples; s++) {
-      void *map = (char *)scene->cbufs[cbuf].map + scene->cbufs[cbuf].sample_stride * s;
-      util_fill_box(map,
-                    format,
-                    scene->cbufs[cbuf].stride,
-                    scene->cbufs[cbuf].layer_stride,
-                    task->x,
-                    task->y,
-                    0,
-                    task->width,
-                    task->height,
-                    scene->fb_max_layer + 1,
-                    &uc);
+   if (task->color_clear[cbuf]) {
+      /* Just remember the value until the tile is drawn to or read. */
+      struct llvmpipe_tile_clear *clear = task->color_clear[cbuf];
+      clear->value.color = uc;
+      if (!clear->pending) {
+         clear->pending = TRUE;
+         p_atomic_inc(&scene->cbufs[cbuf].deferred_clears->num_pending_clears);
+      }
+      task->clears_pending = TRUE;
+   }
+   else {
+      write_color_tile(task, cbuf, &uc, scene->cbufs[cbuf].nr_samples);
    }
 
    /* this will increase for each rb which probably doesn't mean much */
@@ -177,123 +494,247 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
 
 
 /**
- * Clear the rasterizer's current z/stencil tile.
- * This is a bin command called during bin processing.
- * Clear commands always clear all bound layers.
+ * Write a z/stencil clear to the current tile in memory.
  */
 static void
-lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
-                       const union lp_rast_cmd_arg arg)
+write_zstencil_tile(struct lp_rasterizer_task *task,
+                    uint64_t clear_value64, uint64_t clear_mask64)
 {
    const struct lp_scene *scene = task->scene;
-   uint64_t clear_value64 = arg.clear_zstencil.value;
-   uint64_t clear_mask64 = arg.clear_zstencil.mask;
    uint32_t clear_value = (uint32_t) clear_value64;
    uint32_t clear_mask = (uint32_t) clear_mask64;
    const unsigned height = task->height;
    const unsigned width = task->width;
-   const unsigned dst_stride = scene->zsbuf.stride;
+   const unsigned dst_stride = task->depth_stride;
    uint8_t *dst;
    unsigned i, j;
    unsigned block_size;
+   unsigned layer;
 
-   LP_DBG(DEBUG_RAST, "%s: value=0x%08x, mask=0x%08x\n",
-           __FUNCTION__, clear_value, clear_mask);
+   task->resident_dirty = TRUE;
 
-   /*
-    * Clear the area of the depth/depth buffer matching this tile.
-    */
+   for (unsigned s = 0; s < scene->zsbuf.nr_samples; s++) {
+      uint8_t *dst_layer = task->depth_tile + (s * scene->zsbuf.sample_stride);
+      block_size = util_format_get_blocksize(scene->fb.zsbuf->format);
 
-   if (scene->fb.zsbuf) {
-      unsigned layer;
+      clear_value &= clear_mask;
 
-      for (unsigned s = 0; s < scene->zsbuf.nr_samples; s++) {
-         uint8_t *dst_layer = task->depth_tile + (s * scene->zsbuf.sample_stride);
-         block_size = util_format_get_blocksize(scene->fb.zsbuf->format);
+      for (layer = 0; layer <= scene->fb_max_layer; layer++) {
+         dst = dst_layer;
 
-         clear_value &= clear_mask;
-
-         for (layer = 0; layer <= scene->fb_max_layer; layer++) {
-            dst = dst_layer;
-
-            switch (block_size) {
-            case 1:
-               assert(clear_mask == 0xff);
+         switch (block_size) {
+         case 1:
+            assert(clear_mask == 0xff);
+            for (i = 0; i < height; i++) {
+               uint8_t *row = (uint8_t *)dst;
+               memset(row, (uint8_t) clear_value, width);
+               dst += dst_stride;
+            }
+            break;
+         case 2:
+            if (clear_mask == 0xffff) {
                for (i = 0; i < height; i++) {
-                  uint8_t *row = (uint8_t *)dst;
-                  memset(row, (uint8_t) clear_value, width);
+                  uint16_t *row = (uint16_t *)dst;
+                  for (j = 0; j < width; j++)
+                     *row++ = (uint16_t) clear_value;
                   dst += dst_stride;
                }
-               break;
-            case 2:
-               if (clear_mask == 0xffff) {
-                  for (i = 0; i < height; i++) {
-                     uint16_t *row = (uint16_t *)dst;
-                     for (j = 0; j < width; j++)
-                        *row++ = (uint16_t) clear_value;
-                     dst += dst_stride;
-                  }
-               }
-               else {
-                  for (i = 0; i < height; i++) {
-                     uint16_t *row = (uint16_t *)dst;
-                     for (j = 0; j < width; j++) {
-                        uint16_t tmp = ~clear_mask & *row;
-                        *row++ = clear_value | tmp;
-                     }
-                     dst += dst_stride;
+            }
+            else {
+               for (i = 0; i < height; i++) {
+                  uint16_t *row = (uint16_t *)dst;
+                  for (j = 0; j < width; j++) {
+                     uint16_t tmp = ~clear_mask & *row;
+                     *row++ = clear_value | tmp;
                   }
+                  dst += dst_stride;
                }
-               break;
-            case 4:
-               if (clear_mask == 0xffffffff) {
-                  for (i = 0; i < height; i++) {
-                     util_memset32(dst, clear_value, width);
-                     dst += dst_stride;
-                  }
+            }
+            break;
+         case 4:
+            if (clear_mask == 0xffffffff) {
+               for (i = 0; i < height; i++) {
+                  util_memset32(dst, clear_value, width);
+                  dst += dst_stride;
                }
-               else {
-                  for (i = 0; i < height; i++) {
-                     uint32_t *row = (uint32_t *)dst;
-                     for (j = 0; j < width; j++) {
-                        uint32_t tmp = ~clear_mask & *row;
-                        *row++ = clear_value | tmp;
-                     }
-                     dst += dst_stride;
+            }
+            else {
+               for (i = 0; i < height; i++) {
+                  uint32_t *row = (uint32_t *)dst;
+                  for (j = 0; j < width; j++) {
+                     uint32_t tmp = ~clear_mask & *row;
+                     *row++ = clear_value | tmp;
                   }
+                  dst += dst_stride;
                }
-               break;
-            case 8:
-               clear_value64 &= clear_mask64;
-               if (clear_mask64 == 0xffffffffffULL) {
-                  for (i = 0; i < height; i++) {
-                     util_memset64(dst, clear_value64, width);
-                     dst += dst_stride;
-                  }
+            }
+            break;
+         case 8:
+            clear_value64 &= clear_mask64;
+            if (clear_mask64 == 0xffffffffffULL) {
+               for (i = 0; i < height; i++) {
+                  util_memset64(dst, clear_value64, width);
+                  dst += dst_stride;
                }
-               else {
-                  for (i = 0; i < height; i++) {
-                     uint64_t *row = (uint64_t *)dst;
-                     for (j = 0; j < width; j++) {
-                        uint64_t tmp = ~clear_mask64 & *row;
-                        *row++ = clear_value64 | tmp;
-                     }
-                     dst += dst_stride;
+            }
+            else {
+               for (i = 0; i < height; i++) {
+                  uint64_t *row = (uint64_t *)dst;
+                  for (j = 0; j < width; j++) {
+                     uint64_t tmp = ~clear_mask64 & *row;
+                     *row++ = clear_value64 | tmp;
                   }
+                  dst += dst_stride;
                }
-               break;
-
-            default:
-               assert(0);
-               break;
             }
-            dst_layer += scene->zsbuf.layer_stride;
+            break;
+
+         default:
+            assert(0);
+            break;
+         }
+         dst_layer += scene->zsbuf.layer_stride;
+      }
+   }
+}
+
+
+/**
+ * Clear the rasterizer's current z/stencil tile.
+ * This is a bin command called during bin processing.
+ * Clear commands always clear all bound layers.
+ */
+static void
+lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
+                       const union lp_rast_cmd_arg arg)
+{
+   const struct lp_scene *scene = task->scene;
+   uint64_t clear_value64 = arg.clear_zstencil.value;
+   uint64_t clear_mask64 = arg.clear_zstencil.mask;
+
+   LP_DBG(DEBUG_RAST, "%s: value=0x%08x, mask=0x%08x\n",
+           __FUNCTION__, (uint32_t) clear_value64, (uint32_t) clear_mask64);
+
+   /*
+    * Clear the area of the depth/depth buffer matching this tile.
+    */
+
+   if (scene->fb.zsbuf) {
+      struct llvmpipe_tile_clear *clear = task->zs_clear;
+      const uint64_t full_mask64 =
+         util_pack64_mask_z_stencil(scene->fb.zsbuf->format, 0xffffffff, 0xff);
+
+      /*
+       * A clear of all channels, or of some channels of a tile that still
+       * holds a deferred clear, again leaves a single value for the tile.
+       */
+      if (clear &&
+          (clear->pending || (clear_mask64 & full_mask64) == full_mask64)) {
+         clear->value.zs = (clear->value.zs & ~clear_mask64) |
+                           (clear_value64 & clear_mask64);
+         if (!clear->pending) {
+            clear->pending = TRUE;
+            p_atomic_inc(&scene->zsbuf.deferred_clears->num_pending_clears);
+         }
+         task->clears_pending = TRUE;
+      }
+      else {
+         write_zstencil_tile(task, clear_value64, clear_mask64);
+      }
+
+      lp_rast_hiz_clear(task, arg.clear_zstencil.value, clear_mask64);
+   }
+}
+
+
+
+/**
+ * Get the multisampled color buffers ready to shade the 4x4 block at x, y
+ * with the given coverage mask.
+ *
+ * Blocks whose samples are all equal, and that either stay so or become so
+ * because the shader overwrites all of them, are shaded for sample 0 only:
+ * the mask is cut down to sample 0, and the sample strides are zeroed so
+ * that the other samples, now uncovered, can't touch anything but what
+ * sample 0 got.  All samples of other blocks are written out first.
+ *
+ * \return TRUE if the block is shaded for sample 0 only, in which case
+ * lp_rast_end_uniform_block() must be called after the shader
+ */
+boolean
+lp_rast_begin_uniform_block(struct lp_rasterizer_task *task,
+                            unsigned x, unsigned y, uint64_t *mask,
+                            unsigned *sample_stride)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_state *state = task->state;
+   const struct lp_fragment_shader_variant *variant = state->variant;
+   const unsigned nr_samples = scene->fb_max_samples;
+   const uint32_t all_samples = BITFIELD_MASK(nr_samples);
+   const unsigned block = (y % TILE_SIZE) / 4 * (TILE_SIZE / 4) +
+                          (x % TILE_SIZE) / 4;
+   const uint64_t bit = 1ull << (block % 64);
+   const uint64_t mask0 = *mask & 0xffff;
+   boolean uniform, stored_once = TRUE;
+   unsigned i, s;
+
+   uniform = variant->uniform_samples &&
+             (state->jit_context.sample_mask & all_samples) == all_samples;
+   for (s = 1; s < nr_samples && uniform; s++)
+      uniform = ((*mask >> (16 * s)) & 0xffff) == mask0;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->cbufs[i].nr_samples > 1 &&
+          !(task->color_clear[i]->uniform_blocks[block / 64] & bit))
+         stored_once = FALSE;
+   }
+
+   if (uniform &&
+       (stored_once || (mask0 == 0xffff && variant->overwrites_samples))) {
+      for (i = 0; i < scene->fb.nr_cbufs; i++) {
+         struct llvmpipe_tile_clear *clear = task->color_clear[i];
+
+         if (scene->cbufs[i].nr_samples <= 1)
+            continue;
+
+         clear->uniform_blocks[block / 64] |= bit;
+         if (!clear->uniform) {
+            clear->uniform = TRUE;
+            p_atomic_inc(&scene->cbufs[i].deferred_clears->num_uniform_tiles);
          }
+         sample_stride[i] = 0;
       }
+
+      *mask = mask0;
+      task->uniform_vis_counter = task->thread_data.vis_counter;
+      return TRUE;
    }
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct llvmpipe_tile_clear *clear = task->color_clear[i];
+
+      if (scene->cbufs[i].nr_samples > 1 &&
+          (clear->uniform_blocks[block / 64] & bit)) {
+         llvmpipe_resource_expand_block(scene->cbufs[i].deferred_clears, x, y);
+         clear->uniform_blocks[block / 64] &= ~bit;
+      }
+   }
+
+   return FALSE;
 }
 
 
+/**
+ * Count the samples the shader skipped for occlusion queries.
+ */
+void
+lp_rast_end_uniform_block(struct lp_rasterizer_task *task)
+{
+   task->thread_data.vis_counter +=
+      (task->thread_data.vis_counter - task->uniform_vis_counter) *
+      (task->scene->fb_max_samples - 1);
+}
+
 
 /**
  * Run the shader on all blocks in a tile.  This is used when a tile is
@@ -309,6 +750,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    const struct lp_rast_state *state;
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
+   unsigned culled = 0;
    unsigned x, y;
 
    if (inputs->disable) {
@@ -325,6 +767,25 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   if (variant->linear_blit.enabled &&
+       lp_rast_linear_shade_tile(task, inputs))
+      return;
+
+   if (lp_rast_hiz_cull(task, inputs, tile_x, tile_y, TILE_SIZE, TILE_SIZE))
+      return;
+
+   /* find the 16x16 blocks which fail the depth test */
+   for (y = 0; y < task->height; y += LP_HIZ_BLOCK_SIZE) {
+      for (x = 0; x < task->width; x += LP_HIZ_BLOCK_SIZE) {
+         if (lp_rast_hiz_cull(task, inputs, tile_x + x, tile_y + y,
+                              LP_HIZ_BLOCK_SIZE, LP_HIZ_BLOCK_SIZE))
+            culled |= 1 << ((y / LP_HIZ_BLOCK_SIZE) * LP_HIZ_BLOCKS +
+                            x / LP_HIZ_BLOCK_SIZE);
+         else
+            lp_rast_hiz_accept(task, inputs, tile_x + x, tile_y + y);
+      }
+   }
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -334,12 +795,17 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          uint8_t *depth = NULL;
          unsigned depth_stride = 0;
          unsigned depth_sample_stride = 0;
+         boolean uniform;
          unsigned i;
 
+         if (culled & (1 << ((y / LP_HIZ_BLOCK_SIZE) * LP_HIZ_BLOCKS +
+                             x / LP_HIZ_BLOCK_SIZE)))
+            continue;
+
          /* color buffer */
          for (i = 0; i < scene->fb.nr_cbufs; i++){
             if (scene->fb.cbufs[i]) {
-               stride[i] = scene->cbufs[i].stride;
+               stride[i] = task->color_stride[i];
                sample_stride[i] = scene->cbufs[i].sample_stride;
                color[i] = lp_rast_get_color_block_pointer(task, i, tile_x + x,
                                                           tile_y + y, inputs->layer + inputs->view_index);
@@ -355,7 +821,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          if (scene->zsbuf.map) {
             depth = lp_rast_get_depth_block_pointer(task, tile_x + x,
                                                     tile_y + y, inputs->layer + inputs->view_index);
-            depth_stride = scene->zsbuf.stride;
+            depth_stride = task->depth_stride;
             depth_sample_stride = scene->zsbuf.sample_stride;
          }
 
@@ -367,6 +833,12 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          task->thread_data.raster_state.viewport_index = inputs->viewport_index;
          task->thread_data.raster_state.view_index = inputs->view_index;
 
+         lp_rast_hiz_update(task, inputs, tile_x + x, tile_y + y);
+
+         uniform = task->ms_uniform &&
+                   lp_rast_begin_uniform_block(task, tile_x + x, tile_y + y,
+                                               &mask, sample_stride);
+
          /* run shader on 4x4 block */
          BEGIN_JIT_CALL(state, task);
          variant->jit_function[RAST_WHOLE]( &state->jit_context,
@@ -384,6 +856,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
                                             sample_stride,
                                             depth_sample_stride);
          END_JIT_CALL();
+
+         if (uniform)
+            lp_rast_end_uniform_block(task);
       }
    }
 }
@@ -430,6 +905,7 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
    uint8_t *depth = NULL;
    unsigned depth_stride = 0;
    unsigned depth_sample_stride = 0;
+   boolean uniform;
    unsigned i;
 
    assert(state);
@@ -446,7 +922,7 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_stride[i];
          sample_stride[i] = scene->cbufs[i].sample_stride;
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer + inputs->view_index);
@@ -460,7 +936,7 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
 
    /* depth buffer */
    if (scene->zsbuf.map) {
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
       depth_sample_stride = scene->zsbuf.sample_stride;
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer + inputs->view_index);
    }
@@ -476,6 +952,11 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
       task->thread_data.raster_state.view_index = inputs->view_index;
 
+      lp_rast_hiz_update(task, inputs, x, y);
+
+      uniform = task->ms_uniform &&
+                lp_rast_begin_uniform_block(task, x, y, &mask, sample_stride);
+
       /* run shader on 4x4 block */
       BEGIN_JIT_CALL(state, task);
       variant->jit_function[RAST_EDGE_TEST](&state->jit_context,
@@ -493,6 +974,9 @@ lp_rast_shade_quads_mask_sample(struct lp_rasterizer_task *task,
                                             sample_stride,
                                             depth_sample_stride);
       END_JIT_CALL();
+
+      if (uniform)
+         lp_rast_end_uniform_block(task);
    }
 }
 
@@ -577,7 +1061,55 @@ void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
+   const struct lp_fragment_shader_variant *variant = arg.state->variant;
+   const struct lp_fragment_shader_variant_key *key = &variant->key;
+   const struct tgsi_shader_info *info = &variant->shader->info.base;
+   unsigned flags = 0;
+
    task->state = arg.state;
+
+   /* How hot a quickly compiled variant is, see llvmpipe_update_fs_tier(). */
+   if (variant->fast_tier)
+      p_atomic_inc(&arg.state->variant->nr_tiles);
+
+   if (!task->scene->zsbuf.map || !key->depth.enabled ||
+       (LP_PERF & PERF_NO_HIZ)) {
+      task->hiz_flags = 0;
+      return;
+   }
+
+   /* Failing fragments must have no effect other than not being drawn. */
+   if (!key->stencil[0].enabled && !info->writes_z && !info->writes_memory) {
+      if (key->depth.func == PIPE_FUNC_LESS ||
+          key->depth.func == PIPE_FUNC_LEQUAL)
+         flags |= LP_HIZ_CULL_LESS;
+      else if (key->depth.func == PIPE_FUNC_GREATER ||
+               key->depth.func == PIPE_FUNC_GEQUAL)
+         flags |= LP_HIZ_CULL_GREATER;
+   }
+
+   if (key->depth.writemask) {
+      /* Passing fragments can only move the depth values one way. */
+      if (key->depth.func == PIPE_FUNC_LESS ||
+          key->depth.func == PIPE_FUNC_LEQUAL)
+         flags |= LP_HIZ_WRITE_MIN;
+      else if (key->depth.func == PIPE_FUNC_GREATER ||
+               key->depth.func == PIPE_FUNC_GEQUAL)
+         flags |= LP_HIZ_WRITE_MAX;
+      else if (key->depth.func != PIPE_FUNC_NEVER)
+         flags |= LP_HIZ_WRITE_MIN | LP_HIZ_WRITE_MAX;
+
+      if (info->writes_z)
+         flags |= LP_HIZ_WRITE_ANY;
+      else if (!key->stencil[0].enabled && !key->alpha.enabled &&
+               !key->blend.alpha_to_coverage && !key->multisample &&
+               !info->uses_kill && !info->writes_samplemask &&
+               (flags & (LP_HIZ_CULL_LESS | LP_HIZ_CULL_GREATER) ||
+                key->depth.func == PIPE_FUNC_ALWAYS))
+         flags |= LP_HIZ_ACCEPT;
+   }
+
+   task->hiz_flags = flags;
 }
 
 
@@ -594,6 +1126,12 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
 
+   if (task->resident) {
+      if (task->resident_dirty)
+         lp_rast_tile_store(task);
+      task->resident = FALSE;
+   }
+
    /* debug */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
@@ -646,6 +1184,53 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
 };
 
 
+/**
+ * Write the deferred clears of the current tile to memory, before a command
+ * reads or partially writes the tile.  With drop_color the color clears are
+ * forgotten instead, as the command overwrites the whole color tile, and a
+ * z/stencil clear stays pending.
+ */
+static void
+lp_rast_write_pending_clears(struct lp_rasterizer_task *task,
+                             boolean drop_color)
+{
+   const struct lp_scene *scene = task->scene;
+   unsigned i;
+
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      struct llvmpipe_tile_clear *clear = task->color_clear[i];
+      if (clear && clear->pending) {
+         if (drop_color) {
+            /* nothing to write */
+         }
+         else if (task->ms_uniform && scene->cbufs[i].nr_samples > 1) {
+            /* All samples are equal, store only the first. */
+            write_color_tile(task, i, &clear->value.color, 1);
+            set_uniform_tile(task, i);
+         }
+         else {
+            write_color_tile(task, i, &clear->value.color,
+                             scene->cbufs[i].nr_samples);
+         }
+         clear->pending = FALSE;
+         p_atomic_dec(&scene->cbufs[i].deferred_clears->num_pending_clears);
+      }
+   }
+
+   if (task->zs_clear && task->zs_clear->pending) {
+      if (drop_color)
+         return;
+      write_zstencil_tile(task, task->zs_clear->value.zs,
+                          util_pack64_mask_z_stencil(scene->fb.zsbuf->format,
+                                                     0xffffffff, 0xff));
+      task->zs_clear->pending = FALSE;
+      p_atomic_dec(&scene->zsbuf.deferred_clears->num_pending_clears);
+   }
+
+   task->clears_pending = FALSE;
+}
+
+
 static void
 do_rasterize_bin(struct lp_rasterizer_task *task,
                  const struct cmd_bin *bin,
@@ -659,6 +1244,28 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
+         switch (block->cmd[k]) {
+         case LP_RAST_OP_CLEAR_COLOR:
+         case LP_RAST_OP_CLEAR_ZSTENCIL:
+         case LP_RAST_OP_SET_STATE:
+         case LP_RAST_OP_BEGIN_QUERY:
+         case LP_RAST_OP_END_QUERY:
+            break;
+         case LP_RAST_OP_SHADE_TILE_OPAQUE:
+            /*
+             * Opaque variants write every channel of the single color
+             * buffer and neither test nor write depth/stencil.
+             */
+            if (task->clears_pending && !block->arg[k].shade_tile->disable)
+               lp_rast_write_pending_clears(task, TRUE);
+            task->resident_dirty = TRUE;
+            break;
+         default:
+            if (task->clears_pending)
+               lp_rast_write_pending_clears(task, FALSE);
+            task->resident_dirty = TRUE;
+            break;
+         }
          dispatch[block->cmd[k]]( task, block->arg[k] );
       }
    }
@@ -1024,7 +1631,11 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       pipe_semaphore_destroy(&rast->tasks[i].work_done);
    }
    for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+      unsigned j;
       align_free(rast->tasks[i].thread_data.cache);
+      for (j = 0; j < PIPE_MAX_COLOR_BUFS; j++)
+         align_free(rast->tasks[i].resident_color[j]);
+      align_free(rast->tasks[i].resident_depth);
    }
 
    /* for synchronizing rasterization threads */
@@ -0,0 +1,227 @@
+/**************************************************************************
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Whole tile shading of plain texture blits with 8-bit integer code.
+ *
+ * When a tile is fully covered by a draw whose variant passed
+ * llvmpipe_fs_variant_linear(), and the texture coordinates map pixels
+ * 1:1 onto texel centers, every pixel reads exactly one texel.  The
+ * generated code would then unpack each texel to floats, interpolate and
+ * sample 4x4 pixels at a time and pack the result back; here the rows are
+ * simply copied (or blended) straight from the texture.  Anything else,
+ * e.g. scaled or rotated blits, falls back to the generated code.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "util/u_math.h"
+#include "lp_rast_priv.h"
+#include "lp_state_fs.h"
+
+
+/** Allowed deviation of texel coordinate gradients from 1:1 */
+#define LINEAR_GRADIENT_EPS (1.0f / 65536.0f)
+
+
+/**
+ * Work out the texel the top left pixel of the tile reads along one axis,
+ * given the texel coordinate at the four corners of the tile.  For nearest
+ * filtering the coordinates must stay well inside a texel, for linear
+ * filtering close enough to its center that the other texel gets no weight.
+ */
+static boolean
+linear_axis(const float coord[4], boolean linear_filter, int *texel)
+{
+   const float lo = linear_filter ? 0.5f - 1.0f / 1024.0f : 0.25f;
+   const float hi = linear_filter ? 0.5f + 1.0f / 1024.0f : 0.75f;
+   unsigned i;
+
+   *texel = (int)floorf(coord[0]);
+
+   for (i = 0; i < 4; i++) {
+      float fract = coord[i] - floorf(coord[i]);
+      if (!(fract >= lo && fract <= hi))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+static void
+blit_row(uint8_t *dst, const uint8_t *src, unsigned width,
+         const struct lp_fs_linear_blit *blit)
+{
+   unsigned i;
+
+   if (!blit->swap_rb && !blit->alpha_one && !blit->blend) {
+      memcpy(dst, src, width * 4);
+      return;
+   }
+
+   for (i = 0; i < width; i++, src += 4, dst += 4) {
+      uint32_t texel, even, odd;
+      unsigned inv_a;
+
+      memcpy(&texel, src, 4);
+      texel = util_le32_to_cpu(texel);
+      if (blit->swap_rb)
+         texel = (texel & 0xff00ff00) | ((texel >> 16) & 0xff) |
+                 ((texel & 0xff) << 16);
+      if (blit->alpha_one)
+         texel |= 0xff000000;
+
+      inv_a = 0xff - (texel >> 24);
+      if (blit->blend && inv_a) {
+         uint32_t pixel;
+
+         /*
+          * texel + pixel * (1 - a) on the even and the odd channels in 16
+          * bit lanes, rounding the multiply like lp_build_mul_norm() and
+          * saturating the add.
+          */
+         memcpy(&pixel, dst, 4);
+         pixel = util_le32_to_cpu(pixel);
+         even = (pixel & 0x00ff00ff) * inv_a;
+         odd = ((pixel >> 8) & 0x00ff00ff) * inv_a;
+         even = (even + ((even >> 8) & 0x00ff00ff) + 0x00800080) >> 8;
+         odd = (odd + ((odd >> 8) & 0x00ff00ff) + 0x00800080) >> 8;
+         even = (even & 0x00ff00ff) + (texel & 0x00ff00ff);
+         odd = (odd & 0x00ff00ff) + ((texel >> 8) & 0x00ff00ff);
+         even |= ((even >> 8) & 0x00010001) * 0xff;
+         odd |= ((odd >> 8) & 0x00010001) * 0xff;
+         texel = (even & 0x00ff00ff) | ((odd & 0x00ff00ff) << 8);
+      }
+
+      texel = util_cpu_to_le32(texel);
+      memcpy(dst, &texel, 4);
+   }
+}
+
+
+/**
+ * Shade a fully covered tile of a linear blit variant.
+ * \return FALSE if the tile must be shaded by the generated code instead
+ */
+boolean
+lp_rast_linear_shade_tile(struct lp_rasterizer_task *task,
+                          const struct lp_rast_shader_inputs *inputs)
+{
+   const struct lp_scene *scene = task->scene;
+   const struct lp_rast_state *state = task->state;
+   const struct lp_fragment_shader_variant *variant = state->variant;
+   const struct lp_fs_blit_info *info = &variant->shader->blit;
+   const struct lp_jit_texture *tex = &state->jit_context.textures[info->unit];
+   const unsigned attrib = variant->shader->inputs[info->input].src_index;
+   const float (*a0)[4] = (const float (*)[4])GET_A0(inputs);
+   const float (*dadx)[4] = (const float (*)[4])GET_DADX(inputs);
+   const float (*dady)[4] = (const float (*)[4])GET_DADY(inputs);
+   const unsigned width = task->width, height = task->height;
+   const float x0 = task->x, y0 = task->y;
+   const float x1 = x0 + width - 1, y1 = y0 + height - 1;
+   unsigned level, tex_width, tex_height, row_stride;
+   float scale_s = 1.0f, scale_t = 1.0f;
+   float dsdx, dsdy, dtdx, dtdy;
+   float s[4], t[4];
+   int s0, t0;
+   const uint8_t *src;
+   uint8_t *dst;
+   unsigned dst_stride;
+   unsigned y;
+
+   if (!scene->fb.cbufs[0] || scene->cbufs[0].format_bytes != 4 ||
+       !tex->base)
+      return FALSE;
+
+   /* No perspective: 1/w must be constant one. */
+   if (a0[0][3] != 1.0f || dadx[0][3] != 0.0f || dady[0][3] != 0.0f)
+      return FALSE;
+
+   level = tex->first_level;
+   tex_width = u_minify(tex->width, level);
+   tex_height = u_minify(tex->height, level);
+   row_stride = tex->row_stride[level];
+   if (!row_stride)
+      return FALSE;
+
+   if (variant->linear_blit.normalized_coords) {
+      scale_s = (float)tex_width;
+      scale_t = (float)tex_height;
+   }
+
+   dsdx = dadx[attrib][info->chan_s] * scale_s;
+   dsdy = dady[attrib][info->chan_s] * scale_s;
+   dtdx = dadx[attrib][info->chan_t] * scale_t;
+   dtdy = dady[attrib][info->chan_t] * scale_t;
+
+   if (fabsf(dsdx - 1.0f) > LINEAR_GRADIENT_EPS ||
+       fabsf(dtdy - 1.0f) > LINEAR_GRADIENT_EPS ||
+       fabsf(dsdy) > LINEAR_GRADIENT_EPS ||
+       fabsf(dtdx) > LINEAR_GRADIENT_EPS)
+      return FALSE;
+
+   /*
+    * Texel coordinates at the tile corners, minus the pixel offset, so that
+    * a 1:1 blit reads texel s0 + x at pixel x of the tile.
+    */
+   s[0] = a0[attrib][info->chan_s] * scale_s + dsdx * x0 + dsdy * y0;
+   s[1] = s[0] + dsdx * (x1 - x0) - (x1 - x0);
+   s[2] = s[0] + dsdy * (y1 - y0);
+   s[3] = s[1] + dsdy * (y1 - y0);
+   t[0] = a0[attrib][info->chan_t] * scale_t + dtdx * x0 + dtdy * y0;
+   t[1] = t[0] + dtdx * (x1 - x0);
+   t[2] = t[0] + dtdy * (y1 - y0) - (y1 - y0);
+   t[3] = t[2] + dtdx * (x1 - x0);
+
+   if (!linear_axis(s, variant->linear_blit.linear_filter, &s0) ||
+       !linear_axis(t, variant->linear_blit.linear_filter, &t0))
+      return FALSE;
+
+   /* The blit must not need any wrapping. */
+   if (s0 < 0 || t0 < 0 ||
+       s0 + width > tex_width || t0 + height > tex_height)
+      return FALSE;
+
+   src = (const uint8_t *)tex->base + tex->mip_offsets[level] +
+         t0 * row_stride + s0 * 4;
+   dst = lp_rast_get_color_block_pointer(task, 0, task->x, task->y,
+                                         inputs->layer + inputs->view_index);
+   dst_stride = task->color_stride[0];
+
+   for (y = 0; y < height; y++) {
+      blit_row(dst, src, width, &variant->linear_blit);
+      src += row_stride;
+      dst += dst_stride;
+   }
+
+   /* Keep pipeline statistics in line with the generated code. */
+   task->thread_data.ps_invocations +=
+      DIV_ROUND_UP(width, 4) * DIV_ROUND_UP(height, 4);
+
+   return TRUE;
+}
@@ -29,6 +29,7 @@
 #define LP_RAST_PRIV_H
 
 #include "util/format/u_format.h"
+#include "util/u_math.h"
 #include "util/u_thread.h"
 #include "gallivm/lp_bld_debug.h"
 #include "lp_memory.h"
@@ -42,6 +43,22 @@
 #define TILE_VECTOR_HEIGHT 4
 #define TILE_VECTOR_WIDTH 4
 
+/**
+ * The rasterizer keeps bounds of the depth values in each 16x16 block of
+ * the current tile, so triangles which fail the depth test everywhere in
+ * a block can be skipped without running the shader.
+ */
+#define LP_HIZ_BLOCK_SIZE 16
+#define LP_HIZ_BLOCKS (TILE_SIZE / LP_HIZ_BLOCK_SIZE)
+
+/* lp_rasterizer_task::hiz_flags, derived from the current state */
+#define LP_HIZ_CULL_LESS     0x1   /**< fragments with z above zmax fail */
+#define LP_HIZ_CULL_GREATER  0x2   /**< fragments with z below zmin fail */
+#define LP_HIZ_WRITE_MIN     0x4   /**< depth writes may lower zmin */
+#define LP_HIZ_WRITE_MAX     0x8   /**< depth writes may raise zmax */
+#define LP_HIZ_WRITE_ANY     0x10  /**< written depth isn't the interpolated z */
+#define LP_HIZ_ACCEPT        0x20  /**< passing fragments write every sample */
+
 /* If we crash in a jitted function, we can examine jit_line and jit_state
  * to get some info.  This is not thread-safe, however.
  */
@@ -79,6 +96,10 @@ struct cmd_bin;
 /**
  * Per-thread rasterization state
  */
+/** Size of a tile copy, for the largest (128 bit) pixel formats */
+#define LP_RESIDENT_TILE_SIZE (TILE_SIZE * TILE_SIZE * 16)
+
+
 struct lp_rasterizer_task
 {
    const struct cmd_bin *bin;
@@ -90,6 +111,39 @@ struct lp_rasterizer_task
 
    uint8_t *color_tiles[PIPE_MAX_COLOR_BUFS];
    uint8_t *depth_tile;
+   unsigned color_stride[PIPE_MAX_COLOR_BUFS]; /**< row stride of color_tiles */
+   unsigned depth_stride;                      /**< row stride of depth_tile */
+
+   /**
+    * Thread-local copies of the current tile, with LP_PERF=tile_resident.
+    * Allocated on first use, LP_RESIDENT_TILE_SIZE bytes each.
+    */
+   uint8_t *resident_color[PIPE_MAX_COLOR_BUFS];
+   uint8_t *resident_depth;
+   boolean resident;       /**< color_tiles/depth_tile point at the copies */
+   boolean resident_dirty; /**< the copies have been written to */
+
+   /**
+    * Deferred clear state of the current tile in the bound resources, or
+    * NULL where clears are written to memory right away.
+    */
+   struct llvmpipe_tile_clear *color_clear[PIPE_MAX_COLOR_BUFS];
+   struct llvmpipe_tile_clear *zs_clear;
+   boolean clears_pending; /**< any of the above pending */
+
+   /**
+    * All multisampled color buffers have the above, and so track the 4x4
+    * blocks of the tile whose samples are equal, see
+    * lp_rast_begin_uniform_block().
+    */
+   boolean ms_uniform;
+   uint64_t uniform_vis_counter; /**< vis_counter before a uniform block */
+
+   /** Bounds of the layer 0 depth values of each 16x16 block of the tile */
+   float hiz_zmin[LP_HIZ_BLOCKS][LP_HIZ_BLOCKS];
+   float hiz_zmax[LP_HIZ_BLOCKS][LP_HIZ_BLOCKS];
+   float hiz_eps;          /**< depth buffer quantization step */
+   unsigned hiz_flags;     /**< LP_HIZ_x */
 
    /** "back" pointer */
    struct lp_rasterizer *rast;
@@ -142,6 +196,10 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                          unsigned x, unsigned y,
                          unsigned mask);
 
+boolean
+lp_rast_linear_shade_tile(struct lp_rasterizer_task *task,
+                          const struct lp_rast_shader_inputs *inputs);
+
 
 /**
  * Get the pointer to a 4x4 color block (within a 64x64 tile).
@@ -172,7 +230,7 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->cbufs[buf].format_bytes +
-                  py * task->scene->cbufs[buf].stride;
+                  py * task->color_stride[buf];
    color = task->color_tiles[buf] + pixel_offset;
 
    if (layer) {
@@ -206,7 +264,7 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
    py = y % TILE_SIZE;
 
    pixel_offset = px * task->scene->zsbuf.format_bytes +
-                  py * task->scene->zsbuf.stride;
+                  py * task->depth_stride;
    depth = task->depth_tile + pixel_offset;
 
    if (layer) {
@@ -219,6 +277,173 @@ lp_rast_get_depth_block_pointer(struct lp_rasterizer_task *task,
 
 
 
+/**
+ * Compute conservative bounds of the depth values a triangle produces
+ * within a rectangle of the tile, as they'd be stored in the depth buffer.
+ * \param x, y, w, h  rectangle in window coords
+ * \return FALSE if no bounds can be given
+ */
+static inline boolean
+lp_rast_hiz_range(const struct lp_rasterizer_task *task,
+                  const struct lp_rast_shader_inputs *inputs,
+                  int x, int y, int w, int h,
+                  float *zmin, float *zmax)
+{
+   const float a0 = GET_A0(inputs)[0][2];
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const float x0 = (float)x, x1 = (float)(x + w);
+   const float y0 = (float)y, y1 = (float)(y + h);
+   float lo, hi, err;
+
+   lo = a0 + MIN2(dzdx * x0, dzdx * x1) + MIN2(dzdy * y0, dzdy * y1);
+   hi = a0 + MAX2(dzdx * x0, dzdx * x1) + MAX2(dzdy * y0, dzdy * y1);
+
+   /*
+    * The coefficients refer to (0,0), so the shader's interpolation may
+    * round differently from ours by a few ulps of the largest term.
+    */
+   err = (fabsf(a0) + fabsf(dzdx) * x1 + fabsf(dzdy) * y1) * (1.0f / (1 << 20));
+   lo -= err;
+   hi += err;
+   if (!(lo <= hi))
+      return FALSE;
+
+   if (task->state->variant->key.depth_clamp) {
+      const struct lp_jit_viewport *vp =
+         &task->state->jit_context.viewports[inputs->viewport_index];
+      lo = CLAMP(lo, vp->min_depth, vp->max_depth);
+      hi = CLAMP(hi, vp->min_depth, vp->max_depth);
+   }
+   else {
+      lo = CLAMP(lo, 0.0f, 1.0f);
+      hi = CLAMP(hi, 0.0f, 1.0f);
+   }
+
+   *zmin = lo - task->hiz_eps;
+   *zmax = hi + task->hiz_eps;
+   return TRUE;
+}
+
+
+/**
+ * Check whether a triangle fails the depth test everywhere within a
+ * rectangle of the tile.
+ * \param x, y, w, h  rectangle in window coords
+ */
+static inline boolean
+lp_rast_hiz_cull(const struct lp_rasterizer_task *task,
+                 const struct lp_rast_shader_inputs *inputs,
+                 int x, int y, int w, int h)
+{
+   unsigned bx0, by0, bx1, by1, bx, by;
+   float zmin, zmax;
+
+   if (!(task->hiz_flags & (LP_HIZ_CULL_LESS | LP_HIZ_CULL_GREATER)) ||
+       inputs->layer + inputs->view_index != 0)
+      return FALSE;
+
+   bx0 = (x - task->x) / LP_HIZ_BLOCK_SIZE;
+   by0 = (y - task->y) / LP_HIZ_BLOCK_SIZE;
+   bx1 = MIN2((x + w - 1 - task->x) / LP_HIZ_BLOCK_SIZE, LP_HIZ_BLOCKS - 1);
+   by1 = MIN2((y + h - 1 - task->y) / LP_HIZ_BLOCK_SIZE, LP_HIZ_BLOCKS - 1);
+
+   if (!lp_rast_hiz_range(task, inputs, x, y, w, h, &zmin, &zmax))
+      return FALSE;
+
+   for (by = by0; by <= by1; by++) {
+      for (bx = bx0; bx <= bx1; bx++) {
+         if (task->hiz_flags & LP_HIZ_CULL_LESS) {
+            if (!(zmin > task->hiz_zmax[by][bx]))
+               return FALSE;
+         }
+         else {
+            if (!(zmax < task->hiz_zmin[by][bx]))
+               return FALSE;
+         }
+      }
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Account for the depth writes of shading a 4x4 block.
+ * \param x, y location of 4x4 block in window coords
+ */
+static inline void
+lp_rast_hiz_update(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   int x, int y)
+{
+   const unsigned bx = (x - task->x) / LP_HIZ_BLOCK_SIZE;
+   const unsigned by = (y - task->y) / LP_HIZ_BLOCK_SIZE;
+   float zmin = -FLT_MAX, zmax = FLT_MAX;
+
+   if (!(task->hiz_flags & (LP_HIZ_WRITE_MIN | LP_HIZ_WRITE_MAX)) ||
+       inputs->layer + inputs->view_index != 0 ||
+       bx >= LP_HIZ_BLOCKS || by >= LP_HIZ_BLOCKS)
+      return;
+
+   if (!(task->hiz_flags & LP_HIZ_WRITE_ANY) &&
+       !lp_rast_hiz_range(task, inputs, x, y, 4, 4, &zmin, &zmax)) {
+      zmin = -FLT_MAX;
+      zmax = FLT_MAX;
+   }
+
+   if (task->hiz_flags & LP_HIZ_WRITE_MIN)
+      task->hiz_zmin[by][bx] = MIN2(task->hiz_zmin[by][bx], zmin);
+   if (task->hiz_flags & LP_HIZ_WRITE_MAX)
+      task->hiz_zmax[by][bx] = MAX2(task->hiz_zmax[by][bx], zmax);
+}
+
+
+/**
+ * A triangle is about to be shaded on a whole 16x16 block.  If all its
+ * fragments pass the depth test there, they replace every depth value in
+ * the block, so the block's bounds become the triangle's.
+ * \param x, y location of 16x16 block in window coords
+ */
+static inline void
+lp_rast_hiz_accept(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   int x, int y)
+{
+   const unsigned bx = (x - task->x) / LP_HIZ_BLOCK_SIZE;
+   const unsigned by = (y - task->y) / LP_HIZ_BLOCK_SIZE;
+   float zmin, zmax;
+
+   if (!(task->hiz_flags & LP_HIZ_ACCEPT) ||
+       inputs->layer + inputs->view_index != 0 ||
+       !lp_rast_hiz_range(task, inputs, x, y,
+                          LP_HIZ_BLOCK_SIZE, LP_HIZ_BLOCK_SIZE,
+                          &zmin, &zmax))
+      return;
+
+   if (task->hiz_flags & LP_HIZ_CULL_LESS) {
+      if (!(zmax < task->hiz_zmin[by][bx]))
+         return;
+   }
+   else if (task->hiz_flags & LP_HIZ_CULL_GREATER) {
+      if (!(zmin > task->hiz_zmax[by][bx]))
+         return;
+   }
+
+   task->hiz_zmin[by][bx] = zmin;
+   task->hiz_zmax[by][bx] = zmax;
+}
+
+
+boolean
+lp_rast_begin_uniform_block(struct lp_rasterizer_task *task,
+                            unsigned x, unsigned y, uint64_t *mask,
+                            unsigned *sample_stride);
+
+void
+lp_rast_end_uniform_block(struct lp_rasterizer_task *task);
+
+
 /**
  * Shade all pixels in a 4x4 block.  The fragment code omits the
  * triangle in/out tests.
@@ -238,12 +463,13 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    uint8_t *depth = NULL;
    unsigned depth_stride = 0;
    unsigned depth_sample_stride = 0;
+   boolean uniform;
    unsigned i;
 
    /* color buffer */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       if (scene->fb.cbufs[i]) {
-         stride[i] = scene->cbufs[i].stride;
+         stride[i] = task->color_stride[i];
          sample_stride[i] = scene->cbufs[i].sample_stride;
          color[i] = lp_rast_get_color_block_pointer(task, i, x, y,
                                                     inputs->layer + inputs->view_index);
@@ -258,7 +484,7 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    if (scene->zsbuf.map) {
       depth = lp_rast_get_depth_block_pointer(task, x, y, inputs->layer + inputs->view_index);
       depth_sample_stride = scene->zsbuf.sample_stride;
-      depth_stride = scene->zsbuf.stride;
+      depth_stride = task->depth_stride;
    }
 
    uint64_t mask = 0;
@@ -274,6 +500,11 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
       task->thread_data.raster_state.viewport_index = inputs->viewport_index;
       task->thread_data.raster_state.view_index = inputs->view_index;
 
+      lp_rast_hiz_update(task, inputs, x, y);
+
+      uniform = task->ms_uniform &&
+                lp_rast_begin_uniform_block(task, x, y, &mask, sample_stride);
+
       /* run shader on 4x4 block */
       BEGIN_JIT_CALL(state, task);
       variant->jit_function[RAST_WHOLE]( &state->jit_context,
@@ -291,6 +522,9 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
                                          sample_stride,
                                          depth_sample_stride);
       END_JIT_CALL();
+
+      if (uniform)
+         lp_rast_end_uniform_block(task);
    }
 }
 
@@ -277,6 +277,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    struct { unsigned mask:16; unsigned i:8; unsigned j:8; } out[16];
    unsigned nr = 0;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
    __m128i p1 = _mm_loadu_si128((__m128i *)&plane[1]);
@@ -386,6 +389,9 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    unsigned x = (arg.triangle.plane_mask & 0xff) + task->x;
    unsigned y = (arg.triangle.plane_mask >> 8) + task->y;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 4, 4))
+      return;
+
    /* p0 and p2 are aligned, p1 is not (plane size 24 bytes). */
    __m128i p0 = _mm_load_si128((__m128i *)&plane[0]); /* clo, chi, dcdx, dcdy */
    __m128i p1 = _mm_loadu_si128((__m128i *)&plane[1]);
@@ -561,6 +567,9 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    struct { unsigned mask:16; unsigned i:8; unsigned j:8; } out[16];
    unsigned nr = 0;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    __m128i p0 = lp_plane_to_m128i(&plane[0]); /* c, dcdx, dcdy, eo */
    __m128i p1 = lp_plane_to_m128i(&plane[1]); /* c, dcdx, dcdy, eo */
    __m128i p2 = lp_plane_to_m128i(&plane[2]); /* c, dcdx, dcdy, eo */
@@ -212,6 +212,9 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
       return;
    }
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, TILE_SIZE, TILE_SIZE))
+      return;
+
    outmask = 0;                 /* outside one or more trivial reject planes */
    partmask = 0;                /* outside one or more trivial accept planes */
 
@@ -322,6 +325,9 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       partial_mask &= ~(1 << i);
 
+      if (lp_rast_hiz_cull(task, &tri->inputs, px, py, 16, 16))
+         continue;
+
       LP_COUNT(nr_partially_covered_16);
       TAG(do_block_16)(task, tri, plane, px, py, cx);
    }
@@ -337,7 +343,11 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       inmask &= ~(1 << i);
 
+      if (lp_rast_hiz_cull(task, &tri->inputs, px, py, 16, 16))
+         continue;
+
       LP_COUNT(nr_fully_covered_16);
+      lp_rast_hiz_accept(task, &tri->inputs, px, py);
       block_full_16(task, tri, px, py);
    }
 }
@@ -366,6 +376,9 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16, 16))
+      return;
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -431,6 +444,9 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 4, 4))
+      return;
+
    /* Iterate over partials:
     */
    {
@@ -36,6 +36,7 @@
 #include "lp_debug.h"
 #include "lp_context.h"
 #include "lp_state_fs.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -101,8 +102,11 @@ lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
    mtx_destroy(&scene->mutex);
-   assert(scene->data.head->next == NULL);
-   FREE(scene->data.head);
+   /* bin worker scenes only own data blocks while binning */
+   if (scene->data.head) {
+      assert(scene->data.head->next == NULL);
+      FREE(scene->data.head);
+   }
    FREE(scene);
 }
 
@@ -164,9 +168,12 @@ init_scene_texture(struct lp_scene_surface *ssurf, struct pipe_surface *psurf)
       ssurf->sample_stride = 0;
       ssurf->nr_samples = 0;
       ssurf->map = NULL;
+      ssurf->deferred_clears = NULL;
       return;
    }
 
+   ssurf->deferred_clears = NULL;
+
    if (llvmpipe_resource_is_texture(psurf->texture)) {
       ssurf->stride = llvmpipe_resource_stride(psurf->texture,
                                                psurf->u.tex.level);
@@ -194,23 +201,71 @@ init_scene_texture(struct lp_scene_surface *ssurf, struct pipe_surface *psurf)
    }
 }
 
+/**
+ * Can the rasterizer keep the clears of the surface's tiles in its
+ * resource's tile_clears, instead of writing them to memory?  Only if the
+ * tiles of the scene are exactly those of level 0 of the resource, and the
+ * scene doesn't also read the resource.
+ */
+static void
+init_deferred_clears(struct lp_scene *scene, struct lp_scene_surface *ssurf,
+                     struct pipe_surface *psurf)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(psurf->texture);
+
+   if (!lpr->clear_deferrable ||
+       psurf->u.tex.level != 0 ||
+       psurf->u.tex.first_layer != 0 ||
+       scene->fb_max_layer != 0 ||
+       scene->fb.width != psurf->texture->width0 ||
+       scene->fb.height != psurf->texture->height0 ||
+       lp_scene_is_resource_referenced(scene, psurf->texture)) {
+      llvmpipe_resource_resolve_clears(psurf->texture, FALSE);
+      return;
+   }
+
+   ssurf->deferred_clears = lpr;
+}
+
+
 void
 lp_scene_begin_rasterization(struct lp_scene *scene)
 {
    const struct pipe_framebuffer_state *fb = &scene->fb;
+   const struct resource_ref *ref;
    int i;
 
    //LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
+   /* Textures the scene reads must hold the cleared values. */
+   for (ref = scene->resources; ref; ref = ref->next) {
+      for (i = 0; i < ref->count; i++)
+         llvmpipe_resource_resolve_clears(ref->resource[i], FALSE);
+   }
+
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
       struct pipe_surface *cbuf = scene->fb.cbufs[i];
       init_scene_texture(&scene->cbufs[i], cbuf);
+      if (cbuf && llvmpipe_resource_is_texture(cbuf->texture))
+         init_deferred_clears(scene, &scene->cbufs[i], cbuf);
    }
 
    if (fb->zsbuf) {
       struct pipe_surface *zsbuf = scene->fb.zsbuf;
       init_scene_texture(&scene->zsbuf, zsbuf);
+      if (llvmpipe_resource_is_texture(zsbuf->texture))
+         init_deferred_clears(scene, &scene->zsbuf, zsbuf);
+   }
+
+   /* Tile copies hold a single layer and sample of each buffer. */
+   scene->tile_resident = (LP_PERF & PERF_TILE_RESIDENT) &&
+                          scene->fb_max_layer == 0;
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] && scene->cbufs[i].nr_samples > 1)
+         scene->tile_resident = FALSE;
    }
+   if (fb->zsbuf && scene->zsbuf.nr_samples > 1)
+      scene->tile_resident = FALSE;
 }
 
 
@@ -118,6 +118,7 @@ struct data_block_list {
 struct resource_ref;
 
 struct shader_ref;
+struct llvmpipe_resource;
 
 struct lp_scene_surface {
    uint8_t *map;
@@ -126,6 +127,9 @@ struct lp_scene_surface {
    unsigned format_bytes;
    unsigned sample_stride;
    unsigned nr_samples;
+
+   /** The surface's resource if its tile clears may be deferred, or NULL */
+   struct llvmpipe_resource *deferred_clears;
 };
 
 /**
@@ -160,6 +164,9 @@ struct lp_scene {
    /* max samples for bound framebuffer */
    unsigned fb_max_samples;
 
+   /* Rasterize tiles in the threads' own copies (LP_PERF=tile_resident) */
+   boolean tile_resident;
+
    /** the framebuffer to render the scene into */
    struct pipe_framebuffer_state fb;
 
@@ -89,6 +89,13 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "no_hiz",         PERF_NO_HIZ, NULL },
+   { "tiled_tex",      PERF_TILED_TEX, NULL },
+   { "no_fastblit",    PERF_NO_FASTBLIT, NULL },
+   { "no_tiered",      PERF_NO_TIERED, NULL },
+   { "no_defer_clear", PERF_NO_DEFER_CLEAR, NULL },
+   { "tile_resident",  PERF_TILE_RESIDENT, NULL },
+   { "no_ms_uniform",  PERF_NO_MS_UNIFORM, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -808,6 +815,9 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
    struct sw_winsys *winsys = screen->winsys;
 
+   if (screen->late_init_done)
+      util_queue_destroy(&screen->fs_tier_queue);
+
    if (screen->cs_tpool)
       lp_cs_tpool_destroy(screen->cs_tpool);
 
@@ -971,6 +981,17 @@ llvmpipe_screen_late_init(struct llvmpipe_screen *screen)
       goto out;
    }
 
+   if (!util_queue_init(&screen->fs_tier_queue, "lp_fs_tier", 32, 1,
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL |
+                        UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY, NULL)) {
+      lp_cs_tpool_destroy(screen->cs_tpool);
+      screen->cs_tpool = NULL;
+      lp_rast_destroy(screen->rast);
+      screen->rast = NULL;
+      ret = false;
+      goto out;
+   }
+
    lp_disk_cache_create(screen);
    screen->late_init_done = true;
 out:
@@ -1040,6 +1061,11 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
 #endif
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
    screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
+   screen->num_bin_threads = MIN2(debug_get_num_option("LP_BIN_THREADS", 0),
+                                  LP_MAX_THREADS);
+   screen->variant_budget.max =
+      (uint64_t)debug_get_num_option("LP_VARIANT_BUDGET_MB",
+                                     LP_DEFAULT_VARIANT_BUDGET_MB) << 20;
 
    (void) mtx_init(&screen->cs_mutex, mtx_plain);
    (void) mtx_init(&screen->rast_mutex, mtx_plain);
@@ -37,8 +37,10 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
 #include "gallivm/lp_bld_misc.h"
+#include "gallivm/lp_bld_init.h"
 
 struct sw_winsys;
 struct lp_cs_tpool;
@@ -50,6 +52,7 @@ struct llvmpipe_screen
    struct sw_winsys *winsys;
 
    unsigned num_threads;
+   unsigned num_bin_threads;
 
    /* Increments whenever textures are modified.  Contexts can track this.
     */
@@ -61,6 +64,15 @@ struct llvmpipe_screen
    struct lp_cs_tpool *cs_tpool;
    mtx_t cs_mutex;
 
+   /* Recompiles hot fragment shader variants, see llvmpipe_update_fs_tier() */
+   struct util_queue fs_tier_queue;
+
+   /*
+    * JIT code of the fragment, compute and draw module shader variants
+    * cached by all contexts of this screen.
+    */
+   struct gallivm_variant_budget variant_budget;
+
    bool use_tgsi;
    bool allow_cl;
 
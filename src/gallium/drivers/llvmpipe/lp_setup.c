@@ -932,7 +932,10 @@ lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
-               jit_tex->base = lp_tex->tex_data;
+               if (llvmpipe_sampler_view_is_tiled(view, &setup->fb))
+                  jit_tex->base = lp_tex->tiled_data;
+               else
+                  jit_tex->base = lp_tex->tex_data;
             }
             else {
               jit_tex->base = lp_tex->data;
@@ -1317,6 +1320,19 @@ try_update_scene_state( struct lp_setup_context *setup )
                }
             }
          }
+
+         /* Likewise for image textures, whose deferred clears must be
+          * resolved before the scene runs, see lp_scene_begin_rasterization().
+          */
+         for (i = 0; i < ARRAY_SIZE(setup->images); i++) {
+            struct pipe_resource *res = setup->images[i].current.resource;
+            if (res && llvmpipe_resource_is_texture(res)) {
+               if (!lp_scene_add_resource_reference(scene, res, new_scene)) {
+                  assert(!new_scene);
+                  return FALSE;
+               }
+            }
+         }
       }
    }
 
@@ -1451,6 +1467,8 @@ lp_setup_destroy( struct lp_setup_context *setup )
 
    lp_fence_reference(&setup->last_fence, NULL);
 
+   lp_setup_destroy_bin_workers(setup);
+
    FREE( setup );
 }
 
@@ -1507,6 +1525,10 @@ lp_setup_create( struct pipe_context *pipe,
    setup->framebuffer.x1 = -1;
    setup->framebuffer.y1 = -1;
 
+   /* Last, as nothing after it may fail and leave the threads running. */
+   if (screen->num_bin_threads > 1)
+      lp_setup_init_bin_workers(setup, screen->num_bin_threads);
+
    return setup;
 
 no_scenes:
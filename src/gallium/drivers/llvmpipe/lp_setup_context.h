@@ -43,6 +43,7 @@
 #include "draw/draw_vbuf.h"
 #include "util/u_rect.h"
 #include "util/u_pack_color.h"
+#include "util/u_queue.h"
 
 #define LP_SETUP_NEW_FS          0x01
 #define LP_SETUP_NEW_CONSTANTS   0x02
@@ -52,6 +53,7 @@
 #define LP_SETUP_NEW_SSBOS       0x20
 
 struct lp_setup_variant;
+struct lp_setup_bin_worker;
 
 
 /** Max number of scenes */
@@ -88,6 +90,15 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+
+   /** Threads binning large triangle batches in parallel, see
+    * lp_setup_bin_triangles_parallel().  num_bin_threads counts the
+    * calling thread too.
+    */
+   unsigned num_bin_threads;
+   struct util_queue bin_queue;
+   struct lp_setup_bin_worker *bin_workers;
+
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
@@ -202,6 +213,15 @@ void lp_setup_choose_point( struct lp_setup_context *setup );
 
 void lp_setup_init_vbuf(struct lp_setup_context *setup);
 
+boolean lp_setup_init_bin_workers(struct lp_setup_context *setup,
+                                  unsigned num_threads);
+void lp_setup_destroy_bin_workers(struct lp_setup_context *setup);
+boolean lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                        const void *vertex_buffer,
+                                        unsigned stride,
+                                        const ushort *indices,
+                                        unsigned nr);
+
 boolean lp_setup_update_state( struct lp_setup_context *setup,
                             boolean update_scene);
 
@@ -73,6 +73,73 @@ struct fixed_position {
 };
 
 
+/**
+ * What setting up and binning a triangle reads.  The context fills one in
+ * for every triangle it draws, while the bin workers of
+ * lp_setup_bin_triangles_parallel() get one each, so they never touch the
+ * context.
+ */
+struct lp_setup_binner {
+   struct lp_setup_context *setup;     /**< for restarting, NULL in workers */
+   struct lp_scene *scene;
+   const struct lp_setup_variant *variant;
+   const struct lp_rast_state *stored;
+   const struct u_rect *draw_regions;  /**< unchanged while binning */
+   struct lp_counters *counters;       /**< private to each bin worker */
+   boolean opaque;
+   boolean multisample;
+   boolean flatshade_first;
+   boolean ccw_is_frontface;
+   unsigned bottom_edge_rule;
+   float pixel_offset;
+   int8_t viewport_index_slot;
+   int8_t layer_slot;
+   uint view_index;
+   unsigned fb_width, fb_height;
+};
+
+
+/** Increment the named counter of a binner (only for debug builds) */
+#ifdef DEBUG
+#define BIN_COUNT(binner, counter) (binner)->counters->counter++
+#else
+#define BIN_COUNT(binner, counter) do {} while (0)
+#endif
+
+
+static inline void
+lp_setup_binner_init(struct lp_setup_binner *binner,
+                     struct lp_setup_context *setup)
+{
+   binner->setup = setup;
+   binner->scene = setup->scene;
+   binner->variant = setup->setup.variant;
+   binner->stored = setup->fs.stored;
+   binner->draw_regions = setup->draw_regions;
+   binner->counters = &lp_count;
+   binner->opaque = setup->fs.current.variant->opaque;
+   binner->multisample = setup->multisample;
+   binner->flatshade_first = setup->flatshade_first;
+   binner->ccw_is_frontface = setup->ccw_is_frontface;
+   binner->bottom_edge_rule = setup->bottom_edge_rule;
+   binner->pixel_offset = setup->pixel_offset;
+   binner->viewport_index_slot = setup->viewport_index_slot;
+   binner->layer_slot = setup->layer_slot;
+   binner->view_index = setup->view_index;
+   binner->fb_width = setup->fb.width;
+   binner->fb_height = setup->fb.height;
+}
+
+
+static boolean
+bin_triangle(const struct lp_setup_binner *binner,
+             struct lp_rast_triangle *tri,
+             const struct u_rect *bboxorig,
+             const struct u_rect *bbox,
+             int nr_planes,
+             unsigned viewport_index);
+
+
 /**
  * Alloc space for a new triangle plus the input.a0/dadx/dady arrays
  * immediately after it.
@@ -224,13 +291,13 @@ lp_rast_ms_tri_tab[MAX_PLANES+1] = {
  * \param tx, ty  the tile position in tiles, not pixels
  */
 static boolean
-lp_setup_whole_tile(struct lp_setup_context *setup,
+lp_setup_whole_tile(const struct lp_setup_binner *binner,
                     const struct lp_rast_shader_inputs *inputs,
                     int tx, int ty)
 {
-   struct lp_scene *scene = setup->scene;
+   struct lp_scene *scene = binner->scene;
 
-   LP_COUNT(nr_fully_covered_64);
+   BIN_COUNT(binner, nr_fully_covered_64);
 
    /* if variant is opaque and scissor doesn't effect the tile */
    if (inputs->opaque) {
@@ -253,15 +320,15 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
          lp_scene_bin_reset( scene, tx, ty );
       }
 
-      LP_COUNT(nr_shade_opaque_64);
+      BIN_COUNT(binner, nr_shade_opaque_64);
       return lp_scene_bin_cmd_with_state( scene, tx, ty,
-                                          setup->fs.stored,
+                                          binner->stored,
                                           LP_RAST_OP_SHADE_TILE_OPAQUE,
                                           lp_rast_arg_inputs(inputs) );
    } else {
-      LP_COUNT(nr_shade_64);
+      BIN_COUNT(binner, nr_shade_64);
       return lp_scene_bin_cmd_with_state( scene, tx, ty,
-                                          setup->fs.stored,
+                                          binner->stored,
                                           LP_RAST_OP_SHADE_TILE,
                                           lp_rast_arg_inputs(inputs) );
    }
@@ -274,15 +341,15 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
  * bins for the tiles which we overlap.
  */
 static boolean
-do_triangle_ccw(struct lp_setup_context *setup,
+do_triangle_ccw(const struct lp_setup_binner *binner,
                 struct fixed_position* position,
                 const float (*v0)[4],
                 const float (*v1)[4],
                 const float (*v2)[4],
                 boolean frontfacing )
 {
-   struct lp_scene *scene = setup->scene;
-   const struct lp_setup_variant_key *key = &setup->setup.variant->key;
+   struct lp_scene *scene = binner->scene;
+   const struct lp_setup_variant_key *key = &binner->variant->key;
    struct lp_rast_triangle *tri;
    struct lp_rast_plane *plane;
    const struct u_rect *scissor = NULL;
@@ -297,21 +364,21 @@ do_triangle_ccw(struct lp_setup_context *setup,
    /* Area should always be positive here */
    assert(position->area > 0);
 
-   if (0)
-      lp_setup_print_triangle(setup, v0, v1, v2);
+   if (0 && binner->setup)
+      lp_setup_print_triangle(binner->setup, v0, v1, v2);
 
-   if (setup->flatshade_first) {
+   if (binner->flatshade_first) {
       pv = v0;
    }
    else {
       pv = v2;
    }
-   if (setup->viewport_index_slot > 0) {
-      unsigned *udata = (unsigned*)pv[setup->viewport_index_slot];
+   if (binner->viewport_index_slot > 0) {
+      unsigned *udata = (unsigned*)pv[binner->viewport_index_slot];
       viewport_index = lp_clamp_viewport_idx(*udata);
    }
-   if (setup->layer_slot > 0) {
-      layer = *(unsigned*)pv[setup->layer_slot];
+   if (binner->layer_slot > 0) {
+      layer = *(unsigned*)pv[binner->layer_slot];
       layer = MIN2(layer, scene->fb_max_layer);
    }
 
@@ -322,7 +389,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
        * up needing a bottom-left fill convention, which requires
        * slightly different rounding.
        */
-      int adj = (setup->bottom_edge_rule != 0) ? 1 : 0;
+      int adj = (binner->bottom_edge_rule != 0) ? 1 : 0;
 
       /* Inclusive x0, exclusive x1 */
       bbox.x0 =  MIN3(position->x[0], position->x[1], position->x[2]) >> FIXED_ORDER;
@@ -336,13 +403,13 @@ do_triangle_ccw(struct lp_setup_context *setup,
    if (bbox.x1 < bbox.x0 ||
        bbox.y1 < bbox.y0) {
       if (0) debug_printf("empty bounding box\n");
-      LP_COUNT(nr_culled_tris);
+      BIN_COUNT(binner, nr_culled_tris);
       return TRUE;
    }
 
-   if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bbox)) {
+   if (!u_rect_test_intersection(&binner->draw_regions[viewport_index], &bbox)) {
       if (0) debug_printf("offscreen\n");
-      LP_COUNT(nr_culled_tris);
+      BIN_COUNT(binner, nr_culled_tris);
       return TRUE;
    }
 
@@ -360,7 +427,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
     * Determine how many scissor planes we need, that is drop scissor
     * edges if the bounding box of the tri is fully inside that edge.
     */
-   scissor = &setup->draw_regions[viewport_index];
+   scissor = &binner->draw_regions[viewport_index];
    scissor_planes_needed(s_planes, &bboxpos, scissor);
    nr_planes += s_planes[0] + s_planes[1] + s_planes[2] + s_planes[3];
 
@@ -380,25 +447,25 @@ do_triangle_ccw(struct lp_setup_context *setup,
    tri->v[2][1] = v2[0][1];
 #endif
 
-   LP_COUNT(nr_tris);
+   BIN_COUNT(binner, nr_tris);
 
    /* Setup parameter interpolants:
     */
-   setup->setup.variant->jit_function(v0, v1, v2,
-                                      frontfacing,
-                                      GET_A0(&tri->inputs),
-                                      GET_DADX(&tri->inputs),
-                                      GET_DADY(&tri->inputs));
+   binner->variant->jit_function(v0, v1, v2,
+                                 frontfacing,
+                                 GET_A0(&tri->inputs),
+                                 GET_DADX(&tri->inputs),
+                                 GET_DADY(&tri->inputs));
 
    tri->inputs.frontfacing = frontfacing;
    tri->inputs.disable = FALSE;
-   tri->inputs.opaque = setup->fs.current.variant->opaque;
+   tri->inputs.opaque = binner->opaque;
    tri->inputs.layer = layer;
    tri->inputs.viewport_index = viewport_index;
-   tri->inputs.view_index = setup->view_index;
+   tri->inputs.view_index = binner->view_index;
 
    if (0)
-      lp_dump_setup_coef(&setup->setup.variant->key,
+      lp_dump_setup_coef(&binner->variant->key,
                          (const float (*)[4])GET_A0(&tri->inputs),
                          (const float (*)[4])GET_DADX(&tri->inputs),
                          (const float (*)[4])GET_DADY(&tri->inputs));
@@ -432,7 +499,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
       dcdx_zero_mask = _mm_cmpeq_epi32(dcdx, zero);
       dcdy_neg_mask = _mm_srai_epi32(dcdy, 31);
 
-      top_left_flag = _mm_set1_epi32((setup->bottom_edge_rule == 0) ? ~0 : 0);
+      top_left_flag = _mm_set1_epi32((binner->bottom_edge_rule == 0) ? ~0 : 0);
 
       c_dec = _mm_or_si128(dcdx_neg_mask,
                            _mm_and_si128(dcdx_zero_mask,
@@ -504,8 +571,8 @@ do_triangle_ccw(struct lp_setup_context *setup,
     * XXX this code is effectively disabled for all practical purposes,
     * as the allowed fb size is tiny if FIXED_ORDER is 8.
     */
-   if (setup->fb.width <= MAX_FIXED_LENGTH32 &&
-       setup->fb.height <= MAX_FIXED_LENGTH32 &&
+   if (binner->fb_width <= MAX_FIXED_LENGTH32 &&
+       binner->fb_height <= MAX_FIXED_LENGTH32 &&
        (bbox.x1 - bbox.x0) <= MAX_FIXED_LENGTH32 &&
        (bbox.y1 - bbox.y0) <= MAX_FIXED_LENGTH32) {
       unsigned int bottom_edge;
@@ -550,7 +617,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
       dcdx_zero_mask = vec_cmpeq_epi32(dcdx, zero);
       dcdy_neg_mask = vec_srai_epi32(dcdy, 31);
 
-      bottom_edge = (setup->bottom_edge_rule == 0) ? ~0 : 0;
+      bottom_edge = (binner->bottom_edge_rule == 0) ? ~0 : 0;
       top_left_flag = (__m128i) vec_splats(bottom_edge);
 
       c_inc_mask = vec_or(dcdx_neg_mask,
@@ -620,7 +687,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
             plane[i].c++;
          }
          else if (plane[i].dcdx == 0) {
-            if (setup->bottom_edge_rule == 0){
+            if (binner->bottom_edge_rule == 0){
                /* correct for top-left fill convention:
                 */
                if (plane[i].dcdy > 0) plane[i].c++;
@@ -727,7 +794,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
       assert(plane_s == &plane[nr_planes]);
    }
 
-   return lp_setup_bin_triangle(setup, tri, &bbox, &bboxpos, nr_planes, viewport_index);
+   return bin_triangle(binner, tri, &bbox, &bboxpos, nr_planes, viewport_index);
 }
 
 /*
@@ -758,15 +825,15 @@ floor_pot(uint32_t n)
 }
 
 
-boolean
-lp_setup_bin_triangle(struct lp_setup_context *setup,
-                      struct lp_rast_triangle *tri,
-                      const struct u_rect *bboxorig,
-                      const struct u_rect *bbox,
-                      int nr_planes,
-                      unsigned viewport_index)
+static boolean
+bin_triangle(const struct lp_setup_binner *binner,
+             struct lp_rast_triangle *tri,
+             const struct u_rect *bboxorig,
+             const struct u_rect *bbox,
+             int nr_planes,
+             unsigned viewport_index)
 {
-   struct lp_scene *scene = setup->scene;
+   struct lp_scene *scene = binner->scene;
    struct u_rect trimmed_box = *bbox;   
    int i;
    unsigned cmd;
@@ -798,7 +865,7 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
     * the rasterizer to also respect scissor, etc, just for the rare
     * cases where a small triangle extends beyond the scissor.
     */
-   u_rect_find_intersection(&setup->draw_regions[viewport_index],
+   u_rect_find_intersection(&binner->draw_regions[viewport_index],
                             &trimmed_box);
 
    /* Determine which tile(s) intersect the triangle's bounding box
@@ -820,12 +887,12 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
              */
             assert(px + 4 <= TILE_SIZE);
             assert(py + 4 <= TILE_SIZE);
-            if (setup->multisample)
+            if (binner->multisample)
                cmd = LP_RAST_OP_MS_TRIANGLE_3_4;
             else
                cmd = use_32bits ? LP_RAST_OP_TRIANGLE_32_3_4 : LP_RAST_OP_TRIANGLE_3_4;
             return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
-                                                setup->fs.stored, cmd,
+                                                binner->stored, cmd,
                                                 lp_rast_arg_triangle_contained(tri, px, py) );
          }
 
@@ -845,12 +912,12 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
             assert(px + 16 <= TILE_SIZE);
             assert(py + 16 <= TILE_SIZE);
 
-            if (setup->multisample)
+            if (binner->multisample)
                cmd = LP_RAST_OP_MS_TRIANGLE_3_16;
             else
                cmd = use_32bits ? LP_RAST_OP_TRIANGLE_32_3_16 : LP_RAST_OP_TRIANGLE_3_16;
             return lp_scene_bin_cmd_with_state( scene, ix0, iy0,
-                                                setup->fs.stored, cmd,
+                                                binner->stored, cmd,
                                                 lp_rast_arg_triangle_contained(tri, px, py) );
          }
       }
@@ -862,24 +929,24 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
          assert(px + 16 <= TILE_SIZE);
          assert(py + 16 <= TILE_SIZE);
 
-         if (setup->multisample)
+         if (binner->multisample)
             cmd = LP_RAST_OP_MS_TRIANGLE_4_16;
          else
             cmd = use_32bits ? LP_RAST_OP_TRIANGLE_32_4_16 : LP_RAST_OP_TRIANGLE_4_16;
          return lp_scene_bin_cmd_with_state(scene, ix0, iy0,
-                                            setup->fs.stored, cmd,
+                                            binner->stored, cmd,
                                             lp_rast_arg_triangle_contained(tri, px, py));
       }
 
 
       /* Triangle is contained in a single tile:
        */
-      if (setup->multisample)
+      if (binner->multisample)
          cmd = lp_rast_ms_tri_tab[nr_planes];
       else
          cmd = use_32bits ? lp_rast_32_tri_tab[nr_planes] : lp_rast_tri_tab[nr_planes];
       return lp_scene_bin_cmd_with_state(
-         scene, ix0, iy0, setup->fs.stored, cmd,
+         scene, ix0, iy0, binner->stored, cmd,
          lp_rast_arg_triangle(tri, (1<<nr_planes)-1));
    }
    else
@@ -943,7 +1010,7 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                /* do nothing */
                if (in)
                   break;  /* exiting triangle, all done with this row */
-               LP_COUNT(nr_empty_64);
+               BIN_COUNT(binner, nr_empty_64);
             }
             else if (partial) {
                /* Not trivially accepted by at least one plane -
@@ -952,22 +1019,22 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                int count = util_bitcount(partial);
                in = TRUE;
 
-               if (setup->multisample)
+               if (binner->multisample)
                   cmd = lp_rast_ms_tri_tab[count];
                else
                   cmd = use_32bits ? lp_rast_32_tri_tab[count] : lp_rast_tri_tab[count];
                if (!lp_scene_bin_cmd_with_state( scene, x, y,
-                                                 setup->fs.stored, cmd,
+                                                 binner->stored, cmd,
                                                  lp_rast_arg_triangle(tri, partial) ))
                   goto fail;
 
-               LP_COUNT(nr_partially_covered_64);
+               BIN_COUNT(binner, nr_partially_covered_64);
             }
             else {
                /* triangle covers the whole tile- shade whole tile */
-               LP_COUNT(nr_fully_covered_64);
+               BIN_COUNT(binner, nr_fully_covered_64);
                in = TRUE;
-               if (!lp_setup_whole_tile(setup, &tri->inputs, x, y))
+               if (!lp_setup_whole_tile(binner, &tri->inputs, x, y))
                   goto fail;
             }
 
@@ -994,22 +1061,48 @@ fail:
 }
 
 
+boolean
+lp_setup_bin_triangle(struct lp_setup_context *setup,
+                      struct lp_rast_triangle *tri,
+                      const struct u_rect *bboxorig,
+                      const struct u_rect *bbox,
+                      int nr_planes,
+                      unsigned viewport_index)
+{
+   struct lp_setup_binner binner;
+
+   lp_setup_binner_init(&binner, setup);
+   return bin_triangle(&binner, tri, bboxorig, bbox, nr_planes,
+                       viewport_index);
+}
+
+
 /**
  * Try to draw the triangle, restart the scene on failure.
  */
-static void retry_triangle_ccw( struct lp_setup_context *setup,
+static void retry_triangle_ccw( struct lp_setup_binner *binner,
                                 struct fixed_position* position,
                                 const float (*v0)[4],
                                 const float (*v1)[4],
                                 const float (*v2)[4],
                                 boolean front)
 {
-   if (!do_triangle_ccw( setup, position, v0, v1, v2, front ))
+   if (!do_triangle_ccw( binner, position, v0, v1, v2, front ))
    {
-      if (!lp_setup_flush_and_restart(setup))
+      /* A bin worker can't flush, the whole batch gets binned again
+       * serially instead.
+       */
+      if (!binner->setup) {
+         binner->scene->alloc_failed = TRUE;
+         return;
+      }
+      if (!lp_setup_flush_and_restart(binner->setup))
          return;
 
-      if (!do_triangle_ccw( setup, position, v0, v1, v2, front ))
+      /* Pick up the new scene and the state stored in it. */
+      lp_setup_binner_init(binner, binner->setup);
+
+      if (!do_triangle_ccw( binner, position, v0, v1, v2, front ))
          return;
    }
 }
@@ -1021,13 +1114,13 @@ static void retry_triangle_ccw( struct lp_setup_context *setup,
  * to what is done in the jit setup prog.
  */
 static inline void
-calc_fixed_position(struct lp_setup_context *setup,
+calc_fixed_position(const struct lp_setup_binner *binner,
                     struct fixed_position* position,
                     const float (*v0)[4],
                     const float (*v1)[4],
                     const float (*v2)[4])
 {
-   float pixel_offset = setup->multisample ? 0.0 : setup->pixel_offset;
+   float pixel_offset = binner->multisample ? 0.0 : binner->pixel_offset;
    /*
     * The rounding may not be quite the same with PIPE_ARCH_SSE
     * (util_iround right now only does nearest/even on x87,
@@ -1140,68 +1233,53 @@ rotate_fixed_position_12( struct fixed_position* position )
 
 
 /**
- * Draw triangle if it's CW, cull otherwise.
+ * Bin triangle if it's CW, cull otherwise.
  */
-static void triangle_cw(struct lp_setup_context *setup,
-                        const float (*v0)[4],
-                        const float (*v1)[4],
-                        const float (*v2)[4])
+static void bin_triangle_cw(struct lp_setup_binner *binner,
+                            const float (*v0)[4],
+                            const float (*v1)[4],
+                            const float (*v2)[4])
 {
    PIPE_ALIGN_VAR(16) struct fixed_position position;
-   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
 
-   if (lp_context->active_statistics_queries) {
-      lp_context->pipeline_statistics.c_primitives++;
-   }
-
-   calc_fixed_position(setup, &position, v0, v1, v2);
+   calc_fixed_position(binner, &position, v0, v1, v2);
 
    if (position.area < 0) {
-      if (setup->flatshade_first) {
+      if (binner->flatshade_first) {
          rotate_fixed_position_12(&position);
-         retry_triangle_ccw(setup, &position, v0, v2, v1, !setup->ccw_is_frontface);
+         retry_triangle_ccw(binner, &position, v0, v2, v1, !binner->ccw_is_frontface);
       } else {
          rotate_fixed_position_01(&position);
-         retry_triangle_ccw(setup, &position, v1, v0, v2, !setup->ccw_is_frontface);
+         retry_triangle_ccw(binner, &position, v1, v0, v2, !binner->ccw_is_frontface);
       }
    }
 }
 
 
-static void triangle_ccw(struct lp_setup_context *setup,
-                         const float (*v0)[4],
-                         const float (*v1)[4],
-                         const float (*v2)[4])
+static void bin_triangle_ccw(struct lp_setup_binner *binner,
+                             const float (*v0)[4],
+                             const float (*v1)[4],
+                             const float (*v2)[4])
 {
    PIPE_ALIGN_VAR(16) struct fixed_position position;
-   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
-
-   if (lp_context->active_statistics_queries) {
-      lp_context->pipeline_statistics.c_primitives++;
-   }
 
-   calc_fixed_position(setup, &position, v0, v1, v2);
+   calc_fixed_position(binner, &position, v0, v1, v2);
 
    if (position.area > 0)
-      retry_triangle_ccw(setup, &position, v0, v1, v2, setup->ccw_is_frontface);
+      retry_triangle_ccw(binner, &position, v0, v1, v2, binner->ccw_is_frontface);
 }
 
 /**
- * Draw triangle whether it's CW or CCW.
+ * Bin triangle whether it's CW or CCW.
  */
-static void triangle_both(struct lp_setup_context *setup,
-                          const float (*v0)[4],
-                          const float (*v1)[4],
-                          const float (*v2)[4])
+static void bin_triangle_both(struct lp_setup_binner *binner,
+                              const float (*v0)[4],
+                              const float (*v1)[4],
+                              const float (*v2)[4])
 {
    PIPE_ALIGN_VAR(16) struct fixed_position position;
-   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
-
-   if (lp_context->active_statistics_queries) {
-      lp_context->pipeline_statistics.c_primitives++;
-   }
 
-   calc_fixed_position(setup, &position, v0, v1, v2);
+   calc_fixed_position(binner, &position, v0, v1, v2);
 
    if (0) {
       assert(!util_is_inf_or_nan(v0[0][0]));
@@ -1213,19 +1291,79 @@ static void triangle_both(struct lp_setup_context *setup,
    }
 
    if (position.area > 0)
-      retry_triangle_ccw( setup, &position, v0, v1, v2, setup->ccw_is_frontface );
+      retry_triangle_ccw( binner, &position, v0, v1, v2, binner->ccw_is_frontface );
    else if (position.area < 0) {
-      if (setup->flatshade_first) {
+      if (binner->flatshade_first) {
          rotate_fixed_position_12( &position );
-         retry_triangle_ccw( setup, &position, v0, v2, v1, !setup->ccw_is_frontface );
+         retry_triangle_ccw( binner, &position, v0, v2, v1, !binner->ccw_is_frontface );
       } else {
          rotate_fixed_position_01( &position );
-         retry_triangle_ccw( setup, &position, v1, v0, v2, !setup->ccw_is_frontface );
+         retry_triangle_ccw( binner, &position, v1, v0, v2, !binner->ccw_is_frontface );
       }
    }
 }
 
 
+/**
+ * Count the primitive for pipeline statistics and set up a binner from
+ * the context.  Bin workers are accounted for in
+ * lp_setup_bin_triangles_parallel() instead.
+ */
+static inline void
+triangle_begin(struct lp_setup_context *setup,
+               struct lp_setup_binner *binner)
+{
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+
+   if (lp_context->active_statistics_queries) {
+      lp_context->pipeline_statistics.c_primitives++;
+   }
+
+   lp_setup_binner_init(binner, setup);
+}
+
+
+/**
+ * Draw triangle if it's CW, cull otherwise.
+ */
+static void triangle_cw(struct lp_setup_context *setup,
+                        const float (*v0)[4],
+                        const float (*v1)[4],
+                        const float (*v2)[4])
+{
+   struct lp_setup_binner binner;
+
+   triangle_begin(setup, &binner);
+   bin_triangle_cw(&binner, v0, v1, v2);
+}
+
+
+static void triangle_ccw(struct lp_setup_context *setup,
+                         const float (*v0)[4],
+                         const float (*v1)[4],
+                         const float (*v2)[4])
+{
+   struct lp_setup_binner binner;
+
+   triangle_begin(setup, &binner);
+   bin_triangle_ccw(&binner, v0, v1, v2);
+}
+
+/**
+ * Draw triangle whether it's CW or CCW.
+ */
+static void triangle_both(struct lp_setup_context *setup,
+                          const float (*v0)[4],
+                          const float (*v1)[4],
+                          const float (*v2)[4])
+{
+   struct lp_setup_binner binner;
+
+   triangle_begin(setup, &binner);
+   bin_triangle_both(&binner, v0, v1, v2);
+}
+
+
 static void triangle_noop(struct lp_setup_context *setup,
                           const float (*v0)[4],
                           const float (*v1)[4],
@@ -1256,3 +1394,350 @@ lp_setup_choose_triangle(struct lp_setup_context *setup)
       break;
    }
 }
+
+
+/* Minimum number of triangles per bin worker. */
+#define LP_SETUP_BIN_MIN_TRIS 128
+
+/**
+ * A thread binning a range of a triangle batch into bins and data
+ * blocks of its own, which are appended to the scene in primitive order
+ * once all workers are done.
+ */
+struct lp_setup_bin_worker {
+   struct lp_setup_binner binner;   /**< binning into scene */
+   struct lp_counters counters;     /**< added to lp_count when done */
+   struct lp_scene *scene;
+   void (*triangle)(struct lp_setup_binner *,
+                    const float (*v0)[4],
+                    const float (*v1)[4],
+                    const float (*v2)[4]);
+   const void *vertex_buffer;
+   const ushort *indices;
+   unsigned stride;
+   unsigned start, end;             /**< vertex range of the triangles */
+   unsigned fpstate;
+   struct util_queue_fence fence;
+};
+
+
+boolean
+lp_setup_init_bin_workers(struct lp_setup_context *setup,
+                          unsigned num_threads)
+{
+   unsigned i;
+
+   setup->bin_workers = CALLOC(num_threads, sizeof(*setup->bin_workers));
+   if (!setup->bin_workers)
+      return FALSE;
+
+   for (i = 0; i < num_threads; i++) {
+      struct lp_scene *scene = lp_scene_create(setup->pipe);
+
+      if (!scene)
+         goto fail;
+
+      /* Data blocks are only allocated while binning. */
+      FREE(scene->data.head);
+      scene->data.head = NULL;
+      setup->bin_workers[i].scene = scene;
+   }
+
+   /* The calling thread bins the first range itself. */
+   if (!util_queue_init(&setup->bin_queue, "lp_bin", LP_MAX_THREADS,
+                        num_threads - 1, 0, NULL))
+      goto fail;
+
+   setup->num_bin_threads = num_threads;
+   return TRUE;
+
+fail:
+   for (i = 0; i < num_threads; i++) {
+      if (setup->bin_workers[i].scene)
+         lp_scene_destroy(setup->bin_workers[i].scene);
+   }
+   FREE(setup->bin_workers);
+   setup->bin_workers = NULL;
+   return FALSE;
+}
+
+
+void
+lp_setup_destroy_bin_workers(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   if (!setup->num_bin_threads)
+      return;
+
+   util_queue_destroy(&setup->bin_queue);
+   for (i = 0; i < setup->num_bin_threads; i++)
+      lp_scene_destroy(setup->bin_workers[i].scene);
+   FREE(setup->bin_workers);
+   setup->bin_workers = NULL;
+   setup->num_bin_threads = 0;
+}
+
+
+/**
+ * Point a worker at the current scene state, with empty bins and at most
+ * "budget" bytes of data blocks.
+ */
+static boolean
+bin_worker_begin(struct lp_setup_context *setup,
+                 struct lp_setup_bin_worker *worker,
+                 unsigned budget)
+{
+   struct lp_scene *scene = setup->scene;
+   struct lp_scene *wscene = worker->scene;
+   struct data_block *block = MALLOC_STRUCT(data_block);
+   unsigned x, y;
+
+   if (!block)
+      return FALSE;
+
+   block->used = 0;
+   block->next = NULL;
+   wscene->data.head = block;
+   wscene->scene_size = LP_SCENE_MAX_SIZE - budget + sizeof *block;
+   wscene->alloc_failed = FALSE;
+
+   /*
+    * Only what binning triangles reads is copied.  The fence, queries,
+    * resource and shader references, and the framebuffer mappings stay
+    * with the scene: workers don't add any of those, and never rasterize.
+    */
+   wscene->tiles_x = scene->tiles_x;
+   wscene->tiles_y = scene->tiles_y;
+   wscene->fb_max_layer = scene->fb_max_layer;
+   wscene->fb.zsbuf = scene->fb.zsbuf;
+   wscene->had_queries = scene->had_queries;
+
+   for (x = 0; x < scene->tiles_x; x++) {
+      for (y = 0; y < scene->tiles_y; y++) {
+         struct cmd_bin *wbin = lp_scene_get_bin(wscene, x, y);
+
+         wbin->head = NULL;
+         wbin->tail = NULL;
+         wbin->last_state = lp_scene_get_bin(scene, x, y)->last_state;
+      }
+   }
+
+   lp_setup_binner_init(&worker->binner, setup);
+   worker->binner.setup = NULL;
+   worker->binner.scene = wscene;
+   worker->binner.counters = &worker->counters;
+   memset(&worker->counters, 0, sizeof worker->counters);
+   return TRUE;
+}
+
+
+/** Release the data a worker binned, without using it. */
+static void
+bin_worker_discard(struct lp_setup_bin_worker *worker)
+{
+   struct lp_scene *wscene = worker->scene;
+   struct data_block *block, *next;
+
+   for (block = wscene->data.head; block; block = next) {
+      next = block->next;
+      FREE(block);
+   }
+   wscene->data.head = NULL;
+   wscene->fb.zsbuf = NULL;
+}
+
+
+/** Hand the data blocks a worker binned into over to the scene. */
+static void
+bin_worker_end(struct lp_scene *scene, struct lp_setup_bin_worker *worker)
+{
+   struct lp_scene *wscene = worker->scene;
+   struct data_block *last = wscene->data.head;
+
+   scene->scene_size += sizeof *last;
+   while (last->next) {
+      last = last->next;
+      scene->scene_size += sizeof *last;
+   }
+
+   /* Keep the scene's current block at the head of its list. */
+   last->next = scene->data.head->next;
+   scene->data.head->next = wscene->data.head;
+
+   wscene->data.head = NULL;
+   wscene->fb.zsbuf = NULL;
+
+   LP_COUNT_ADD(nr_tris, worker->counters.nr_tris);
+   LP_COUNT_ADD(nr_culled_tris, worker->counters.nr_culled_tris);
+   LP_COUNT_ADD(nr_empty_64, worker->counters.nr_empty_64);
+   LP_COUNT_ADD(nr_fully_covered_64, worker->counters.nr_fully_covered_64);
+   LP_COUNT_ADD(nr_partially_covered_64,
+                worker->counters.nr_partially_covered_64);
+   LP_COUNT_ADD(nr_shade_64, worker->counters.nr_shade_64);
+   LP_COUNT_ADD(nr_shade_opaque_64, worker->counters.nr_shade_opaque_64);
+}
+
+
+static void
+bin_worker_execute(void *data, void *gdata, int thread_index)
+{
+   struct lp_setup_bin_worker *worker = (struct lp_setup_bin_worker *)data;
+   struct lp_setup_binner *binner = &worker->binner;
+   const char *vb = (const char *)worker->vertex_buffer;
+   const unsigned stride = worker->stride;
+   unsigned fpstate = util_fpstate_get();
+   unsigned i;
+
+   util_fpstate_set(worker->fpstate);
+
+   for (i = worker->start + 2; i < worker->end; i += 3) {
+      if (worker->indices) {
+         worker->triangle(binner,
+                          (const float (*)[4])(vb + worker->indices[i-2] * stride),
+                          (const float (*)[4])(vb + worker->indices[i-1] * stride),
+                          (const float (*)[4])(vb + worker->indices[i-0] * stride));
+      } else {
+         worker->triangle(binner,
+                          (const float (*)[4])(vb + (i-2) * stride),
+                          (const float (*)[4])(vb + (i-1) * stride),
+                          (const float (*)[4])(vb + (i-0) * stride));
+      }
+
+      if (worker->scene->alloc_failed)
+         break;
+   }
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Bin a batch of independent triangles by splitting it into ranges which
+ * the bin workers set up and bin concurrently, each into bins of its own.
+ * The per-worker command lists are then appended to the scene's bins in
+ * range order, so every tile sees its commands in primitive order.
+ *
+ * Returns FALSE if the batch wasn't binned, in which case the caller
+ * must bin it serially.
+ */
+boolean
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                unsigned stride,
+                                const ushort *indices,
+                                unsigned nr)
+{
+   struct lp_scene *scene = setup->scene;
+   struct llvmpipe_context *lp_context = (struct llvmpipe_context *)setup->pipe;
+   const unsigned num_tris = nr / 3;
+   void (*bin_tri)(struct lp_setup_binner *,
+                   const float (*v0)[4],
+                   const float (*v1)[4],
+                   const float (*v2)[4]);
+   unsigned num_workers, tris_per_worker, budget;
+   unsigned fpstate = util_fpstate_get();
+   boolean failed = FALSE;
+   unsigned i, x, y;
+
+   if (setup->num_bin_threads < 2 || !scene || lp_scene_is_oom(scene))
+      return FALSE;
+
+   if (setup->triangle == triangle_both)
+      bin_tri = bin_triangle_both;
+   else if (setup->triangle == triangle_cw)
+      bin_tri = bin_triangle_cw;
+   else if (setup->triangle == triangle_ccw)
+      bin_tri = bin_triangle_ccw;
+   else
+      return FALSE;
+
+   num_workers = MIN2(setup->num_bin_threads,
+                      num_tris / LP_SETUP_BIN_MIN_TRIS);
+   if (num_workers < 2)
+      return FALSE;
+
+   /* Split what's left of the scene's memory budget between the workers,
+    * leaving it to the serial path to flush if that's too little.
+    */
+   budget = (LP_SCENE_MAX_SIZE - MIN2(scene->scene_size, LP_SCENE_MAX_SIZE)) /
+            num_workers;
+   if (budget < 4 * sizeof(struct data_block))
+      return FALSE;
+
+   tris_per_worker = DIV_ROUND_UP(num_tris, num_workers);
+
+   for (i = 0; i < num_workers; i++) {
+      struct lp_setup_bin_worker *worker = &setup->bin_workers[i];
+
+      if (!bin_worker_begin(setup, worker, budget)) {
+         while (i--)
+            bin_worker_discard(&setup->bin_workers[i]);
+         return FALSE;
+      }
+
+      worker->triangle = bin_tri;
+      worker->vertex_buffer = vertex_buffer;
+      worker->indices = indices;
+      worker->stride = stride;
+      worker->start = MIN2(i * tris_per_worker, num_tris) * 3;
+      worker->end = MIN2((i + 1) * tris_per_worker, num_tris) * 3;
+      worker->fpstate = fpstate;
+   }
+
+   for (i = 1; i < num_workers; i++) {
+      struct lp_setup_bin_worker *worker = &setup->bin_workers[i];
+
+      util_queue_fence_init(&worker->fence);
+      util_queue_add_job(&setup->bin_queue, worker, &worker->fence,
+                         bin_worker_execute, NULL, 0);
+   }
+
+   bin_worker_execute(&setup->bin_workers[0], NULL, 0);
+
+   for (i = 0; i < num_workers; i++) {
+      struct lp_setup_bin_worker *worker = &setup->bin_workers[i];
+
+      if (i > 0) {
+         util_queue_fence_wait(&worker->fence);
+         util_queue_fence_destroy(&worker->fence);
+      }
+      failed |= worker->scene->alloc_failed;
+   }
+
+   if (failed) {
+      for (i = 0; i < num_workers; i++)
+         bin_worker_discard(&setup->bin_workers[i]);
+      return FALSE;
+   }
+
+   /* Append each worker's commands to the scene's bins, in order. */
+   for (x = 0; x < scene->tiles_x; x++) {
+      for (y = 0; y < scene->tiles_y; y++) {
+         struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+
+         for (i = 0; i < num_workers; i++) {
+            struct cmd_bin *wbin =
+               lp_scene_get_bin(setup->bin_workers[i].scene, x, y);
+
+            if (!wbin->head)
+               continue;
+
+            if (bin->tail)
+               bin->tail->next = wbin->head;
+            else
+               bin->head = wbin->head;
+            bin->tail = wbin->tail;
+            bin->last_state = wbin->last_state;
+         }
+      }
+   }
+
+   for (i = 0; i < num_workers; i++)
+      bin_worker_end(scene, &setup->bin_workers[i]);
+
+   if (lp_context->active_statistics_queries)
+      lp_context->pipeline_statistics.c_primitives += num_tris;
+
+   return TRUE;
+}
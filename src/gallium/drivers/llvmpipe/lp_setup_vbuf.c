@@ -190,6 +190,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          indices, nr))
+         break;
       for (i = 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, indices[i-2], stride),
@@ -388,6 +391,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
+      if (lp_setup_bin_triangles_parallel(setup, vertex_buffer, stride,
+                                          NULL, nr))
+         break;
       for (i = 2; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, i-2, stride),
@@ -113,6 +113,15 @@ llvmpipe_set_framebuffer_state(struct pipe_context *,
 void
 llvmpipe_update_fs(struct llvmpipe_context *lp);
 
+void
+llvmpipe_orphan_current_fs_variant(struct llvmpipe_context *lp);
+
+void
+llvmpipe_update_fs_tier(struct llvmpipe_context *lp);
+
+void
+llvmpipe_finish_fs_tier_jobs(struct llvmpipe_context *lp);
+
 void 
 llvmpipe_update_setup(struct llvmpipe_context *lp);
 
@@ -178,6 +187,14 @@ void
 llvmpipe_cleanup_stage_sampling(struct llvmpipe_context *ctx,
                                 enum pipe_shader_type stage);
 
+void
+llvmpipe_update_tiled_sampler_views(struct llvmpipe_context *ctx,
+                                    enum pipe_shader_type stage);
+
+void
+llvmpipe_resolve_deferred_clears(struct llvmpipe_context *ctx,
+                                 enum pipe_shader_type stage);
+
 void
 llvmpipe_prepare_vertex_images(struct llvmpipe_context *lp,
                                unsigned num,
@@ -443,7 +443,7 @@ llvmpipe_create_compute_state(struct pipe_context *pipe,
    if (!shader)
       return NULL;
 
-   shader->no = cs_no++;
+   shader->no = p_atomic_inc_return(&cs_no) - 1;
 
    shader->base.type = templ->ir_type;
    shader->req_local_mem = templ->req_local_mem;
@@ -521,6 +521,7 @@ llvmpipe_remove_cs_shader_variant(struct llvmpipe_context *lp,
    remove_from_list(&variant->list_item_global);
    lp->nr_cs_variants--;
    lp->nr_cs_instrs -= variant->nr_instrs;
+   gallivm_budget_add(lp->variant_budget, -(int64_t)variant->code_size);
 
    FREE(variant);
 }
@@ -592,6 +593,9 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
             lp_sampler_static_texture_state(&cs_sampler[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            cs_sampler[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_COMPUTE][i],
+                                              &lp->framebuffer);
          }
       }
    }
@@ -601,6 +605,9 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
             lp_sampler_static_texture_state(&cs_sampler[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+            cs_sampler[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_COMPUTE][i],
+                                              &lp->framebuffer);
          }
       }
    }
@@ -653,6 +660,8 @@ dump_cs_variant_key(const struct lp_compute_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -765,6 +774,7 @@ generate_variant(struct llvmpipe_context *lp,
    variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
 
    variant->jit_function = (lp_jit_cs_func)gallivm_jit_function(variant->gallivm, variant->function);
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
 
    if (needs_caching) {
       lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
@@ -827,7 +837,7 @@ llvmpipe_update_cs(struct llvmpipe_context *lp)
       variants_to_cull = lp->nr_cs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 16 : 0;
 
       if (variants_to_cull ||
-          lp->nr_cs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
+          gallivm_budget_exceeded(lp->variant_budget)) {
          if (gallivm_debug & GALLIVM_DEBUG_PERF) {
             debug_printf("Evicting CS: %u cs variants,\t%u total variants,"
                          "\t%u instrs,\t%u instrs/variant\n",
@@ -837,14 +847,14 @@ llvmpipe_update_cs(struct llvmpipe_context *lp)
          }
 
          /*
-          * We need to re-check lp->nr_cs_variants because an arbitrarily large
-          * number of shader variants (potentially all of them) could be
-          * pending for destruction on flush.
+          * The budget is shared with the other variant caches of the screen,
+          * so never evict more than the usual 6.25% per new variant.
           */
-
-         for (i = 0; i < variants_to_cull || lp->nr_cs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
+         for (i = 0; i < LP_MAX_SHADER_VARIANTS / 16; i++) {
             struct lp_cs_variant_list_item *item;
-            if (is_empty_list(&lp->cs_variants_list)) {
+            if (is_empty_list(&lp->cs_variants_list) ||
+                (i >= variants_to_cull &&
+                 !gallivm_budget_exceeded(lp->variant_budget))) {
                break;
             }
             item = last_elem(&lp->cs_variants_list);
@@ -869,6 +879,7 @@ llvmpipe_update_cs(struct llvmpipe_context *lp)
          insert_at_head(&lp->cs_variants_list, &variant->list_item_global);
          lp->nr_cs_variants++;
          lp->nr_cs_instrs += variant->nr_instrs;
+         gallivm_budget_add(lp->variant_budget, variant->code_size);
          shader->variants_cached++;
       }
    }
@@ -882,7 +893,8 @@ llvmpipe_update_cs(struct llvmpipe_context *lp)
 static void
 lp_csctx_set_sampler_views(struct lp_cs_context *csctx,
                            unsigned num,
-                           struct pipe_sampler_view **views)
+                           struct pipe_sampler_view **views,
+                           const struct pipe_framebuffer_state *fb)
 {
    unsigned i, max_tex_num;
 
@@ -923,7 +935,10 @@ lp_csctx_set_sampler_views(struct lp_cs_context *csctx,
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
-               jit_tex->base = lp_tex->tex_data;
+               if (llvmpipe_sampler_view_is_tiled(view, fb))
+                  jit_tex->base = lp_tex->tiled_data;
+               else
+                  jit_tex->base = lp_tex->tex_data;
             }
             else {
               jit_tex->base = lp_tex->data;
@@ -1241,10 +1256,16 @@ llvmpipe_cs_update_derived(struct llvmpipe_context *llvmpipe, void *input)
       update_csctx_ssbo(llvmpipe);
    }
 
+   llvmpipe_resolve_deferred_clears(llvmpipe, PIPE_SHADER_COMPUTE);
+
+   if (LP_PERF & PERF_TILED_TEX)
+      llvmpipe_update_tiled_sampler_views(llvmpipe, PIPE_SHADER_COMPUTE);
+
    if (llvmpipe->cs_dirty & LP_CSNEW_SAMPLER_VIEW)
       lp_csctx_set_sampler_views(llvmpipe->csctx,
                                  llvmpipe->num_sampler_views[PIPE_SHADER_COMPUTE],
-                                 llvmpipe->sampler_views[PIPE_SHADER_COMPUTE]);
+                                 llvmpipe->sampler_views[PIPE_SHADER_COMPUTE],
+                                 &llvmpipe->framebuffer);
 
    if (llvmpipe->cs_dirty & LP_CSNEW_SAMPLER)
       lp_csctx_set_sampler_state(llvmpipe->csctx,
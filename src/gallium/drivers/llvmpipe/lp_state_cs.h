@@ -86,6 +86,9 @@ struct lp_compute_shader_variant
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
+   /* Bytes of JIT code, counted against the screen's variant budget */
+   size_t code_size;
+
    struct lp_cs_variant_list_item list_item_global, list_item_local;
 
    struct lp_compute_shader *shader;
@@ -35,6 +35,7 @@
 #include "lp_screen.h"
 #include "lp_setup.h"
 #include "lp_state.h"
+#include "lp_debug.h"
 
 
 
@@ -191,6 +192,10 @@ void llvmpipe_update_derived( struct llvmpipe_context *llvmpipe )
       llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
    }
 
+   if ((LP_PERF & PERF_TILED_TEX) &&
+       (llvmpipe->dirty & LP_NEW_SAMPLER_VIEW))
+      llvmpipe_update_tiled_sampler_views(llvmpipe, PIPE_SHADER_FRAGMENT);
+
    /* This needs LP_NEW_RASTERIZER because of draw_prepare_shader_outputs(). */
    if (llvmpipe->dirty & (LP_NEW_RASTERIZER |
                           LP_NEW_FS |
@@ -68,6 +68,7 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/u_queue.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -112,6 +113,9 @@
 /** Fragment shader number (for debugging) */
 static unsigned fs_no = 0;
 
+/** Tiles a fast tier variant shades before it gets recompiled optimized */
+#define LP_FS_HOT_TILES 512
+
 static void
 load_unswizzled_block(struct gallivm_state *gallivm,
                       LLVMValueRef base_ptr,
@@ -554,10 +558,13 @@ static void fs_fb_fetch(const struct lp_build_fs_iface *iface,
 
 /**
  * Generate the fragment shader, depth/stencil test, and alpha tests.
+ * \param nir  the shader to build for NIR shaders, lp_build_nir_soa()
+ *             modifies it
  */
 static void
 generate_fs_loop(struct gallivm_state *gallivm,
                  struct lp_fragment_shader *shader,
+                 struct nir_shader *nir,
                  const struct lp_fragment_shader_variant_key *key,
                  LLVMBuilderRef builder,
                  struct lp_type type,
@@ -968,7 +975,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
       lp_build_tgsi_soa(gallivm, tokens, &params,
                         outputs);
    else
-      lp_build_nir_soa(gallivm, shader->base.ir.nir, &params,
+      lp_build_nir_soa(gallivm, nir, &params,
                        outputs);
 
    /* Alpha test */
@@ -2349,7 +2356,9 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
    undef_src_val = lp_build_undef(gallivm, fs_type);
 
    row_type.length = fs_type.length;
-   vector_width    = dst_type.floating ? lp_native_vector_width : lp_integer_vector_width;
+   /* The blend gets at most 8-wide fs vectors, see generate_fragment. */
+   vector_width    = dst_type.floating ? MIN2(lp_native_vector_width, 256) :
+                                         lp_integer_vector_width;
 
    /* Compute correct swizzle and count channels */
    memset(swizzle, LP_BLD_SWIZZLE_DONTCARE, TGSI_NUM_CHANNELS);
@@ -2929,6 +2938,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
 static void
 generate_fragment(struct llvmpipe_context *lp,
                   struct lp_fragment_shader *shader,
+                  struct nir_shader *nir,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2968,6 +2978,8 @@ generate_fragment(struct llvmpipe_context *lp,
    LLVMValueRef function;
    LLVMValueRef facing;
    unsigned num_fs;
+   struct lp_type blend_fs_type;
+   unsigned blend_num_fs;
    unsigned i;
    unsigned chan;
    unsigned cbuf;
@@ -3002,6 +3014,9 @@ generate_fragment(struct llvmpipe_context *lp,
    fs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
    fs_type.width = 32;           /* 32-bit float */
    fs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+   /* 1d resources only use the upper half of the stamp, 8 wide covers it */
+   if (key->resource_1d)
+      fs_type.length = MIN2(fs_type.length, 8);
 
    memset(&blend_type, 0, sizeof blend_type);
    blend_type.floating = FALSE; /* values are integers */
@@ -3214,7 +3229,7 @@ generate_fragment(struct llvmpipe_context *lp,
       }
 
       generate_fs_loop(gallivm,
-                       shader, key,
+                       shader, nir, key,
                        builder,
                        fs_type,
                        context_ptr,
@@ -3271,6 +3286,45 @@ generate_fragment(struct llvmpipe_context *lp,
 
    sampler->destroy(sampler);
    image->destroy(image);
+
+   /*
+    * The blend code handles 4 or 8 wide vectors.  A 16-wide shader covers
+    * the 4x4 stamp in the same pixel order as two 8-wide iterations, so
+    * hand the blend the two halves of each mask and color.
+    */
+   blend_fs_type = fs_type;
+   blend_num_fs = num_fs;
+   if (fs_type.length == 16) {
+      LLVMTypeRef half_ptr_type;
+
+      blend_fs_type.length = 8;
+      blend_num_fs = 2 * num_fs;
+      half_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, blend_fs_type), 0);
+
+      assert(num_fs == 1);
+      for (int s = key->coverage_samples - 1; s >= 0; s--) {
+         LLVMValueRef mask = fs_mask[s];
+         fs_mask[2 * s + 0] = lp_build_extract_range(gallivm, mask, 0, 8);
+         fs_mask[2 * s + 1] = lp_build_extract_range(gallivm, mask, 8, 8);
+      }
+
+      for (unsigned s = 0; s < key->min_samples; s++) {
+         for (cbuf = 0; cbuf < PIPE_MAX_COLOR_BUFS; cbuf++) {
+            if (cbuf >= key->nr_cbufs && !(dual_source_blend && cbuf == 1))
+               continue;
+            for (chan = 0; chan < TGSI_NUM_CHANNELS; ++chan) {
+               LLVMValueRef ptr = LLVMBuildBitCast(builder,
+                                                   fs_out_color[s][cbuf][chan][0],
+                                                   half_ptr_type, "");
+               LLVMValueRef index1 = lp_build_const_int32(gallivm, 1);
+               fs_out_color[s][cbuf][chan][0] = ptr;
+               fs_out_color[s][cbuf][chan][1] = LLVMBuildGEP(builder, ptr,
+                                                             &index1, 1, "");
+            }
+         }
+      }
+   }
+
    /* Loop over color outputs / color buffers to do blending.
     */
    for(cbuf = 0; cbuf < key->nr_cbufs; cbuf++) {
@@ -3280,10 +3334,16 @@ generate_fragment(struct llvmpipe_context *lp,
          LLVMValueRef sample_stride = NULL;
          LLVMValueRef index = lp_build_const_int32(gallivm, cbuf);
 
+         /*
+          * Samples left uncovered are common with multisampling, not least
+          * all but the first one of blocks only stored once, see
+          * lp_rast_begin_uniform_block().
+          */
          boolean do_branch = ((key->depth.enabled
                                || key->stencil[0].enabled
                                || key->alpha.enabled)
-                              && !shader->info.base.uses_kill);
+                              && !shader->info.base.uses_kill) ||
+                             key->multisample;
 
          color_ptr = LLVMBuildLoad(builder,
                                    LLVMBuildGEP(builder, color_ptr_ptr,
@@ -3300,7 +3360,7 @@ generate_fragment(struct llvmpipe_context *lp,
                                                        &index, 1, ""), "");
 
          for (unsigned s = 0; s < key->cbuf_nr_samples[cbuf]; s++) {
-            unsigned mask_idx = num_fs * (key->multisample ? s : 0);
+            unsigned mask_idx = blend_num_fs * (key->multisample ? s : 0);
             unsigned out_idx = key->min_samples == 1 ? 0 : s;
             LLVMValueRef out_ptr = color_ptr;;
 
@@ -3314,7 +3374,8 @@ generate_fragment(struct llvmpipe_context *lp,
 
             generate_unswizzled_blend(gallivm, cbuf, variant,
                                       key->cbuf_format[cbuf],
-                                      num_fs, fs_type, &fs_mask[mask_idx], fs_out_color[out_idx],
+                                      blend_num_fs, blend_fs_type,
+                                      &fs_mask[mask_idx], fs_out_color[out_idx],
                                       context_ptr, out_ptr, stride,
                                       partial_mask, do_branch);
          }
@@ -3420,6 +3481,8 @@ dump_fs_variant_key(struct lp_fragment_shader_variant_key *key)
                    util_str_tex_target(texture->target, TRUE));
       debug_printf("  .level_zero_only = %u\n",
                    texture->level_zero_only);
+      debug_printf("  .tiled = %u\n",
+                   texture->tiled);
       debug_printf("  .pot = %u %u %u\n",
                    texture->pot_width,
                    texture->pot_height,
@@ -3454,6 +3517,7 @@ lp_debug_fs_variant(struct lp_fragment_shader_variant *variant)
       nir_print_shader(variant->shader->base.ir.nir, stderr);
    dump_fs_variant_key(&variant->key);
    debug_printf("variant->opaque = %u\n", variant->opaque);
+   debug_printf("variant->linear_blit = %u\n", variant->linear_blit.enabled);
    debug_printf("\n");
 }
 
@@ -3494,6 +3558,7 @@ generate_variant(struct llvmpipe_context *lp,
    boolean fullcolormask;
    char module_name[64];
    unsigned char ir_sha1_cache_key[20];
+   unsigned i;
    struct lp_cached_code cached = { 0 };
    bool needs_caching = false;
    variant = MALLOC(sizeof *variant + shader->variant_key_size - sizeof variant->key);
@@ -3526,7 +3591,19 @@ generate_variant(struct llvmpipe_context *lp,
    variant->list_item_local.base = variant;
    variant->no = shader->variants_created++;
 
-
+   /*
+    * Unless the object code is cached already, compile quickly to get
+    * drawing going and leave the optimized build to
+    * llvmpipe_update_fs_tier() once the variant turns out to be hot.
+    * Variants built ahead of their first draw have the time to spare.
+    */
+   if (!cached.data_size && !lp->precompiling &&
+       !(LP_PERF & PERF_NO_TIERED) &&
+       !(gallivm_get_perf_flags() & GALLIVM_PERF_NO_OPT)) {
+      variant->fast_tier = TRUE;
+      variant->gallivm->fast_compile = TRUE;
+      needs_caching = false;
+   }
 
    /*
     * Determine whether we are touching all channels in the color buffer.
@@ -3550,6 +3627,38 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.writes_samplemask
       ? TRUE : FALSE;
 
+   variant->uniform_samples =
+         key->multisample &&
+         key->min_samples == 1 &&
+         !key->depth.enabled &&
+         !key->stencil[0].enabled &&
+         !key->blend.alpha_to_coverage &&
+         !shader->info.base.reads_samplemask &&
+         !shader->info.base.writes_samplemask &&
+         !shader->info.base.uses_fbfetch &&
+         !shader->info.base.uses_persp_centroid &&
+         !shader->info.base.uses_linear_centroid &&
+         !shader->info.base.uses_persp_opcode_interp_centroid &&
+         !shader->info.base.uses_linear_opcode_interp_centroid &&
+         !shader->info.base.uses_persp_sample &&
+         !shader->info.base.uses_linear_sample &&
+         !(LP_PERF & PERF_NO_MS_UNIFORM);
+
+   variant->overwrites_samples =
+         variant->uniform_samples &&
+         !key->blend.logicop_enable &&
+         !key->alpha.enabled &&
+         !shader->info.base.uses_kill;
+   for (i = 0; i < key->nr_cbufs; i++) {
+      if (key->cbuf_format[i] != PIPE_FORMAT_NONE &&
+          (key->blend.rt[i].blend_enable ||
+           !util_format_colormask_full(util_format_description(key->cbuf_format[i]),
+                                       key->blend.rt[i].colormask)))
+         variant->overwrites_samples = FALSE;
+   }
+
+   llvmpipe_fs_variant_linear(shader, variant);
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
@@ -3557,12 +3666,14 @@ generate_variant(struct llvmpipe_context *lp,
    lp_jit_init_types(variant);
    
    if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+      generate_fragment(lp, shader, shader->base.ir.nir, variant,
+                        RAST_EDGE_TEST);
 
    if (variant->jit_function[RAST_WHOLE] == NULL) {
       if (variant->opaque) {
          /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
+         generate_fragment(lp, shader, shader->base.ir.nir, variant,
+                           RAST_WHOLE);
       }
    }
 
@@ -3588,6 +3699,8 @@ generate_variant(struct llvmpipe_context *lp,
       variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
    }
 
+   variant->code_size = gallivm_get_code_size(variant->gallivm);
+
    if (needs_caching) {
       lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
    }
@@ -3598,6 +3711,201 @@ generate_variant(struct llvmpipe_context *lp,
 }
 
 
+/**
+ * Background recompilation of a hot fast tier variant.
+ */
+struct lp_fs_tier_job {
+   struct list_head link;
+   struct util_queue_fence fence;
+   struct llvmpipe_context *lp;
+   struct lp_fragment_shader_variant *variant;
+   unsigned char ir_sha1_cache_key[20];
+
+   /* Private copy of the shader's NIR: building code from NIR modifies it,
+    * which the context thread may be doing to the shader's own at the same
+    * time.
+    */
+   struct nir_shader *nir;
+
+   /* results */
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   lp_jit_frag_func jit_function[2];
+};
+
+
+static void
+fs_tier_job_execute(void *data, void *gdata, int thread_index)
+{
+   struct lp_fs_tier_job *job = data;
+   struct llvmpipe_screen *screen = llvmpipe_screen(job->lp->pipe.screen);
+   struct lp_fragment_shader *shader = job->variant->shader;
+   struct lp_fragment_shader_variant *variant;
+   struct lp_cached_code cached = { 0 };
+   char module_name[64];
+
+   /*
+    * LLVM contexts are not thread safe, so build the code in a context of
+    * our own, and into a scratch variant to leave the live one alone.
+    */
+   job->context = LLVMContextCreate();
+   if (!job->context)
+      return;
+
+   variant = CALLOC(1, sizeof *variant + shader->variant_key_size -
+                       sizeof variant->key);
+   if (!variant)
+      return;
+
+   variant->shader = shader;
+   variant->opaque = job->variant->opaque;
+   variant->uniform_samples = job->variant->uniform_samples;
+   variant->overwrites_samples = job->variant->overwrites_samples;
+   variant->no = job->variant->no;
+   memcpy(&variant->key, &job->variant->key, shader->variant_key_size);
+
+   snprintf(module_name, sizeof(module_name), "fs%u_variant%u_opt",
+            shader->no, variant->no);
+
+   variant->gallivm = gallivm_create(module_name, job->context, &cached);
+   if (!variant->gallivm) {
+      FREE(variant);
+      return;
+   }
+
+   lp_jit_init_types(variant);
+
+   generate_fragment(job->lp, shader, job->nir, variant, RAST_EDGE_TEST);
+   if (variant->opaque)
+      generate_fragment(job->lp, shader, job->nir, variant, RAST_WHOLE);
+
+   gallivm_compile_module(variant->gallivm);
+
+   job->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+      gallivm_jit_function(variant->gallivm,
+                           variant->function[RAST_EDGE_TEST]);
+   if (variant->function[RAST_WHOLE]) {
+      job->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+         gallivm_jit_function(variant->gallivm,
+                              variant->function[RAST_WHOLE]);
+   } else {
+      job->jit_function[RAST_WHOLE] = job->jit_function[RAST_EDGE_TEST];
+   }
+
+   if (shader->base.ir.nir)
+      lp_disk_cache_insert_shader(screen, &cached, job->ir_sha1_cache_key);
+
+   gallivm_free_ir(variant->gallivm);
+
+   job->gallivm = variant->gallivm;
+   FREE(variant);
+}
+
+
+/**
+ * Wait for a tier job and switch its variant over to the optimized code.
+ */
+static void
+fs_tier_job_finish(struct llvmpipe_context *lp, struct lp_fs_tier_job *job)
+{
+   struct lp_fragment_shader_variant *variant = job->variant;
+
+   util_queue_fence_wait(&job->fence);
+   util_queue_fence_destroy(&job->fence);
+
+   if (job->gallivm) {
+      size_t size = gallivm_get_code_size(job->gallivm);
+
+      /*
+       * Scenes in flight may still be running the fast code, so that stays
+       * around as long as the variant does.  Rasterizer threads pick up the
+       * new functions with the next block they shade.
+       */
+      variant->opt_gallivm = job->gallivm;
+      p_atomic_set(&variant->jit_function[RAST_WHOLE],
+                   job->jit_function[RAST_WHOLE]);
+      p_atomic_set(&variant->jit_function[RAST_EDGE_TEST],
+                   job->jit_function[RAST_EDGE_TEST]);
+      variant->fast_tier = FALSE;
+      variant->code_size += size;
+      if (!is_empty_list(&variant->list_item_global))
+         gallivm_budget_add(lp->variant_budget, size);
+      LP_COUNT(nr_llvm_tier_ups);
+   }
+
+   if (job->context)
+      LLVMContextDispose(job->context);
+   ralloc_free(job->nir);
+
+   list_del(&job->link);
+   lp_fs_variant_reference(lp, &job->variant, NULL);
+   FREE(job);
+}
+
+
+/**
+ * Called before each draw: retire finished tier jobs, and queue the
+ * optimized build of the bound fragment shader variant once it has shaded
+ * enough tiles with its quickly compiled code.
+ */
+void
+llvmpipe_update_fs_tier(struct llvmpipe_context *lp)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_variant_list_item *li;
+   struct lp_fragment_shader_variant *variant;
+   struct lp_fs_tier_job *job;
+
+   list_for_each_entry_safe(struct lp_fs_tier_job, done, &lp->fs_tier_jobs, link) {
+      if (util_queue_fence_is_signalled(&done->fence))
+         fs_tier_job_finish(lp, done);
+   }
+
+   /* The variant bound last is at the head of the LRU list. */
+   li = first_elem(&lp->fs_variants_list);
+   if (at_end(&lp->fs_variants_list, li))
+      return;
+
+   variant = li->base;
+   if (!variant->fast_tier || variant->tier_queued ||
+       p_atomic_read(&variant->nr_tiles) < LP_FS_HOT_TILES)
+      return;
+
+   job = CALLOC_STRUCT(lp_fs_tier_job);
+   if (!job)
+      return;
+
+   if (variant->shader->base.ir.nir) {
+      job->nir = nir_shader_clone(NULL, variant->shader->base.ir.nir);
+      if (!job->nir) {
+         FREE(job);
+         return;
+      }
+      lp_fs_get_ir_cache_key(variant, job->ir_sha1_cache_key);
+   }
+
+   variant->tier_queued = TRUE;
+   job->lp = lp;
+   lp_fs_variant_reference(lp, &job->variant, variant);
+
+   util_queue_fence_init(&job->fence);
+   list_addtail(&job->link, &lp->fs_tier_jobs);
+   util_queue_add_job(&screen->fs_tier_queue, job, &job->fence,
+                      fs_tier_job_execute, NULL, 0);
+}
+
+
+/**
+ * Wait for all of the context's tier jobs, before it goes away.
+ */
+void
+llvmpipe_finish_fs_tier_jobs(struct llvmpipe_context *lp)
+{
+   list_for_each_entry_safe(struct lp_fs_tier_job, job, &lp->fs_tier_jobs, link)
+      fs_tier_job_finish(lp, job);
+}
+
+
 static void *
 llvmpipe_create_fs_state(struct pipe_context *pipe,
                          const struct pipe_shader_state *templ)
@@ -3614,7 +3922,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       return NULL;
 
    pipe_reference_init(&shader->reference, 1);
-   shader->no = fs_no++;
+   shader->no = p_atomic_inc_return(&fs_no) - 1;
    make_empty_list(&shader->variants);
 
    shader->base.type = templ->type;
@@ -3680,6 +3988,8 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       shader->inputs[i].src_index = i+1;
    }
 
+   llvmpipe_fs_analyse_blit(shader, templ);
+
    if (LP_DEBUG & DEBUG_TGSI && templ->type == PIPE_SHADER_IR_TGSI) {
       unsigned attrib;
       debug_printf("llvmpipe: Create fragment shader #%u %p:\n",
@@ -3743,10 +4053,32 @@ void llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
    remove_from_list(&variant->list_item_local);
    variant->shader->variants_cached--;
 
-   /* remove from context's list */
-   remove_from_list(&variant->list_item_global);
+   /* remove from context's list, precompiled variants may not be on one */
+   if (!is_empty_list(&variant->list_item_global)) {
+      remove_from_list(&variant->list_item_global);
+      lp->nr_fs_variants--;
+      lp->nr_fs_instrs -= variant->nr_instrs;
+      gallivm_budget_add(lp->variant_budget, -(int64_t)variant->code_size);
+   }
+}
+
+/**
+ * Take the most recently used fragment shader variant off this context's
+ * LRU list, leaving it only on its shader's list.  The next context to
+ * look it up there adopts it, see llvmpipe_update_fs().
+ */
+void
+llvmpipe_orphan_current_fs_variant(struct llvmpipe_context *lp)
+{
+   struct lp_fs_variant_list_item *li = first_elem(&lp->fs_variants_list);
+
+   if (at_end(&lp->fs_variants_list, li))
+      return;
+
+   remove_from_list(li);
    lp->nr_fs_variants--;
-   lp->nr_fs_instrs -= variant->nr_instrs;
+   lp->nr_fs_instrs -= li->base->nr_instrs;
+   gallivm_budget_add(lp->variant_budget, -(int64_t)li->base->code_size);
 }
 
 void
@@ -3754,6 +4086,8 @@ llvmpipe_destroy_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
    gallivm_destroy(variant->gallivm);
+   if (variant->opt_gallivm)
+      gallivm_destroy(variant->opt_gallivm);
 
    lp_fs_reference(lp, &variant->shader, NULL);
 
@@ -3899,6 +4233,22 @@ llvmpipe_set_shader_images(struct pipe_context *pipe,
       const struct pipe_image_view *image = images ? &images[idx] : NULL;
 
       util_copy_image_view(&llvmpipe->images[shader][i], image);
+
+      /* Image stores go to tex_data behind the back of the tiled copy, so a
+       * texture written as an image is sampled linearly from then on.  The
+       * timestamp makes every context rebuild its sampler state.
+       */
+      if (image && image->resource &&
+          (image->access & PIPE_IMAGE_ACCESS_WRITE) &&
+          llvmpipe_resource_is_texture(image->resource)) {
+         struct llvmpipe_resource *lpr = llvmpipe_resource(image->resource);
+         if (lpr->tileable) {
+            lpr->tileable = FALSE;
+            llvmpipe_screen(pipe->screen)->timestamp++;
+            llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+            llvmpipe->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+         }
+      }
    }
 
    llvmpipe->num_images[shader] = start_slot + count;
@@ -4101,6 +4451,51 @@ make_variant_key(struct llvmpipe_context *lp,
       }
    }
 
+   /*
+    * Normalize state that can't affect the generated code, so that
+    * equivalent states share a variant rather than compiling (and taking up
+    * variant budget) once per bit pattern.
+    */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      struct pipe_rt_blend_state *blend_rt = &key->blend.rt[i];
+
+      if (i >= key->nr_cbufs || !blend_rt->colormask) {
+         memset(blend_rt, 0, sizeof *blend_rt);
+         continue;
+      }
+
+      if (!blend_rt->blend_enable) {
+         blend_rt->rgb_func = 0;
+         blend_rt->rgb_src_factor = 0;
+         blend_rt->rgb_dst_factor = 0;
+         blend_rt->alpha_func = 0;
+         blend_rt->alpha_src_factor = 0;
+         blend_rt->alpha_dst_factor = 0;
+      }
+      else if (!(blend_rt->colormask & PIPE_MASK_A)) {
+         blend_rt->alpha_func       = blend_rt->rgb_func;
+         blend_rt->alpha_src_factor = blend_rt->rgb_src_factor;
+         blend_rt->alpha_dst_factor = blend_rt->rgb_dst_factor;
+      }
+      else if (!(blend_rt->colormask & (PIPE_MASK_R | PIPE_MASK_G | PIPE_MASK_B))) {
+         blend_rt->rgb_func       = blend_rt->alpha_func;
+         blend_rt->rgb_src_factor = blend_rt->alpha_src_factor;
+         blend_rt->rgb_dst_factor = blend_rt->alpha_dst_factor;
+      }
+   }
+
+   if (!key->blend.logicop_enable)
+      key->blend.logicop_func = 0;
+
+   /* A depth test that always passes and writes nothing is no test. */
+   if (key->depth.enabled &&
+       key->depth.func == PIPE_FUNC_ALWAYS &&
+       !key->depth.writemask) {
+      memset(&key->depth, 0, sizeof key->depth);
+      if (!key->stencil[0].enabled)
+         key->zsbuf_format = PIPE_FORMAT_NONE;
+   }
+
    /* This value will be the same for all the variants of a given shader:
     */
    key->nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
@@ -4134,6 +4529,9 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
             lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            fs_sampler[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_FRAGMENT][i],
+                                              &lp->framebuffer);
          }
       }
    }
@@ -4143,6 +4541,9 @@ make_variant_key(struct llvmpipe_context *lp,
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
             lp_sampler_static_texture_state(&fs_sampler[i].texture_state,
                                             lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            fs_sampler[i].texture_state.tiled =
+               llvmpipe_sampler_view_is_tiled(lp->sampler_views[PIPE_SHADER_FRAGMENT][i],
+                                              &lp->framebuffer);
          }
       }
    }
@@ -4187,6 +4588,12 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
    }
 
    if (variant) {
+      /* A precompiled variant is not on any context's list yet. */
+      if (is_empty_list(&variant->list_item_global)) {
+         lp->nr_fs_variants++;
+         lp->nr_fs_instrs += variant->nr_instrs;
+         gallivm_budget_add(lp->variant_budget, variant->code_size);
+      }
       /* Move this variant to the head of the list to implement LRU
        * deletion of shader's when we have too many.
        */
@@ -4199,10 +4606,12 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       unsigned variants_to_cull;
 
       if (LP_DEBUG & DEBUG_FS) {
-         debug_printf("%u variants,\t%u instrs,\t%u instrs/variant\n",
+         debug_printf("%u variants,\t%u instrs,\t%u instrs/variant,"
+                      "\t%" PRIu64 " budget bytes\n",
                       lp->nr_fs_variants,
                       lp->nr_fs_instrs,
-                      lp->nr_fs_variants ? lp->nr_fs_instrs / lp->nr_fs_variants : 0);
+                      lp->nr_fs_variants ? lp->nr_fs_instrs / lp->nr_fs_variants : 0,
+                      lp->variant_budget->used);
       }
 
       /* First, check if we've exceeded the max number of shader variants.
@@ -4211,7 +4620,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       variants_to_cull = lp->nr_fs_variants >= LP_MAX_SHADER_VARIANTS ? LP_MAX_SHADER_VARIANTS / 16 : 0;
 
       if (variants_to_cull ||
-          lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
+          gallivm_budget_exceeded(lp->variant_budget)) {
          if (gallivm_debug & GALLIVM_DEBUG_PERF) {
             debug_printf("Evicting FS: %u fs variants,\t%u total variants,"
                          "\t%u instrs,\t%u instrs/variant\n",
@@ -4221,14 +4630,17 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
          }
 
          /*
-          * We need to re-check lp->nr_fs_variants because an arbitrarliy large
-          * number of shader variants (potentially all of them) could be
-          * pending for destruction on flush.
+          * Only variants on the LRU list count against the budget, so it
+          * can't be kept exceeded by variants pending destruction on flush.
+          * Other contexts' and the draw module's variants do count though,
+          * so never evict more than the usual 6.25% per new variant, rather
+          * than emptying this context's list for code it doesn't own.
           */
-
-         for (i = 0; i < variants_to_cull || lp->nr_fs_instrs >= LP_MAX_SHADER_INSTRUCTIONS; i++) {
+         for (i = 0; i < LP_MAX_SHADER_VARIANTS / 16; i++) {
             struct lp_fs_variant_list_item *item;
-            if (is_empty_list(&lp->fs_variants_list)) {
+            if (is_empty_list(&lp->fs_variants_list) ||
+                (i >= variants_to_cull &&
+                 !gallivm_budget_exceeded(lp->variant_budget))) {
                break;
             }
             item = last_elem(&lp->fs_variants_list);
@@ -4256,6 +4668,7 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
          insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
          lp->nr_fs_variants++;
          lp->nr_fs_instrs += variant->nr_instrs;
+         gallivm_budget_add(lp->variant_budget, variant->code_size);
          shader->variants_cached++;
       }
    }
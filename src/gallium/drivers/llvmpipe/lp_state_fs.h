@@ -127,6 +127,35 @@ lp_fs_variant_key_images(struct lp_fragment_shader_variant_key *key)
       &key->samplers[key->nr_samplers];
 }
 
+/**
+ * Fragment shaders that only copy a 2D texture lookup at an interpolated
+ * input to color output 0.
+ */
+struct lp_fs_blit_info
+{
+   unsigned is_blit:1;
+   unsigned unit:8;    /**< texture and sampler unit */
+   unsigned input:8;   /**< shader input holding the coordinate */
+   unsigned chan_s:2;
+   unsigned chan_t:2;
+};
+
+
+/**
+ * How the rasterizer may shade whole tiles of a variant without running
+ * the generated code, see lp_rast_linear.c.
+ */
+struct lp_fs_linear_blit
+{
+   unsigned enabled:1;
+   unsigned blend:1;         /**< premultiplied "over" blending */
+   unsigned swap_rb:1;       /**< texture and color buffer differ in R/B order */
+   unsigned alpha_one:1;     /**< texture alpha reads as one */
+   unsigned linear_filter:1;
+   unsigned normalized_coords:1;
+};
+
+
 /** doubly-linked list item */
 struct lp_fs_variant_list_item
 {
@@ -139,6 +168,16 @@ struct lp_fragment_shader_variant
 {
    struct pipe_reference reference;
    boolean opaque;
+   struct lp_fs_linear_blit linear_blit;
+
+   /*
+    * Multisampled variants that give all covered samples of a pixel the
+    * same color can shade blocks whose samples are all equal for sample 0
+    * only, see lp_rast_begin_uniform_block().  overwrites_samples if they
+    * also replace all channels of every color buffer.
+    */
+   boolean uniform_samples;
+   boolean overwrites_samples;
 
    struct gallivm_state *gallivm;
 
@@ -150,9 +189,23 @@ struct lp_fragment_shader_variant
 
    lp_jit_frag_func jit_function[2];
 
+   /*
+    * Tiered compilation.  A fast_tier variant runs quickly compiled code
+    * and counts the tiles it is used for in nr_tiles; once hot it gets
+    * recompiled optimized in the background and jit_function[] is
+    * switched over to the code in opt_gallivm.
+    */
+   boolean fast_tier;
+   boolean tier_queued;
+   unsigned nr_tiles;
+   struct gallivm_state *opt_gallivm;
+
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
+   /* Bytes of JIT code, counted against the screen's variant budget */
+   size_t code_size;
+
    struct lp_fs_variant_list_item list_item_global, list_item_local;
    struct lp_fragment_shader *shader;
 
@@ -171,6 +224,7 @@ struct lp_fragment_shader
 
    struct pipe_reference reference;
    struct lp_tgsi_info info;
+   struct lp_fs_blit_info blit;
 
    struct lp_fs_variant_list_item variants;
 
@@ -194,6 +248,14 @@ void
 llvmpipe_destroy_fs(struct llvmpipe_context *llvmpipe,
                     struct lp_fragment_shader *shader);
 
+void
+llvmpipe_fs_analyse_blit(struct lp_fragment_shader *shader,
+                         const struct pipe_shader_state *templ);
+
+void
+llvmpipe_fs_variant_linear(struct lp_fragment_shader *shader,
+                           struct lp_fragment_shader_variant *variant);
+
 static inline void
 lp_fs_reference(struct llvmpipe_context *llvmpipe,
                 struct lp_fragment_shader **ptr,
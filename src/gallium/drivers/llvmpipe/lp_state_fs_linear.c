@@ -0,0 +1,396 @@
+/**************************************************************************
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Detection of fragment shaders and state the rasterizer can run as plain
+ * 8-bit texture blits, see lp_rast_linear.c.
+ *
+ * Desktop compositors and 2D toolkits mostly draw screen aligned textured
+ * quads, whose fragment shader is a single 2D texture lookup at an
+ * interpolated coordinate.
+ */
+
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/format/u_format.h"
+#include "compiler/nir/nir.h"
+
+#include "lp_debug.h"
+#include "lp_state_fs.h"
+
+
+/**
+ * Match "TEX OUT[color0], IN[n].xy, SAMP[m], 2D; END".
+ */
+static boolean
+analyse_blit_tgsi(const struct tgsi_token *tokens,
+                  const struct tgsi_shader_info *info,
+                  struct lp_fs_blit_info *blit)
+{
+   struct tgsi_parse_context parse;
+   unsigned num_instrs = 0;
+   boolean ok = FALSE;
+
+   tgsi_parse_init(&parse, tokens);
+
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      const struct tgsi_full_instruction *inst;
+
+      tgsi_parse_token(&parse);
+      if (parse.FullToken.Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &parse.FullToken.FullInstruction;
+      num_instrs++;
+
+      if (inst->Instruction.Opcode == TGSI_OPCODE_END)
+         break;
+
+      if (num_instrs > 1 ||
+          (inst->Instruction.Opcode != TGSI_OPCODE_TEX &&
+           inst->Instruction.Opcode != TGSI_OPCODE_TEX_LZ) ||
+          inst->Instruction.Saturate ||
+          (inst->Texture.Texture != TGSI_TEXTURE_2D &&
+           inst->Texture.Texture != TGSI_TEXTURE_RECT) ||
+          inst->Dst[0].Register.File != TGSI_FILE_OUTPUT ||
+          inst->Dst[0].Register.Indirect ||
+          inst->Dst[0].Register.WriteMask != TGSI_WRITEMASK_XYZW ||
+          inst->Src[0].Register.File != TGSI_FILE_INPUT ||
+          inst->Src[0].Register.Indirect ||
+          inst->Src[0].Register.Absolute ||
+          inst->Src[0].Register.Negate ||
+          inst->Src[1].Register.File != TGSI_FILE_SAMPLER ||
+          inst->Src[1].Register.Indirect)
+         break;
+
+      if (info->output_semantic_name[inst->Dst[0].Register.Index] !=
+             TGSI_SEMANTIC_COLOR ||
+          info->output_semantic_index[inst->Dst[0].Register.Index] != 0)
+         break;
+
+      blit->input = inst->Src[0].Register.Index;
+      blit->chan_s = inst->Src[0].Register.SwizzleX;
+      blit->chan_t = inst->Src[0].Register.SwizzleY;
+      blit->unit = inst->Src[1].Register.Index;
+      ok = TRUE;
+   }
+
+   tgsi_parse_free(&parse);
+
+   return ok && num_instrs == 2;
+}
+
+
+/**
+ * Find the shader input and channel a scalar was loaded from.
+ */
+static boolean
+nir_scalar_input(nir_ssa_def *def, unsigned channel,
+                 unsigned *input, unsigned *chan)
+{
+   nir_ssa_scalar s = nir_ssa_scalar_resolved(def, channel);
+   nir_intrinsic_instr *intr;
+   if (s.def->parent_instr->type != nir_instr_type_intrinsic)
+      return FALSE;
+
+   intr = nir_instr_as_intrinsic(s.def->parent_instr);
+   if (intr->intrinsic == nir_intrinsic_load_deref) {
+      nir_deref_instr *deref = nir_src_as_deref(intr->src[0]);
+      nir_variable *var;
+
+      if (deref->deref_type != nir_deref_type_var)
+         return FALSE;
+      var = deref->var;
+      if (var->data.mode != nir_var_shader_in)
+         return FALSE;
+      *input = var->data.driver_location;
+      *chan = var->data.location_frac + s.comp;
+      return TRUE;
+   }
+   else if (intr->intrinsic == nir_intrinsic_load_input) {
+      if (!nir_src_is_const(intr->src[0]) || nir_src_as_uint(intr->src[0]))
+         return FALSE;
+      *input = nir_intrinsic_base(intr);
+      *chan = nir_intrinsic_component(intr) + s.comp;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
+
+/**
+ * Match a shader whose only side effect is storing a 2D texture lookup at
+ * an input coordinate to color output 0.  Everything else in it must be
+ * side effect free (derefs, loads, ALU), so it is dead once this matches.
+ */
+static boolean
+analyse_blit_nir(nir_shader *nir, struct lp_fs_blit_info *blit)
+{
+   nir_function_impl *impl = nir_shader_get_entrypoint(nir);
+   nir_tex_instr *tex = NULL;
+   nir_intrinsic_instr *store = NULL;
+   unsigned location;
+   unsigned input_s, input_t, chan_s, chan_t;
+
+   if (!impl || nir->info.fs.uses_discard ||
+       !exec_list_is_singular(&impl->body))
+      return FALSE;
+
+   nir_foreach_block(block, impl) {
+      nir_foreach_instr(instr, block) {
+         switch (instr->type) {
+         case nir_instr_type_alu:
+         case nir_instr_type_deref:
+         case nir_instr_type_load_const:
+         case nir_instr_type_ssa_undef:
+            break;
+         case nir_instr_type_tex:
+            if (tex)
+               return FALSE;
+            tex = nir_instr_as_tex(instr);
+            break;
+         case nir_instr_type_intrinsic: {
+            nir_intrinsic_instr *intr = nir_instr_as_intrinsic(instr);
+            switch (intr->intrinsic) {
+            case nir_intrinsic_load_deref:
+            case nir_intrinsic_load_input:
+               break;
+            case nir_intrinsic_store_deref:
+            case nir_intrinsic_store_output:
+               if (store)
+                  return FALSE;
+               store = intr;
+               break;
+            default:
+               return FALSE;
+            }
+            break;
+         }
+         default:
+            return FALSE;
+         }
+      }
+   }
+
+   if (!tex || !store)
+      return FALSE;
+
+   if (store->intrinsic == nir_intrinsic_store_deref) {
+      nir_deref_instr *deref = nir_src_as_deref(store->src[0]);
+      if (deref->deref_type != nir_deref_type_var ||
+          deref->var->data.index != 0)
+         return FALSE;
+      location = deref->var->data.location;
+      if (!store->src[1].is_ssa ||
+          store->src[1].ssa != &tex->dest.ssa)
+         return FALSE;
+   }
+   else {
+      if (nir_intrinsic_io_semantics(store).dual_source_blend_index ||
+          nir_intrinsic_component(store) != 0 ||
+          !nir_src_is_const(store->src[1]) ||
+          nir_src_as_uint(store->src[1]))
+         return FALSE;
+      location = nir_intrinsic_io_semantics(store).location;
+      if (!store->src[0].is_ssa ||
+          store->src[0].ssa != &tex->dest.ssa)
+         return FALSE;
+   }
+
+   if ((location != FRAG_RESULT_COLOR && location != FRAG_RESULT_DATA0) ||
+       nir_intrinsic_write_mask(store) != 0xf)
+      return FALSE;
+
+   if (tex->op != nir_texop_tex ||
+       (tex->sampler_dim != GLSL_SAMPLER_DIM_2D &&
+        tex->sampler_dim != GLSL_SAMPLER_DIM_RECT) ||
+       tex->is_array || tex->is_shadow ||
+       tex->num_srcs != 1 ||
+       tex->src[0].src_type != nir_tex_src_coord ||
+       !tex->src[0].src.is_ssa ||
+       tex->dest.ssa.num_components != 4 ||
+       nir_alu_type_get_base_type(tex->dest_type) != nir_type_float ||
+       tex->texture_index != tex->sampler_index)
+      return FALSE;
+
+   if (!nir_scalar_input(tex->src[0].src.ssa, 0, &input_s, &chan_s) ||
+       !nir_scalar_input(tex->src[0].src.ssa, 1, &input_t, &chan_t) ||
+       input_s != input_t ||
+       chan_s > 3 || chan_t > 3)
+      return FALSE;
+
+   blit->input = input_s;
+   blit->chan_s = chan_s;
+   blit->chan_t = chan_t;
+   blit->unit = tex->texture_index;
+
+   return TRUE;
+}
+
+
+/**
+ * Check whether the fragment shader is a plain texture blit.
+ */
+void
+llvmpipe_fs_analyse_blit(struct lp_fragment_shader *shader,
+                         const struct pipe_shader_state *templ)
+{
+   struct lp_fs_blit_info *blit = &shader->blit;
+   boolean is_blit;
+
+   memset(blit, 0, sizeof *blit);
+
+   if (templ->type == PIPE_SHADER_IR_TGSI)
+      is_blit = analyse_blit_tgsi(templ->tokens, &shader->info.base, blit);
+   else
+      is_blit = analyse_blit_nir(templ->ir.nir, blit);
+
+   if (!is_blit ||
+       blit->input >= shader->info.base.num_inputs ||
+       shader->info.base.writes_z ||
+       shader->info.base.writes_stencil ||
+       shader->info.base.writes_samplemask ||
+       shader->inputs[blit->input].interp == LP_INTERP_POSITION ||
+       shader->inputs[blit->input].interp == LP_INTERP_FACING) {
+      memset(blit, 0, sizeof *blit);
+      return;
+   }
+
+   switch (shader->info.base.input_interpolate[blit->input]) {
+   case TGSI_INTERPOLATE_LINEAR:
+   case TGSI_INTERPOLATE_PERSPECTIVE:
+      break;
+   default:
+      memset(blit, 0, sizeof *blit);
+      return;
+   }
+
+   blit->is_blit = TRUE;
+}
+
+
+static boolean
+is_rgba8_unorm(enum pipe_format format)
+{
+   switch (format) {
+   case PIPE_FORMAT_B8G8R8A8_UNORM:
+   case PIPE_FORMAT_B8G8R8X8_UNORM:
+   case PIPE_FORMAT_R8G8B8A8_UNORM:
+   case PIPE_FORMAT_R8G8B8X8_UNORM:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
+
+
+static boolean
+is_bgra(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_B8G8R8A8_UNORM ||
+          format == PIPE_FORMAT_B8G8R8X8_UNORM;
+}
+
+
+/**
+ * Decide whether the rasterizer may shade whole tiles of this variant with
+ * the linear blit code instead of the generated fragment shader.
+ */
+void
+llvmpipe_fs_variant_linear(struct lp_fragment_shader *shader,
+                           struct lp_fragment_shader_variant *variant)
+{
+   const struct lp_fragment_shader_variant_key *key = &variant->key;
+   const struct pipe_rt_blend_state *rt = &key->blend.rt[0];
+   const struct lp_static_sampler_state *samp;
+   const struct lp_static_texture_state *tex;
+   struct lp_fs_linear_blit *linear = &variant->linear_blit;
+
+   memset(linear, 0, sizeof *linear);
+
+   if (!shader->blit.is_blit || (LP_PERF & PERF_NO_FASTBLIT))
+      return;
+
+   if (shader->blit.unit >= key->nr_samplers ||
+       shader->blit.unit >= key->nr_sampler_views)
+      return;
+
+   if (key->nr_cbufs != 1 ||
+       !is_rgba8_unorm(key->cbuf_format[0]) ||
+       key->cbuf_nr_samples[0] > 1 ||
+       key->multisample ||
+       key->depth.enabled ||
+       key->stencil[0].enabled ||
+       key->alpha.enabled ||
+       key->occlusion_count ||
+       key->blend.logicop_enable ||
+       key->blend.alpha_to_coverage ||
+       rt->colormask != PIPE_MASK_RGBA)
+      return;
+
+   if (rt->blend_enable) {
+      /* Premultiplied alpha "over" only. */
+      if (rt->rgb_func != PIPE_BLEND_ADD ||
+          rt->rgb_src_factor != PIPE_BLENDFACTOR_ONE ||
+          rt->rgb_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA ||
+          rt->alpha_func != PIPE_BLEND_ADD ||
+          rt->alpha_src_factor != PIPE_BLENDFACTOR_ONE ||
+          rt->alpha_dst_factor != PIPE_BLENDFACTOR_INV_SRC_ALPHA)
+         return;
+   }
+
+   samp = &key->samplers[shader->blit.unit].sampler_state;
+   tex = &key->samplers[shader->blit.unit].texture_state;
+
+   if ((tex->target != PIPE_TEXTURE_2D && tex->target != PIPE_TEXTURE_RECT) ||
+       !is_rgba8_unorm(tex->format) ||
+       tex->tiled ||
+       tex->swizzle_r != PIPE_SWIZZLE_X ||
+       tex->swizzle_g != PIPE_SWIZZLE_Y ||
+       tex->swizzle_b != PIPE_SWIZZLE_Z ||
+       (tex->swizzle_a != PIPE_SWIZZLE_W && tex->swizzle_a != PIPE_SWIZZLE_1))
+      return;
+
+   if (samp->min_img_filter != samp->mag_img_filter ||
+       samp->min_mip_filter != PIPE_TEX_MIPFILTER_NONE ||
+       samp->compare_mode != PIPE_TEX_COMPARE_NONE ||
+       samp->seamless_cube_map ||
+       (samp->wrap_s != PIPE_TEX_WRAP_CLAMP_TO_EDGE &&
+        samp->wrap_s != PIPE_TEX_WRAP_REPEAT) ||
+       (samp->wrap_t != PIPE_TEX_WRAP_CLAMP_TO_EDGE &&
+        samp->wrap_t != PIPE_TEX_WRAP_REPEAT))
+      return;
+
+   linear->enabled = TRUE;
+   linear->blend = rt->blend_enable;
+   linear->swap_rb = is_bgra(tex->format) != is_bgra(key->cbuf_format[0]);
+   linear->alpha_one = tex->swizzle_a == PIPE_SWIZZLE_1 ||
+                       !util_format_has_alpha(tex->format);
+   linear->linear_filter = samp->min_img_filter == PIPE_TEX_FILTER_LINEAR;
+   linear->normalized_coords = samp->normalized_coords;
+}
@@ -299,6 +299,7 @@ prepare_shader_sampling(
                last_level = view->u.tex.last_level;
                assert(first_level <= last_level);
                assert(last_level <= res->last_level);
+               llvmpipe_resource_resolve_clears(res, FALSE);
                addr = lp_tex->tex_data;
 
                sample_stride = lp_tex->sample_stride;
@@ -430,6 +431,49 @@ llvmpipe_cleanup_stage_sampling(struct llvmpipe_context *ctx,
    }
 }
 
+/**
+ * Bring the tiled copies of the textures sampled by a fragment or compute
+ * shader up to date.  Called before the shader key and the jit textures are
+ * built, as both depend on llvmpipe_sampler_view_is_tiled().
+ */
+void
+llvmpipe_update_tiled_sampler_views(struct llvmpipe_context *ctx,
+                                    enum pipe_shader_type stage)
+{
+   unsigned i;
+
+   assert(stage == PIPE_SHADER_FRAGMENT || stage == PIPE_SHADER_COMPUTE);
+
+   for (i = 0; i < ctx->num_sampler_views[stage]; i++) {
+      struct pipe_sampler_view *view = ctx->sampler_views[stage][i];
+      if (llvmpipe_sampler_view_is_tiled(view, &ctx->framebuffer))
+         llvmpipe_resource_update_tiled(&ctx->pipe, view->texture);
+   }
+}
+
+/**
+ * Write out the deferred tile clears of the textures a compute shader
+ * reads, which runs right away rather than in a scene.
+ */
+void
+llvmpipe_resolve_deferred_clears(struct llvmpipe_context *ctx,
+                                 enum pipe_shader_type stage)
+{
+   unsigned i;
+
+   for (i = 0; i < ctx->num_sampler_views[stage]; i++) {
+      struct pipe_sampler_view *view = ctx->sampler_views[stage][i];
+      if (view && view->texture)
+         llvmpipe_resource_resolve_clears(view->texture, FALSE);
+   }
+
+   for (i = 0; i < ctx->num_images[stage]; i++) {
+      struct pipe_resource *res = ctx->images[stage][i].resource;
+      if (res)
+         llvmpipe_resource_resolve_clears(res, FALSE);
+   }
+}
+
 static void
 prepare_shader_images(
    struct llvmpipe_context *lp,
@@ -476,6 +520,7 @@ prepare_shader_images(
 
             if (llvmpipe_resource_is_texture(res)) {
                uint32_t mip_offset = lp_img->mip_offsets[view->u.tex.level];
+               llvmpipe_resource_resolve_clears(res, FALSE);
                addr = lp_img->tex_data;
 
                if (img->target == PIPE_TEXTURE_1D_ARRAY ||
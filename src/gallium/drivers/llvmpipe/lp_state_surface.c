@@ -100,5 +100,17 @@ llvmpipe_set_framebuffer_state(struct pipe_context *pipe,
       lp_setup_bind_framebuffer( lp->setup, &lp->framebuffer );
 
       lp->dirty |= LP_NEW_FRAMEBUFFER;
+
+      if (LP_PERF & PERF_TILED_TEX) {
+         /* Rendering makes the tiled copies of the color buffers stale, and
+          * decides which sampler views can use tiled copies.
+          */
+         for (i = 0; i < fb->nr_cbufs; i++) {
+            if (fb->cbufs[i])
+               llvmpipe_resource(fb->cbufs[i]->texture)->tiled_dirty = TRUE;
+         }
+         lp->dirty |= LP_NEW_SAMPLER_VIEW;
+         lp->cs_dirty |= LP_CSNEW_SAMPLER_VIEW;
+      }
    }
 }
@@ -113,6 +113,121 @@ lp_resource_copy(struct pipe_context *pipe,
 }
 
 
+/**
+ * Resolve the n texels from x, y on, which lie in one 4x4 block, of a
+ * multisampled 32 bit per texel color buffer, reading only what its tile
+ * clear state says is stored.
+ */
+static void
+resolve_span(const struct llvmpipe_resource *lpr, unsigned x, unsigned y,
+             unsigned n, uint32_t *dst)
+{
+   const struct llvmpipe_tile_clear *tile =
+      &lpr->tile_clears[y / TILE_SIZE * lpr->tile_clears_stride +
+                        x / TILE_SIZE];
+   const unsigned block = (y % TILE_SIZE) / 4 * (TILE_SIZE / 4) +
+                          (x % TILE_SIZE) / 4;
+   const unsigned nr_samples = lpr->base.nr_samples;
+   const unsigned shift = util_logbase2(nr_samples);
+   const uint32_t round = (nr_samples / 2) * 0x00010001;
+   const ubyte *src = (const ubyte *)lpr->tex_data +
+                      y * lpr->row_stride[0] + x * 4;
+   unsigned i, s;
+
+   if (tile->pending) {
+      util_memset32(dst, tile->value.color.ui[0], n);
+      return;
+   }
+
+   if (tile->uniform_blocks[block / 64] & (1ull << (block % 64))) {
+      memcpy(dst, src, n * 4);
+      return;
+   }
+
+   /* Sum the even and the odd channels in 16 bit lanes. */
+   for (i = 0; i < n; i++) {
+      uint32_t even = 0, odd = 0;
+      for (s = 0; s < nr_samples; s++) {
+         uint32_t texel;
+         memcpy(&texel, src + s * lpr->sample_stride + i * 4, 4);
+         even += texel & 0x00ff00ff;
+         odd += (texel >> 8) & 0x00ff00ff;
+      }
+      even = ((even + round) >> shift) & 0x00ff00ff;
+      odd = ((odd + round) >> shift) & 0x00ff00ff;
+      dst[i] = even | (odd << 8);
+   }
+}
+
+
+/**
+ * Resolve a multisampled color buffer with deferred clear state straight
+ * from that state, without writing out the clears and the samples that
+ * were only stored once first.  Only for 1:1 blits of all channels of 8
+ * bit unorm formats.
+ */
+static boolean
+lp_blit_resolve(struct pipe_context *pipe, const struct pipe_blit_info *info)
+{
+   struct pipe_resource *src = info->src.resource;
+   struct pipe_resource *dst = info->dst.resource;
+   const struct llvmpipe_resource *lpr = llvmpipe_resource_const(src);
+   const struct util_format_description *desc =
+      util_format_description(src->format);
+   const struct pipe_box *box = &info->src.box;
+   struct pipe_transfer *transfer;
+   ubyte *map;
+   int x, y, n;
+
+   if (!lpr->tile_clears ||
+       src->nr_samples <= 1 || dst->nr_samples > 1 ||
+       info->src.format != src->format ||
+       info->dst.format != src->format ||
+       dst->format != src->format ||
+       !util_format_is_rgba8_variant(desc) ||
+       !util_is_power_of_two_nonzero(src->nr_samples) ||
+       desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB ||
+       !llvmpipe_resource_is_texture(dst) ||
+       info->mask != PIPE_MASK_RGBA ||
+       info->scissor_enable ||
+       info->alpha_blend ||
+       info->num_window_rectangles ||
+       info->src.level != 0 ||
+       box->z != 0 || box->depth != 1 ||
+       box->x < 0 || box->y < 0 ||
+       box->width <= 0 || box->height <= 0 ||
+       box->x + box->width > (int)src->width0 ||
+       box->y + box->height > (int)src->height0 ||
+       info->dst.box.width != box->width ||
+       info->dst.box.height != box->height ||
+       info->dst.box.depth != 1)
+      return FALSE;
+
+   llvmpipe_flush_resource(pipe, src, 0,
+                           TRUE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           "resolve src");
+
+   map = pipe_texture_map(pipe, dst, info->dst.level, info->dst.box.z,
+                          PIPE_MAP_WRITE, info->dst.box.x, info->dst.box.y,
+                          box->width, box->height, &transfer);
+   if (!map)
+      return FALSE;
+
+   for (y = 0; y < box->height; y++) {
+      uint32_t *row = (uint32_t *)(map + y * transfer->stride);
+      for (x = 0; x < box->width; x += n) {
+         n = MIN2(4 - (box->x + x) % 4, box->width - x);
+         resolve_span(lpr, box->x + x, box->y + y, n, row + x);
+      }
+   }
+
+   pipe_texture_unmap(pipe, transfer);
+   return TRUE;
+}
+
+
 static void lp_blit(struct pipe_context *pipe,
                     const struct pipe_blit_info *blit_info)
 {
@@ -122,6 +237,9 @@ static void lp_blit(struct pipe_context *pipe,
    if (blit_info->render_condition_enable && !llvmpipe_check_render_cond(lp))
       return;
 
+   if (lp_blit_resolve(pipe, &info))
+      return;
+
    if (util_try_blit_via_copy_region(pipe, &info)) {
       return; /* done */
    }
@@ -255,6 +255,34 @@ const float round_values[] = {
       -FLT_MAX
 };
 
+/* Values for the float -> int rounding, which must fit in an int32. */
+const float iround_values[] = {
+      -10.0, -1, 0.0, 12.0,
+      -1.49, -0.25, 1.25, 2.51,
+      -0.99, -0.01, 0.01, 0.99,
+      -1.5, -0.5, 0.5, 1.5,
+      1.401298464324817e-45f, // smallest denormal
+      -1.401298464324817e-45f,
+      16777215.0f,
+      -16777215.0f,
+};
+
+/* Round to integer and back, to exercise lp_build_iround. */
+static LLVMValueRef
+lp_build_iround_float(struct lp_build_context *bld, LLVMValueRef a)
+{
+   return lp_build_int_to_float(bld, lp_build_iround(bld, a));
+}
+
+/* Fast rsqrt where the hardware has it, the precise one elsewhere. */
+static LLVMValueRef
+lp_build_fast_rsqrt_or_rsqrt(struct lp_build_context *bld, LLVMValueRef a)
+{
+   if (lp_build_fast_rsqrt_available(bld->type))
+      return lp_build_fast_rsqrt(bld, a);
+   return lp_build_rsqrt(bld, a);
+}
+
 static float fractf(float x)
 {
    x -= floorf(x);
@@ -325,10 +353,12 @@ unary_tests[] = {
    {"log", &lp_build_log_safe, &logf, log2_values, ARRAY_SIZE(log2_values), 20.0 },
    {"rcp", &lp_build_rcp, &rcpf, rcp_values, ARRAY_SIZE(rcp_values), 20.0 },
    {"rsqrt", &lp_build_rsqrt, &rsqrtf, rsqrt_values, ARRAY_SIZE(rsqrt_values), 20.0 },
+   {"fast_rsqrt", &lp_build_fast_rsqrt_or_rsqrt, &rsqrtf, rsqrt_values, ARRAY_SIZE(rsqrt_values), 10.0 },
    {"sin", &lp_build_sin, &sinf, sincos_values, ARRAY_SIZE(sincos_values), 20.0 },
    {"cos", &lp_build_cos, &cosf, sincos_values, ARRAY_SIZE(sincos_values), 20.0 },
    {"sgn", &lp_build_sgn, &sgnf, sgn_values, ARRAY_SIZE(sgn_values), 20.0 },
    {"round", &lp_build_round, &nearbyintf, round_values, ARRAY_SIZE(round_values), 24.0 },
+   {"iround", &lp_build_iround_float, &nearbyintf, iround_values, ARRAY_SIZE(iround_values), 24.0 },
    {"trunc", &lp_build_trunc, &truncf, round_values, ARRAY_SIZE(round_values), 24.0 },
    {"floor", &lp_build_floor, &floorf, round_values, ARRAY_SIZE(round_values), 24.0 },
    {"ceil", &lp_build_ceil, &ceilf, round_values, ARRAY_SIZE(round_values), 24.0 },
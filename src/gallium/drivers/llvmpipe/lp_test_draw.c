@@ -0,0 +1,788 @@
+/**************************************************************************
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Draws through a whole llvmpipe screen and checks the pixels, for the
+ * driver paths the gallivm level tests don't reach.
+ */
+
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "cso_cache/cso_context.h"
+#include "frontend/sw_winsys.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_draw_quad.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+/* Large enough for whole tiles inside either triangle of a quad */
+#define WIDTH 256
+#define HEIGHT 256
+
+/* R8G8B8A8_UNORM texels as stored in memory */
+#define RED   0xff0000ff
+#define GREEN 0xff00ff00
+
+
+struct draw_test {
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   void *vs;
+};
+
+
+/*
+ * Only plain textures are used, so the winsys never gets to create a
+ * display target.
+ */
+static bool
+test_ws_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                          unsigned tex_usage,
+                                          enum pipe_format format)
+{
+   return false;
+}
+
+
+static void
+test_ws_destroy(struct sw_winsys *ws)
+{
+}
+
+
+static struct sw_winsys test_ws = {
+   .destroy = test_ws_destroy,
+   .is_displaytarget_format_supported =
+      test_ws_is_displaytarget_format_supported,
+};
+
+
+/**
+ * Create a screen with the given LP_PERF flags, and a context on it set up
+ * to draw screen space quads with a texture coordinate.
+ */
+static boolean
+draw_test_init(struct draw_test *t, const char *perf)
+{
+   const enum tgsi_semantic names[] = {
+      TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_GENERIC
+   };
+   const unsigned indexes[] = { 0, 0 };
+   struct cso_velems_state velem;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state vp;
+   unsigned i;
+
+   memset(t, 0, sizeof *t);
+
+   /* LP_PERF is read when the screen is created. */
+   setenv("LP_PERF", perf, 1);
+   t->screen = llvmpipe_create_screen(&test_ws);
+   if (!t->screen)
+      return FALSE;
+
+   t->pipe = t->screen->context_create(t->screen, NULL, 0);
+   if (!t->pipe) {
+      t->screen->destroy(t->screen);
+      return FALSE;
+   }
+   t->cso = cso_create_context(t->pipe, 0);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(t->cso, &blend);
+
+   memset(&dsa, 0, sizeof dsa);
+   cso_set_depth_stencil_alpha(t->cso, &dsa);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   cso_set_rasterizer(t->cso, &rast);
+
+   memset(&vp, 0, sizeof vp);
+   vp.scale[0] = WIDTH / 2.0f;
+   vp.scale[1] = HEIGHT / 2.0f;
+   vp.scale[2] = 0.5f;
+   vp.translate[0] = WIDTH / 2.0f;
+   vp.translate[1] = HEIGHT / 2.0f;
+   vp.translate[2] = 0.5f;
+   vp.swizzle_x = PIPE_VIEWPORT_SWIZZLE_POSITIVE_X;
+   vp.swizzle_y = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Y;
+   vp.swizzle_z = PIPE_VIEWPORT_SWIZZLE_POSITIVE_Z;
+   vp.swizzle_w = PIPE_VIEWPORT_SWIZZLE_POSITIVE_W;
+   cso_set_viewport(t->cso, &vp);
+
+   memset(&velem, 0, sizeof velem);
+   velem.count = 2;
+   for (i = 0; i < 2; i++) {
+      velem.velems[i].src_offset = i * 4 * sizeof(float);
+      velem.velems[i].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   }
+   cso_set_vertex_elements(t->cso, &velem);
+
+   t->vs = util_make_vertex_passthrough_shader(t->pipe, 2, names, indexes,
+                                               FALSE);
+   cso_set_vertex_shader_handle(t->cso, t->vs);
+
+   return TRUE;
+}
+
+
+static void
+draw_test_destroy(struct draw_test *t)
+{
+   cso_destroy_context(t->cso);
+   t->pipe->delete_vs_state(t->pipe, t->vs);
+   t->pipe->destroy(t->pipe);
+   t->screen->destroy(t->screen);
+}
+
+
+static void *
+create_fs(struct draw_test *t, const char *text)
+{
+   struct tgsi_token tokens[1024];
+   struct pipe_shader_state state;
+
+   if (!tgsi_text_translate(text, tokens, ARRAY_SIZE(tokens)))
+      return NULL;
+
+   pipe_shader_state_from_tgsi(&state, tokens);
+   return t->pipe->create_fs_state(t->pipe, &state);
+}
+
+
+static struct pipe_resource *
+create_texture(struct draw_test *t, enum pipe_format format,
+               unsigned nr_samples, unsigned bind)
+{
+   struct pipe_resource templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = format;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.nr_samples = nr_samples;
+   templ.nr_storage_samples = nr_samples;
+   templ.bind = bind;
+
+   return t->screen->resource_create(t->screen, &templ);
+}
+
+
+static void
+fill_texture(struct draw_test *t, struct pipe_resource *tex,
+             uint32_t (*texel)(unsigned x, unsigned y))
+{
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+   unsigned x, y;
+
+   map = pipe_texture_map(t->pipe, tex, 0, 0, PIPE_MAP_WRITE,
+                          0, 0, WIDTH, HEIGHT, &transfer);
+   for (y = 0; y < HEIGHT; y++) {
+      uint32_t *row = (uint32_t *)(map + y * transfer->stride);
+      for (x = 0; x < WIDTH; x++)
+         row[x] = texel(x, y);
+   }
+   pipe_texture_unmap(t->pipe, transfer);
+}
+
+
+/**
+ * Read back a 4 byte per texel color buffer, waiting for rendering.
+ */
+static void
+read_texture(struct draw_test *t, struct pipe_resource *tex,
+             uint32_t *texels)
+{
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   unsigned y;
+
+   map = pipe_texture_map(t->pipe, tex, 0, 0, PIPE_MAP_READ,
+                          0, 0, WIDTH, HEIGHT, &transfer);
+   for (y = 0; y < HEIGHT; y++)
+      memcpy(texels + y * WIDTH, map + y * transfer->stride, WIDTH * 4);
+   pipe_texture_unmap(t->pipe, transfer);
+}
+
+
+static void
+set_color_buffer(struct draw_test *t, struct pipe_resource *tex)
+{
+   struct pipe_framebuffer_state fb;
+   struct pipe_surface templ;
+
+   memset(&templ, 0, sizeof templ);
+   templ.format = tex->format;
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.samples = tex->nr_samples;
+   fb.layers = 1;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = t->pipe->create_surface(t->pipe, tex, &templ);
+
+   cso_set_framebuffer(t->cso, &fb);
+   pipe_surface_reference(&fb.cbufs[0], NULL);
+}
+
+
+static void
+bind_texture(struct draw_test *t, struct pipe_resource *tex,
+             enum pipe_tex_filter filter)
+{
+   const struct pipe_sampler_state *samplers[1];
+   struct pipe_sampler_state sampler;
+   struct pipe_sampler_view templ, *view;
+
+   memset(&sampler, 0, sizeof sampler);
+   sampler.wrap_s = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler.wrap_t = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler.wrap_r = PIPE_TEX_WRAP_CLAMP_TO_EDGE;
+   sampler.min_img_filter = filter;
+   sampler.mag_img_filter = filter;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.normalized_coords = 1;
+   samplers[0] = &sampler;
+   cso_set_samplers(t->cso, PIPE_SHADER_FRAGMENT, 1, samplers);
+
+   u_sampler_view_default_template(&templ, tex, tex->format);
+   view = t->pipe->create_sampler_view(t->pipe, tex, &templ);
+   t->pipe->set_sampler_views(t->pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0, &view);
+   pipe_sampler_view_reference(&view, NULL);
+}
+
+
+/**
+ * Draw the rectangle x0,y0 - x1,y1, in pixels, with texture coordinates
+ * mapping the whole texture onto the whole framebuffer.
+ */
+static void
+draw_rect(struct draw_test *t, float x0, float y0, float x1, float y1)
+{
+   float verts[4][2][4];
+   const float x[4] = { x0, x1, x0, x1 };
+   const float y[4] = { y0, y0, y1, y1 };
+   unsigned i;
+
+   for (i = 0; i < 4; i++) {
+      verts[i][0][0] = x[i] / WIDTH * 2.0f - 1.0f;
+      verts[i][0][1] = y[i] / HEIGHT * 2.0f - 1.0f;
+      verts[i][0][2] = 0.0f;
+      verts[i][0][3] = 1.0f;
+      verts[i][1][0] = x[i] / WIDTH;
+      verts[i][1][1] = y[i] / HEIGHT;
+      verts[i][1][2] = 0.0f;
+      verts[i][1][3] = 1.0f;
+   }
+
+   util_draw_user_vertex_buffer(t->cso, verts, PIPE_PRIM_TRIANGLE_STRIP,
+                                4, 2);
+}
+
+
+static boolean
+check_texels(const char *test, const uint32_t *texels, uint32_t expected)
+{
+   unsigned i;
+
+   for (i = 0; i < WIDTH * HEIGHT; i++) {
+      if (texels[i] != expected) {
+         fprintf(stderr, "%s: texel %u,%u is 0x%08x, expected 0x%08x\n",
+                 test, i % WIDTH, i / WIDTH, texels[i], expected);
+         return FALSE;
+      }
+   }
+   return TRUE;
+}
+
+
+/**
+ * Compare two 4 byte per texel images, allowing each byte to differ by
+ * the given tolerance.
+ */
+static boolean
+compare_texels(const char *test, const uint32_t *texels,
+               const uint32_t *expected, int tolerance)
+{
+   unsigned i, c;
+
+   for (i = 0; i < WIDTH * HEIGHT; i++) {
+      for (c = 0; c < 32; c += 8) {
+         int diff = (int)((texels[i] >> c) & 0xff) -
+                    (int)((expected[i] >> c) & 0xff);
+         if (diff < -tolerance || diff > tolerance) {
+            fprintf(stderr, "%s: texel %u,%u is 0x%08x, expected 0x%08x\n",
+                    test, i % WIDTH, i / WIDTH, texels[i], expected[i]);
+            return FALSE;
+         }
+      }
+   }
+   return TRUE;
+}
+
+
+static const char blit_fs[] =
+   "FRAG\n"
+   "DCL IN[0], GENERIC[0], PERSPECTIVE\n"
+   "DCL OUT[0], COLOR\n"
+   "DCL SAMP[0]\n"
+   "DCL SVIEW[0], 2D, FLOAT\n"
+   "TEX OUT[0], IN[0], SAMP[0], 2D\n"
+   "END\n";
+
+
+static uint32_t
+red_texel(unsigned x, unsigned y)
+{
+   return RED;
+}
+
+
+/**
+ * Texels varying in every channel, with premultiplied colors and alpha
+ * going from transparent to opaque.
+ */
+static uint32_t
+pattern_texel(unsigned x, unsigned y)
+{
+   const unsigned a = (x * 7 + y * 3) & 0xff;
+   const unsigned r = ((x * 4) & 0xff) * a / 0xff;
+   const unsigned g = ((y * 4) & 0xff) * a / 0xff;
+   const unsigned b = (((x ^ y) * 4) & 0xff) * a / 0xff;
+
+   return r | g << 8 | b << 16 | a << 24;
+}
+
+
+/**
+ * Sample a texture from its tiled copy, write it through an image, then
+ * sample it again: the second draw must see the image stores.
+ */
+static boolean
+test_tiled_image_store(unsigned verbose)
+{
+   static const char store_fs[] =
+      "FRAG\n"
+      "DCL IN[0], POSITION, LINEAR\n"
+      "DCL OUT[0], COLOR\n"
+      "DCL IMAGE[0], 2D, PIPE_FORMAT_R8G8B8A8_UNORM, WR\n"
+      "DCL TEMP[0]\n"
+      "IMM[0] FLT32 { 0.0, 1.0, 0.0, 1.0 }\n"
+      "F2I TEMP[0], IN[0]\n"
+      "STORE IMAGE[0], TEMP[0], IMM[0], 2D, PIPE_FORMAT_R8G8B8A8_UNORM\n"
+      "MOV OUT[0], IMM[0]\n"
+      "END\n";
+   const enum pipe_format format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   struct pipe_resource *tex, *rt, *scratch;
+   struct pipe_image_view image;
+   struct draw_test t;
+   uint32_t *texels;
+   void *fs_blit, *fs_store;
+   boolean success;
+
+   if (!draw_test_init(&t, "tiled_tex"))
+      return FALSE;
+
+   texels = MALLOC(WIDTH * HEIGHT * 4);
+
+   /* Bound like the GL frontend binds textures, without SHADER_IMAGE. */
+   tex = create_texture(&t, format, 0, PIPE_BIND_SAMPLER_VIEW);
+   rt = create_texture(&t, format, 0, PIPE_BIND_RENDER_TARGET);
+   scratch = create_texture(&t, format, 0, PIPE_BIND_RENDER_TARGET);
+   fill_texture(&t, tex, red_texel);
+
+   fs_blit = create_fs(&t, blit_fs);
+   fs_store = create_fs(&t, store_fs);
+
+   set_color_buffer(&t, rt);
+   cso_set_fragment_shader_handle(t.cso, fs_blit);
+   bind_texture(&t, tex, PIPE_TEX_FILTER_NEAREST);
+   draw_rect(&t, 0, 0, WIDTH, HEIGHT);
+   read_texture(&t, rt, texels);
+   success = check_texels("tiled sample", texels, RED);
+
+   memset(&image, 0, sizeof image);
+   image.resource = tex;
+   image.format = format;
+   image.access = PIPE_IMAGE_ACCESS_WRITE;
+   image.shader_access = PIPE_IMAGE_ACCESS_WRITE;
+   set_color_buffer(&t, scratch);
+   cso_set_fragment_shader_handle(t.cso, fs_store);
+   t.pipe->set_shader_images(t.pipe, PIPE_SHADER_FRAGMENT, 0, 1, 0, &image);
+   draw_rect(&t, 0, 0, WIDTH, HEIGHT);
+   t.pipe->set_shader_images(t.pipe, PIPE_SHADER_FRAGMENT, 0, 0, 1, NULL);
+   t.pipe->memory_barrier(t.pipe, PIPE_BARRIER_TEXTURE);
+
+   set_color_buffer(&t, rt);
+   cso_set_fragment_shader_handle(t.cso, fs_blit);
+   draw_rect(&t, 0, 0, WIDTH, HEIGHT);
+   read_texture(&t, rt, texels);
+   success = check_texels("sample after image store", texels, GREEN) &&
+             success;
+
+   if (verbose || !success)
+      printf("tiled texture image store: %s\n", success ? "pass" : "FAIL");
+
+   cso_set_fragment_shader_handle(t.cso, NULL);
+   t.pipe->delete_fs_state(t.pipe, fs_blit);
+   t.pipe->delete_fs_state(t.pipe, fs_store);
+   pipe_resource_reference(&tex, NULL);
+   pipe_resource_reference(&rt, NULL);
+   pipe_resource_reference(&scratch, NULL);
+   FREE(texels);
+   draw_test_destroy(&t);
+
+   return success;
+}
+
+
+/**
+ * Draw a screen aligned quad sampling the pattern texture 1:1, optionally
+ * blending it premultiplied over a cleared color buffer, and read back the
+ * color buffer.
+ */
+static boolean
+draw_blit(const char *perf, enum pipe_format rt_format,
+          enum pipe_tex_filter filter, boolean blend, uint32_t *texels)
+{
+   const union pipe_color_union clear = {
+      .f = { 0.25f, 0.5f, 0.75f, 1.0f }
+   };
+   struct pipe_resource *tex, *rt;
+   struct pipe_blend_state blend_state;
+   struct draw_test t;
+   void *fs;
+
+   if (!draw_test_init(&t, perf))
+      return FALSE;
+
+   tex = create_texture(&t, PIPE_FORMAT_R8G8B8A8_UNORM, 0,
+                        PIPE_BIND_SAMPLER_VIEW);
+   rt = create_texture(&t, rt_format, 0, PIPE_BIND_RENDER_TARGET);
+   fill_texture(&t, tex, pattern_texel);
+   fs = create_fs(&t, blit_fs);
+
+   memset(&blend_state, 0, sizeof blend_state);
+   if (blend) {
+      blend_state.rt[0].blend_enable = 1;
+      blend_state.rt[0].rgb_func = PIPE_BLEND_ADD;
+      blend_state.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend_state.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      blend_state.rt[0].alpha_func = PIPE_BLEND_ADD;
+      blend_state.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend_state.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   }
+   blend_state.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(t.cso, &blend_state);
+
+   set_color_buffer(&t, rt);
+   t.pipe->clear(t.pipe, PIPE_CLEAR_COLOR0, NULL, &clear, 0.0, 0);
+   cso_set_fragment_shader_handle(t.cso, fs);
+   bind_texture(&t, tex, filter);
+   draw_rect(&t, 0, 0, WIDTH, HEIGHT);
+   read_texture(&t, rt, texels);
+
+   cso_set_fragment_shader_handle(t.cso, NULL);
+   t.pipe->delete_fs_state(t.pipe, fs);
+   pipe_resource_reference(&tex, NULL);
+   pipe_resource_reference(&rt, NULL);
+   draw_test_destroy(&t);
+
+   return TRUE;
+}
+
+
+/**
+ * Screen aligned textured quads, as compositors draw them, copied or
+ * blended by the rasterizer's linear blit path must give the same pixels
+ * as the generated fragment shader.
+ */
+static boolean
+test_fast_blit(unsigned verbose)
+{
+   static const struct {
+      const char *name;
+      enum pipe_format rt_format;
+      enum pipe_tex_filter filter;
+      boolean blend;
+   } cases[] = {
+      { "copy", PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_TEX_FILTER_NEAREST, FALSE },
+      { "copy linear", PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_TEX_FILTER_LINEAR,
+        FALSE },
+      { "copy swap rb", PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_TEX_FILTER_NEAREST,
+        FALSE },
+      { "copy no alpha", PIPE_FORMAT_R8G8B8X8_UNORM, PIPE_TEX_FILTER_NEAREST,
+        FALSE },
+      { "over", PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_TEX_FILTER_NEAREST, TRUE },
+      { "over swap rb", PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_TEX_FILTER_LINEAR,
+        TRUE },
+   };
+   uint32_t *texels = MALLOC(WIDTH * HEIGHT * 4);
+   uint32_t *expected = MALLOC(WIDTH * HEIGHT * 4);
+   boolean success = TRUE;
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(cases); i++) {
+      char name[64];
+      boolean passed;
+
+      snprintf(name, sizeof name, "fast blit %s", cases[i].name);
+
+      passed = draw_blit("", cases[i].rt_format, cases[i].filter,
+                         cases[i].blend, texels) &&
+               draw_blit("no_fastblit", cases[i].rt_format, cases[i].filter,
+                         cases[i].blend, expected) &&
+               compare_texels(name, texels, expected, 0);
+
+      if (verbose || !passed)
+         printf("%s: %s\n", name, passed ? "pass" : "FAIL");
+      success = passed && success;
+   }
+
+   FREE(texels);
+   FREE(expected);
+
+   return success;
+}
+
+
+/**
+ * Clear a 4x multisampled color buffer, draw a solid rectangle with
+ * partially covered edge pixels and a blended one over it, and resolve.
+ * Returns the resolved texels and the samples the solid rectangle passed.
+ */
+static boolean
+draw_msaa(const char *perf, uint32_t *texels, uint64_t *samples)
+{
+   static const char solid_fs[] =
+      "FRAG\n"
+      "DCL OUT[0], COLOR\n"
+      "IMM[0] FLT32 { 0.0, 1.0, 0.0, 1.0 }\n"
+      "MOV OUT[0], IMM[0]\n"
+      "END\n";
+   static const char blend_fs[] =
+      "FRAG\n"
+      "DCL OUT[0], COLOR\n"
+      "IMM[0] FLT32 { 0.0, 0.0, 1.0, 0.5 }\n"
+      "MOV OUT[0], IMM[0]\n"
+      "END\n";
+   const enum pipe_format format = PIPE_FORMAT_R8G8B8A8_UNORM;
+   const union pipe_color_union red = { .f = { 1.0f, 0.0f, 0.0f, 1.0f } };
+   struct pipe_resource *ms, *resolved;
+   struct pipe_rasterizer_state rast;
+   struct pipe_blend_state blend;
+   struct pipe_blit_info info;
+   struct pipe_query *query;
+   union pipe_query_result result;
+   struct draw_test t;
+   void *fs_solid, *fs_blend;
+
+   if (!draw_test_init(&t, perf))
+      return FALSE;
+
+   ms = create_texture(&t, format, 4, PIPE_BIND_RENDER_TARGET);
+   resolved = create_texture(&t, format, 0, PIPE_BIND_RENDER_TARGET);
+   fs_solid = create_fs(&t, solid_fs);
+   fs_blend = create_fs(&t, blend_fs);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+   rast.multisample = 1;
+   cso_set_rasterizer(t.cso, &rast);
+   cso_set_min_samples(t.cso, 1);
+
+   set_color_buffer(&t, ms);
+   t.pipe->clear(t.pipe, PIPE_CLEAR_COLOR0, NULL, &red, 0.0, 0);
+
+   query = t.pipe->create_query(t.pipe, PIPE_QUERY_OCCLUSION_COUNTER, 0);
+   t.pipe->begin_query(t.pipe, query);
+   cso_set_fragment_shader_handle(t.cso, fs_solid);
+   draw_rect(&t, 8.5f, 6.25f, 53.75f, 40.5f);
+   t.pipe->end_query(t.pipe, query);
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+   cso_set_blend(t.cso, &blend);
+   cso_set_fragment_shader_handle(t.cso, fs_blend);
+   draw_rect(&t, 0, 32, WIDTH, HEIGHT);
+
+   memset(&info, 0, sizeof info);
+   info.src.resource = ms;
+   info.src.format = format;
+   info.src.box.width = WIDTH;
+   info.src.box.height = HEIGHT;
+   info.src.box.depth = 1;
+   info.dst.resource = resolved;
+   info.dst.format = format;
+   info.dst.box = info.src.box;
+   info.mask = PIPE_MASK_RGBA;
+   info.filter = PIPE_TEX_FILTER_NEAREST;
+   t.pipe->blit(t.pipe, &info);
+
+   read_texture(&t, resolved, texels);
+   t.pipe->get_query_result(t.pipe, query, TRUE, &result);
+   *samples = result.u64;
+
+   cso_set_fragment_shader_handle(t.cso, NULL);
+   t.pipe->destroy_query(t.pipe, query);
+   t.pipe->delete_fs_state(t.pipe, fs_solid);
+   t.pipe->delete_fs_state(t.pipe, fs_blend);
+   pipe_resource_reference(&ms, NULL);
+   pipe_resource_reference(&resolved, NULL);
+   draw_test_destroy(&t);
+
+   return TRUE;
+}
+
+
+/**
+ * Multisampled rendering storing the first sample only of blocks whose
+ * samples are equal, resolved from that, must give the same pixels and
+ * sample counts as rendering and resolving every sample.
+ */
+static boolean
+test_msaa_resolve(unsigned verbose)
+{
+   uint32_t *texels = MALLOC(WIDTH * HEIGHT * 4);
+   uint32_t *expected = MALLOC(WIDTH * HEIGHT * 4);
+   uint64_t samples, expected_samples;
+   boolean success, edge_found = FALSE;
+   unsigned i;
+
+   success = draw_msaa("", texels, &samples) &&
+             draw_msaa("no_defer_clear", expected, &expected_samples);
+
+   /* Resolves may round halfway averages either way. */
+   success = success &&
+             compare_texels("msaa resolve", texels, expected, 1);
+
+   /* Inside, outside and partially covered by the solid rectangle */
+   if (success &&
+       (texels[20 * WIDTH + 20] != GREEN || texels[2 * WIDTH + 2] != RED))
+      success = FALSE;
+   for (i = 0; success && i < HEIGHT / 2; i++) {
+      if (texels[i * WIDTH + 8] != RED && texels[i * WIDTH + 8] != GREEN)
+         edge_found = TRUE;
+   }
+   if (success && !edge_found) {
+      fprintf(stderr, "msaa resolve: no partially covered pixels\n");
+      success = FALSE;
+   }
+
+   if (success && samples != expected_samples) {
+      fprintf(stderr, "msaa resolve: %" PRIu64 " samples passed, "
+              "expected %" PRIu64 "\n", samples, expected_samples);
+      success = FALSE;
+   }
+
+   if (verbose || !success)
+      printf("msaa resolve: %s\n", success ? "pass" : "FAIL");
+
+   FREE(texels);
+   FREE(expected);
+
+   return success;
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "result\t"
+           "test\n");
+
+   fflush(fp);
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   boolean success = TRUE;
+
+   success = test_tiled_image_store(verbose) && success;
+   success = test_fast_blit(verbose) && success;
+   success = test_msaa_resolve(verbose) && success;
+
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   return test_all(verbose, fp);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   printf("no test_single()");
+   return TRUE;
+}
@@ -35,15 +35,18 @@
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
 
+#include "util/u_atomic.h"
 #include "util/u_inlines.h"
 #include "util/u_cpu_detect.h"
 #include "util/format/u_format.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
+#include "util/u_surface.h"
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
 
 #include "lp_context.h"
+#include "lp_debug.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -225,6 +228,32 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
 }
 
 
+/**
+ * Can sampler views of the texture read from a 4x4 tiled copy of it?
+ * Only for uncompressed 2D, 3D, cube and array textures that are written
+ * through transfers or as render targets, whose writes we can track.
+ * Textures bound as writable images later on stop being tiled, see
+ * llvmpipe_set_shader_images().
+ */
+static boolean
+llvmpipe_texture_is_tileable(const struct pipe_resource *pt)
+{
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   if (llvmpipe_resource_is_1d(pt) ||
+       pt->nr_samples > 1 ||
+       (pt->bind & (PIPE_BIND_DEPTH_STENCIL |
+                    PIPE_BIND_SHADER_IMAGE |
+                    PIPE_BIND_LINEAR)))
+      return FALSE;
+
+   return desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          desc->block.bits % 8 == 0;
+}
+
+
 static struct pipe_resource *
 llvmpipe_resource_create_all(struct pipe_screen *_screen,
                              const struct pipe_resource *templat,
@@ -254,6 +283,31 @@ llvmpipe_resource_create_all(struct pipe_screen *_screen,
          /* texture map */
          if (!llvmpipe_texture_layout(screen, lpr, alloc_backing))
             goto fail;
+
+         lpr->tileable = (LP_PERF & PERF_TILED_TEX) && alloc_backing &&
+                         llvmpipe_texture_is_tileable(&lpr->base);
+
+         /* Only memory nothing but llvmpipe reads, see
+          * lp_scene_begin_rasterization() for the rest of the conditions.
+          */
+         lpr->clear_deferrable = !(LP_PERF & PERF_NO_DEFER_CLEAR) &&
+                                 alloc_backing &&
+                                 (lpr->base.target == PIPE_TEXTURE_2D ||
+                                  lpr->base.target == PIPE_TEXTURE_RECT) &&
+                                 lpr->base.array_size == 1 &&
+                                 (lpr->base.bind & (PIPE_BIND_RENDER_TARGET |
+                                                    PIPE_BIND_DEPTH_STENCIL));
+         if (lpr->clear_deferrable) {
+            /* Allocated up front, as scenes of any context may use it. */
+            unsigned tiles_x = DIV_ROUND_UP(lpr->base.width0, TILE_SIZE);
+            unsigned tiles_y = DIV_ROUND_UP(lpr->base.height0, TILE_SIZE);
+
+            lpr->tile_clears = CALLOC(tiles_x * tiles_y,
+                                      sizeof *lpr->tile_clears);
+            lpr->tile_clears_stride = tiles_x;
+            if (!lpr->tile_clears)
+               lpr->clear_deferrable = FALSE;
+         }
       }
    }
    else {
@@ -353,6 +407,11 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
             align_free(lpr->tex_data);
             lpr->tex_data = NULL;
          }
+         if (lpr->tiled_data) {
+            align_free(lpr->tiled_data);
+            lpr->tiled_data = NULL;
+         }
+         FREE(lpr->tile_clears);
       }
       else if (!lpr->userBuffer) {
          if (lpr->data)
@@ -588,6 +647,21 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
       }
    }
 
+   /*
+    * Unsynchronized maps can't write the deferred clears while a scene may
+    * still be adding to them, so wait for rendering first, but only if there
+    * are any.  Those a scene in flight adds are for tiles the caller promised
+    * not to touch.
+    */
+   if (lpr->tile_clears && (p_atomic_read(&lpr->num_pending_clears) ||
+                            p_atomic_read(&lpr->num_uniform_tiles))) {
+      if (usage & PIPE_MAP_UNSYNCHRONIZED)
+         llvmpipe_flush_resource(pipe, resource, 0, FALSE, TRUE, FALSE,
+                                 __FUNCTION__);
+      llvmpipe_resource_resolve_clears(resource,
+                                       (usage & PIPE_MAP_DISCARD_WHOLE_RESOURCE) != 0);
+   }
+
    lpt = CALLOC_STRUCT(llvmpipe_transfer);
    if (!lpt)
       return NULL;
@@ -638,6 +712,7 @@ llvmpipe_transfer_map_ms( struct pipe_context *pipe,
       /* Do something to notify sharing contexts of a texture change.
        */
       screen->timestamp++;
+      lpr->tiled_dirty = TRUE;
    }
 
    map +=
@@ -790,6 +865,232 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 }
 
 
+/**
+ * Copy sample 0 of the 4x4 block at x, y of level 0 to the other samples.
+ */
+void
+llvmpipe_resource_expand_block(struct llvmpipe_resource *lpr,
+                               unsigned x, unsigned y)
+{
+   const unsigned block_size = util_format_get_blocksize(lpr->base.format);
+   const unsigned stride = lpr->row_stride[0];
+   const ubyte *src = (const ubyte *)lpr->tex_data + y * stride +
+                      x * block_size;
+   unsigned s, i;
+
+   for (s = 1; s < lpr->base.nr_samples; s++) {
+      ubyte *dst = (ubyte *)src + s * lpr->sample_stride;
+      for (i = 0; i < 4; i++)
+         memcpy(dst + i * stride, src + i * stride, 4 * block_size);
+   }
+}
+
+
+/**
+ * Copy sample 0 of the uniform blocks of the tile at tile_x, tile_y to the
+ * other samples, and clear the blocks' bits.
+ */
+void
+llvmpipe_resource_expand_tile(struct llvmpipe_resource *lpr,
+                              struct llvmpipe_tile_clear *tile,
+                              unsigned tile_x, unsigned tile_y)
+{
+   unsigned i;
+
+   for (i = 0; i < LP_TILE_BLOCK_WORDS; i++) {
+      uint64_t bits = tile->uniform_blocks[i];
+      while (bits) {
+         const unsigned block = i * 64 + u_bit_scan64(&bits);
+         llvmpipe_resource_expand_block(lpr,
+                                        tile_x + block % (TILE_SIZE / 4) * 4,
+                                        tile_y + block / (TILE_SIZE / 4) * 4);
+      }
+      tile->uniform_blocks[i] = 0;
+   }
+}
+
+
+/**
+ * Write the clears the rasterizer deferred to the resource's memory, or
+ * just forget them if the whole resource is about to be overwritten.
+ * The samples of blocks only stored once are written out as well.
+ * Must be called before anything but the rasterizer's tile commands reads
+ * or writes level 0, once rendering to the resource has finished.
+ */
+void
+llvmpipe_resource_resolve_clears(struct pipe_resource *resource,
+                                 boolean discard)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   const enum pipe_format format = resource->format;
+   const unsigned block_size = util_format_get_blocksize(format);
+   const boolean is_zs = util_format_is_depth_or_stencil(format);
+   unsigned tiles_x, tiles_y, x, y, s;
+
+   if (!lpr->tile_clears ||
+       (!p_atomic_read(&lpr->num_pending_clears) &&
+        !p_atomic_read(&lpr->num_uniform_tiles)))
+      return;
+
+   tiles_x = lpr->tile_clears_stride;
+   tiles_y = DIV_ROUND_UP(resource->height0, TILE_SIZE);
+
+   for (y = 0; y < tiles_y; y++) {
+      for (x = 0; x < tiles_x; x++) {
+         struct llvmpipe_tile_clear *tile = &lpr->tile_clears[y * tiles_x + x];
+         union util_color uc;
+
+         if (tile->uniform) {
+            if (discard || tile->pending)
+               memset(tile->uniform_blocks, 0, sizeof tile->uniform_blocks);
+            else
+               llvmpipe_resource_expand_tile(lpr, tile,
+                                             x * TILE_SIZE, y * TILE_SIZE);
+            tile->uniform = FALSE;
+         }
+
+         if (!tile->pending)
+            continue;
+         tile->pending = FALSE;
+
+         if (discard)
+            continue;
+
+         if (is_zs) {
+            /* Packed z/stencil values are native endian integers. */
+            switch (block_size) {
+            case 1:
+               uc.ub = (ubyte)tile->value.zs;
+               break;
+            case 2:
+               uc.us = (ushort)tile->value.zs;
+               break;
+            case 4:
+               uc.ui[0] = (uint32_t)tile->value.zs;
+               break;
+            default:
+               memcpy(&uc, &tile->value.zs, sizeof tile->value.zs);
+               break;
+            }
+         }
+         else {
+            uc = tile->value.color;
+         }
+
+         for (s = 0; s < util_res_sample_count(resource); s++) {
+            util_fill_rect((ubyte *)lpr->tex_data + s * lpr->sample_stride,
+                           format, lpr->row_stride[0],
+                           x * TILE_SIZE, y * TILE_SIZE,
+                           MIN2(TILE_SIZE, resource->width0 - x * TILE_SIZE),
+                           MIN2(TILE_SIZE, resource->height0 - y * TILE_SIZE),
+                           &uc);
+         }
+      }
+   }
+
+   p_atomic_set(&lpr->num_pending_clears, 0);
+   p_atomic_set(&lpr->num_uniform_tiles, 0);
+   lpr->tiled_dirty = TRUE;
+}
+
+
+/**
+ * Does the view sample from the tiled copy of its texture?
+ * Textures bound in the framebuffer are sampled from tex_data, as rendering
+ * may still be writing to them.
+ */
+boolean
+llvmpipe_sampler_view_is_tiled(const struct pipe_sampler_view *view,
+                               const struct pipe_framebuffer_state *fb)
+{
+   unsigned i;
+
+   if (!view || !view->texture ||
+       !llvmpipe_resource_const(view->texture)->tileable)
+      return FALSE;
+
+   if (util_format_get_blocksize(view->format) !=
+       util_format_get_blocksize(view->texture->format) ||
+       util_format_is_compressed(view->format))
+      return FALSE;
+
+   for (i = 0; i < fb->nr_cbufs; i++) {
+      if (fb->cbufs[i] && fb->cbufs[i]->texture == view->texture)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Rebuild the tiled copy of a tileable texture from tex_data, if tex_data
+ * was written since it was last built.
+ */
+void
+llvmpipe_resource_update_tiled(struct pipe_context *pipe,
+                               struct pipe_resource *resource)
+{
+   struct llvmpipe_resource *lpr = llvmpipe_resource(resource);
+   unsigned texel_size = util_format_get_blocksize(resource->format);
+   unsigned level;
+
+   assert(lpr->tileable);
+
+   if (lpr->tiled_data && !lpr->tiled_dirty)
+      return;
+
+   if (!lpr->tiled_data) {
+      lpr->tiled_data = align_malloc(lpr->size_required,
+                                     MAX2(64, util_get_cpu_caps()->cacheline));
+      if (!lpr->tiled_data) {
+         lpr->tileable = FALSE;
+         return;
+      }
+   }
+
+   /* Wait for rendering to the texture, and for shaders still sampling the
+    * previous tiled copy.
+    */
+   llvmpipe_flush_resource(pipe, resource, 0, FALSE, TRUE, FALSE, __FUNCTION__);
+   llvmpipe_resource_resolve_clears(resource, FALSE);
+
+   for (level = 0; level <= resource->last_level; level++) {
+      unsigned width = align(u_minify(resource->width0, level), 4);
+      unsigned height = align(u_minify(resource->height0, level), 4);
+      unsigned row_stride = lpr->row_stride[level];
+      unsigned num_slices, slice, x, y;
+
+      if (resource->target == PIPE_TEXTURE_3D)
+         num_slices = u_minify(resource->depth0, level);
+      else
+         num_slices = resource->array_size;
+
+      for (slice = 0; slice < num_slices; slice++) {
+         uint64_t offset = lpr->mip_offsets[level] +
+                           slice * lpr->img_stride[level];
+         const ubyte *src = (const ubyte *)lpr->tex_data + offset;
+         ubyte *dst = (ubyte *)lpr->tiled_data + offset;
+
+         /* Each 4 texel row segment moves as a whole, see
+          * lp_build_sample_tiled_partial_offset() for the layout.
+          */
+         for (y = 0; y < height; y++) {
+            ubyte *dst_row = dst + (y & ~3) * row_stride +
+                             (y & 3) * 4 * texel_size;
+            for (x = 0; x < width; x += 4) {
+               memcpy(dst_row + x * 4 * texel_size,
+                      src + y * row_stride + x * texel_size,
+                      4 * texel_size);
+            }
+         }
+      }
+   }
+
+   lpr->tiled_dirty = FALSE;
+}
+
+
 /**
  * Return size of resource in bytes
  */
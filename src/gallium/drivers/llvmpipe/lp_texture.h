@@ -31,6 +31,7 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_pack_color.h"
 #include "lp_limits.h"
 
 
@@ -50,6 +51,32 @@ struct llvmpipe_screen;
 struct sw_displaytarget;
 
 
+/** Number of 64 bit words with a bit for each 4x4 block of a tile */
+#define LP_TILE_BLOCK_WORDS (TILE_SIZE * TILE_SIZE / 16 / 64)
+
+
+/**
+ * Clear value of a tile of level 0 that hasn't been written to tex_data yet.
+ */
+struct llvmpipe_tile_clear
+{
+   union {
+      union util_color color;
+      uint64_t zs;
+   } value;
+   boolean pending;
+
+   /**
+    * Multisampled color buffers only: the 4x4 blocks of the tile, in raster
+    * order, whose samples all hold the value stored for sample 0.  The other
+    * samples of those blocks are stale in tex_data.  Meaningless while the
+    * clear is pending.
+    */
+   boolean uniform;  /**< some bit may be set */
+   uint64_t uniform_blocks[LP_TILE_BLOCK_WORDS];
+};
+
+
 /**
  * llvmpipe subclass of pipe_resource.  A texture, drawing surface,
  * vertex buffer, const buffer, etc.
@@ -84,6 +111,32 @@ struct llvmpipe_resource
     */
    void *tex_data;
 
+   /**
+    * Copy of tex_data with every 2D image stored in 4x4 texel tiles, which
+    * is what shaders sample from with LP_PERF=tiled_tex.  Same size and
+    * level/layer offsets as tex_data, rebuilt from it when tiled_dirty is set.
+    */
+   void *tiled_data;
+   boolean tileable;     /**< may be sampled from tiled_data, cleared for
+                              good once bound as a writable image */
+   boolean tiled_dirty;  /**< tex_data written since tiled_data was built */
+
+   /**
+    * Clears of whole TILE_SIZE tiles of level 0 are kept here by the
+    * rasterizer until the tile is next drawn to, and written to tex_data
+    * before anything else reads it, see llvmpipe_resource_resolve_clears().
+    * For multisampled resources one value stands for all samples of the
+    * tile, which are only written out when the tile stops being uniform.
+    * Multisampled color buffers also track the blocks of each tile whose
+    * samples are equal, so that only their first sample gets shaded and
+    * stored.
+    */
+   boolean clear_deferrable;
+   struct llvmpipe_tile_clear *tile_clears;
+   unsigned tile_clears_stride;  /**< tiles per row */
+   unsigned num_pending_clears;  /**< updated atomically */
+   unsigned num_uniform_tiles;   /**< tiles with uniform set, ditto */
+
    /**
     * Data for non-texture resources.
     */
@@ -235,6 +288,29 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
                                    unsigned face_slice, unsigned level);
 
 
+void
+llvmpipe_resource_expand_block(struct llvmpipe_resource *lpr,
+                               unsigned x, unsigned y);
+
+void
+llvmpipe_resource_expand_tile(struct llvmpipe_resource *lpr,
+                              struct llvmpipe_tile_clear *tile,
+                              unsigned tile_x, unsigned tile_y);
+
+void
+llvmpipe_resource_resolve_clears(struct pipe_resource *resource,
+                                 boolean discard);
+
+boolean
+llvmpipe_sampler_view_is_tiled(const struct pipe_sampler_view *view,
+                               const struct pipe_framebuffer_state *fb);
+
+
+void
+llvmpipe_resource_update_tiled(struct pipe_context *pipe,
+                               struct pipe_resource *resource);
+
+
 extern void
 llvmpipe_print_resources(void);
 
@@ -24,6 +24,7 @@
 #include "lvp_private.h"
 #include "pipe/p_context.h"
 #include "vk_util.h"
+#include "util/hash_table.h"
 
 static VkResult lvp_create_cmd_buffer(
    struct lvp_device *                         device,
@@ -43,6 +44,7 @@ static VkResult lvp_create_cmd_buffer(
    cmd_buffer->device = device;
    cmd_buffer->pool = pool;
    list_inithead(&cmd_buffer->cmds);
+   list_inithead(&cmd_buffer->chunks);
    cmd_buffer->last_emit = &cmd_buffer->cmds;
    cmd_buffer->status = LVP_CMD_BUFFER_STATUS_INITIAL;
    if (pool) {
@@ -61,10 +63,18 @@ static VkResult lvp_create_cmd_buffer(
 static void
 lvp_cmd_buffer_free_all_cmds(struct lvp_cmd_buffer *cmd_buffer)
 {
-   struct lvp_cmd_buffer_entry *tmp, *cmd;
-   LIST_FOR_EACH_ENTRY_SAFE(cmd, tmp, &cmd_buffer->cmds, cmd_link) {
-      list_del(&cmd->cmd_link);
-      vk_free(&cmd_buffer->pool->alloc, cmd);
+   /* Hand the chunks back to the pool, keeping only the standard sized
+    * ones for reuse.
+    */
+   list_for_each_entry_safe(struct lvp_cmd_chunk, chunk,
+                            &cmd_buffer->chunks, link) {
+      list_del(&chunk->link);
+      if (chunk->size == LVP_CMD_CHUNK_SIZE) {
+         chunk->used = 0;
+         list_add(&chunk->link, &cmd_buffer->pool->free_chunks);
+      } else {
+         vk_free(&cmd_buffer->pool->alloc, chunk);
+      }
    }
 }
 
@@ -167,14 +177,118 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_BeginCommandBuffer(
       if (result != VK_SUCCESS)
          return result;
    }
+   cmd_buffer->usage_flags = pBeginInfo->flags;
    cmd_buffer->status = LVP_CMD_BUFFER_STATUS_RECORDING;
    return VK_SUCCESS;
 }
 
+static void *cmd_buf_alloc(struct lvp_cmd_buffer *cmd_buffer, uint32_t size);
+
+static void
+bake_descriptor_sets(struct lvp_cmd_buffer *cmd_buffer,
+                     struct lvp_cmd_bind_descriptor_sets *bds)
+{
+   struct lvp_baked_descriptor *baked;
+   uint32_t count;
+
+   count = lvp_bake_descriptor_sets(bds, NULL);
+   baked = cmd_buf_alloc(cmd_buffer, count * sizeof(*baked));
+   /* on failure the bind is simply translated at execution time */
+   if (!baked)
+      return;
+   bds->baked_count = lvp_bake_descriptor_sets(bds, baked);
+   bds->baked = baked;
+}
+
+static void
+bake_pipeline(struct lvp_cmd_buffer *cmd_buffer,
+              struct hash_table *pipelines,
+              struct lvp_cmd_bind_pipeline *bp)
+{
+   struct lvp_baked_pipeline *baked;
+   struct hash_entry *entry;
+
+   if (bp->pipeline->is_compute_pipeline)
+      return;
+
+   /* binds of the same pipeline share the translation */
+   entry = _mesa_hash_table_search(pipelines, bp->pipeline);
+   if (entry) {
+      bp->baked = entry->data;
+      return;
+   }
+
+   baked = cmd_buf_alloc(cmd_buffer, sizeof(*baked));
+   if (!baked)
+      return;
+   lvp_bake_graphics_pipeline(bp->pipeline, baked);
+   _mesa_hash_table_insert(pipelines, bp->pipeline, baked);
+   bp->baked = baked;
+}
+
+/* Secondaries and simultaneous-use primaries are typically recorded once
+ * and replayed many times, so translate everything that doesn't depend on
+ * the state they execute in up front: descriptor bindings, pipeline state,
+ * viewports and scissors, and the index buffer offset of indexed draws.
+ */
+static void
+lvp_cmd_buffer_bake(struct lvp_cmd_buffer *cmd_buffer)
+{
+   const struct lvp_cmd_bind_index_buffer *ib = NULL;
+   struct hash_table *pipelines = _mesa_pointer_hash_table_create(NULL);
+
+   list_for_each_entry(struct lvp_cmd_buffer_entry, cmd, &cmd_buffer->cmds, cmd_link) {
+      switch (cmd->cmd_type) {
+      case LVP_CMD_BIND_DESCRIPTOR_SETS:
+         bake_descriptor_sets(cmd_buffer, &cmd->u.descriptor_sets);
+         break;
+      case LVP_CMD_BIND_PIPELINE:
+         if (pipelines)
+            bake_pipeline(cmd_buffer, pipelines, &cmd->u.pipeline);
+         break;
+      case LVP_CMD_SET_VIEWPORT: {
+         struct pipe_viewport_state *baked =
+            cmd_buf_alloc(cmd_buffer, cmd->u.set_viewport.viewport_count * sizeof(*baked));
+         if (baked) {
+            lvp_bake_viewports(&cmd->u.set_viewport, baked);
+            cmd->u.set_viewport.baked = baked;
+         }
+         break;
+      }
+      case LVP_CMD_SET_SCISSOR: {
+         struct pipe_scissor_state *baked =
+            cmd_buf_alloc(cmd_buffer, cmd->u.set_scissor.scissor_count * sizeof(*baked));
+         if (baked) {
+            lvp_bake_scissors(&cmd->u.set_scissor, baked);
+            cmd->u.set_scissor.baked = baked;
+         }
+         break;
+      }
+      case LVP_CMD_BIND_INDEX_BUFFER:
+         ib = &cmd->u.index_buffer;
+         break;
+      case LVP_CMD_DRAW_INDEXED:
+         /* an index buffer bound by the primary is only known at execution */
+         if (ib && cmd->u.draw_indexed.calc_start)
+            lvp_bake_draw_indexed(ib, &cmd->u.draw_indexed);
+         break;
+      default:
+         break;
+      }
+   }
+
+   _mesa_hash_table_destroy(pipelines, NULL);
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL lvp_EndCommandBuffer(
    VkCommandBuffer                             commandBuffer)
 {
    LVP_FROM_HANDLE(lvp_cmd_buffer, cmd_buffer, commandBuffer);
+
+   if (cmd_buffer->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY ||
+       (cmd_buffer->usage_flags & VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT))
+      lvp_cmd_buffer_bake(cmd_buffer);
+
    cmd_buffer->status = LVP_CMD_BUFFER_STATUS_EXECUTABLE;
    return VK_SUCCESS;
 }
@@ -202,6 +316,7 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateCommandPool(
 
    list_inithead(&pool->cmd_buffers);
    list_inithead(&pool->free_cmd_buffers);
+   list_inithead(&pool->free_chunks);
 
    *pCmdPool = lvp_cmd_pool_to_handle(pool);
 
@@ -229,6 +344,11 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyCommandPool(
       lvp_cmd_buffer_destroy(cmd_buffer);
    }
 
+   list_for_each_entry_safe(struct lvp_cmd_chunk, chunk,
+                            &pool->free_chunks, link) {
+      vk_free(&pool->alloc, chunk);
+   }
+
    vk_object_base_finish(&pool->base);
    vk_free2(&device->vk.alloc, pAllocator, pool);
 }
@@ -264,6 +384,50 @@ VKAPI_ATTR void VKAPI_CALL lvp_TrimCommandPool(
                             &pool->free_cmd_buffers, pool_link) {
       lvp_cmd_buffer_destroy(cmd_buffer);
    }
+
+   list_for_each_entry_safe(struct lvp_cmd_chunk, chunk,
+                            &pool->free_chunks, link) {
+      list_del(&chunk->link);
+      vk_free(&pool->alloc, chunk);
+   }
+}
+
+/* Allocate from the command buffer's current chunk, taking a new one from
+ * the pool when it is full.  Commands are freed all at once on reset.
+ */
+static void *cmd_buf_alloc(struct lvp_cmd_buffer *cmd_buffer, uint32_t size)
+{
+   struct lvp_cmd_pool *pool = cmd_buffer->pool;
+   struct lvp_cmd_chunk *chunk = NULL;
+   void *ptr;
+
+   size = align(size, 8);
+
+   if (!list_is_empty(&cmd_buffer->chunks)) {
+      chunk = list_last_entry(&cmd_buffer->chunks, struct lvp_cmd_chunk, link);
+      if (chunk->size - chunk->used < size)
+         chunk = NULL;
+   }
+
+   if (!chunk) {
+      if (size <= LVP_CMD_CHUNK_SIZE && !list_is_empty(&pool->free_chunks)) {
+         chunk = list_first_entry(&pool->free_chunks, struct lvp_cmd_chunk, link);
+         list_del(&chunk->link);
+      } else {
+         uint32_t chunk_size = MAX2(size, LVP_CMD_CHUNK_SIZE);
+         chunk = vk_alloc(&pool->alloc, sizeof(*chunk) + chunk_size,
+                          8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+         if (!chunk)
+            return NULL;
+         chunk->size = chunk_size;
+         chunk->used = 0;
+      }
+      list_addtail(&chunk->link, &cmd_buffer->chunks);
+   }
+
+   ptr = (uint8_t *)chunk->data + chunk->used;
+   chunk->used += size;
+   return ptr;
 }
 
 static struct lvp_cmd_buffer_entry *cmd_buf_entry_alloc_size(struct lvp_cmd_buffer *cmd_buffer,
@@ -272,9 +436,7 @@ static struct lvp_cmd_buffer_entry *cmd_buf_entry_alloc_size(struct lvp_cmd_buff
 {
    struct lvp_cmd_buffer_entry *cmd;
    uint32_t cmd_size = sizeof(*cmd) + extra_size;
-   cmd = vk_alloc(&cmd_buffer->pool->alloc,
-                  cmd_size,
-                  8, VK_SYSTEM_ALLOCATION_SCOPE_OBJECT);
+   cmd = cmd_buf_alloc(cmd_buffer, cmd_size);
    if (!cmd)
       return NULL;
 
@@ -426,6 +588,7 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdBindPipeline(
 
    cmd->u.pipeline.bind_point = pipelineBindPoint;
    cmd->u.pipeline.pipeline = pipeline;
+   cmd->u.pipeline.baked = NULL;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
@@ -470,6 +633,8 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdBindDescriptorSets(
    for (i = 0; i < dynamicOffsetCount; i++)
       offsets[i] = pDynamicOffsets[i];
    cmd->u.descriptor_sets.dynamic_offsets = offsets;
+   cmd->u.descriptor_sets.baked = NULL;
+   cmd->u.descriptor_sets.baked_count = 0;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
@@ -560,6 +725,7 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdSetViewport(
    cmd->u.set_viewport.viewport_count = viewportCount;
    for (i = 0; i < viewportCount; i++)
       cmd->u.set_viewport.viewports[i] = pViewports[i];
+   cmd->u.set_viewport.baked = NULL;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
@@ -582,6 +748,7 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdSetScissor(
    cmd->u.set_scissor.scissor_count = scissorCount;
    for (i = 0; i < scissorCount; i++)
       cmd->u.set_scissor.scissors[i] = pScissors[i];
+   cmd->u.set_scissor.baked = NULL;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
@@ -2012,6 +2179,7 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdSetViewportWithCountEXT(
    cmd->u.set_viewport.viewport_count = viewportCount;
    for (i = 0; i < viewportCount; i++)
       cmd->u.set_viewport.viewports[i] = pViewports[i];
+   cmd->u.set_viewport.baked = NULL;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
@@ -2033,6 +2201,7 @@ VKAPI_ATTR void VKAPI_CALL lvp_CmdSetScissorWithCountEXT(
    cmd->u.set_scissor.scissor_count = scissorCount;
    for (i = 0; i < scissorCount; i++)
       cmd->u.set_scissor.scissors[i] = pScissors[i];
+   cmd->u.set_scissor.baked = NULL;
 
    cmd_buf_queue(cmd_buffer, cmd);
 }
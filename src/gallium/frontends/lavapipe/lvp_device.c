@@ -22,6 +22,7 @@
  */
 
 #include "lvp_private.h"
+#include "lvp_conv.h"
 
 #include "pipe-loader/pipe_loader.h"
 #include "git_sha1.h"
@@ -34,6 +35,7 @@
 #include "util/os_memory.h"
 #include "util/u_thread.h"
 #include "util/u_atomic.h"
+#include "util/u_cpu_detect.h"
 #include "util/timespec.h"
 #include "os_time.h"
 
@@ -122,6 +124,7 @@ static const struct vk_device_extension_table lvp_device_extensions_supported =
 #ifdef LVP_USE_WSI_PLATFORM
    .KHR_swapchain                         = true,
 #endif
+   .KHR_timeline_semaphore                = true,
    .KHR_uniform_buffer_standard_layout    = true,
    .KHR_variable_pointers                 = true,
    .EXT_calibrated_timestamps             = true,
@@ -607,6 +610,12 @@ VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceFeatures2(
          features->hostQueryReset = true;
          break;
       }
+      case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES: {
+         VkPhysicalDeviceTimelineSemaphoreFeatures *features =
+            (VkPhysicalDeviceTimelineSemaphoreFeatures *)ext;
+         features->timelineSemaphore = true;
+         break;
+      }
       case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES_KHR: {
          VkPhysicalDeviceBufferDeviceAddressFeaturesKHR *features = (void *)ext;
          features->bufferDeviceAddress = true;
@@ -995,23 +1004,34 @@ VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceProperties2(
          props->maxMultiDrawCount = 2048;
          break;
       }
+      case VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_PROPERTIES: {
+         VkPhysicalDeviceTimelineSemaphoreProperties *props =
+            (VkPhysicalDeviceTimelineSemaphoreProperties *)ext;
+         props->maxTimelineSemaphoreValueDifference = UINT64_MAX;
+         break;
+      }
       default:
          break;
       }
    }
 }
 
+/* Family 0 does everything, family 1 is a compute/transfer-only family so
+ * that applications can run async compute on its own context and thread.
+ */
 static void lvp_get_physical_device_queue_family_properties(
+   uint32_t                                    family,
    VkQueueFamilyProperties*                    pQueueFamilyProperties)
 {
    *pQueueFamilyProperties = (VkQueueFamilyProperties) {
-      .queueFlags = VK_QUEUE_GRAPHICS_BIT |
-      VK_QUEUE_COMPUTE_BIT |
+      .queueFlags = VK_QUEUE_COMPUTE_BIT |
       VK_QUEUE_TRANSFER_BIT,
-      .queueCount = 1,
+      .queueCount = LVP_MAX_QUEUES,
       .timestampValidBits = 64,
       .minImageTransferGranularity = (VkExtent3D) { 1, 1, 1 },
    };
+   if (family == 0)
+      pQueueFamilyProperties->queueFlags |= VK_QUEUE_GRAPHICS_BIT;
 }
 
 VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceQueueFamilyProperties(
@@ -1020,12 +1040,13 @@ VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceQueueFamilyProperties(
    VkQueueFamilyProperties*                    pQueueFamilyProperties)
 {
    if (pQueueFamilyProperties == NULL) {
-      *pCount = 1;
+      *pCount = LVP_QUEUE_FAMILY_COUNT;
       return;
    }
 
-   assert(*pCount >= 1);
-   lvp_get_physical_device_queue_family_properties(pQueueFamilyProperties);
+   *pCount = MIN2(*pCount, LVP_QUEUE_FAMILY_COUNT);
+   for (uint32_t i = 0; i < *pCount; i++)
+      lvp_get_physical_device_queue_family_properties(i, &pQueueFamilyProperties[i]);
 }
 
 VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceQueueFamilyProperties2(
@@ -1034,12 +1055,13 @@ VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceQueueFamilyProperties2(
    VkQueueFamilyProperties2                   *pQueueFamilyProperties)
 {
    if (pQueueFamilyProperties == NULL) {
-      *pCount = 1;
+      *pCount = LVP_QUEUE_FAMILY_COUNT;
       return;
    }
 
-   assert(*pCount >= 1);
-   lvp_get_physical_device_queue_family_properties(&pQueueFamilyProperties->queueFamilyProperties);
+   *pCount = MIN2(*pCount, LVP_QUEUE_FAMILY_COUNT);
+   for (uint32_t i = 0; i < *pCount; i++)
+      lvp_get_physical_device_queue_family_properties(i, &pQueueFamilyProperties[i].queueFamilyProperties);
 }
 
 VKAPI_ATTR void VKAPI_CALL lvp_GetPhysicalDeviceMemoryProperties(
@@ -1116,6 +1138,52 @@ VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL vk_icdGetPhysicalDeviceProcAddr(
    return vk_instance_get_physical_device_proc_addr(&instance->vk, pName);
 }
 
+static void
+queue_wait_semaphores(struct lvp_device *device, struct lvp_queue_work *task)
+{
+   mtx_lock(&device->semaphore_lock);
+   for (uint32_t i = 0; i < task->wait_count; i++) {
+      while (task->waits[i]->value < task->wait_vals[i])
+         u_cnd_monotonic_wait(&device->semaphore_cnd, &device->semaphore_lock);
+   }
+   mtx_unlock(&device->semaphore_lock);
+}
+
+static void
+queue_signal_semaphores(struct lvp_device *device, uint32_t count,
+                        struct lvp_semaphore **semas, const uint64_t *vals)
+{
+   mtx_lock(&device->semaphore_lock);
+   for (uint32_t i = 0; i < count; i++)
+      semas[i]->value = MAX2(semas[i]->value, vals[i]);
+   u_cnd_monotonic_broadcast(&device->semaphore_cnd);
+   mtx_unlock(&device->semaphore_lock);
+}
+
+/* Hand a pipeline's CSO set to the queue that owns it.  Only the queue's
+ * thread may use its context, so the set is deleted there.
+ */
+void
+lvp_queue_delete_csos(struct lvp_queue *queue, void **csos)
+{
+   mtx_lock(&queue->m);
+   memcpy(util_dynarray_grow(&queue->dead_csos, void *, PIPE_SHADER_TYPES),
+          csos, PIPE_SHADER_TYPES * sizeof(void *));
+   cnd_signal(&queue->new_work);
+   mtx_unlock(&queue->m);
+}
+
+static void
+queue_free_dead_csos(struct lvp_queue *queue, struct util_dynarray *dead)
+{
+   void **csos = dead->data;
+   unsigned count = util_dynarray_num_elements(dead, void *);
+
+   for (unsigned i = 0; i < count; i += PIPE_SHADER_TYPES)
+      lvp_pipeline_delete_csos(queue->ctx, &csos[i]);
+   util_dynarray_fini(dead);
+}
+
 static int queue_thread(void *data)
 {
    struct lvp_queue *queue = data;
@@ -1123,28 +1191,55 @@ static int queue_thread(void *data)
    mtx_lock(&queue->m);
    while (!queue->shutdown) {
       struct lvp_queue_work *task;
-      while (list_is_empty(&queue->workqueue) && !queue->shutdown)
+      while (list_is_empty(&queue->workqueue) && !queue->dead_csos.size &&
+             !queue->shutdown)
          cnd_wait(&queue->new_work, &queue->m);
 
       if (queue->shutdown)
          break;
 
+      if (queue->dead_csos.size) {
+         struct util_dynarray dead = queue->dead_csos;
+
+         util_dynarray_init(&queue->dead_csos, NULL);
+         mtx_unlock(&queue->m);
+         queue_free_dead_csos(queue, &dead);
+         mtx_lock(&queue->m);
+         continue;
+      }
+
       task = list_first_entry(&queue->workqueue, struct lvp_queue_work,
                               list);
 
       mtx_unlock(&queue->m);
+      if (task->wait_count)
+         queue_wait_semaphores(queue->device, task);
+
       //execute
       for (unsigned i = 0; i < task->cmd_buffer_count; i++) {
          lvp_execute_cmds(queue->device, queue, task->cmd_buffers[i]);
       }
 
-      if (task->cmd_buffer_count) {
+      if (task->cmd_buffer_count || task->signal_count) {
          struct pipe_fence_handle *handle = NULL;
-         queue->ctx->flush(queue->ctx, task->fence ? &handle : NULL, 0);
+         bool need_fence = task->fence || task->signal_count;
+         queue->ctx->flush(queue->ctx, need_fence ? &handle : NULL, 0);
+         if (task->signal_count) {
+            /* other queues may consume the results as soon as the
+             * semaphores are signalled, so the work has to be done by then
+             */
+            queue->device->pscreen->fence_finish(queue->device->pscreen, NULL,
+                                                 handle, PIPE_TIMEOUT_INFINITE);
+            queue_signal_semaphores(queue->device, task->signal_count,
+                                    task->signals, task->signal_vals);
+         }
          if (task->fence) {
             mtx_lock(&queue->device->fence_lock);
             task->fence->handle = handle;
             mtx_unlock(&queue->device->fence_lock);
+         } else if (handle) {
+            queue->device->pscreen->fence_reference(queue->device->pscreen,
+                                                    &handle, NULL);
          }
       } else if (task->fence)
          task->fence->signaled = true;
@@ -1158,16 +1253,22 @@ static int queue_thread(void *data)
 }
 
 static VkResult
-lvp_queue_init(struct lvp_device *device, struct lvp_queue *queue)
+lvp_queue_init(struct lvp_device *device, struct lvp_queue *queue,
+               uint32_t family, uint32_t index,
+               VkDeviceQueueCreateFlags flags)
 {
    queue->device = device;
 
-   queue->flags = 0;
+   queue->flags = flags;
+   queue->family = family;
+   queue->index = index;
    queue->ctx = device->pscreen->context_create(device->pscreen, NULL, PIPE_CONTEXT_ROBUST_BUFFER_ACCESS);
    queue->cso = cso_create_context(queue->ctx, CSO_NO_VBUF);
    list_inithead(&queue->workqueue);
    p_atomic_set(&queue->count, 0);
+   util_dynarray_init(&queue->dead_csos, NULL);
    mtx_init(&queue->m, mtx_plain);
+   cnd_init(&queue->new_work);
    queue->exec_thread = u_thread_create(queue_thread, queue);
 
    vk_object_base_init(&device->vk, &queue->base, VK_OBJECT_TYPE_QUEUE);
@@ -1183,6 +1284,7 @@ lvp_queue_finish(struct lvp_queue *queue)
    mtx_unlock(&queue->m);
 
    thrd_join(queue->exec_thread, NULL);
+   queue_free_dead_csos(queue, &queue->dead_csos);
 
    cnd_destroy(&queue->new_work);
    mtx_destroy(&queue->m);
@@ -1239,14 +1341,68 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateDevice(
    device->physical_device = physical_device;
 
    mtx_init(&device->fence_lock, mtx_plain);
+   mtx_init(&device->semaphore_lock, mtx_plain);
+   u_cnd_monotonic_init(&device->semaphore_cnd);
    device->pscreen = physical_device->pscreen;
 
-   lvp_queue_init(device, &device->queue);
+   mtx_init(&device->aux_lock, mtx_plain);
+   device->aux_ctx = device->pscreen->context_create(device->pscreen, NULL, 0);
+   if (!device->aux_ctx)
+      goto fail_locks;
+   device->aux_cso = cso_create_context(device->aux_ctx, CSO_NO_VBUF);
+   if (!device->aux_cso)
+      goto fail_aux_ctx;
+   if (!util_queue_init(&device->compile_queue, "lvp_compile", 64,
+                        MAX2(util_get_cpu_caps()->nr_cpus - 1, 1),
+                        UTIL_QUEUE_INIT_RESIZE_IF_FULL, NULL))
+      goto fail_aux_cso;
+
+   /* The primary queue always exists since queries use its context; every
+    * other requested queue gets its own context and thread so submissions to
+    * different queues run concurrently.  Each queue creates its own shader
+    * CSOs, see lvp_pipeline_queue_csos().
+    */
+   lvp_queue_init(device, &device->queue, 0, 0, 0);
+   for (uint32_t i = 0; i < pCreateInfo->queueCreateInfoCount; i++) {
+      const VkDeviceQueueCreateInfo *qinfo = &pCreateInfo->pQueueCreateInfos[i];
+      uint32_t family = qinfo->queueFamilyIndex;
+
+      assert(family < LVP_QUEUE_FAMILY_COUNT);
+      assert(qinfo->queueCount <= LVP_MAX_QUEUES);
+      for (uint32_t j = 0; j < qinfo->queueCount; j++) {
+         struct lvp_queue *queue;
+         if (family == 0 && j == 0) {
+            queue = &device->queue;
+            queue->flags = qinfo->flags;
+         } else {
+            queue = vk_zalloc(&device->vk.alloc, sizeof(*queue), 8,
+                              VK_SYSTEM_ALLOCATION_SCOPE_DEVICE);
+            if (!queue) {
+               lvp_DestroyDevice(lvp_device_to_handle(device), pAllocator);
+               return vk_error(instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+            }
+            lvp_queue_init(device, queue, family, j, qinfo->flags);
+         }
+         device->queues[family][j] = queue;
+      }
+   }
 
    *pDevice = lvp_device_to_handle(device);
 
    return VK_SUCCESS;
 
+fail_aux_cso:
+   cso_destroy_context(device->aux_cso);
+fail_aux_ctx:
+   device->aux_ctx->destroy(device->aux_ctx);
+fail_locks:
+   mtx_destroy(&device->aux_lock);
+   u_cnd_monotonic_destroy(&device->semaphore_cnd);
+   mtx_destroy(&device->semaphore_lock);
+   mtx_destroy(&device->fence_lock);
+   vk_device_finish(&device->vk);
+   vk_free(&device->vk.alloc, device);
+   return vk_error(instance, VK_ERROR_INITIALIZATION_FAILED);
 }
 
 VKAPI_ATTR void VKAPI_CALL lvp_DestroyDevice(
@@ -1255,7 +1411,24 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyDevice(
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
 
+   for (uint32_t i = 0; i < LVP_QUEUE_FAMILY_COUNT; i++) {
+      for (uint32_t j = 0; j < LVP_MAX_QUEUES; j++) {
+         struct lvp_queue *queue = device->queues[i][j];
+         if (!queue || queue == &device->queue)
+            continue;
+         lvp_queue_finish(queue);
+         vk_object_base_finish(&queue->base);
+         vk_free(&device->vk.alloc, queue);
+      }
+   }
    lvp_queue_finish(&device->queue);
+   util_queue_destroy(&device->compile_queue);
+   cso_destroy_context(device->aux_cso);
+   device->aux_ctx->destroy(device->aux_ctx);
+   mtx_destroy(&device->aux_lock);
+   u_cnd_monotonic_destroy(&device->semaphore_cnd);
+   mtx_destroy(&device->semaphore_lock);
+   mtx_destroy(&device->fence_lock);
    vk_device_finish(&device->vk);
    vk_free(&device->vk.alloc, device);
 }
@@ -1305,10 +1478,12 @@ VKAPI_ATTR void VKAPI_CALL lvp_GetDeviceQueue2(
    VkQueue*                                    pQueue)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
-   struct lvp_queue *queue;
+   struct lvp_queue *queue = NULL;
 
-   queue = &device->queue;
-   if (pQueueInfo->flags != queue->flags) {
+   if (pQueueInfo->queueFamilyIndex < LVP_QUEUE_FAMILY_COUNT &&
+       pQueueInfo->queueIndex < LVP_MAX_QUEUES)
+      queue = device->queues[pQueueInfo->queueFamilyIndex][pQueueInfo->queueIndex];
+   if (!queue || pQueueInfo->flags != queue->flags) {
       /* From the Vulkan 1.1.70 spec:
        *
        * "The queue returned by vkGetDeviceQueue2 must have the same
@@ -1349,19 +1524,60 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_QueueSubmit(
 {
    LVP_FROM_HANDLE(lvp_queue, queue, _queue);
    LVP_FROM_HANDLE(lvp_fence, fence, _fence);
+   struct lvp_device *device = queue->device;
 
+   if (fence)
+      fence->queue = queue;
    if (submitCount == 0)
       goto just_signal_fence;
    for (uint32_t i = 0; i < submitCount; i++) {
-      uint32_t task_size = sizeof(struct lvp_queue_work) + pSubmits[i].commandBufferCount * sizeof(struct lvp_cmd_buffer *);
+      const VkSubmitInfo *submit = &pSubmits[i];
+      const VkTimelineSemaphoreSubmitInfo *timeline_info =
+         vk_find_struct_const(submit->pNext, TIMELINE_SEMAPHORE_SUBMIT_INFO);
+      uint32_t sema_count = submit->waitSemaphoreCount + submit->signalSemaphoreCount;
+      uint32_t task_size = sizeof(struct lvp_queue_work) +
+                           submit->commandBufferCount * sizeof(struct lvp_cmd_buffer *) +
+                           sema_count * (sizeof(struct lvp_semaphore *) + sizeof(uint64_t));
       struct lvp_queue_work *task = malloc(task_size);
+      if (!task)
+         return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+
+      task->cmd_buffer_count = submit->commandBufferCount;
+      /* only the last batch signals the fence */
+      task->fence = i == submitCount - 1 ? fence : NULL;
+      task->wait_count = submit->waitSemaphoreCount;
+      task->signal_count = submit->signalSemaphoreCount;
+      task->wait_vals = (uint64_t *)(task + 1);
+      task->signal_vals = task->wait_vals + task->wait_count;
+      task->cmd_buffers = (struct lvp_cmd_buffer **)(task->signal_vals + task->signal_count);
+      task->waits = (struct lvp_semaphore **)(task->cmd_buffers + task->cmd_buffer_count);
+      task->signals = task->waits + task->wait_count;
+      for (uint32_t j = 0; j < submit->commandBufferCount; j++) {
+         task->cmd_buffers[j] = lvp_cmd_buffer_from_handle(submit->pCommandBuffers[j]);
+      }
 
-      task->cmd_buffer_count = pSubmits[i].commandBufferCount;
-      task->fence = fence;
-      task->cmd_buffers = (struct lvp_cmd_buffer **)(task + 1);
-      for (uint32_t j = 0; j < pSubmits[i].commandBufferCount; j++) {
-         task->cmd_buffers[j] = lvp_cmd_buffer_from_handle(pSubmits[i].pCommandBuffers[j]);
+      /* Binary semaphores are tracked as timelines whose pending value is
+       * bumped for every signal operation; a wait takes whatever was last
+       * queued for signalling, which is valid per the submission order rules.
+       */
+      mtx_lock(&device->semaphore_lock);
+      for (uint32_t j = 0; j < task->wait_count; j++) {
+         struct lvp_semaphore *sema = lvp_semaphore_from_handle(submit->pWaitSemaphores[j]);
+         task->waits[j] = sema;
+         if (sema->timeline && timeline_info && j < timeline_info->waitSemaphoreValueCount)
+            task->wait_vals[j] = timeline_info->pWaitSemaphoreValues[j];
+         else
+            task->wait_vals[j] = sema->pending;
+      }
+      for (uint32_t j = 0; j < task->signal_count; j++) {
+         struct lvp_semaphore *sema = lvp_semaphore_from_handle(submit->pSignalSemaphores[j]);
+         task->signals[j] = sema;
+         if (sema->timeline && timeline_info && j < timeline_info->signalSemaphoreValueCount)
+            task->signal_vals[j] = timeline_info->pSignalSemaphoreValues[j];
+         else
+            task->signal_vals[j] = ++sema->pending;
       }
+      mtx_unlock(&device->semaphore_lock);
 
       mtx_lock(&queue->m);
       p_atomic_inc(&queue->count);
@@ -1403,7 +1619,14 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_DeviceWaitIdle(
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
 
-   return queue_wait_idle(&device->queue, UINT64_MAX);
+   /* the primary queue is in the table whenever it can have work */
+   for (uint32_t i = 0; i < LVP_QUEUE_FAMILY_COUNT; i++) {
+      for (uint32_t j = 0; j < LVP_MAX_QUEUES; j++) {
+         if (device->queues[i][j])
+            queue_wait_idle(device->queues[i][j], UINT64_MAX);
+      }
+   }
+   return VK_SUCCESS;
 }
 
 VKAPI_ATTR VkResult VKAPI_CALL lvp_AllocateMemory(
@@ -1712,6 +1935,7 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateFence(
    fence->signaled = pCreateInfo->flags & VK_FENCE_CREATE_SIGNALED_BIT;
 
    fence->handle = NULL;
+   fence->queue = NULL;
    *pFence = lvp_fence_to_handle(fence);
 
    return VK_SUCCESS;
@@ -1847,11 +2071,24 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_WaitForFences(
    uint64_t                                    timeout)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
-
-   VkResult qret = queue_wait_idle(&device->queue, timeout);
+   int64_t atime = timeout == UINT64_MAX || timeout == 0 ? 0 :
+                   os_time_get_absolute_timeout(timeout);
    bool timeout_status = false;
-   if (qret == VK_TIMEOUT)
-      return VK_TIMEOUT;
+
+   /* only the queues the fences were submitted to need to drain */
+   for (unsigned i = 0; i < fenceCount; i++) {
+      struct lvp_fence *fence = lvp_fence_from_handle(pFences[i]);
+      uint64_t remaining = timeout;
+
+      if (fence->signaled || !fence->queue)
+         continue;
+      if (atime) {
+         int64_t now = os_time_get_nano();
+         remaining = atime > now ? atime - now : 0;
+      }
+      if (queue_wait_idle(fence->queue, remaining) == VK_TIMEOUT)
+         return VK_TIMEOUT;
+   }
 
    mtx_lock(&device->fence_lock);
    for (unsigned i = 0; i < fenceCount; i++) {
@@ -1895,6 +2132,12 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateSemaphore(
       return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
    vk_object_base_init(&device->vk, &sema->base,
                        VK_OBJECT_TYPE_SEMAPHORE);
+
+   const VkSemaphoreTypeCreateInfo *type_info =
+      vk_find_struct_const(pCreateInfo->pNext, SEMAPHORE_TYPE_CREATE_INFO);
+   sema->timeline = type_info && type_info->semaphoreType == VK_SEMAPHORE_TYPE_TIMELINE;
+   sema->value = sema->timeline ? type_info->initialValue : 0;
+   sema->pending = sema->value;
    *pSemaphore = lvp_semaphore_to_handle(sema);
 
    return VK_SUCCESS;
@@ -1914,6 +2157,74 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroySemaphore(
    vk_free2(&device->vk.alloc, pAllocator, semaphore);
 }
 
+VKAPI_ATTR VkResult VKAPI_CALL lvp_GetSemaphoreCounterValue(
+   VkDevice                                    _device,
+   VkSemaphore                                 _semaphore,
+   uint64_t*                                   pValue)
+{
+   LVP_FROM_HANDLE(lvp_device, device, _device);
+   LVP_FROM_HANDLE(lvp_semaphore, semaphore, _semaphore);
+
+   mtx_lock(&device->semaphore_lock);
+   *pValue = semaphore->value;
+   mtx_unlock(&device->semaphore_lock);
+   return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL lvp_WaitSemaphores(
+   VkDevice                                    _device,
+   const VkSemaphoreWaitInfo*                  pWaitInfo,
+   uint64_t                                    timeout)
+{
+   LVP_FROM_HANDLE(lvp_device, device, _device);
+   bool wait_any = pWaitInfo->flags & VK_SEMAPHORE_WAIT_ANY_BIT;
+   int64_t atime = timeout == UINT64_MAX ? 0 : os_time_get_absolute_timeout(timeout);
+   struct timespec abs_timeout = {
+      .tv_sec = atime / 1000000000,
+      .tv_nsec = atime % 1000000000,
+   };
+   VkResult result = VK_SUCCESS;
+
+   mtx_lock(&device->semaphore_lock);
+   while (true) {
+      uint32_t done = 0;
+      for (uint32_t i = 0; i < pWaitInfo->semaphoreCount; i++) {
+         struct lvp_semaphore *sema = lvp_semaphore_from_handle(pWaitInfo->pSemaphores[i]);
+         if (sema->value >= pWaitInfo->pValues[i])
+            done++;
+      }
+      if (done == pWaitInfo->semaphoreCount || (wait_any && done))
+         break;
+      if (timeout == 0) {
+         result = VK_TIMEOUT;
+         break;
+      }
+      if (timeout == UINT64_MAX) {
+         u_cnd_monotonic_wait(&device->semaphore_cnd, &device->semaphore_lock);
+      } else if (u_cnd_monotonic_timedwait(&device->semaphore_cnd, &device->semaphore_lock,
+                                           &abs_timeout) == thrd_busy) {
+         result = VK_TIMEOUT;
+         break;
+      }
+   }
+   mtx_unlock(&device->semaphore_lock);
+   return result;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL lvp_SignalSemaphore(
+   VkDevice                                    _device,
+   const VkSemaphoreSignalInfo*                pSignalInfo)
+{
+   LVP_FROM_HANDLE(lvp_device, device, _device);
+   LVP_FROM_HANDLE(lvp_semaphore, semaphore, pSignalInfo->semaphore);
+
+   mtx_lock(&device->semaphore_lock);
+   semaphore->pending = MAX2(semaphore->pending, pSignalInfo->value);
+   mtx_unlock(&device->semaphore_lock);
+   queue_signal_semaphores(device, 1, &semaphore, &pSignalInfo->value);
+   return VK_SUCCESS;
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateEvent(
    VkDevice                                    _device,
    const VkEventCreateInfo*                    pCreateInfo,
@@ -2045,6 +2356,26 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateSampler(
    if (reduction_mode_create_info)
       sampler->reduction_mode = reduction_mode_create_info->reductionMode;
 
+   struct pipe_sampler_state *ss = &sampler->state;
+   memset(ss, 0, sizeof(*ss));
+   ss->wrap_s = vk_conv_wrap_mode(pCreateInfo->addressModeU);
+   ss->wrap_t = vk_conv_wrap_mode(pCreateInfo->addressModeV);
+   ss->wrap_r = vk_conv_wrap_mode(pCreateInfo->addressModeW);
+   ss->min_img_filter = pCreateInfo->minFilter == VK_FILTER_LINEAR ? PIPE_TEX_FILTER_LINEAR : PIPE_TEX_FILTER_NEAREST;
+   ss->min_mip_filter = pCreateInfo->mipmapMode == VK_SAMPLER_MIPMAP_MODE_LINEAR ? PIPE_TEX_MIPFILTER_LINEAR : PIPE_TEX_MIPFILTER_NEAREST;
+   ss->mag_img_filter = pCreateInfo->magFilter == VK_FILTER_LINEAR ? PIPE_TEX_FILTER_LINEAR : PIPE_TEX_FILTER_NEAREST;
+   ss->min_lod = pCreateInfo->minLod;
+   ss->max_lod = pCreateInfo->maxLod;
+   ss->lod_bias = pCreateInfo->mipLodBias;
+   ss->max_anisotropy = pCreateInfo->maxAnisotropy;
+   ss->normalized_coords = !pCreateInfo->unnormalizedCoordinates;
+   ss->compare_mode = pCreateInfo->compareEnable ? PIPE_TEX_COMPARE_R_TO_TEXTURE : PIPE_TEX_COMPARE_NONE;
+   ss->compare_func = pCreateInfo->compareOp;
+   ss->seamless_cube_map = true;
+   ss->reduction_mode = sampler->reduction_mode;
+   memcpy(&ss->border_color, &sampler->border_color,
+          sizeof(union pipe_color_union));
+
    *pSampler = lvp_sampler_to_handle(sampler);
 
    return VK_SUCCESS;
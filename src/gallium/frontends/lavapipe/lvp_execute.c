@@ -35,7 +35,6 @@
 
 #include "util/format/u_format.h"
 #include "util/u_surface.h"
-#include "util/u_sampler.h"
 #include "util/u_box.h"
 #include "util/u_inlines.h"
 #include "util/u_prim.h"
@@ -52,9 +51,31 @@ enum gs_output {
   GS_OUTPUT_LINES,
 };
 
+/* Slots [start, end) written since the last emit; empty when end is 0. */
+struct dirty_range {
+   uint16_t start;
+   uint16_t end;
+};
+
+static inline void
+dirty_range_add(struct dirty_range *range, unsigned idx)
+{
+   if (!range->end) {
+      range->start = idx;
+      range->end = idx + 1;
+   } else {
+      range->start = MIN2(range->start, idx);
+      range->end = MAX2(range->end, idx + 1);
+   }
+}
+
 struct rendering_state {
    struct pipe_context *pctx;
    struct cso_context *cso;
+   /* NULL while precompiling */
+   struct lvp_queue *queue;
+   /* the set being precompiled, while there's no queue */
+   void **precompile_csos;
 
    bool blend_dirty;
    bool rs_dirty;
@@ -64,7 +85,7 @@ struct rendering_state {
    bool blend_color_dirty;
    bool ve_dirty;
    bool vb_dirty;
-   bool constbuf_dirty[PIPE_SHADER_TYPES];
+   struct dirty_range constbuf_dirty[PIPE_SHADER_TYPES];
    bool pcbuf_dirty[PIPE_SHADER_TYPES];
    bool vp_dirty;
    bool scissor_dirty;
@@ -108,21 +129,21 @@ struct rendering_state {
    struct pipe_vertex_buffer vb[PIPE_MAX_ATTRIBS];
    struct cso_velems_state velem;
 
-   struct pipe_sampler_view *sv[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
+   struct pipe_sampler_view *sv[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_SAMPLER_VIEWS];
    int num_sampler_views[PIPE_SHADER_TYPES];
    struct pipe_sampler_state ss[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
    /* cso_context api is stupid */
    const struct pipe_sampler_state *cso_ss_ptr[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
    int num_sampler_states[PIPE_SHADER_TYPES];
-   bool sv_dirty[PIPE_SHADER_TYPES];
-   bool ss_dirty[PIPE_SHADER_TYPES];
+   struct dirty_range sv_dirty[PIPE_SHADER_TYPES];
+   struct dirty_range ss_dirty[PIPE_SHADER_TYPES];
 
    struct pipe_image_view iv[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_IMAGES];
    int num_shader_images[PIPE_SHADER_TYPES];
    struct pipe_shader_buffer sb[PIPE_SHADER_TYPES][PIPE_MAX_SHADER_BUFFERS];
    int num_shader_buffers[PIPE_SHADER_TYPES];
-   bool iv_dirty[PIPE_SHADER_TYPES];
-   bool sb_dirty[PIPE_SHADER_TYPES];
+   struct dirty_range iv_dirty[PIPE_SHADER_TYPES];
+   struct dirty_range sb_dirty[PIPE_SHADER_TYPES];
    bool disable_multisample;
    enum gs_output gs_output_lines : 2;
    void *ss_cso[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
@@ -167,49 +188,61 @@ assert_subresource_layers(const struct pipe_resource *pres, const VkImageSubreso
 #endif
 }
 
+/* Only the slots touched since the last emit are rebound, so binding a
+ * few descriptors doesn't cost a rebind of every slot in use.
+ */
 static void emit_compute_state(struct rendering_state *state)
 {
-   if (state->iv_dirty[PIPE_SHADER_COMPUTE]) {
-      state->pctx->set_shader_images(state->pctx, PIPE_SHADER_COMPUTE,
-                                     0, state->num_shader_images[PIPE_SHADER_COMPUTE],
-                                     0, state->iv[PIPE_SHADER_COMPUTE]);
-      state->iv_dirty[PIPE_SHADER_COMPUTE] = false;
+   const enum pipe_shader_type sh = PIPE_SHADER_COMPUTE;
+   struct dirty_range *r;
+
+   r = &state->iv_dirty[sh];
+   if (r->end) {
+      state->pctx->set_shader_images(state->pctx, sh,
+                                     r->start, r->end - r->start,
+                                     0, &state->iv[sh][r->start]);
+      r->end = 0;
    }
 
-   if (state->pcbuf_dirty[PIPE_SHADER_COMPUTE]) {
-      state->pctx->set_constant_buffer(state->pctx, PIPE_SHADER_COMPUTE,
-                                       0, false, &state->pc_buffer[PIPE_SHADER_COMPUTE]);
-      state->pcbuf_dirty[PIPE_SHADER_COMPUTE] = false;
+   if (state->pcbuf_dirty[sh]) {
+      state->pctx->set_constant_buffer(state->pctx, sh,
+                                       0, false, &state->pc_buffer[sh]);
+      state->pcbuf_dirty[sh] = false;
    }
 
-   if (state->constbuf_dirty[PIPE_SHADER_COMPUTE]) {
-      for (unsigned i = 0; i < state->num_const_bufs[PIPE_SHADER_COMPUTE]; i++)
-         state->pctx->set_constant_buffer(state->pctx, PIPE_SHADER_COMPUTE,
-                                          i + 1, false, &state->const_buffer[PIPE_SHADER_COMPUTE][i]);
-      state->constbuf_dirty[PIPE_SHADER_COMPUTE] = false;
+   r = &state->constbuf_dirty[sh];
+   if (r->end) {
+      for (unsigned i = r->start; i < r->end; i++)
+         state->pctx->set_constant_buffer(state->pctx, sh,
+                                          i + 1, false, &state->const_buffer[sh][i]);
+      r->end = 0;
    }
 
-   if (state->sb_dirty[PIPE_SHADER_COMPUTE]) {
-      state->pctx->set_shader_buffers(state->pctx, PIPE_SHADER_COMPUTE,
-                                      0, state->num_shader_buffers[PIPE_SHADER_COMPUTE],
-                                      state->sb[PIPE_SHADER_COMPUTE], 0);
-      state->sb_dirty[PIPE_SHADER_COMPUTE] = false;
+   r = &state->sb_dirty[sh];
+   if (r->end) {
+      state->pctx->set_shader_buffers(state->pctx, sh,
+                                      r->start, r->end - r->start,
+                                      &state->sb[sh][r->start], 0);
+      r->end = 0;
    }
 
-   if (state->sv_dirty[PIPE_SHADER_COMPUTE]) {
-      state->pctx->set_sampler_views(state->pctx, PIPE_SHADER_COMPUTE, 0, state->num_sampler_views[PIPE_SHADER_COMPUTE],
-                                     0, state->sv[PIPE_SHADER_COMPUTE]);
-      state->sv_dirty[PIPE_SHADER_COMPUTE] = false;
+   r = &state->sv_dirty[sh];
+   if (r->end) {
+      state->pctx->set_sampler_views(state->pctx, sh, r->start, r->end - r->start,
+                                     0, &state->sv[sh][r->start]);
+      r->end = 0;
    }
 
-   if (state->ss_dirty[PIPE_SHADER_COMPUTE]) {
-      for (unsigned i = 0; i < state->num_sampler_states[PIPE_SHADER_COMPUTE]; i++) {
-         if (state->ss_cso[PIPE_SHADER_COMPUTE][i])
-            state->pctx->delete_sampler_state(state->pctx, state->ss_cso[PIPE_SHADER_COMPUTE][i]);
-         state->ss_cso[PIPE_SHADER_COMPUTE][i] = state->pctx->create_sampler_state(state->pctx, &state->ss[PIPE_SHADER_COMPUTE][i]);
+   r = &state->ss_dirty[sh];
+   if (r->end) {
+      for (unsigned i = r->start; i < r->end; i++) {
+         if (state->ss_cso[sh][i])
+            state->pctx->delete_sampler_state(state->pctx, state->ss_cso[sh][i]);
+         state->ss_cso[sh][i] = state->pctx->create_sampler_state(state->pctx, &state->ss[sh][i]);
       }
-      state->pctx->bind_sampler_states(state->pctx, PIPE_SHADER_COMPUTE, 0, state->num_sampler_states[PIPE_SHADER_COMPUTE], state->ss_cso[PIPE_SHADER_COMPUTE]);
-      state->ss_dirty[PIPE_SHADER_COMPUTE] = false;
+      state->pctx->bind_sampler_states(state->pctx, sh, r->start, r->end - r->start,
+                                       &state->ss_cso[sh][r->start]);
+      r->end = 0;
    }
 }
 
@@ -275,52 +308,59 @@ static void emit_state(struct rendering_state *state)
    
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
-      if (state->constbuf_dirty[sh]) {
-         for (unsigned idx = 0; idx < state->num_const_bufs[sh]; idx++)
-            state->pctx->set_constant_buffer(state->pctx, sh,
-                                             idx + 1, false, &state->const_buffer[sh][idx]);
-      }
-      state->constbuf_dirty[sh] = false;
+      struct dirty_range *r = &state->constbuf_dirty[sh];
+      for (unsigned idx = r->start; idx < r->end; idx++)
+         state->pctx->set_constant_buffer(state->pctx, sh,
+                                          idx + 1, false, &state->const_buffer[sh][idx]);
+      r->end = 0;
    }
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
       if (state->pcbuf_dirty[sh]) {
          state->pctx->set_constant_buffer(state->pctx, sh,
                                           0, false, &state->pc_buffer[sh]);
+         state->pcbuf_dirty[sh] = false;
       }
    }
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
-      if (state->sb_dirty[sh]) {
+      struct dirty_range *r = &state->sb_dirty[sh];
+      if (r->end) {
          state->pctx->set_shader_buffers(state->pctx, sh,
-                                         0, state->num_shader_buffers[sh],
-                                         state->sb[sh], 0);
+                                         r->start, r->end - r->start,
+                                         &state->sb[sh][r->start], 0);
+         r->end = 0;
       }
    }
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
-      if (state->iv_dirty[sh]) {
+      struct dirty_range *r = &state->iv_dirty[sh];
+      if (r->end) {
          state->pctx->set_shader_images(state->pctx, sh,
-                                        0, state->num_shader_images[sh], 0,
-                                        state->iv[sh]);
+                                        r->start, r->end - r->start, 0,
+                                        &state->iv[sh][r->start]);
+         r->end = 0;
       }
    }
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
+      struct dirty_range *r = &state->sv_dirty[sh];
 
-      if (!state->sv_dirty[sh])
+      if (!r->end)
          continue;
 
-      state->pctx->set_sampler_views(state->pctx, sh, 0, state->num_sampler_views[sh],
-                                     0, state->sv[sh]);
-      state->sv_dirty[sh] = false;
+      state->pctx->set_sampler_views(state->pctx, sh, r->start, r->end - r->start,
+                                     0, &state->sv[sh][r->start]);
+      r->end = 0;
    }
 
    for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
-      if (!state->ss_dirty[sh])
+      if (!state->ss_dirty[sh].end)
          continue;
 
+      /* the cso cache makes rebinding unchanged samplers cheap */
       cso_set_samplers(state->cso, sh, state->num_sampler_states[sh], state->cso_ss_ptr[sh]);
+      state->ss_dirty[sh].end = 0;
    }
 
    if (state->vp_dirty) {
@@ -334,15 +374,25 @@ static void emit_state(struct rendering_state *state)
    }
 }
 
+static void **
+pipeline_csos(struct rendering_state *state, struct lvp_pipeline *pipeline)
+{
+   /* the precompile binds the sets it builds on the auxiliary context */
+   if (!state->queue)
+      return state->precompile_csos;
+   return lvp_pipeline_queue_csos(pipeline, state->queue);
+}
+
 static void handle_compute_pipeline(struct lvp_cmd_buffer_entry *cmd,
                                     struct rendering_state *state)
 {
    struct lvp_pipeline *pipeline = cmd->u.pipeline.pipeline;
+   void **csos = pipeline_csos(state, pipeline);
 
    state->dispatch_info.block[0] = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.workgroup_size[0];
    state->dispatch_info.block[1] = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.workgroup_size[1];
    state->dispatch_info.block[2] = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.workgroup_size[2];
-   state->pctx->bind_compute_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_COMPUTE]);
+   state->pctx->bind_compute_state(state->pctx, csos[PIPE_SHADER_COMPUTE]);
 }
 
 static void
@@ -421,14 +471,13 @@ static int conv_dynamic_state_idx(VkDynamicState dyn_state)
    return -1;
 }
 
-static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
-                                     struct rendering_state *state)
+void
+lvp_bake_graphics_pipeline(const struct lvp_pipeline *pipeline,
+                           struct lvp_baked_pipeline *baked)
 {
-   struct lvp_pipeline *pipeline = cmd->u.pipeline.pipeline;
-   bool dynamic_states[VK_DYNAMIC_STATE_STENCIL_REFERENCE+32];
-   unsigned fb_samples = 0;
+   bool *dynamic_states = baked->dynamic_states;
 
-   memset(dynamic_states, 0, sizeof(dynamic_states));
+   memset(baked, 0, sizeof(*baked));
    if (pipeline->graphics_create_info.pDynamicState)
    {
       const VkPipelineDynamicStateCreateInfo *dyn = pipeline->graphics_create_info.pDynamicState;
@@ -441,6 +490,121 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
       }
    }
 
+   if (pipeline->graphics_create_info.pColorBlendState) {
+      const VkPipelineColorBlendStateCreateInfo *cb = pipeline->graphics_create_info.pColorBlendState;
+      int i;
+
+      for (i = 0; i < cb->attachmentCount; i++) {
+         struct pipe_rt_blend_state *rt = &baked->blend_rt[i];
+
+         rt->colormask = cb->pAttachments[i].colorWriteMask;
+         rt->blend_enable = cb->pAttachments[i].blendEnable;
+         rt->rgb_func = vk_conv_blend_func(cb->pAttachments[i].colorBlendOp);
+         rt->rgb_src_factor = vk_conv_blend_factor(cb->pAttachments[i].srcColorBlendFactor);
+         rt->rgb_dst_factor = vk_conv_blend_factor(cb->pAttachments[i].dstColorBlendFactor);
+         rt->alpha_func = vk_conv_blend_func(cb->pAttachments[i].alphaBlendOp);
+         rt->alpha_src_factor = vk_conv_blend_factor(cb->pAttachments[i].srcAlphaBlendFactor);
+         rt->alpha_dst_factor = vk_conv_blend_factor(cb->pAttachments[i].dstAlphaBlendFactor);
+
+         /* At least llvmpipe applies the blend factor prior to the blend function,
+          * regardless of what function is used. (like i965 hardware).
+          * It means for MIN/MAX the blend factor has to be stomped to ONE.
+          */
+         if (cb->pAttachments[i].colorBlendOp == VK_BLEND_OP_MIN ||
+             cb->pAttachments[i].colorBlendOp == VK_BLEND_OP_MAX) {
+            rt->rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+            rt->rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
+         }
+
+         if (cb->pAttachments[i].alphaBlendOp == VK_BLEND_OP_MIN ||
+             cb->pAttachments[i].alphaBlendOp == VK_BLEND_OP_MAX) {
+            rt->alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+            rt->alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
+         }
+      }
+   }
+
+   if (!dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VERTEX_INPUT_EXT)]) {
+      const VkPipelineVertexInputStateCreateInfo *vi = pipeline->graphics_create_info.pVertexInputState;
+      int i;
+      const VkPipelineVertexInputDivisorStateCreateInfoEXT *div_state =
+         vk_find_struct_const(vi->pNext,
+                              PIPELINE_VERTEX_INPUT_DIVISOR_STATE_CREATE_INFO_EXT);
+
+      int max_location = -1;
+      for (i = 0; i < vi->vertexAttributeDescriptionCount; i++) {
+         unsigned location = vi->pVertexAttributeDescriptions[i].location;
+         struct pipe_vertex_element *velem = &baked->velems[location];
+
+         velem->src_offset = vi->pVertexAttributeDescriptions[i].offset;
+         velem->vertex_buffer_index = vi->pVertexAttributeDescriptions[i].binding;
+         velem->src_format = lvp_vk_format_to_pipe_format(vi->pVertexAttributeDescriptions[i].format);
+
+         switch (vi->pVertexBindingDescriptions[vi->pVertexAttributeDescriptions[i].binding].inputRate) {
+         case VK_VERTEX_INPUT_RATE_VERTEX:
+            velem->instance_divisor = 0;
+            break;
+         case VK_VERTEX_INPUT_RATE_INSTANCE:
+            if (div_state) {
+               for (unsigned j = 0; j < div_state->vertexBindingDivisorCount; j++) {
+                  const VkVertexInputBindingDivisorDescriptionEXT *desc =
+                     &div_state->pVertexBindingDivisors[j];
+                  if (desc->binding == velem->vertex_buffer_index) {
+                     velem->instance_divisor = desc->divisor;
+                     break;
+                  }
+               }
+            } else
+               velem->instance_divisor = 1;
+            break;
+         default:
+            assert(0);
+            break;
+         }
+
+         if ((int)location > max_location)
+            max_location = location;
+      }
+      baked->velem_count = max_location + 1;
+   }
+
+   if (pipeline->graphics_create_info.pViewportState) {
+      const VkPipelineViewportStateCreateInfo *vpi= pipeline->graphics_create_info.pViewportState;
+      int i;
+
+      if (!dynamic_states[VK_DYNAMIC_STATE_VIEWPORT] &&
+          !dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT)]) {
+         for (i = 0; i < vpi->viewportCount; i++)
+            get_viewport_xform(&vpi->pViewports[i], baked->viewports[i].scale, baked->viewports[i].translate);
+      }
+      if (!dynamic_states[VK_DYNAMIC_STATE_SCISSOR] &&
+          !dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT)]) {
+         for (i = 0; i < vpi->scissorCount; i++) {
+            const VkRect2D *ss = &vpi->pScissors[i];
+            baked->scissors[i].minx = ss->offset.x;
+            baked->scissors[i].miny = ss->offset.y;
+            baked->scissors[i].maxx = ss->offset.x + ss->extent.width;
+            baked->scissors[i].maxy = ss->offset.y + ss->extent.height;
+         }
+      }
+   }
+}
+
+static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
+                                     struct rendering_state *state)
+{
+   struct lvp_pipeline *pipeline = cmd->u.pipeline.pipeline;
+   void **csos = pipeline_csos(state, pipeline);
+   const struct lvp_baked_pipeline *baked = cmd->u.pipeline.baked;
+   struct lvp_baked_pipeline translated;
+   unsigned fb_samples = 0;
+
+   if (!baked) {
+      lvp_bake_graphics_pipeline(pipeline, &translated);
+      baked = &translated;
+   }
+   const bool *dynamic_states = baked->dynamic_states;
+
    bool has_stage[PIPE_SHADER_TYPES] = { false };
 
    state->pctx->bind_gs_state(state->pctx, NULL);
@@ -455,24 +619,24 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
          const VkPipelineShaderStageCreateInfo *sh = &pipeline->graphics_create_info.pStages[i];
          switch (sh->stage) {
          case VK_SHADER_STAGE_FRAGMENT_BIT:
-            state->pctx->bind_fs_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_FRAGMENT]);
+            state->pctx->bind_fs_state(state->pctx, csos[PIPE_SHADER_FRAGMENT]);
             has_stage[PIPE_SHADER_FRAGMENT] = true;
             break;
          case VK_SHADER_STAGE_VERTEX_BIT:
-            state->pctx->bind_vs_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_VERTEX]);
+            state->pctx->bind_vs_state(state->pctx, csos[PIPE_SHADER_VERTEX]);
             has_stage[PIPE_SHADER_VERTEX] = true;
             break;
          case VK_SHADER_STAGE_GEOMETRY_BIT:
-            state->pctx->bind_gs_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_GEOMETRY]);
+            state->pctx->bind_gs_state(state->pctx, csos[PIPE_SHADER_GEOMETRY]);
             state->gs_output_lines = pipeline->gs_output_lines ? GS_OUTPUT_LINES : GS_OUTPUT_NOT_LINES;
             has_stage[PIPE_SHADER_GEOMETRY] = true;
             break;
          case VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT:
-            state->pctx->bind_tcs_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_TESS_CTRL]);
+            state->pctx->bind_tcs_state(state->pctx, csos[PIPE_SHADER_TESS_CTRL]);
             has_stage[PIPE_SHADER_TESS_CTRL] = true;
             break;
          case VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT:
-            state->pctx->bind_tes_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_TESS_EVAL]);
+            state->pctx->bind_tes_state(state->pctx, csos[PIPE_SHADER_TESS_EVAL]);
             has_stage[PIPE_SHADER_TESS_EVAL] = true;
             break;
          default:
@@ -484,7 +648,7 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
 
    /* there should always be a dummy fs. */
    if (!has_stage[PIPE_SHADER_FRAGMENT])
-      state->pctx->bind_fs_state(state->pctx, pipeline->shader_cso[PIPE_SHADER_FRAGMENT]);
+      state->pctx->bind_fs_state(state->pctx, csos[PIPE_SHADER_FRAGMENT]);
    if (state->pctx->bind_gs_state && !has_stage[PIPE_SHADER_GEOMETRY])
       state->pctx->bind_gs_state(state->pctx, NULL);
    if (state->pctx->bind_tcs_state && !has_stage[PIPE_SHADER_TESS_CTRL])
@@ -626,8 +790,6 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
 
    if (pipeline->graphics_create_info.pColorBlendState) {
       const VkPipelineColorBlendStateCreateInfo *cb = pipeline->graphics_create_info.pColorBlendState;
-      int i;
-
       if (cb->logicOpEnable) {
          state->blend_state.logicop_enable = VK_TRUE;
          if (!dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_LOGIC_OP_EXT)])
@@ -636,32 +798,8 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
 
       if (cb->attachmentCount > 1)
          state->blend_state.independent_blend_enable = true;
-      for (i = 0; i < cb->attachmentCount; i++) {
-         state->blend_state.rt[i].colormask = cb->pAttachments[i].colorWriteMask;
-         state->blend_state.rt[i].blend_enable = cb->pAttachments[i].blendEnable;
-         state->blend_state.rt[i].rgb_func = vk_conv_blend_func(cb->pAttachments[i].colorBlendOp);
-         state->blend_state.rt[i].rgb_src_factor = vk_conv_blend_factor(cb->pAttachments[i].srcColorBlendFactor);
-         state->blend_state.rt[i].rgb_dst_factor = vk_conv_blend_factor(cb->pAttachments[i].dstColorBlendFactor);
-         state->blend_state.rt[i].alpha_func = vk_conv_blend_func(cb->pAttachments[i].alphaBlendOp);
-         state->blend_state.rt[i].alpha_src_factor = vk_conv_blend_factor(cb->pAttachments[i].srcAlphaBlendFactor);
-         state->blend_state.rt[i].alpha_dst_factor = vk_conv_blend_factor(cb->pAttachments[i].dstAlphaBlendFactor);
-
-         /* At least llvmpipe applies the blend factor prior to the blend function,
-          * regardless of what function is used. (like i965 hardware).
-          * It means for MIN/MAX the blend factor has to be stomped to ONE.
-          */
-         if (cb->pAttachments[i].colorBlendOp == VK_BLEND_OP_MIN ||
-             cb->pAttachments[i].colorBlendOp == VK_BLEND_OP_MAX) {
-            state->blend_state.rt[i].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
-            state->blend_state.rt[i].rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
-         }
-
-         if (cb->pAttachments[i].alphaBlendOp == VK_BLEND_OP_MIN ||
-             cb->pAttachments[i].alphaBlendOp == VK_BLEND_OP_MAX) {
-            state->blend_state.rt[i].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
-            state->blend_state.rt[i].alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
-         }
-      }
+      memcpy(state->blend_state.rt, baked->blend_rt,
+             cb->attachmentCount * sizeof(baked->blend_rt[0]));
       state->blend_dirty = true;
       if (!dynamic_states[VK_DYNAMIC_STATE_BLEND_CONSTANTS]) {
          memcpy(state->blend_color.color, cb->blendConstants, 4 * sizeof(float));
@@ -675,9 +813,6 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
    if (!dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VERTEX_INPUT_EXT)]) {
       const VkPipelineVertexInputStateCreateInfo *vi = pipeline->graphics_create_info.pVertexInputState;
       int i;
-      const VkPipelineVertexInputDivisorStateCreateInfoEXT *div_state =
-         vk_find_struct_const(vi->pNext,
-                              PIPELINE_VERTEX_INPUT_DIVISOR_STATE_CREATE_INFO_EXT);
 
       if (!dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VERTEX_INPUT_BINDING_STRIDE_EXT)]) {
          for (i = 0; i < vi->vertexBindingDescriptionCount; i++) {
@@ -685,39 +820,11 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
          }
       }
 
-      int max_location = -1;
-      for (i = 0; i < vi->vertexAttributeDescriptionCount; i++) {
-         unsigned location = vi->pVertexAttributeDescriptions[i].location;
-         state->velem.velems[location].src_offset = vi->pVertexAttributeDescriptions[i].offset;
-         state->velem.velems[location].vertex_buffer_index = vi->pVertexAttributeDescriptions[i].binding;
-         state->velem.velems[location].src_format = lvp_vk_format_to_pipe_format(vi->pVertexAttributeDescriptions[i].format);
-
-         switch (vi->pVertexBindingDescriptions[vi->pVertexAttributeDescriptions[i].binding].inputRate) {
-         case VK_VERTEX_INPUT_RATE_VERTEX:
-            state->velem.velems[location].instance_divisor = 0;
-            break;
-         case VK_VERTEX_INPUT_RATE_INSTANCE:
-            if (div_state) {
-               for (unsigned j = 0; j < div_state->vertexBindingDivisorCount; j++) {
-                  const VkVertexInputBindingDivisorDescriptionEXT *desc =
-                     &div_state->pVertexBindingDivisors[j];
-                  if (desc->binding == state->velem.velems[location].vertex_buffer_index) {
-                     state->velem.velems[location].instance_divisor = desc->divisor;
-                     break;
-                  }
-               }
-            } else
-               state->velem.velems[location].instance_divisor = 1;
-            break;
-         default:
-            assert(0);
-            break;
-         }
-
-         if ((int)location > max_location)
-            max_location = location;
+      for (i = 0; i < baked->velem_count; i++) {
+         if (baked->velems[i].src_format != PIPE_FORMAT_NONE)
+            state->velem.velems[i] = baked->velems[i];
       }
-      state->velem.count = max_location + 1;
+      state->velem.count = baked->velem_count;
       state->vb_dirty = true;
       state->ve_dirty = true;
    }
@@ -743,8 +850,6 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
 
    if (pipeline->graphics_create_info.pViewportState) {
       const VkPipelineViewportStateCreateInfo *vpi= pipeline->graphics_create_info.pViewportState;
-      int i;
-
       if (!dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT)]) {
          state->num_viewports = vpi->viewportCount;
          state->vp_dirty = true;
@@ -756,21 +861,15 @@ static void handle_graphics_pipeline(struct lvp_cmd_buffer_entry *cmd,
 
       if (!dynamic_states[VK_DYNAMIC_STATE_VIEWPORT] &&
           !dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_VIEWPORT_WITH_COUNT_EXT)]) {
-         for (i = 0; i < vpi->viewportCount; i++)
-            get_viewport_xform(&vpi->pViewports[i], state->viewports[i].scale, state->viewports[i].translate);
+         memcpy(state->viewports, baked->viewports,
+                vpi->viewportCount * sizeof(baked->viewports[0]));
          state->vp_dirty = true;
       }
       if (!dynamic_states[VK_DYNAMIC_STATE_SCISSOR] &&
           !dynamic_states[conv_dynamic_state_idx(VK_DYNAMIC_STATE_SCISSOR_WITH_COUNT_EXT)]) {
-         for (i = 0; i < vpi->scissorCount; i++) {
-            const VkRect2D *ss = &vpi->pScissors[i];
-            state->scissors[i].minx = ss->offset.x;
-            state->scissors[i].miny = ss->offset.y;
-            state->scissors[i].maxx = ss->offset.x + ss->extent.width;
-            state->scissors[i].maxy = ss->offset.y + ss->extent.height;
-            state->scissor_dirty = true;
-         }
-
+         memcpy(state->scissors, baked->scissors,
+                vpi->scissorCount * sizeof(baked->scissors[0]));
+         state->scissor_dirty |= vpi->scissorCount > 0;
       }
    }
 
@@ -824,28 +923,66 @@ struct dyn_info {
    uint32_t dyn_index;
    const uint32_t *dynamic_offsets;
    uint32_t dynamic_offset_count;
+
+   /* when baking, descriptors are written here instead of to the state */
+   struct lvp_baked_descriptor *baked;
+   uint32_t baked_count;
 };
 
-static void fill_sampler(struct pipe_sampler_state *ss,
-                         struct lvp_sampler *samp)
-{
-   ss->wrap_s = vk_conv_wrap_mode(samp->create_info.addressModeU);
-   ss->wrap_t = vk_conv_wrap_mode(samp->create_info.addressModeV);
-   ss->wrap_r = vk_conv_wrap_mode(samp->create_info.addressModeW);
-   ss->min_img_filter = samp->create_info.minFilter == VK_FILTER_LINEAR ? PIPE_TEX_FILTER_LINEAR : PIPE_TEX_FILTER_NEAREST;
-   ss->min_mip_filter = samp->create_info.mipmapMode == VK_SAMPLER_MIPMAP_MODE_LINEAR ? PIPE_TEX_MIPFILTER_LINEAR : PIPE_TEX_MIPFILTER_NEAREST;
-   ss->mag_img_filter = samp->create_info.magFilter == VK_FILTER_LINEAR ? PIPE_TEX_FILTER_LINEAR : PIPE_TEX_FILTER_NEAREST;
-   ss->min_lod = samp->create_info.minLod;
-   ss->max_lod = samp->create_info.maxLod;
-   ss->lod_bias = samp->create_info.mipLodBias;
-   ss->max_anisotropy = samp->create_info.maxAnisotropy;
-   ss->normalized_coords = !samp->create_info.unnormalizedCoordinates;
-   ss->compare_mode = samp->create_info.compareEnable ? PIPE_TEX_COMPARE_R_TO_TEXTURE : PIPE_TEX_COMPARE_NONE;
-   ss->compare_func = samp->create_info.compareOp;
-   ss->seamless_cube_map = true;
-   ss->reduction_mode = samp->reduction_mode;
-   memcpy(&ss->border_color, &samp->border_color,
-          sizeof(union pipe_color_union));
+static void apply_descriptor(struct rendering_state *state,
+                             const struct lvp_baked_descriptor *bd)
+{
+   enum pipe_shader_type p_stage = bd->p_stage;
+   int idx = bd->idx;
+
+   switch (bd->type) {
+   case LVP_BAKED_CONST_BUFFER:
+      state->const_buffer[p_stage][idx] = bd->cb;
+      if (state->num_const_bufs[p_stage] <= idx)
+         state->num_const_bufs[p_stage] = idx + 1;
+      dirty_range_add(&state->constbuf_dirty[p_stage], idx);
+      break;
+   case LVP_BAKED_SHADER_BUFFER:
+      state->sb[p_stage][idx] = bd->sb;
+      if (state->num_shader_buffers[p_stage] <= idx)
+         state->num_shader_buffers[p_stage] = idx + 1;
+      dirty_range_add(&state->sb_dirty[p_stage], idx);
+      break;
+   case LVP_BAKED_SAMPLER:
+      state->ss[p_stage][idx] = *bd->ss;
+      if (state->num_sampler_states[p_stage] <= idx)
+         state->num_sampler_states[p_stage] = idx + 1;
+      dirty_range_add(&state->ss_dirty[p_stage], idx);
+      break;
+   case LVP_BAKED_SAMPLER_VIEW:
+      pipe_sampler_view_reference(&state->sv[p_stage][idx], bd->sv);
+      if (state->num_sampler_views[p_stage] <= idx)
+         state->num_sampler_views[p_stage] = idx + 1;
+      dirty_range_add(&state->sv_dirty[p_stage], idx);
+      break;
+   case LVP_BAKED_IMAGE:
+      state->iv[p_stage][idx] = *bd->iv;
+      if (state->num_shader_images[p_stage] <= idx)
+         state->num_shader_images[p_stage] = idx + 1;
+      dirty_range_add(&state->iv_dirty[p_stage], idx);
+      break;
+   default:
+      unreachable("bad baked descriptor type");
+   }
+}
+
+/* Bind the descriptor now, or record it when baking (state is NULL). */
+static void emit_descriptor(struct rendering_state *state,
+                            struct dyn_info *dyn_info,
+                            const struct lvp_baked_descriptor *bd)
+{
+   if (state) {
+      apply_descriptor(state, bd);
+      return;
+   }
+   if (dyn_info->baked)
+      dyn_info->baked[dyn_info->baked_count] = *bd;
+   dyn_info->baked_count++;
 }
 
 static void fill_sampler_stage(struct rendering_state *state,
@@ -856,188 +993,63 @@ static void fill_sampler_stage(struct rendering_state *state,
                                const union lvp_descriptor_info *descriptor,
                                const struct lvp_descriptor_set_binding_layout *binding)
 {
+   struct lvp_baked_descriptor bd;
    int ss_idx = binding->stage[stage].sampler_index;
    if (ss_idx == -1)
       return;
    ss_idx += array_idx;
    ss_idx += dyn_info->stage[stage].sampler_count;
-   fill_sampler(&state->ss[p_stage][ss_idx], binding->immutable_samplers ? binding->immutable_samplers[array_idx] : descriptor->sampler);
-   if (state->num_sampler_states[p_stage] <= ss_idx)
-      state->num_sampler_states[p_stage] = ss_idx + 1;
-   state->ss_dirty[p_stage] = true;
-}
-
-#define fix_depth_swizzle(x) do { \
-  if (x > PIPE_SWIZZLE_X && x < PIPE_SWIZZLE_0) \
-    x = PIPE_SWIZZLE_0;				\
-  } while (0)
-#define fix_depth_swizzle_a(x) do { \
-  if (x > PIPE_SWIZZLE_X && x < PIPE_SWIZZLE_0) \
-    x = PIPE_SWIZZLE_1;				\
-  } while (0)
-
-static void fill_sampler_view_stage(struct rendering_state *state,
-                                    struct dyn_info *dyn_info,
-                                    gl_shader_stage stage,
-                                    enum pipe_shader_type p_stage,
-                                    int array_idx,
-                                    const union lvp_descriptor_info *descriptor,
-                                    const struct lvp_descriptor_set_binding_layout *binding)
-{
-   int sv_idx = binding->stage[stage].sampler_view_index;
-   if (sv_idx == -1)
-      return;
-   sv_idx += array_idx;
-   sv_idx += dyn_info->stage[stage].sampler_view_count;
-   struct lvp_image_view *iv = descriptor->iview;
-   struct pipe_sampler_view templ;
-
-   enum pipe_format pformat;
-   if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT)
-      pformat = lvp_vk_format_to_pipe_format(iv->format);
-   else if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT)
-      pformat = util_format_stencil_only(lvp_vk_format_to_pipe_format(iv->format));
-   else
-      pformat = lvp_vk_format_to_pipe_format(iv->format);
-   u_sampler_view_default_template(&templ,
-                                   iv->image->bo,
-                                   pformat);
-   if (iv->view_type == VK_IMAGE_VIEW_TYPE_1D)
-      templ.target = PIPE_TEXTURE_1D;
-   if (iv->view_type == VK_IMAGE_VIEW_TYPE_2D)
-      templ.target = PIPE_TEXTURE_2D;
-   if (iv->view_type == VK_IMAGE_VIEW_TYPE_CUBE)
-      templ.target = PIPE_TEXTURE_CUBE;
-   if (iv->view_type == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY)
-      templ.target = PIPE_TEXTURE_CUBE_ARRAY;
-   templ.u.tex.first_layer = iv->subresourceRange.baseArrayLayer;
-   templ.u.tex.last_layer = iv->subresourceRange.baseArrayLayer + lvp_get_layerCount(iv->image, &iv->subresourceRange) - 1;
-   templ.u.tex.first_level = iv->subresourceRange.baseMipLevel;
-   templ.u.tex.last_level = iv->subresourceRange.baseMipLevel + lvp_get_levelCount(iv->image, &iv->subresourceRange) - 1;
-   if (iv->components.r != VK_COMPONENT_SWIZZLE_IDENTITY)
-      templ.swizzle_r = vk_conv_swizzle(iv->components.r);
-   if (iv->components.g != VK_COMPONENT_SWIZZLE_IDENTITY)
-      templ.swizzle_g = vk_conv_swizzle(iv->components.g);
-   if (iv->components.b != VK_COMPONENT_SWIZZLE_IDENTITY)
-      templ.swizzle_b = vk_conv_swizzle(iv->components.b);
-   if (iv->components.a != VK_COMPONENT_SWIZZLE_IDENTITY)
-      templ.swizzle_a = vk_conv_swizzle(iv->components.a);
-
-   /* depth stencil swizzles need special handling to pass VK CTS
-    * but also for zink GL tests.
-    * piping A swizzle into R fixes GL_ALPHA depth texture mode
-    * only swizzling from R/0/1 (for alpha) fixes VK CTS tests
-    * and a bunch of zink tests.
-   */
-   if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT ||
-       iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT) {
-      if (templ.swizzle_a == PIPE_SWIZZLE_X)
-         templ.swizzle_r = PIPE_SWIZZLE_X;
-      fix_depth_swizzle(templ.swizzle_r);
-      fix_depth_swizzle(templ.swizzle_g);
-      fix_depth_swizzle(templ.swizzle_b);
-      fix_depth_swizzle_a(templ.swizzle_a);
-   }
-
-   if (state->sv[p_stage][sv_idx])
-      pipe_sampler_view_reference(&state->sv[p_stage][sv_idx], NULL);
-   state->sv[p_stage][sv_idx] = state->pctx->create_sampler_view(state->pctx, iv->image->bo, &templ);
-   if (state->num_sampler_views[p_stage] <= sv_idx)
-      state->num_sampler_views[p_stage] = sv_idx + 1;
-   state->sv_dirty[p_stage] = true;
-}
-
-static void fill_sampler_buffer_view_stage(struct rendering_state *state,
-                                           struct dyn_info *dyn_info,
-                                           gl_shader_stage stage,
-                                           enum pipe_shader_type p_stage,
-                                           int array_idx,
-                                           const union lvp_descriptor_info *descriptor,
-                                           const struct lvp_descriptor_set_binding_layout *binding)
+
+   bd.type = LVP_BAKED_SAMPLER;
+   bd.p_stage = p_stage;
+   bd.idx = ss_idx;
+   bd.ss = binding->immutable_samplers ?
+      &binding->immutable_samplers[array_idx]->state : &descriptor->sampler->state;
+   emit_descriptor(state, dyn_info, &bd);
+}
+
+static void set_sampler_view_stage(struct rendering_state *state,
+                                   struct dyn_info *dyn_info,
+                                   gl_shader_stage stage,
+                                   enum pipe_shader_type p_stage,
+                                   int array_idx,
+                                   struct pipe_sampler_view *sv,
+                                   const struct lvp_descriptor_set_binding_layout *binding)
 {
+   struct lvp_baked_descriptor bd;
    int sv_idx = binding->stage[stage].sampler_view_index;
    if (sv_idx == -1)
       return;
    sv_idx += array_idx;
    sv_idx += dyn_info->stage[stage].sampler_view_count;
-   struct lvp_buffer_view *bv = descriptor->buffer_view;
-   struct pipe_sampler_view templ;
-   memset(&templ, 0, sizeof(templ));
-   templ.target = PIPE_BUFFER;
-   templ.swizzle_r = PIPE_SWIZZLE_X;
-   templ.swizzle_g = PIPE_SWIZZLE_Y;
-   templ.swizzle_b = PIPE_SWIZZLE_Z;
-   templ.swizzle_a = PIPE_SWIZZLE_W;
-   templ.format = bv->pformat;
-   templ.u.buf.offset = bv->offset + bv->buffer->offset;
-   templ.u.buf.size = bv->range == VK_WHOLE_SIZE ? (bv->buffer->size - bv->offset) : bv->range;
-   templ.texture = bv->buffer->bo;
-   templ.context = state->pctx;
-
-   if (state->sv[p_stage][sv_idx])
-      pipe_sampler_view_reference(&state->sv[p_stage][sv_idx], NULL);
-   state->sv[p_stage][sv_idx] = state->pctx->create_sampler_view(state->pctx, bv->buffer->bo, &templ);
-   if (state->num_sampler_views[p_stage] <= sv_idx)
-      state->num_sampler_views[p_stage] = sv_idx + 1;
-   state->sv_dirty[p_stage] = true;
-}
-
-static void fill_image_view_stage(struct rendering_state *state,
-                                  struct dyn_info *dyn_info,
-                                  gl_shader_stage stage,
-                                  enum pipe_shader_type p_stage,
-                                  int array_idx,
-                                  const union lvp_descriptor_info *descriptor,
-                                  const struct lvp_descriptor_set_binding_layout *binding)
-{
-   struct lvp_image_view *iv = descriptor->iview;
-   int idx = binding->stage[stage].image_index;
-   if (idx == -1)
-      return;
-   idx += array_idx;
-   idx += dyn_info->stage[stage].image_count;
-   state->iv[p_stage][idx].resource = iv->image->bo;
-   if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT)
-      state->iv[p_stage][idx].format = lvp_vk_format_to_pipe_format(iv->format);
-   else if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT)
-      state->iv[p_stage][idx].format = util_format_stencil_only(lvp_vk_format_to_pipe_format(iv->format));
-   else
-      state->iv[p_stage][idx].format = lvp_vk_format_to_pipe_format(iv->format);
 
-   if (iv->view_type == VK_IMAGE_VIEW_TYPE_3D) {
-      state->iv[p_stage][idx].u.tex.first_layer = 0;
-      state->iv[p_stage][idx].u.tex.last_layer = u_minify(iv->image->bo->depth0, iv->subresourceRange.baseMipLevel) - 1;
-   } else {
-      state->iv[p_stage][idx].u.tex.first_layer = iv->subresourceRange.baseArrayLayer;
-      state->iv[p_stage][idx].u.tex.last_layer = iv->subresourceRange.baseArrayLayer + lvp_get_layerCount(iv->image, &iv->subresourceRange) - 1;
-   }
-   state->iv[p_stage][idx].u.tex.level = iv->subresourceRange.baseMipLevel;
-   if (state->num_shader_images[p_stage] <= idx)
-      state->num_shader_images[p_stage] = idx + 1;
-   state->iv_dirty[p_stage] = true;
+   bd.type = LVP_BAKED_SAMPLER_VIEW;
+   bd.p_stage = p_stage;
+   bd.idx = sv_idx;
+   bd.sv = sv;
+   emit_descriptor(state, dyn_info, &bd);
 }
 
-static void fill_image_buffer_view_stage(struct rendering_state *state,
-                                         struct dyn_info *dyn_info,
-                                         gl_shader_stage stage,
-                                         enum pipe_shader_type p_stage,
-                                         int array_idx,
-                                         const union lvp_descriptor_info *descriptor,
-                                         const struct lvp_descriptor_set_binding_layout *binding)
+static void set_image_view_stage(struct rendering_state *state,
+                                 struct dyn_info *dyn_info,
+                                 gl_shader_stage stage,
+                                 enum pipe_shader_type p_stage,
+                                 int array_idx,
+                                 const struct pipe_image_view *iv,
+                                 const struct lvp_descriptor_set_binding_layout *binding)
 {
-   struct lvp_buffer_view *bv = descriptor->buffer_view;
+   struct lvp_baked_descriptor bd;
    int idx = binding->stage[stage].image_index;
    if (idx == -1)
       return;
    idx += array_idx;
    idx += dyn_info->stage[stage].image_count;
-   state->iv[p_stage][idx].resource = bv->buffer->bo;
-   state->iv[p_stage][idx].format = bv->pformat;
-   state->iv[p_stage][idx].u.buf.offset = bv->offset + bv->buffer->offset;
-   state->iv[p_stage][idx].u.buf.size = bv->range == VK_WHOLE_SIZE ? (bv->buffer->size - bv->offset): bv->range;
-   if (state->num_shader_images[p_stage] <= idx)
-      state->num_shader_images[p_stage] = idx + 1;
-   state->iv_dirty[p_stage] = true;
+
+   bd.type = LVP_BAKED_IMAGE;
+   bd.p_stage = p_stage;
+   bd.idx = idx;
+   bd.iv = iv;
+   emit_descriptor(state, dyn_info, &bd);
 }
 
 static void handle_descriptor(struct rendering_state *state,
@@ -1049,13 +1061,14 @@ static void handle_descriptor(struct rendering_state *state,
                               VkDescriptorType type,
                               const union lvp_descriptor_info *descriptor)
 {
+   struct lvp_baked_descriptor bd;
    bool is_dynamic = type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
       type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
 
    switch (type) {
    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: {
-      fill_image_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
+      set_image_view_stage(state, dyn_info, stage, p_stage, array_idx, &descriptor->iview->iv, binding);
       break;
    }
    case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
@@ -1065,19 +1078,21 @@ static void handle_descriptor(struct rendering_state *state,
          return;
       idx += array_idx;
       idx += dyn_info->stage[stage].const_buffer_count;
-      state->const_buffer[p_stage][idx].buffer = descriptor->buffer->bo;
-      state->const_buffer[p_stage][idx].buffer_offset = descriptor->offset + descriptor->buffer->offset;
+      memset(&bd.cb, 0, sizeof(bd.cb));
+      bd.type = LVP_BAKED_CONST_BUFFER;
+      bd.p_stage = p_stage;
+      bd.idx = idx;
+      bd.cb.buffer = descriptor->buffer->bo;
+      bd.cb.buffer_offset = descriptor->offset + descriptor->buffer->offset;
       if (is_dynamic) {
          uint32_t offset = dyn_info->dynamic_offsets[dyn_info->dyn_index + binding->dynamic_index + array_idx];
-         state->const_buffer[p_stage][idx].buffer_offset += offset;
+         bd.cb.buffer_offset += offset;
       }
       if (descriptor->range == VK_WHOLE_SIZE)
-         state->const_buffer[p_stage][idx].buffer_size = descriptor->buffer->bo->width0 - state->const_buffer[p_stage][idx].buffer_offset;
+         bd.cb.buffer_size = descriptor->buffer->bo->width0 - bd.cb.buffer_offset;
       else
-         state->const_buffer[p_stage][idx].buffer_size = descriptor->range;
-      if (state->num_const_bufs[p_stage] <= idx)
-         state->num_const_bufs[p_stage] = idx + 1;
-      state->constbuf_dirty[p_stage] = true;
+         bd.cb.buffer_size = descriptor->range;
+      emit_descriptor(state, dyn_info, &bd);
       break;
    }
    case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
@@ -1087,19 +1102,21 @@ static void handle_descriptor(struct rendering_state *state,
          return;
       idx += array_idx;
       idx += dyn_info->stage[stage].shader_buffer_count;
-      state->sb[p_stage][idx].buffer = descriptor->buffer->bo;
-      state->sb[p_stage][idx].buffer_offset = descriptor->offset + descriptor->buffer->offset;
+      memset(&bd.sb, 0, sizeof(bd.sb));
+      bd.type = LVP_BAKED_SHADER_BUFFER;
+      bd.p_stage = p_stage;
+      bd.idx = idx;
+      bd.sb.buffer = descriptor->buffer->bo;
+      bd.sb.buffer_offset = descriptor->offset + descriptor->buffer->offset;
       if (is_dynamic) {
          uint32_t offset = dyn_info->dynamic_offsets[dyn_info->dyn_index + binding->dynamic_index + array_idx];
-         state->sb[p_stage][idx].buffer_offset += offset;
+         bd.sb.buffer_offset += offset;
       }
       if (descriptor->range == VK_WHOLE_SIZE)
-         state->sb[p_stage][idx].buffer_size = descriptor->buffer->bo->width0 - state->sb[p_stage][idx].buffer_offset;
+         bd.sb.buffer_size = descriptor->buffer->bo->width0 - bd.sb.buffer_offset;
       else
-         state->sb[p_stage][idx].buffer_size = descriptor->range;
-      if (state->num_shader_buffers[p_stage] <= idx)
-         state->num_shader_buffers[p_stage] = idx + 1;
-      state->sb_dirty[p_stage] = true;
+         bd.sb.buffer_size = descriptor->range;
+      emit_descriptor(state, dyn_info, &bd);
       break;
    }
    case VK_DESCRIPTOR_TYPE_SAMPLER:
@@ -1108,17 +1125,17 @@ static void handle_descriptor(struct rendering_state *state,
       fill_sampler_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
       break;
    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
-      fill_sampler_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
+      set_sampler_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor->iview->sv, binding);
       break;
    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
       fill_sampler_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
-      fill_sampler_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
+      set_sampler_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor->iview->sv, binding);
       break;
    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
-      fill_sampler_buffer_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
+      set_sampler_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor->buffer_view->sv, binding);
       break;
    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
-      fill_image_buffer_view_stage(state, dyn_info, stage, p_stage, array_idx, descriptor, binding);
+      set_image_view_stage(state, dyn_info, stage, p_stage, array_idx, &descriptor->buffer_view->iv, binding);
       break;
    default:
       fprintf(stderr, "Unhandled descriptor set %d\n", type);
@@ -1161,11 +1178,10 @@ static void increment_dyn_info(struct dyn_info *dyn_info,
       dyn_info->dyn_index += layout->dynamic_offset_count;
 }
 
-static void handle_compute_descriptor_sets(struct lvp_cmd_buffer_entry *cmd,
+static void handle_compute_descriptor_sets(const struct lvp_cmd_bind_descriptor_sets *bds,
                                            struct dyn_info *dyn_info,
                                            struct rendering_state *state)
 {
-   struct lvp_cmd_bind_descriptor_sets *bds = &cmd->u.descriptor_sets;
    int i;
 
    for (i = 0; i < bds->first; i++) {
@@ -1180,46 +1196,78 @@ static void handle_compute_descriptor_sets(struct lvp_cmd_buffer_entry *cmd,
    }
 }
 
-static void handle_descriptor_sets(struct lvp_cmd_buffer_entry *cmd,
-                                   struct rendering_state *state)
+static void walk_descriptor_sets(const struct lvp_cmd_bind_descriptor_sets *bds,
+                                 struct dyn_info *dyn_info,
+                                 struct rendering_state *state)
 {
-   struct lvp_cmd_bind_descriptor_sets *bds = &cmd->u.descriptor_sets;
    int i;
-   struct dyn_info dyn_info;
 
-   dyn_info.dyn_index = 0;
-   dyn_info.dynamic_offsets = bds->dynamic_offsets;
-   dyn_info.dynamic_offset_count = bds->dynamic_offset_count;
+   dyn_info->dyn_index = 0;
+   dyn_info->dynamic_offsets = bds->dynamic_offsets;
+   dyn_info->dynamic_offset_count = bds->dynamic_offset_count;
 
-   memset(dyn_info.stage, 0, sizeof(dyn_info.stage));
+   memset(dyn_info->stage, 0, sizeof(dyn_info->stage));
    if (bds->bind_point == VK_PIPELINE_BIND_POINT_COMPUTE) {
-      handle_compute_descriptor_sets(cmd, &dyn_info, state);
+      handle_compute_descriptor_sets(bds, dyn_info, state);
       return;
    }
 
    for (i = 0; i < bds->first; i++) {
-      increment_dyn_info(&dyn_info, bds->set_layout[i], false);
+      increment_dyn_info(dyn_info, bds->set_layout[i], false);
    }
 
    for (i = 0; i < bds->count; i++) {
       const struct lvp_descriptor_set *set = bds->sets[i];
 
       if (set->layout->shader_stages & VK_SHADER_STAGE_VERTEX_BIT)
-         handle_set_stage(state, &dyn_info, set, MESA_SHADER_VERTEX, PIPE_SHADER_VERTEX);
+         handle_set_stage(state, dyn_info, set, MESA_SHADER_VERTEX, PIPE_SHADER_VERTEX);
 
       if (set->layout->shader_stages & VK_SHADER_STAGE_GEOMETRY_BIT)
-         handle_set_stage(state, &dyn_info, set, MESA_SHADER_GEOMETRY, PIPE_SHADER_GEOMETRY);
+         handle_set_stage(state, dyn_info, set, MESA_SHADER_GEOMETRY, PIPE_SHADER_GEOMETRY);
 
       if (set->layout->shader_stages & VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT)
-         handle_set_stage(state, &dyn_info, set, MESA_SHADER_TESS_CTRL, PIPE_SHADER_TESS_CTRL);
+         handle_set_stage(state, dyn_info, set, MESA_SHADER_TESS_CTRL, PIPE_SHADER_TESS_CTRL);
 
       if (set->layout->shader_stages & VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT)
-         handle_set_stage(state, &dyn_info, set, MESA_SHADER_TESS_EVAL, PIPE_SHADER_TESS_EVAL);
+         handle_set_stage(state, dyn_info, set, MESA_SHADER_TESS_EVAL, PIPE_SHADER_TESS_EVAL);
 
       if (set->layout->shader_stages & VK_SHADER_STAGE_FRAGMENT_BIT)
-	 handle_set_stage(state, &dyn_info, set, MESA_SHADER_FRAGMENT, PIPE_SHADER_FRAGMENT);
-      increment_dyn_info(&dyn_info, bds->set_layout[bds->first + i], true);
+	 handle_set_stage(state, dyn_info, set, MESA_SHADER_FRAGMENT, PIPE_SHADER_FRAGMENT);
+      increment_dyn_info(dyn_info, bds->set_layout[bds->first + i], true);
+   }
+}
+
+/* Resolve every descriptor of a bind to its gallium slot ahead of
+ * execution.  Without update-after-bind the sets can't change while the
+ * command buffer is executable, so the result stays valid for every
+ * replay.  Returns the number of entries, writing them when baked is
+ * non-NULL.
+ */
+uint32_t lvp_bake_descriptor_sets(const struct lvp_cmd_bind_descriptor_sets *bds,
+                                  struct lvp_baked_descriptor *baked)
+{
+   struct dyn_info dyn_info;
+
+   dyn_info.baked = baked;
+   dyn_info.baked_count = 0;
+   walk_descriptor_sets(bds, &dyn_info, NULL);
+   return dyn_info.baked_count;
+}
+
+static void handle_descriptor_sets(struct lvp_cmd_buffer_entry *cmd,
+                                   struct rendering_state *state)
+{
+   struct lvp_cmd_bind_descriptor_sets *bds = &cmd->u.descriptor_sets;
+   struct dyn_info dyn_info;
+
+   if (bds->baked) {
+      for (unsigned i = 0; i < bds->baked_count; i++)
+         apply_descriptor(state, &bds->baked[i]);
+      return;
    }
+
+   dyn_info.baked = NULL;
+   walk_descriptor_sets(bds, &dyn_info, state);
 }
 
 static struct pipe_surface *create_img_surface_bo(struct rendering_state *state,
@@ -1647,42 +1695,57 @@ static void handle_draw(struct lvp_cmd_buffer_entry *cmd,
    state->pctx->draw_vbo(state->pctx, &state->info, 0, NULL, cmd->u.draw.draws, cmd->u.draw.draw_count);
 }
 
+void lvp_bake_viewports(const struct lvp_cmd_set_viewport *vp,
+                        struct pipe_viewport_state *baked)
+{
+   memset(baked, 0, vp->viewport_count * sizeof(*baked));
+   for (unsigned i = 0; i < vp->viewport_count; i++)
+      get_viewport_xform(&vp->viewports[i], baked[i].scale, baked[i].translate);
+}
+
+void lvp_bake_scissors(const struct lvp_cmd_set_scissor *ss,
+                       struct pipe_scissor_state *baked)
+{
+   for (unsigned i = 0; i < ss->scissor_count; i++) {
+      const VkRect2D *rect = &ss->scissors[i];
+      baked[i].minx = rect->offset.x;
+      baked[i].miny = rect->offset.y;
+      baked[i].maxx = rect->offset.x + rect->extent.width;
+      baked[i].maxy = rect->offset.y + rect->extent.height;
+   }
+}
+
 static void handle_set_viewport(struct lvp_cmd_buffer_entry *cmd,
                                 struct rendering_state *state)
 {
-   int i;
    unsigned base = 0;
    if (cmd->u.set_viewport.first_viewport == UINT32_MAX)
       state->num_viewports = cmd->u.set_viewport.viewport_count;
    else
       base = cmd->u.set_viewport.first_viewport;
 
-   for (i = 0; i < cmd->u.set_viewport.viewport_count; i++) {
-      int idx = i + base;
-      const VkViewport *vp = &cmd->u.set_viewport.viewports[i];
-      get_viewport_xform(vp, state->viewports[idx].scale, state->viewports[idx].translate);
-   }
+   if (cmd->u.set_viewport.baked)
+      memcpy(&state->viewports[base], cmd->u.set_viewport.baked,
+             cmd->u.set_viewport.viewport_count * sizeof(state->viewports[0]));
+   else
+      lvp_bake_viewports(&cmd->u.set_viewport, &state->viewports[base]);
    state->vp_dirty = true;
 }
 
 static void handle_set_scissor(struct lvp_cmd_buffer_entry *cmd,
                                struct rendering_state *state)
 {
-   int i;
    unsigned base = 0;
    if (cmd->u.set_scissor.first_scissor == UINT32_MAX)
       state->num_scissors = cmd->u.set_scissor.scissor_count;
    else
       base = cmd->u.set_scissor.first_scissor;
 
-   for (i = 0; i < cmd->u.set_scissor.scissor_count; i++) {
-      int idx = i + base;
-      const VkRect2D *ss = &cmd->u.set_scissor.scissors[i];
-      state->scissors[idx].minx = ss->offset.x;
-      state->scissors[idx].miny = ss->offset.y;
-      state->scissors[idx].maxx = ss->offset.x + ss->extent.width;
-      state->scissors[idx].maxy = ss->offset.y + ss->extent.height;
-   }
+   if (cmd->u.set_scissor.baked)
+      memcpy(&state->scissors[base], cmd->u.set_scissor.baked,
+             cmd->u.set_scissor.scissor_count * sizeof(state->scissors[0]));
+   else
+      lvp_bake_scissors(&cmd->u.set_scissor, &state->scissors[base]);
    state->scissor_dirty = true;
 }
 
@@ -2238,28 +2301,45 @@ static void handle_draw_indirect(struct lvp_cmd_buffer_entry *cmd,
    state->indirect_info.stride = cmd->u.draw_indirect.stride;
    state->indirect_info.draw_count = cmd->u.draw_indirect.draw_count;
    state->indirect_info.buffer = cmd->u.draw_indirect.buffer->bo;
+   state->indirect_info.indirect_draw_count = NULL;
    state->info.view_mask = subpass->view_mask;
+   state->info.increment_draw_id = true;
 
    state->pctx->draw_vbo(state->pctx, &state->info, 0, &state->indirect_info, &draw, 1);
 }
 
-static void handle_index_buffer(struct lvp_cmd_buffer_entry *cmd,
-                                struct rendering_state *state)
+static unsigned index_type_size(VkIndexType index_type)
 {
-   struct lvp_cmd_bind_index_buffer *ib = &cmd->u.index_buffer;
-   switch (ib->index_type) {
+   switch (index_type) {
    case VK_INDEX_TYPE_UINT8_EXT:
-      state->index_size = 1;
-      break;
+      return 1;
    case VK_INDEX_TYPE_UINT16:
-      state->index_size = 2;
-      break;
+      return 2;
    case VK_INDEX_TYPE_UINT32:
-      state->index_size = 4;
-      break;
+      return 4;
    default:
-      break;
+      unreachable("bad index type");
    }
+}
+
+/* Folds the offset of the index buffer bound earlier in the same command
+ * buffer into the draw starts, so replaying the draw doesn't touch it.
+ */
+void lvp_bake_draw_indexed(const struct lvp_cmd_bind_index_buffer *ib,
+                           struct lvp_cmd_draw_indexed *draw)
+{
+   unsigned index_size = index_type_size(ib->index_type);
+
+   for (unsigned i = 0; i < draw->draw_count; i++)
+      draw->draws[i].start += ib->offset / index_size;
+   draw->calc_start = false;
+}
+
+static void handle_index_buffer(struct lvp_cmd_buffer_entry *cmd,
+                                struct rendering_state *state)
+{
+   struct lvp_cmd_bind_index_buffer *ib = &cmd->u.index_buffer;
+   state->index_size = index_type_size(ib->index_type);
    state->index_offset = ib->offset;
    if (ib->buffer)
       state->index_buffer = ib->buffer->bo;
@@ -2712,6 +2792,7 @@ static void handle_draw_indirect_count(struct lvp_cmd_buffer_entry *cmd,
    state->indirect_info.indirect_draw_count_offset = cmd->u.draw_indirect_count.count_buffer_offset;
    state->indirect_info.indirect_draw_count = cmd->u.draw_indirect_count.count_buffer->bo;
    state->info.view_mask = subpass->view_mask;
+   state->info.increment_draw_id = true;
 
    state->pctx->draw_vbo(state->pctx, &state->info, 0, &state->indirect_info, &draw, 1);
 }
@@ -3298,6 +3379,135 @@ static void lvp_execute_cmd_buffer(struct lvp_cmd_buffer *cmd_buffer,
    }
 }
 
+static struct pipe_surface *
+precompile_surface(struct rendering_state *state,
+                   const struct lvp_render_pass_attachment *att,
+                   unsigned bind,
+                   struct pipe_resource **res)
+{
+   struct pipe_screen *pscreen = state->pctx->screen;
+   struct pipe_resource templ;
+   struct pipe_surface surf_templ;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = lvp_vk_format_to_pipe_format(att->format);
+   templ.width0 = templ.height0 = 1;
+   templ.depth0 = templ.array_size = 1;
+   templ.nr_samples = templ.nr_storage_samples = att->samples > 1 ? att->samples : 0;
+   templ.bind = bind;
+   *res = pscreen->resource_create(pscreen, &templ);
+   if (!*res)
+      return NULL;
+
+   memset(&surf_templ, 0, sizeof(surf_templ));
+   surf_templ.format = templ.format;
+   return state->pctx->create_surface(state->pctx, *res, &surf_templ);
+}
+
+/* Create the CSO set of every graphics queue for a graphics pipeline on
+ * the device's auxiliary context, bind each with everything else the
+ * pipeline fixes against stand-in attachments of the subpass formats, and
+ * let the driver build the shader variants a draw would use.  This keeps
+ * the JIT off the first draw on every queue.  Descriptor contents and
+ * dynamic state are unknown here, so variants depending on those are still
+ * built at draw time.
+ */
+void
+lvp_pipeline_precompile(struct lvp_device *device,
+                        struct lvp_pipeline *pipeline)
+{
+   const VkGraphicsPipelineCreateInfo *info = &pipeline->graphics_create_info;
+   LVP_FROM_HANDLE(lvp_render_pass, pass, info->renderPass);
+   struct pipe_resource *res[PIPE_MAX_COLOR_BUFS + 1] = { NULL };
+   struct pipe_surface *surf[PIPE_MAX_COLOR_BUFS + 1] = { NULL };
+   struct lvp_cmd_buffer_entry cmd;
+   struct rendering_state *state;
+
+   /* the draw module only precompiles the plain vertex shader path */
+   if (!pass ||
+       pipeline->pipeline_nir[MESA_SHADER_GEOMETRY] ||
+       pipeline->pipeline_nir[MESA_SHADER_TESS_EVAL])
+      return;
+
+   state = calloc(1, sizeof(*state));
+   if (!state)
+      return;
+
+   mtx_lock(&device->aux_lock);
+   if (!device->aux_ctx->precompile_shader_variants)
+      goto out;
+
+   state->pctx = device->aux_ctx;
+   state->cso = device->aux_cso;
+   for (enum pipe_shader_type s = PIPE_SHADER_VERTEX; s < PIPE_SHADER_TYPES; s++) {
+      for (unsigned i = 0; i < PIPE_MAX_SAMPLERS; i++)
+         state->cso_ss_ptr[s][i] = &state->ss[s][i];
+   }
+
+   const struct lvp_subpass *subpass = &pass->subpasses[info->subpass];
+   state->framebuffer.width = 1;
+   state->framebuffer.height = 1;
+   state->framebuffer.layers = 1;
+   for (unsigned i = 0; i < subpass->color_count; i++) {
+      uint32_t a = subpass->color_attachments[i].attachment;
+      if (a != VK_ATTACHMENT_UNUSED)
+         surf[i] = precompile_surface(state, &pass->attachments[a],
+                                      PIPE_BIND_RENDER_TARGET, &res[i]);
+      state->framebuffer.cbufs[i] = surf[i];
+      state->framebuffer.nr_cbufs++;
+   }
+   if (subpass->depth_stencil_attachment &&
+       subpass->depth_stencil_attachment->attachment != VK_ATTACHMENT_UNUSED) {
+      uint32_t a = subpass->depth_stencil_attachment->attachment;
+      surf[PIPE_MAX_COLOR_BUFS] = precompile_surface(state, &pass->attachments[a],
+                                                     PIPE_BIND_DEPTH_STENCIL,
+                                                     &res[PIPE_MAX_COLOR_BUFS]);
+      state->framebuffer.zsbuf = surf[PIPE_MAX_COLOR_BUFS];
+   }
+
+   /* Variants belong to their CSO, which only its owning context may use,
+    * so each queue that can draw gets a set of its own.  Vertex and
+    * fragment CSOs don't depend on the context creating them, unlike the
+    * geometry and tessellation ones, so the sets can be handed over: no
+    * queue can see the pipeline before vkCreateGraphicsPipelines returns.
+    */
+   for (unsigned q = 0; q < LVP_MAX_QUEUES; q++) {
+      if (!device->queues[0][q])
+         continue;
+
+      state->precompile_csos = pipeline->shader_cso[0][q];
+      lvp_pipeline_create_csos(pipeline, device->aux_ctx, state->precompile_csos);
+
+      state->blend_dirty = true;
+      state->dsa_dirty = true;
+      state->rs_dirty = true;
+      state->vp_dirty = true;
+      cmd.u.pipeline.pipeline = pipeline;
+      cmd.u.pipeline.baked = NULL;
+      handle_graphics_pipeline(&cmd, state);
+      state->pctx->set_framebuffer_state(state->pctx, &state->framebuffer);
+      emit_state(state);
+
+      state->pctx->precompile_shader_variants(state->pctx, state->info.mode);
+
+      /* the pipeline can be destroyed through another context, drop it here */
+      cso_unbind_context(state->cso);
+      state->pctx->bind_vs_state(state->pctx, NULL);
+      state->pctx->bind_fs_state(state->pctx, NULL);
+   }
+   memset(&state->framebuffer, 0, sizeof(state->framebuffer));
+   state->pctx->set_framebuffer_state(state->pctx, &state->framebuffer);
+
+out:
+   for (unsigned i = 0; i < ARRAY_SIZE(res); i++) {
+      pipe_surface_reference(&surf[i], NULL);
+      pipe_resource_reference(&res[i], NULL);
+   }
+   mtx_unlock(&device->aux_lock);
+   free(state);
+}
+
 VkResult lvp_execute_cmds(struct lvp_device *device,
                           struct lvp_queue *queue,
                           struct lvp_cmd_buffer *cmd_buffer)
@@ -3306,6 +3516,7 @@ VkResult lvp_execute_cmds(struct lvp_device *device,
    memset(&state, 0, sizeof(state));
    state.pctx = queue->ctx;
    state.cso = queue->cso;
+   state.queue = queue;
    state.blend_dirty = true;
    state.dsa_dirty = true;
    state.rs_dirty = true;
@@ -3326,6 +3537,14 @@ VkResult lvp_execute_cmds(struct lvp_device *device,
       }
    }
 
+   /* The views belong to the device's aux context, but releasing an
+    * llvmpipe view touches no context state, see lvp_create_sampler_view().
+    */
+   for (enum pipe_shader_type s = PIPE_SHADER_VERTEX; s < PIPE_SHADER_TYPES; s++) {
+      for (unsigned i = 0; i < PIPE_MAX_SHADER_SAMPLER_VIEWS; i++)
+         pipe_sampler_view_reference(&state.sv[s][i], NULL);
+   }
+
    free(state.pending_clear_aspects);
    free(state.cleared_views);
    return VK_SUCCESS;
@@ -22,8 +22,10 @@
  */
 
 #include "lvp_private.h"
+#include "lvp_conv.h"
 #include "util/format/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_sampler.h"
 #include "pipe/p_state.h"
 
 VkResult
@@ -180,6 +182,107 @@ lvp_DestroyImage(VkDevice _device, VkImage _image,
    vk_free2(&device->vk.alloc, pAllocator, image);
 }
 
+#define fix_depth_swizzle(x) do { \
+  if (x > PIPE_SWIZZLE_X && x < PIPE_SWIZZLE_0) \
+    x = PIPE_SWIZZLE_0;				\
+  } while (0)
+#define fix_depth_swizzle_a(x) do { \
+  if (x > PIPE_SWIZZLE_X && x < PIPE_SWIZZLE_0) \
+    x = PIPE_SWIZZLE_1;				\
+  } while (0)
+
+/* Views are created by the application's threads while the queue threads
+ * use their own contexts, so they go through the device's auxiliary
+ * context.  llvmpipe sampler views carry no per-context state, which lets
+ * every queue bind them, and llvmpipe_sampler_view_destroy() only drops the
+ * texture reference and frees the view, so the last reference may be
+ * released on any thread without aux_lock.  The queue contexts release
+ * views they had bound from inside the driver anyway.
+ */
+static struct pipe_sampler_view *
+lvp_create_sampler_view(struct lvp_device *device,
+                        struct pipe_resource *res,
+                        const struct pipe_sampler_view *templ)
+{
+   struct pipe_context *ctx = device->aux_ctx;
+   struct pipe_sampler_view *sv;
+
+   mtx_lock(&device->aux_lock);
+   sv = ctx->create_sampler_view(ctx, res, templ);
+   mtx_unlock(&device->aux_lock);
+   return sv;
+}
+
+static VkResult
+lvp_image_view_create_state(struct lvp_device *device,
+                            struct lvp_image_view *iv)
+{
+   struct pipe_sampler_view templ;
+
+   enum pipe_format pformat;
+   if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT)
+      pformat = util_format_stencil_only(iv->pformat);
+   else
+      pformat = iv->pformat;
+
+   u_sampler_view_default_template(&templ,
+                                   iv->image->bo,
+                                   pformat);
+   if (iv->view_type == VK_IMAGE_VIEW_TYPE_1D)
+      templ.target = PIPE_TEXTURE_1D;
+   if (iv->view_type == VK_IMAGE_VIEW_TYPE_2D)
+      templ.target = PIPE_TEXTURE_2D;
+   if (iv->view_type == VK_IMAGE_VIEW_TYPE_CUBE)
+      templ.target = PIPE_TEXTURE_CUBE;
+   if (iv->view_type == VK_IMAGE_VIEW_TYPE_CUBE_ARRAY)
+      templ.target = PIPE_TEXTURE_CUBE_ARRAY;
+   templ.u.tex.first_layer = iv->subresourceRange.baseArrayLayer;
+   templ.u.tex.last_layer = iv->subresourceRange.baseArrayLayer + lvp_get_layerCount(iv->image, &iv->subresourceRange) - 1;
+   templ.u.tex.first_level = iv->subresourceRange.baseMipLevel;
+   templ.u.tex.last_level = iv->subresourceRange.baseMipLevel + lvp_get_levelCount(iv->image, &iv->subresourceRange) - 1;
+   if (iv->components.r != VK_COMPONENT_SWIZZLE_IDENTITY)
+      templ.swizzle_r = vk_conv_swizzle(iv->components.r);
+   if (iv->components.g != VK_COMPONENT_SWIZZLE_IDENTITY)
+      templ.swizzle_g = vk_conv_swizzle(iv->components.g);
+   if (iv->components.b != VK_COMPONENT_SWIZZLE_IDENTITY)
+      templ.swizzle_b = vk_conv_swizzle(iv->components.b);
+   if (iv->components.a != VK_COMPONENT_SWIZZLE_IDENTITY)
+      templ.swizzle_a = vk_conv_swizzle(iv->components.a);
+
+   /* depth stencil swizzles need special handling to pass VK CTS
+    * but also for zink GL tests.
+    * piping A swizzle into R fixes GL_ALPHA depth texture mode
+    * only swizzling from R/0/1 (for alpha) fixes VK CTS tests
+    * and a bunch of zink tests.
+   */
+   if (iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT ||
+       iv->subresourceRange.aspectMask == VK_IMAGE_ASPECT_STENCIL_BIT) {
+      if (templ.swizzle_a == PIPE_SWIZZLE_X)
+         templ.swizzle_r = PIPE_SWIZZLE_X;
+      fix_depth_swizzle(templ.swizzle_r);
+      fix_depth_swizzle(templ.swizzle_g);
+      fix_depth_swizzle(templ.swizzle_b);
+      fix_depth_swizzle_a(templ.swizzle_a);
+   }
+
+   iv->sv = lvp_create_sampler_view(device, iv->image->bo, &templ);
+   if (!iv->sv)
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
+
+   memset(&iv->iv, 0, sizeof(iv->iv));
+   iv->iv.resource = iv->image->bo;
+   iv->iv.format = pformat;
+   if (iv->view_type == VK_IMAGE_VIEW_TYPE_3D) {
+      iv->iv.u.tex.first_layer = 0;
+      iv->iv.u.tex.last_layer = u_minify(iv->image->bo->depth0, iv->subresourceRange.baseMipLevel) - 1;
+   } else {
+      iv->iv.u.tex.first_layer = iv->subresourceRange.baseArrayLayer;
+      iv->iv.u.tex.last_layer = iv->subresourceRange.baseArrayLayer + lvp_get_layerCount(iv->image, &iv->subresourceRange) - 1;
+   }
+   iv->iv.u.tex.level = iv->subresourceRange.baseMipLevel;
+   return VK_SUCCESS;
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL
 lvp_CreateImageView(VkDevice _device,
                     const VkImageViewCreateInfo *pCreateInfo,
@@ -204,6 +307,11 @@ lvp_CreateImageView(VkDevice _device,
    view->subresourceRange = pCreateInfo->subresourceRange;
    view->image = image;
    view->surface = NULL;
+   if (lvp_image_view_create_state(device, view) != VK_SUCCESS) {
+      vk_object_base_finish(&view->base);
+      vk_free2(&device->vk.alloc, pAllocator, view);
+      return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+   }
    *pView = lvp_image_view_to_handle(view);
 
    return VK_SUCCESS;
@@ -220,6 +328,8 @@ lvp_DestroyImageView(VkDevice _device, VkImageView _iview,
      return;
 
    pipe_surface_reference(&iview->surface, NULL);
+   /* no aux_lock needed, see lvp_create_sampler_view() */
+   pipe_sampler_view_reference(&iview->sv, NULL);
    vk_object_base_finish(&iview->base);
    vk_free2(&device->vk.alloc, pAllocator, iview);
 }
@@ -405,6 +515,30 @@ lvp_CreateBufferView(VkDevice _device,
    view->pformat = lvp_vk_format_to_pipe_format(pCreateInfo->format);
    view->offset = pCreateInfo->offset;
    view->range = pCreateInfo->range;
+
+   struct pipe_sampler_view templ;
+   memset(&templ, 0, sizeof(templ));
+   templ.target = PIPE_BUFFER;
+   templ.swizzle_r = PIPE_SWIZZLE_X;
+   templ.swizzle_g = PIPE_SWIZZLE_Y;
+   templ.swizzle_b = PIPE_SWIZZLE_Z;
+   templ.swizzle_a = PIPE_SWIZZLE_W;
+   templ.format = view->pformat;
+   templ.u.buf.offset = view->offset + buffer->offset;
+   templ.u.buf.size = view->range == VK_WHOLE_SIZE ? (buffer->size - view->offset) : view->range;
+   templ.texture = buffer->bo;
+   view->sv = lvp_create_sampler_view(device, buffer->bo, &templ);
+   if (!view->sv) {
+      vk_object_base_finish(&view->base);
+      vk_free2(&device->vk.alloc, pAllocator, view);
+      return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+   }
+
+   memset(&view->iv, 0, sizeof(view->iv));
+   view->iv.resource = buffer->bo;
+   view->iv.format = view->pformat;
+   view->iv.u.buf.offset = templ.u.buf.offset;
+   view->iv.u.buf.size = templ.u.buf.size;
    *pView = lvp_buffer_view_to_handle(view);
 
    return VK_SUCCESS;
@@ -419,6 +553,8 @@ lvp_DestroyBufferView(VkDevice _device, VkBufferView bufferView,
 
    if (!bufferView)
      return;
+   /* no aux_lock needed, see lvp_create_sampler_view() */
+   pipe_sampler_view_reference(&view->sv, NULL);
    vk_object_base_finish(&view->base);
    vk_free2(&device->vk.alloc, pAllocator, view);
 }
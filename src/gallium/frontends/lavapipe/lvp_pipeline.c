@@ -30,6 +30,7 @@
 #include "pipe/p_state.h"
 #include "pipe/p_context.h"
 #include "nir/nir_xfb_info.h"
+#include "tgsi/tgsi_from_mesa.h"
 
 #define SPIR_V_MAGIC_NUMBER 0x07230203
 
@@ -40,6 +41,14 @@
       dst = temp;                                                \
    } while(0)
 
+static bool
+lvp_pipeline_has_csos(const struct lvp_pipeline *pipeline, void **csos)
+{
+   /* graphics pipelines always have a fragment shader, if only a dummy */
+   return csos[pipeline->is_compute_pipeline ? PIPE_SHADER_COMPUTE
+                                             : PIPE_SHADER_FRAGMENT] != NULL;
+}
+
 VKAPI_ATTR void VKAPI_CALL lvp_DestroyPipeline(
    VkDevice                                    _device,
    VkPipeline                                  _pipeline,
@@ -51,18 +60,16 @@ VKAPI_ATTR void VKAPI_CALL lvp_DestroyPipeline(
    if (!_pipeline)
       return;
 
-   if (pipeline->shader_cso[PIPE_SHADER_VERTEX])
-      device->queue.ctx->delete_vs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_VERTEX]);
-   if (pipeline->shader_cso[PIPE_SHADER_FRAGMENT])
-      device->queue.ctx->delete_fs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_FRAGMENT]);
-   if (pipeline->shader_cso[PIPE_SHADER_GEOMETRY])
-      device->queue.ctx->delete_gs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_GEOMETRY]);
-   if (pipeline->shader_cso[PIPE_SHADER_TESS_CTRL])
-      device->queue.ctx->delete_tcs_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_TESS_CTRL]);
-   if (pipeline->shader_cso[PIPE_SHADER_TESS_EVAL])
-      device->queue.ctx->delete_tes_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_TESS_EVAL]);
-   if (pipeline->shader_cso[PIPE_SHADER_COMPUTE])
-      device->queue.ctx->delete_compute_state(device->queue.ctx, pipeline->shader_cso[PIPE_SHADER_COMPUTE]);
+   /* each queue deletes its own set, its context may be busy right now */
+   for (uint32_t i = 0; i < LVP_QUEUE_FAMILY_COUNT; i++) {
+      for (uint32_t j = 0; j < LVP_MAX_QUEUES; j++) {
+         if (device->queues[i][j] && lvp_pipeline_has_csos(pipeline, pipeline->shader_cso[i][j]))
+            lvp_queue_delete_csos(device->queues[i][j], pipeline->shader_cso[i][j]);
+      }
+   }
+
+   for (gl_shader_stage stage = 0; stage < MESA_SHADER_STAGES; stage++)
+      ralloc_free(pipeline->pipeline_nir[stage]);
 
    ralloc_free(pipeline->mem_ctx);
    vk_object_base_finish(&pipeline->base);
@@ -645,7 +652,7 @@ lvp_shader_compile_to_ir(struct lvp_pipeline *pipeline,
 static void fill_shader_prog(struct pipe_shader_state *state, gl_shader_stage stage, struct lvp_pipeline *pipeline)
 {
    state->type = PIPE_SHADER_IR_NIR;
-   state->ir.nir = pipeline->pipeline_nir[stage];
+   state->ir.nir = nir_shader_clone(NULL, pipeline->pipeline_nir[stage]);
 }
 
 static void
@@ -709,18 +716,17 @@ lvp_shader_stage(VkShaderStageFlagBits stage)
    }
 }
 
-static VkResult
-lvp_pipeline_compile(struct lvp_pipeline *pipeline,
-                     gl_shader_stage stage)
+static void *
+lvp_pipeline_create_cso(struct lvp_pipeline *pipeline,
+                        struct pipe_context *ctx,
+                        gl_shader_stage stage)
 {
-   struct lvp_device *device = pipeline->device;
-   device->physical_device->pscreen->finalize_nir(device->physical_device->pscreen, pipeline->pipeline_nir[stage], true);
    if (stage == MESA_SHADER_COMPUTE) {
       struct pipe_compute_state shstate = {0};
-      shstate.prog = (void *)pipeline->pipeline_nir[MESA_SHADER_COMPUTE];
+      shstate.prog = (void *)nir_shader_clone(NULL, pipeline->pipeline_nir[MESA_SHADER_COMPUTE]);
       shstate.ir_type = PIPE_SHADER_IR_NIR;
       shstate.req_local_mem = pipeline->pipeline_nir[MESA_SHADER_COMPUTE]->info.shared_size;
-      pipeline->shader_cso[PIPE_SHADER_COMPUTE] = device->queue.ctx->create_compute_state(device->queue.ctx, &shstate);
+      return ctx->create_compute_state(ctx, &shstate);
    } else {
       struct pipe_shader_state shstate = {0};
       fill_shader_prog(&shstate, stage, pipeline);
@@ -761,26 +767,134 @@ lvp_pipeline_compile(struct lvp_pipeline *pipeline,
 
       switch (stage) {
       case MESA_SHADER_FRAGMENT:
-         pipeline->shader_cso[PIPE_SHADER_FRAGMENT] = device->queue.ctx->create_fs_state(device->queue.ctx, &shstate);
-         break;
+         return ctx->create_fs_state(ctx, &shstate);
       case MESA_SHADER_VERTEX:
-         pipeline->shader_cso[PIPE_SHADER_VERTEX] = device->queue.ctx->create_vs_state(device->queue.ctx, &shstate);
-         break;
+         return ctx->create_vs_state(ctx, &shstate);
       case MESA_SHADER_GEOMETRY:
-         pipeline->shader_cso[PIPE_SHADER_GEOMETRY] = device->queue.ctx->create_gs_state(device->queue.ctx, &shstate);
-         break;
+         return ctx->create_gs_state(ctx, &shstate);
       case MESA_SHADER_TESS_CTRL:
-         pipeline->shader_cso[PIPE_SHADER_TESS_CTRL] = device->queue.ctx->create_tcs_state(device->queue.ctx, &shstate);
-         break;
+         return ctx->create_tcs_state(ctx, &shstate);
       case MESA_SHADER_TESS_EVAL:
-         pipeline->shader_cso[PIPE_SHADER_TESS_EVAL] = device->queue.ctx->create_tes_state(device->queue.ctx, &shstate);
-         break;
+         return ctx->create_tes_state(ctx, &shstate);
       default:
          unreachable("illegal shader");
-         break;
+         return NULL;
       }
    }
-   return VK_SUCCESS;
+}
+
+/* Create a CSO for every stage of the pipeline on ctx.  Each CSO gets its
+ * own copy of the NIR, the pipeline keeps the original.
+ */
+void
+lvp_pipeline_create_csos(struct lvp_pipeline *pipeline,
+                         struct pipe_context *ctx,
+                         void **csos)
+{
+   for (gl_shader_stage stage = 0; stage < MESA_SHADER_STAGES; stage++) {
+      if (pipeline->pipeline_nir[stage])
+         csos[pipe_shader_type_from_mesa(stage)] = lvp_pipeline_create_cso(pipeline, ctx, stage);
+   }
+}
+
+void
+lvp_pipeline_delete_csos(struct pipe_context *ctx, void **csos)
+{
+   if (csos[PIPE_SHADER_VERTEX])
+      ctx->delete_vs_state(ctx, csos[PIPE_SHADER_VERTEX]);
+   if (csos[PIPE_SHADER_FRAGMENT])
+      ctx->delete_fs_state(ctx, csos[PIPE_SHADER_FRAGMENT]);
+   if (csos[PIPE_SHADER_GEOMETRY])
+      ctx->delete_gs_state(ctx, csos[PIPE_SHADER_GEOMETRY]);
+   if (csos[PIPE_SHADER_TESS_CTRL])
+      ctx->delete_tcs_state(ctx, csos[PIPE_SHADER_TESS_CTRL]);
+   if (csos[PIPE_SHADER_TESS_EVAL])
+      ctx->delete_tes_state(ctx, csos[PIPE_SHADER_TESS_EVAL]);
+   if (csos[PIPE_SHADER_COMPUTE])
+      ctx->delete_compute_state(ctx, csos[PIPE_SHADER_COMPUTE]);
+}
+
+/* Return the CSO set of a queue, on the queue's thread.  llvmpipe keeps
+ * shader variants per CSO and per context without locking, so a CSO is
+ * only ever bound on the context that owns it.  Graphics queues usually
+ * get theirs from the variant precompile, otherwise the set is created
+ * here on first use.
+ */
+void **
+lvp_pipeline_queue_csos(struct lvp_pipeline *pipeline,
+                        struct lvp_queue *queue)
+{
+   void **csos = pipeline->shader_cso[queue->family][queue->index];
+
+   if (!lvp_pipeline_has_csos(pipeline, csos))
+      lvp_pipeline_create_csos(pipeline, queue->ctx, csos);
+   return csos;
+}
+
+struct lvp_stage_job {
+   struct util_queue_fence fence;
+   struct lvp_pipeline *pipeline;
+   const VkPipelineShaderStageCreateInfo *stage_info;
+};
+
+static void
+lvp_stage_compile_to_ir_job(void *data, void *gdata, int thread_index)
+{
+   struct lvp_stage_job *job = data;
+   VK_FROM_HANDLE(vk_shader_module, module, job->stage_info->module);
+
+   lvp_shader_compile_to_ir(job->pipeline, module,
+                            job->stage_info->pName,
+                            lvp_shader_stage(job->stage_info->stage),
+                            job->stage_info->pSpecializationInfo);
+}
+
+static void
+lvp_stage_finalize_job(void *data, void *gdata, int thread_index)
+{
+   struct lvp_stage_job *job = data;
+   struct pipe_screen *pscreen = job->pipeline->device->pscreen;
+
+   pscreen->finalize_nir(pscreen, job->pipeline->pipeline_nir[lvp_shader_stage(job->stage_info->stage)], true);
+}
+
+/* Run a per-stage NIR function over all stages of a pipeline.  Stages
+ * other than the first go to the compile queue while the calling thread
+ * handles the first one itself; stages never depend on each other at this
+ * point.  Nothing here may touch a pipe_context, CSOs are created later on
+ * a single thread by lvp_pipeline_prepare() and the queues.
+ */
+static void
+lvp_pipeline_run_stages(struct lvp_pipeline *pipeline,
+                        const VkGraphicsPipelineCreateInfo *pCreateInfo,
+                        util_queue_execute_func execute,
+                        bool parallel)
+{
+   struct lvp_stage_job jobs[MESA_SHADER_STAGES];
+   struct util_queue *queue = &pipeline->device->compile_queue;
+   uint32_t count = pCreateInfo->stageCount;
+
+   assert(count <= MESA_SHADER_STAGES);
+   for (uint32_t i = 0; i < count; i++) {
+      jobs[i].pipeline = pipeline;
+      jobs[i].stage_info = &pCreateInfo->pStages[i];
+   }
+
+   if (!parallel || count < 2) {
+      for (uint32_t i = 0; i < count; i++)
+         execute(&jobs[i], NULL, 0);
+      return;
+   }
+
+   for (uint32_t i = 1; i < count; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(queue, &jobs[i], &jobs[i].fence, execute, NULL, 0);
+   }
+   execute(&jobs[0], NULL, 0);
+   for (uint32_t i = 1; i < count; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
 }
 
 static VkResult
@@ -788,7 +902,8 @@ lvp_graphics_pipeline_init(struct lvp_pipeline *pipeline,
                            struct lvp_device *device,
                            struct lvp_pipeline_cache *cache,
                            const VkGraphicsPipelineCreateInfo *pCreateInfo,
-                           const VkAllocationCallbacks *alloc)
+                           const VkAllocationCallbacks *alloc,
+                           bool parallel)
 {
    if (alloc == NULL)
       alloc = &device->vk.alloc;
@@ -824,14 +939,10 @@ lvp_graphics_pipeline_init(struct lvp_pipeline *pipeline,
       pipeline->line_rectangular = true;
 
 
+   lvp_pipeline_run_stages(pipeline, pCreateInfo,
+                           lvp_stage_compile_to_ir_job, parallel);
    for (uint32_t i = 0; i < pCreateInfo->stageCount; i++) {
-      VK_FROM_HANDLE(vk_shader_module, module,
-                      pCreateInfo->pStages[i].module);
       gl_shader_stage stage = lvp_shader_stage(pCreateInfo->pStages[i].stage);
-      lvp_shader_compile_to_ir(pipeline, module,
-                               pCreateInfo->pStages[i].pName,
-                               stage,
-                               pCreateInfo->pStages[i].pSpecializationInfo);
       if (!pipeline->pipeline_nir[stage])
          return VK_ERROR_FEATURE_NOT_PRESENT;
    }
@@ -856,35 +967,39 @@ lvp_graphics_pipeline_init(struct lvp_pipeline *pipeline,
                                pipeline->pipeline_nir[MESA_SHADER_GEOMETRY]->info.gs.output_primitive == GL_LINES;
 
 
-   bool has_fragment_shader = false;
-   for (uint32_t i = 0; i < pCreateInfo->stageCount; i++) {
-      gl_shader_stage stage = lvp_shader_stage(pCreateInfo->pStages[i].stage);
-      lvp_pipeline_compile(pipeline, stage);
-      if (stage == MESA_SHADER_FRAGMENT)
-         has_fragment_shader = true;
-   }
+   lvp_pipeline_run_stages(pipeline, pCreateInfo,
+                           lvp_stage_finalize_job, parallel);
 
-   if (has_fragment_shader == false) {
+   if (!pipeline->pipeline_nir[MESA_SHADER_FRAGMENT]) {
       /* create a dummy fragment shader for this pipeline. */
       nir_builder b = nir_builder_init_simple_shader(MESA_SHADER_FRAGMENT, NULL,
                                                      "dummy_frag");
 
       pipeline->pipeline_nir[MESA_SHADER_FRAGMENT] = b.shader;
-      struct pipe_shader_state shstate = {0};
-      shstate.type = PIPE_SHADER_IR_NIR;
-      shstate.ir.nir = pipeline->pipeline_nir[MESA_SHADER_FRAGMENT];
-      pipeline->shader_cso[PIPE_SHADER_FRAGMENT] = device->queue.ctx->create_fs_state(device->queue.ctx, &shstate);
    }
    return VK_SUCCESS;
 }
 
+/* Build the precompiled CSO sets of a pipeline whose NIR is complete.
+ * This runs on the thread that called vkCreate*Pipelines, after any
+ * compile queue jobs for the pipeline are done.  The queues create the
+ * rest of their CSOs on their own threads, see lvp_pipeline_queue_csos().
+ */
+static void
+lvp_pipeline_prepare(struct lvp_pipeline *pipeline)
+{
+   if (!pipeline->is_compute_pipeline)
+      lvp_pipeline_precompile(pipeline->device, pipeline);
+}
+
 static VkResult
 lvp_graphics_pipeline_create(
    VkDevice _device,
    VkPipelineCache _cache,
    const VkGraphicsPipelineCreateInfo *pCreateInfo,
    const VkAllocationCallbacks *pAllocator,
-   VkPipeline *pPipeline)
+   VkPipeline *pPipeline,
+   bool parallel)
 {
    LVP_FROM_HANDLE(lvp_device, device, _device);
    LVP_FROM_HANDLE(lvp_pipeline_cache, cache, _cache);
@@ -901,7 +1016,7 @@ lvp_graphics_pipeline_create(
    vk_object_base_init(&device->vk, &pipeline->base,
                        VK_OBJECT_TYPE_PIPELINE);
    result = lvp_graphics_pipeline_init(pipeline, device, cache, pCreateInfo,
-                                       pAllocator);
+                                       pAllocator, parallel);
    if (result != VK_SUCCESS) {
       vk_free2(&device->vk.alloc, pAllocator, pipeline);
       return result;
@@ -912,6 +1027,85 @@ lvp_graphics_pipeline_create(
    return VK_SUCCESS;
 }
 
+struct lvp_pipeline_job {
+   struct util_queue_fence fence;
+   VkDevice device;
+   VkPipelineCache cache;
+   const void *create_info;
+   const VkAllocationCallbacks *alloc;
+   VkPipeline *pipeline;
+   VkResult result;
+};
+
+static void
+lvp_graphics_pipeline_job(void *data, void *gdata, int thread_index)
+{
+   struct lvp_pipeline_job *job = data;
+
+   /* the batch already keeps the workers busy, compile stages serially */
+   job->result = lvp_graphics_pipeline_create(job->device, job->cache,
+                                              job->create_info, job->alloc,
+                                              job->pipeline, false);
+}
+
+/* Create a batch of pipelines, one compile queue job per pipeline with the
+ * calling thread taking the first one.  The jobs stop at NIR, the
+ * precompile runs here as each job completes.
+ */
+static VkResult
+lvp_create_pipelines(VkDevice _device,
+                     VkPipelineCache pipelineCache,
+                     uint32_t count,
+                     const void *pCreateInfos,
+                     size_t create_info_size,
+                     util_queue_execute_func execute,
+                     const VkAllocationCallbacks *pAllocator,
+                     VkPipeline *pPipelines)
+{
+   LVP_FROM_HANDLE(lvp_device, device, _device);
+   VkResult result = VK_SUCCESS;
+
+   if (count == 0)
+      return VK_SUCCESS;
+
+   struct lvp_pipeline_job *jobs = calloc(count, sizeof(*jobs));
+   if (!jobs)
+      return vk_error(device->instance, VK_ERROR_OUT_OF_HOST_MEMORY);
+
+   for (uint32_t i = 0; i < count; i++) {
+      jobs[i].device = _device;
+      jobs[i].cache = pipelineCache;
+      jobs[i].create_info = (const char *)pCreateInfos + i * create_info_size;
+      jobs[i].alloc = pAllocator;
+      jobs[i].pipeline = &pPipelines[i];
+      pPipelines[i] = VK_NULL_HANDLE;
+   }
+
+   for (uint32_t i = 1; i < count; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      util_queue_add_job(&device->compile_queue, &jobs[i], &jobs[i].fence,
+                         execute, NULL, 0);
+   }
+   execute(&jobs[0], NULL, 0);
+
+   for (uint32_t i = 0; i < count; i++) {
+      if (i > 0) {
+         util_queue_fence_wait(&jobs[i].fence);
+         util_queue_fence_destroy(&jobs[i].fence);
+      }
+
+      if (jobs[i].result == VK_SUCCESS) {
+         lvp_pipeline_prepare(lvp_pipeline_from_handle(pPipelines[i]));
+      } else {
+         result = jobs[i].result;
+         pPipelines[i] = VK_NULL_HANDLE;
+      }
+   }
+
+   free(jobs);
+   return result;
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateGraphicsPipelines(
    VkDevice                                    _device,
    VkPipelineCache                             pipelineCache,
@@ -920,22 +1114,24 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateGraphicsPipelines(
    const VkAllocationCallbacks*                pAllocator,
    VkPipeline*                                 pPipelines)
 {
-   VkResult result = VK_SUCCESS;
-   unsigned i = 0;
-
-   for (; i < count; i++) {
-      VkResult r;
-      r = lvp_graphics_pipeline_create(_device,
-                                       pipelineCache,
-                                       &pCreateInfos[i],
-                                       pAllocator, &pPipelines[i]);
-      if (r != VK_SUCCESS) {
-         result = r;
-         pPipelines[i] = VK_NULL_HANDLE;
-      }
+   VkResult result;
+
+   if (count == 1) {
+      result = lvp_graphics_pipeline_create(_device,
+                                            pipelineCache,
+                                            &pCreateInfos[0],
+                                            pAllocator, &pPipelines[0], true);
+      if (result != VK_SUCCESS)
+         pPipelines[0] = VK_NULL_HANDLE;
+      else
+         lvp_pipeline_prepare(lvp_pipeline_from_handle(pPipelines[0]));
+      return result;
    }
 
-   return result;
+   return lvp_create_pipelines(_device, pipelineCache, count,
+                               pCreateInfos, sizeof(*pCreateInfos),
+                               lvp_graphics_pipeline_job,
+                               pAllocator, pPipelines);
 }
 
 static VkResult
@@ -964,7 +1160,7 @@ lvp_compute_pipeline_init(struct lvp_pipeline *pipeline,
                             pCreateInfo->stage.pSpecializationInfo);
    if (!pipeline->pipeline_nir[MESA_SHADER_COMPUTE])
       return VK_ERROR_FEATURE_NOT_PRESENT;
-   lvp_pipeline_compile(pipeline, MESA_SHADER_COMPUTE);
+   device->pscreen->finalize_nir(device->pscreen, pipeline->pipeline_nir[MESA_SHADER_COMPUTE], true);
    return VK_SUCCESS;
 }
 
@@ -1002,6 +1198,16 @@ lvp_compute_pipeline_create(
    return VK_SUCCESS;
 }
 
+static void
+lvp_compute_pipeline_job(void *data, void *gdata, int thread_index)
+{
+   struct lvp_pipeline_job *job = data;
+
+   job->result = lvp_compute_pipeline_create(job->device, job->cache,
+                                             job->create_info, job->alloc,
+                                             job->pipeline);
+}
+
 VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateComputePipelines(
    VkDevice                                    _device,
    VkPipelineCache                             pipelineCache,
@@ -1010,20 +1216,8 @@ VKAPI_ATTR VkResult VKAPI_CALL lvp_CreateComputePipelines(
    const VkAllocationCallbacks*                pAllocator,
    VkPipeline*                                 pPipelines)
 {
-   VkResult result = VK_SUCCESS;
-   unsigned i = 0;
-
-   for (; i < count; i++) {
-      VkResult r;
-      r = lvp_compute_pipeline_create(_device,
-                                      pipelineCache,
-                                      &pCreateInfos[i],
-                                      pAllocator, &pPipelines[i]);
-      if (r != VK_SUCCESS) {
-         result = r;
-         pPipelines[i] = VK_NULL_HANDLE;
-      }
-   }
-
-   return result;
+   return lvp_create_pipelines(_device, pipelineCache, count,
+                               pCreateInfos, sizeof(*pCreateInfos),
+                               lvp_compute_pipeline_job,
+                               pAllocator, pPipelines);
 }
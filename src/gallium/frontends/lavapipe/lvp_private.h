@@ -31,6 +31,9 @@
 
 #include "util/macros.h"
 #include "util/list.h"
+#include "util/cnd_monotonic.h"
+#include "util/u_queue.h"
+#include "util/u_dynarray.h"
 
 #include "compiler/shader_enums.h"
 #include "pipe/p_screen.h"
@@ -159,9 +162,14 @@ void lvp_finish_wsi(struct lvp_physical_device *physical_device);
 bool lvp_physical_device_extension_supported(struct lvp_physical_device *dev,
                                               const char *name);
 
+#define LVP_QUEUE_FAMILY_COUNT 2
+#define LVP_MAX_QUEUES 4
+
 struct lvp_queue {
    struct vk_object_base base;
    VkDeviceQueueCreateFlags flags;
+   uint32_t family;
+   uint32_t index;
    struct lvp_device *                         device;
    struct pipe_context *ctx;
    struct cso_context *cso;
@@ -171,6 +179,8 @@ struct lvp_queue {
    cnd_t new_work;
    struct list_head workqueue;
    volatile int count;
+   /* shader CSO sets of destroyed pipelines, for the thread to delete */
+   struct util_dynarray dead_csos;
 };
 
 struct lvp_queue_work {
@@ -178,6 +188,16 @@ struct lvp_queue_work {
    uint32_t cmd_buffer_count;
    struct lvp_cmd_buffer **cmd_buffers;
    struct lvp_fence *fence;
+
+   /* semaphore payloads to wait for before executing and to signal once
+    * the command buffers have completed
+    */
+   uint32_t wait_count;
+   struct lvp_semaphore **waits;
+   uint64_t *wait_vals;
+   uint32_t signal_count;
+   struct lvp_semaphore **signals;
+   uint64_t *signal_vals;
 };
 
 struct lvp_pipeline_cache {
@@ -189,12 +209,27 @@ struct lvp_pipeline_cache {
 struct lvp_device {
    struct vk_device vk;
 
+   /* family 0, index 0; queries use its context */
    struct lvp_queue queue;
+   struct lvp_queue *queues[LVP_QUEUE_FAMILY_COUNT][LVP_MAX_QUEUES];
    struct lvp_instance *                       instance;
    struct lvp_physical_device *physical_device;
    struct pipe_screen *pscreen;
 
    mtx_t fence_lock;
+
+   mtx_t semaphore_lock;
+   struct u_cnd_monotonic semaphore_cnd;
+
+   /* workers for vkCreate*Pipelines, fed per pipeline or per stage */
+   struct util_queue compile_queue;
+
+   /* context for state built off the queue threads: sampler views and the
+    * shader variants of new pipelines
+    */
+   mtx_t aux_lock;
+   struct pipe_context *aux_ctx;
+   struct cso_context *aux_cso;
 };
 
 void lvp_device_get_cache_uuid(void *uuid);
@@ -256,6 +291,10 @@ struct lvp_image_view {
    VkImageSubresourceRange subresourceRange;
 
    struct pipe_surface *surface; /* have we created a pipe surface for this? */
+
+   /* gallium views baked at creation so descriptor binds are a copy */
+   struct pipe_sampler_view *sv;
+   struct pipe_image_view iv;
 };
 
 struct lvp_subpass_attachment {
@@ -316,7 +355,7 @@ struct lvp_sampler {
    VkSamplerCreateInfo create_info;
    union pipe_color_union border_color;
    VkSamplerReductionMode reduction_mode;
-   uint32_t state[4];
+   struct pipe_sampler_state state;
 };
 
 struct lvp_framebuffer {
@@ -477,7 +516,10 @@ struct lvp_pipeline {
    bool is_compute_pipeline;
    bool force_min_sample;
    nir_shader *pipeline_nir[MESA_SHADER_STAGES];
-   void *shader_cso[PIPE_SHADER_TYPES];
+   /* one CSO set per queue, only used by its context; the variant
+    * precompile creates those of the graphics queues
+    */
+   void *shader_cso[LVP_QUEUE_FAMILY_COUNT][LVP_MAX_QUEUES][PIPE_SHADER_TYPES];
    VkGraphicsPipelineCreateInfo graphics_create_info;
    VkComputePipelineCreateInfo compute_create_info;
    uint32_t line_stipple_factor;
@@ -499,11 +541,16 @@ struct lvp_fence {
    struct vk_object_base base;
    bool signaled;
    struct pipe_fence_handle *handle;
+   struct lvp_queue *queue;
 };
 
 struct lvp_semaphore {
    struct vk_object_base base;
-   bool dummy;
+   bool timeline;
+   /* last value a submission has been queued to signal */
+   uint64_t pending;
+   /* last value actually signalled, protected by device->semaphore_lock */
+   uint64_t value;
 };
 
 struct lvp_buffer {
@@ -526,6 +573,9 @@ struct lvp_buffer_view {
    struct lvp_buffer *buffer;
    uint32_t offset;
    uint64_t range;
+
+   struct pipe_sampler_view *sv;
+   struct pipe_image_view iv;
 };
 
 struct lvp_query_pool {
@@ -537,11 +587,24 @@ struct lvp_query_pool {
    struct pipe_query *queries[0];
 };
 
+/* Commands are recorded into chunks of this size, recycled through the
+ * command pool.  Larger commands get a chunk of their own.
+ */
+#define LVP_CMD_CHUNK_SIZE (64 * 1024)
+
+struct lvp_cmd_chunk {
+   struct list_head link;
+   uint32_t size;
+   uint32_t used;
+   uint64_t data[];
+};
+
 struct lvp_cmd_pool {
    struct vk_object_base                        base;
    VkAllocationCallbacks                        alloc;
    struct list_head                             cmd_buffers;
    struct list_head                             free_cmd_buffers;
+   struct list_head                             free_chunks;
 };
 
 
@@ -559,12 +622,14 @@ struct lvp_cmd_buffer {
    struct lvp_device *                          device;
 
    VkCommandBufferLevel                         level;
+   VkCommandBufferUsageFlags                    usage_flags;
    enum lvp_cmd_buffer_status status;
    struct lvp_cmd_pool *                        pool;
    struct list_head                             pool_link;
 
    struct list_head                             cmds;
    struct list_head                            *last_emit;
+   struct list_head                             chunks;
 
    uint8_t push_constants[MAX_PUSH_CONSTANTS_SIZE];
 };
@@ -692,21 +757,39 @@ enum lvp_cmds {
    LVP_CMD_SET_RASTERIZER_DISCARD_ENABLE,
 };
 
+/* The state of a graphics pipeline that doesn't depend on the command
+ * stream, translated to gallium so binding it is a plain copy.
+ */
+struct lvp_baked_pipeline {
+   bool dynamic_states[VK_DYNAMIC_STATE_STENCIL_REFERENCE+32];
+   struct pipe_rt_blend_state blend_rt[PIPE_MAX_COLOR_BUFS];
+   /* locations the pipeline doesn't use have PIPE_FORMAT_NONE */
+   struct pipe_vertex_element velems[PIPE_MAX_ATTRIBS];
+   unsigned velem_count;
+   struct pipe_viewport_state viewports[16];
+   struct pipe_scissor_state scissors[16];
+};
+
 struct lvp_cmd_bind_pipeline {
    VkPipelineBindPoint bind_point;
    struct lvp_pipeline *pipeline;
+
+   /* Filled at EndCommandBuffer for command buffers that get replayed */
+   const struct lvp_baked_pipeline *baked;
 };
 
 struct lvp_cmd_set_viewport {
    uint32_t first_viewport;
    uint32_t viewport_count;
    VkViewport viewports[16];
+   const struct pipe_viewport_state *baked;
 };
 
 struct lvp_cmd_set_scissor {
    uint32_t first_scissor;
    uint32_t scissor_count;
    VkRect2D scissors[16];
+   const struct pipe_scissor_state *baked;
 };
 
 struct lvp_cmd_set_line_width {
@@ -733,6 +816,30 @@ struct lvp_cmd_set_stencil_vals {
    uint32_t value;
 };
 
+enum lvp_baked_descriptor_type {
+   LVP_BAKED_CONST_BUFFER,
+   LVP_BAKED_SHADER_BUFFER,
+   LVP_BAKED_SAMPLER,
+   LVP_BAKED_SAMPLER_VIEW,
+   LVP_BAKED_IMAGE,
+};
+
+/* A descriptor resolved to its final gallium slot, so binding it is a
+ * plain copy into the rendering state.
+ */
+struct lvp_baked_descriptor {
+   uint8_t type;
+   uint8_t p_stage;
+   uint16_t idx;
+   union {
+      struct pipe_constant_buffer cb;
+      struct pipe_shader_buffer sb;
+      const struct pipe_sampler_state *ss;
+      struct pipe_sampler_view *sv;
+      const struct pipe_image_view *iv;
+   };
+};
+
 struct lvp_cmd_bind_descriptor_sets {
    VkPipelineBindPoint bind_point;
    struct lvp_descriptor_set_layout *set_layout[MAX_SETS];
@@ -741,6 +848,10 @@ struct lvp_cmd_bind_descriptor_sets {
    struct lvp_descriptor_set **sets;
    uint32_t dynamic_offset_count;
    const uint32_t *dynamic_offsets;
+
+   /* Filled at EndCommandBuffer for command buffers that get replayed */
+   struct lvp_baked_descriptor *baked;
+   uint32_t baked_count;
 };
 
 struct lvp_cmd_bind_index_buffer {
@@ -1166,6 +1277,28 @@ VkResult lvp_execute_cmds(struct lvp_device *device,
                           struct lvp_queue *queue,
                           struct lvp_cmd_buffer *cmd_buffer);
 
+void lvp_pipeline_precompile(struct lvp_device *device,
+                             struct lvp_pipeline *pipeline);
+
+void lvp_pipeline_create_csos(struct lvp_pipeline *pipeline,
+                              struct pipe_context *ctx,
+                              void **csos);
+void lvp_pipeline_delete_csos(struct pipe_context *ctx, void **csos);
+void **lvp_pipeline_queue_csos(struct lvp_pipeline *pipeline,
+                               struct lvp_queue *queue);
+void lvp_queue_delete_csos(struct lvp_queue *queue, void **csos);
+
+uint32_t lvp_bake_descriptor_sets(const struct lvp_cmd_bind_descriptor_sets *bds,
+                                  struct lvp_baked_descriptor *baked);
+void lvp_bake_graphics_pipeline(const struct lvp_pipeline *pipeline,
+                                struct lvp_baked_pipeline *baked);
+void lvp_bake_draw_indexed(const struct lvp_cmd_bind_index_buffer *ib,
+                           struct lvp_cmd_draw_indexed *draw);
+void lvp_bake_viewports(const struct lvp_cmd_set_viewport *vp,
+                        struct pipe_viewport_state *baked);
+void lvp_bake_scissors(const struct lvp_cmd_set_scissor *ss,
+                       struct pipe_scissor_state *baked);
+
 struct lvp_image *lvp_swapchain_get_image(VkSwapchainKHR swapchain,
 					  uint32_t index);
 
@@ -142,6 +142,18 @@ struct pipe_context {
                     const struct pipe_draw_indirect_info *indirect,
                     const struct pipe_draw_start_count_bias *draws,
                     unsigned num_draws);
+
+   /**
+    * Compile the shader variants that a draw of the given primitive type
+    * would use with the currently bound state, without drawing anything.
+    *
+    * This is for frontends that know the complete state ahead of time and
+    * want to move shader compilation out of the draw path.  The compiled
+    * variants must remain usable by other contexts sharing the shaders.
+    * Optional.
+    */
+   void (*precompile_shader_variants)(struct pipe_context *pipe,
+                                      enum pipe_prim_type mode);
    /*@}*/
 
    /**
@@ -0,0 +1,223 @@
+/**************************************************************************
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Vertex shading throughput of the draw module: draws a large point list
+ * through an ALU heavy vertex shader with rasterization discarded, and
+ * prints the vertices shaded per second.  Run it with different
+ * DRAW_VS_THREADS values to compare the draw worker pool settings.
+ *
+ *    vs-throughput [vertices [iterations [shader length]]]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+/* util_draw_arrays */
+#include "util/u_draw.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+#include "util/os_time.h"
+/* ureg_* shader building */
+#include "tgsi/tgsi_ureg.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_rasterizer_state rasterizer;
+	struct cso_velems_state velem;
+
+	void *vs;
+	void *fs;
+
+	struct pipe_resource *vbuf;
+	unsigned num_verts;
+};
+
+static void *make_vs(struct pipe_context *pipe, unsigned length)
+{
+	struct ureg_program *ureg = ureg_create(PIPE_SHADER_VERTEX);
+	struct ureg_src in = ureg_DECL_vs_input(ureg, 0);
+	struct ureg_dst out = ureg_DECL_output(ureg, TGSI_SEMANTIC_POSITION, 0);
+	struct ureg_dst tmp = ureg_DECL_temporary(ureg);
+	struct ureg_src scale = ureg_imm4f(ureg, 0.999f, 1.001f, 0.998f, 1.0f);
+	struct ureg_src bias = ureg_imm4f(ureg, 0.001f, -0.001f, 0.002f, 0.0f);
+	unsigned i;
+
+	/* Dependent math the compiler can't fold away. */
+	ureg_MOV(ureg, tmp, in);
+	for (i = 0; i < length; i++)
+		ureg_MAD(ureg, tmp, ureg_src(tmp), scale, bias);
+	ureg_MOV(ureg, out, ureg_src(tmp));
+	ureg_END(ureg);
+
+	return ureg_create_shader_and_destroy(ureg, pipe);
+}
+
+static void init_prog(struct program *p, unsigned num_verts, unsigned length)
+{
+	ASSERTED int ret;
+	float *verts;
+	unsigned i;
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev);
+	assert(p->screen);
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL, 0);
+	p->cso = cso_create_context(p->pipe, 0);
+
+	/* vertex buffer, points spread over the clip volume */
+	p->num_verts = num_verts;
+	verts = MALLOC(num_verts * 4 * sizeof(float));
+	for (i = 0; i < num_verts; i++) {
+		verts[i * 4 + 0] = (float)(i % 1024) / 512.0f - 1.0f;
+		verts[i * 4 + 1] = (float)((i / 1024) % 1024) / 512.0f - 1.0f;
+		verts[i * 4 + 2] = 0.0f;
+		verts[i * 4 + 3] = 1.0f;
+	}
+	p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+				     PIPE_USAGE_DEFAULT,
+				     num_verts * 4 * sizeof(float));
+	pipe_buffer_write(p->pipe, p->vbuf, 0, num_verts * 4 * sizeof(float),
+			  verts);
+	FREE(verts);
+
+	/* only measure vertex processing */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.rasterizer_discard = 1;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.point_size = 1.0f;
+	p->rasterizer.depth_clip_near = 1;
+	p->rasterizer.depth_clip_far = 1;
+
+	/* vertex elements state */
+	memset(&p->velem, 0, sizeof(p->velem));
+	p->velem.count = 1;
+	p->velem.velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->vs = make_vs(p->pipe, length);
+
+	{
+		struct ureg_program *ureg = ureg_create(PIPE_SHADER_FRAGMENT);
+		ureg_END(ureg);
+		p->fs = ureg_create_shader_and_destroy(ureg, p->pipe);
+	}
+}
+
+static void close_prog(struct program *p)
+{
+	cso_destroy_context(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_resource_reference(&p->vbuf, NULL);
+
+	p->pipe->destroy(p->pipe);
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+
+	FREE(p);
+}
+
+static void draw(struct program *p)
+{
+	struct pipe_vertex_buffer vb;
+
+	memset(&vb, 0, sizeof(vb));
+	vb.stride = 4 * sizeof(float);
+	vb.buffer.resource = p->vbuf;
+
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+	cso_set_vertex_elements(p->cso, &p->velem);
+	p->pipe->set_vertex_buffers(p->pipe, 0, 1, 0, false, &vb);
+
+	util_draw_arrays(p->pipe, PIPE_PRIM_POINTS, 0, p->num_verts);
+}
+
+static void finish(struct program *p)
+{
+	struct pipe_fence_handle *fence = NULL;
+
+	p->pipe->flush(p->pipe, &fence, 0);
+	p->screen->fence_finish(p->screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+	p->screen->fence_reference(p->screen, &fence, NULL);
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	unsigned num_verts = argc > 1 ? atoi(argv[1]) : 1024 * 1024;
+	unsigned iterations = argc > 2 ? atoi(argv[2]) : 20;
+	unsigned length = argc > 3 ? atoi(argv[3]) : 64;
+	int64_t start, end;
+	unsigned i;
+
+	init_prog(p, num_verts, length);
+
+	/* compile the shader variants before timing */
+	draw(p);
+	finish(p);
+
+	start = os_time_get_nano();
+	for (i = 0; i < iterations; i++)
+		draw(p);
+	finish(p);
+	end = os_time_get_nano();
+
+	printf("%u vertices x %u draws, %u MADs: %.1f Mvertices/s\n",
+	       num_verts, iterations, length,
+	       (double)num_verts * iterations * 1000.0 / (end - start));
+
+	close_prog(p);
+
+	return 0;
+}
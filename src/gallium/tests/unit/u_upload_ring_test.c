@@ -0,0 +1,305 @@
+/**************************************************************************
+ *
+ * Copyright © 2026 agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR THEIR SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for the ring mode of u_upload_mgr: space is only reused once
+ * the fences covering it have signalled, and the ring grows otherwise.
+ *
+ * Runs against a fake screen whose buffers are plain memory and whose
+ * fences are signalled by the test.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_upload_mgr.h"
+
+
+#define BUFFER_SIZE 4096
+#define CHUNK 1024
+
+
+struct fake_resource {
+   struct pipe_resource base;
+   uint8_t *data;
+};
+
+struct fake_fence {
+   struct pipe_reference reference;
+   boolean signalled;
+};
+
+static int live_resources;
+static int live_fences;
+static unsigned failures;
+
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) { \
+         printf("%s:%u: check failed: %s\n", __FILE__, __LINE__, #cond); \
+         ++failures; \
+      } \
+   } while (0)
+
+
+static int
+fake_get_param(struct pipe_screen *screen, enum pipe_cap param)
+{
+   return param == PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT;
+}
+
+static struct pipe_resource *
+fake_resource_create(struct pipe_screen *screen,
+                     const struct pipe_resource *templat)
+{
+   struct fake_resource *res = CALLOC_STRUCT(fake_resource);
+
+   res->base = *templat;
+   res->base.screen = screen;
+   pipe_reference_init(&res->base.reference, 1);
+   res->data = MALLOC(templat->width0);
+   ++live_resources;
+   return &res->base;
+}
+
+static void
+fake_resource_destroy(struct pipe_screen *screen, struct pipe_resource *pt)
+{
+   struct fake_resource *res = (struct fake_resource *)pt;
+
+   FREE(res->data);
+   FREE(res);
+   --live_resources;
+}
+
+static void
+fake_fence_reference(struct pipe_screen *screen,
+                     struct pipe_fence_handle **ptr,
+                     struct pipe_fence_handle *fence)
+{
+   struct fake_fence *old = (struct fake_fence *)*ptr;
+   struct fake_fence *f = (struct fake_fence *)fence;
+
+   if (pipe_reference(old ? &old->reference : NULL,
+                      f ? &f->reference : NULL)) {
+      FREE(old);
+      --live_fences;
+   }
+   *ptr = fence;
+}
+
+static bool
+fake_fence_finish(struct pipe_screen *screen, struct pipe_context *ctx,
+                  struct pipe_fence_handle *fence, uint64_t timeout)
+{
+   return ((struct fake_fence *)fence)->signalled;
+}
+
+static void *
+fake_buffer_map(struct pipe_context *pipe, struct pipe_resource *resource,
+                unsigned level, unsigned usage, const struct pipe_box *box,
+                struct pipe_transfer **out_transfer)
+{
+   struct pipe_transfer *transfer = CALLOC_STRUCT(pipe_transfer);
+
+   pipe_resource_reference(&transfer->resource, resource);
+   transfer->usage = usage;
+   transfer->box = *box;
+   *out_transfer = transfer;
+   return ((struct fake_resource *)resource)->data + box->x;
+}
+
+static void
+fake_buffer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
+{
+   pipe_resource_reference(&transfer->resource, NULL);
+   FREE(transfer);
+}
+
+static struct pipe_fence_handle *
+fake_fence_create(void)
+{
+   struct fake_fence *fence = CALLOC_STRUCT(fake_fence);
+
+   pipe_reference_init(&fence->reference, 1);
+   ++live_fences;
+   return (struct pipe_fence_handle *)fence;
+}
+
+static void
+fake_fence_signal(struct pipe_fence_handle *fence)
+{
+   ((struct fake_fence *)fence)->signalled = TRUE;
+}
+
+
+/** Allocate CHUNK bytes, returning the offset and updating *buf. */
+static unsigned
+alloc_chunk(struct u_upload_mgr *upload, struct pipe_resource **buf)
+{
+   unsigned offset;
+   void *ptr;
+
+   u_upload_alloc(upload, 0, CHUNK, 256, &offset, buf, &ptr);
+   CHECK(ptr != NULL);
+   return offset;
+}
+
+
+static void
+test_no_ring(struct pipe_context *pipe)
+{
+   struct u_upload_mgr *upload =
+      u_upload_create(pipe, BUFFER_SIZE, PIPE_BIND_VERTEX_BUFFER,
+                      PIPE_USAGE_STREAM, 0);
+   struct pipe_resource *buf = NULL, *first;
+   struct u_upload_stats stats;
+   unsigned i;
+
+   for (i = 0; i < BUFFER_SIZE / CHUNK; i++)
+      CHECK(alloc_chunk(upload, &buf) == i * CHUNK);
+   first = NULL;
+   pipe_resource_reference(&first, buf);
+
+   /* Without the ring a full buffer is always replaced. */
+   CHECK(alloc_chunk(upload, &buf) == 0);
+   CHECK(buf != first);
+
+   u_upload_get_stats(upload, &stats);
+   CHECK(stats.num_buffer_allocs == 2);
+   CHECK(stats.num_ring_wraps == 0);
+   CHECK(stats.bytes_uploaded == BUFFER_SIZE + CHUNK);
+
+   u_upload_reset_stats(upload);
+   u_upload_get_stats(upload, &stats);
+   CHECK(stats.num_buffer_allocs == 0 && stats.bytes_uploaded == 0);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buf, NULL);
+   u_upload_destroy(upload);
+}
+
+
+static void
+test_ring(struct pipe_context *pipe)
+{
+   struct u_upload_mgr *upload =
+      u_upload_create(pipe, BUFFER_SIZE, PIPE_BIND_VERTEX_BUFFER,
+                      PIPE_USAGE_STREAM, 0);
+   struct pipe_fence_handle *f1 = fake_fence_create();
+   struct pipe_fence_handle *f2 = fake_fence_create();
+   struct pipe_resource *buf = NULL, *first;
+   struct u_upload_stats stats;
+
+   u_upload_enable_ring(upload);
+
+   /* Two chunks covered by f1, two by f2. */
+   CHECK(alloc_chunk(upload, &buf) == 0);
+   CHECK(alloc_chunk(upload, &buf) == CHUNK);
+   u_upload_fence(upload, f1);
+   CHECK(alloc_chunk(upload, &buf) == 2 * CHUNK);
+   CHECK(alloc_chunk(upload, &buf) == 3 * CHUNK);
+   u_upload_fence(upload, f2);
+   first = NULL;
+   pipe_resource_reference(&first, buf);
+
+   /* Once f1 signals its chunks are reused, in the same buffer. */
+   fake_fence_signal(f1);
+   CHECK(alloc_chunk(upload, &buf) == 0);
+   CHECK(alloc_chunk(upload, &buf) == CHUNK);
+   CHECK(buf == first);
+
+   u_upload_get_stats(upload, &stats);
+   CHECK(stats.num_buffer_allocs == 1);
+   CHECK(stats.num_ring_wraps == 1);
+
+   /* f2 still covers the rest, so the ring has to grow. */
+   CHECK(alloc_chunk(upload, &buf) == 0);
+   CHECK(buf != first);
+   CHECK(buf->width0 == 2 * BUFFER_SIZE);
+
+   u_upload_get_stats(upload, &stats);
+   CHECK(stats.num_buffer_allocs == 2);
+   CHECK(stats.bytes_uploaded == 7 * CHUNK);
+
+   /* The new buffer starts with an empty ring. */
+   u_upload_fence(upload, f2);
+   fake_fence_signal(f2);
+   while (alloc_chunk(upload, &buf) != 0)
+      ;
+   u_upload_get_stats(upload, &stats);
+   CHECK(stats.num_buffer_allocs == 2);
+   CHECK(stats.num_ring_wraps == 2);
+
+   pipe_resource_reference(&first, NULL);
+   pipe_resource_reference(&buf, NULL);
+   u_upload_destroy(upload);
+
+   pipe->screen->fence_reference(pipe->screen, &f1, NULL);
+   pipe->screen->fence_reference(pipe->screen, &f2, NULL);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_screen screen;
+   struct pipe_context pipe;
+
+   memset(&screen, 0, sizeof screen);
+   screen.get_param = fake_get_param;
+   screen.resource_create = fake_resource_create;
+   screen.resource_destroy = fake_resource_destroy;
+   screen.fence_reference = fake_fence_reference;
+   screen.fence_finish = fake_fence_finish;
+
+   memset(&pipe, 0, sizeof pipe);
+   pipe.screen = &screen;
+   pipe.buffer_map = fake_buffer_map;
+   pipe.buffer_unmap = fake_buffer_unmap;
+
+   test_no_ring(&pipe);
+   test_ring(&pipe);
+
+   CHECK(live_resources == 0);
+   CHECK(live_fences == 0);
+
+   if (failures) {
+      printf("Failure! %u checks failed.\n", failures);
+      return 1;
+   }
+
+   printf("Success!\n");
+   return 0;
+}
@@ -28,6 +28,14 @@
 
 #include <sys/types.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int os_create_anonymous_file(off_t size, const char *debug_name);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -47,6 +47,7 @@
 
 #include "disk_cache.h"
 #include "disk_cache_os.h"
+#include "disk_cache_server.h"
 
 /* The cache version should be bumped whenever a change is made to the
  * structure of cache entries or the index. This will give any 3rd party
@@ -92,6 +93,9 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    if (cache == NULL)
       goto fail;
 
+   cache->server_fd = -1;
+   simple_mtx_init(&cache->server_mtx, mtx_plain);
+
    /* Assume failure. */
    cache->path_init_failed = true;
 
@@ -178,6 +182,13 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
                         UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY, NULL))
       goto fail;
 
+   /* Share entries with other processes through the cache server, if one
+    * was requested.  Failing to reach it just leaves us with the local cache.
+    */
+   const char *server = getenv("MESA_DISK_CACHE_SERVER");
+   if (server)
+      cache->server_fd = disk_cache_server_connect(server);
+
    cache->path_init_failed = false;
 
  path_fail:
@@ -220,8 +231,11 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
    return cache;
 
  fail:
-   if (cache)
+   if (cache) {
+      disk_cache_server_disconnect(cache->server_fd);
+      simple_mtx_destroy(&cache->server_mtx);
       ralloc_free(cache);
+   }
    ralloc_free(local);
 
    return NULL;
@@ -240,6 +254,11 @@ disk_cache_destroy(struct disk_cache *cache)
       disk_cache_destroy_mmap(cache);
    }
 
+   if (cache) {
+      disk_cache_server_disconnect(cache->server_fd);
+      simple_mtx_destroy(&cache->server_mtx);
+   }
+
    ralloc_free(cache);
 }
 
@@ -328,6 +347,39 @@ destroy_put_job_nocopy(void *job, void *gdata, int thread_index)
    destroy_put_job(job, gdata, thread_index);
 }
 
+static void *
+cache_server_get(struct disk_cache *cache, const cache_key key, size_t *size)
+{
+   void *data = NULL;
+   size_t data_size = 0;
+
+   simple_mtx_lock(&cache->server_mtx);
+   if (cache->server_fd >= 0 &&
+       !disk_cache_server_get(cache->server_fd, key, &data, &data_size)) {
+      /* The server went away, stop talking to it. */
+      disk_cache_server_disconnect(cache->server_fd);
+      p_atomic_set(&cache->server_fd, -1);
+   }
+   simple_mtx_unlock(&cache->server_mtx);
+
+   if (data && size)
+      *size = data_size;
+   return data;
+}
+
+static void
+cache_server_put(struct disk_cache *cache, const cache_key key,
+                 const void *data, size_t size)
+{
+   simple_mtx_lock(&cache->server_mtx);
+   if (cache->server_fd >= 0 &&
+       !disk_cache_server_put(cache->server_fd, key, data, size)) {
+      disk_cache_server_disconnect(cache->server_fd);
+      p_atomic_set(&cache->server_fd, -1);
+   }
+   simple_mtx_unlock(&cache->server_mtx);
+}
+
 static void
 cache_put(void *job, void *gdata, int thread_index)
 {
@@ -337,6 +389,9 @@ cache_put(void *job, void *gdata, int thread_index)
    char *filename = NULL;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
+   if (p_atomic_read(&dc_job->cache->server_fd) >= 0)
+      cache_server_put(dc_job->cache, dc_job->key, dc_job->data, dc_job->size);
+
    if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
       disk_cache_write_item_to_disk_foz(dc_job);
    } else {
@@ -435,15 +490,30 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (p_atomic_read(&cache->server_fd) >= 0) {
+      void *data = cache_server_get(cache, key, size);
+      if (data)
+         return data;
+   }
+
+   void *data;
    if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
-      return disk_cache_load_item_foz(cache, key, size);
+      data = disk_cache_load_item_foz(cache, key, size);
    } else {
       char *filename = disk_cache_get_cache_filename(cache, key);
       if (filename == NULL)
          return NULL;
 
-      return disk_cache_load_item(cache, filename, size);
+      data = disk_cache_load_item(cache, filename, size);
    }
+
+   /* The server missed but we had it locally, hand it over so that other
+    * processes don't have to go to disk or recompile.
+    */
+   if (data && size && p_atomic_read(&cache->server_fd) >= 0)
+      cache_server_put(cache, key, data, *size);
+
+   return data;
 }
 
 void
@@ -33,6 +33,7 @@
 #else
 
 #include "util/fossilize_db.h"
+#include "util/simple_mtx.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -75,6 +76,13 @@ struct disk_cache {
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* Connection to the host-wide cache server, or -1 if there is none.
+    * Requests on it are serialized by server_mtx, which is also held to
+    * reset it to -1.  Checks outside the lock must use p_atomic_read().
+    */
+   int server_fd;
+   simple_mtx_t server_mtx;
 };
 
 struct disk_cache_put_job {
@@ -0,0 +1,537 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util/disk_cache_server.h"
+
+#if defined(__linux__)
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "util/hash_table.h"
+#include "util/list.h"
+#include "util/os_socket.h"
+
+/* Wire protocol.  Every request starts with a dcs_header.  PUT requests are
+ * followed by header.size bytes of payload and get no reply.  GET requests
+ * carry no payload; the server answers with a dcs_header whose size is the
+ * payload size (0 on a miss) followed by the payload itself.
+ */
+enum dcs_op {
+   DCS_OP_GET = 1,
+   DCS_OP_PUT = 2,
+};
+
+struct dcs_header {
+   uint32_t op;
+   uint32_t size;
+   cache_key key;
+};
+
+static bool
+dcs_send_all(int fd, const void *buf, size_t size)
+{
+   const uint8_t *p = buf;
+
+   while (size) {
+      ssize_t ret = os_socket_send(fd, p, size, MSG_NOSIGNAL);
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret <= 0)
+         return false;
+      p += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+static bool
+dcs_recv_all(int fd, void *buf, size_t size)
+{
+   uint8_t *p = buf;
+
+   while (size) {
+      ssize_t ret = os_socket_recv(fd, p, size, 0);
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret <= 0)
+         return false;
+      p += ret;
+      size -= ret;
+   }
+   return true;
+}
+
+/* Abstract sockets can be bound and connected to by anyone on the host, so
+ * both ends only talk to processes of their own user: cache entries are
+ * compiled code.
+ */
+static bool
+dcs_peer_is_same_user(int fd)
+{
+   struct ucred cred;
+   socklen_t len = sizeof(cred);
+
+   return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0 &&
+          len == sizeof(cred) && cred.uid == geteuid();
+}
+
+int
+disk_cache_server_connect(const char *name)
+{
+   if (!name || !*name)
+      name = DISK_CACHE_SERVER_DEFAULT_NAME;
+
+   int fd = os_socket_connect_abstract(name);
+   if (fd < 0)
+      return -1;
+
+   if (!dcs_peer_is_same_user(fd)) {
+      os_socket_close(fd);
+      errno = EACCES;
+      return -1;
+   }
+
+   /* The caller holds its cache's server lock across a request, so a stuck
+    * server must not stall the compile threads: time out instead, which
+    * makes the request fail and the caller fall back to the local cache.
+    */
+   struct timeval tv = {
+      .tv_sec = DISK_CACHE_SERVER_TIMEOUT_MS / 1000,
+      .tv_usec = (DISK_CACHE_SERVER_TIMEOUT_MS % 1000) * 1000,
+   };
+   if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0 ||
+       setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) < 0) {
+      os_socket_close(fd);
+      return -1;
+   }
+
+   return fd;
+}
+
+void
+disk_cache_server_disconnect(int fd)
+{
+   if (fd >= 0)
+      os_socket_close(fd);
+}
+
+bool
+disk_cache_server_get(int fd, const cache_key key, void **data, size_t *size)
+{
+   struct dcs_header hdr = { .op = DCS_OP_GET };
+   memcpy(hdr.key, key, CACHE_KEY_SIZE);
+
+   *data = NULL;
+   *size = 0;
+
+   if (!dcs_send_all(fd, &hdr, sizeof(hdr)) ||
+       !dcs_recv_all(fd, &hdr, sizeof(hdr)))
+      return false;
+
+   if (hdr.op != DCS_OP_GET || memcmp(hdr.key, key, CACHE_KEY_SIZE) != 0 ||
+       hdr.size > DISK_CACHE_SERVER_MAX_ITEM_SIZE)
+      return false;
+
+   /* Miss. */
+   if (hdr.size == 0)
+      return true;
+
+   void *buf = malloc(hdr.size);
+   if (!buf)
+      return false;
+
+   if (!dcs_recv_all(fd, buf, hdr.size)) {
+      free(buf);
+      return false;
+   }
+
+   *data = buf;
+   *size = hdr.size;
+   return true;
+}
+
+bool
+disk_cache_server_put(int fd, const cache_key key,
+                      const void *data, size_t size)
+{
+   if (size == 0 || size > DISK_CACHE_SERVER_MAX_ITEM_SIZE)
+      return true;
+
+   struct dcs_header hdr = { .op = DCS_OP_PUT, .size = size };
+   memcpy(hdr.key, key, CACHE_KEY_SIZE);
+
+   return dcs_send_all(fd, &hdr, sizeof(hdr)) &&
+          dcs_send_all(fd, data, size);
+}
+
+/* Server side. */
+
+struct dcs_entry {
+   struct list_head link;
+   cache_key key;
+   uint32_t size;
+   uint8_t data[];
+};
+
+struct dcs_server {
+   struct hash_table *entries;
+   struct list_head lru; /* most recently used first */
+   uint64_t size;
+   uint64_t max_size;
+};
+
+static uint32_t
+dcs_key_hash(const void *key)
+{
+   return _mesa_hash_data(key, CACHE_KEY_SIZE);
+}
+
+static bool
+dcs_key_equal(const void *a, const void *b)
+{
+   return memcmp(a, b, CACHE_KEY_SIZE) == 0;
+}
+
+static void
+dcs_remove_entry(struct dcs_server *server, struct dcs_entry *entry)
+{
+   _mesa_hash_table_remove_key(server->entries, entry->key);
+   list_del(&entry->link);
+   server->size -= entry->size;
+   free(entry);
+}
+
+static void
+dcs_insert_entry(struct dcs_server *server, struct dcs_entry *entry)
+{
+   struct hash_entry *he = _mesa_hash_table_search(server->entries,
+                                                   entry->key);
+   if (he)
+      dcs_remove_entry(server, he->data);
+
+   _mesa_hash_table_insert(server->entries, entry->key, entry);
+   list_add(&entry->link, &server->lru);
+   server->size += entry->size;
+
+   while (server->size > server->max_size && !list_is_empty(&server->lru)) {
+      struct dcs_entry *lru =
+         list_last_entry(&server->lru, struct dcs_entry, link);
+      dcs_remove_entry(server, lru);
+   }
+}
+
+/* A client connection.  Sockets are read and written without blocking, so
+ * a client that stalls halfway through a request or doesn't read its reply
+ * holds up nobody but itself.
+ */
+struct dcs_client {
+   /* Request being received. */
+   struct dcs_header hdr;
+   size_t hdr_received;
+   struct dcs_entry *put;   /* PUT payload, once the header is complete */
+   size_t put_received;
+
+   /* GET reply being sent.  No further request is read until it is done. */
+   uint8_t *reply;
+   size_t reply_size;
+   size_t reply_sent;
+};
+
+static void
+dcs_client_fini(struct dcs_client *client)
+{
+   free(client->put);
+   free(client->reply);
+}
+
+/* Queues the reply to a GET request.  The entry is copied, as other
+ * clients' PUTs may evict it before the reply is sent.
+ */
+static bool
+dcs_queue_get_reply(struct dcs_server *server, struct dcs_client *client)
+{
+   struct hash_entry *he = _mesa_hash_table_search(server->entries,
+                                                   client->hdr.key);
+   struct dcs_entry *entry = he ? he->data : NULL;
+   struct dcs_header hdr = client->hdr;
+
+   hdr.size = entry ? entry->size : 0;
+   client->reply = malloc(sizeof(hdr) + hdr.size);
+   if (!client->reply)
+      return false;
+
+   memcpy(client->reply, &hdr, sizeof(hdr));
+   if (entry) {
+      memcpy(client->reply + sizeof(hdr), entry->data, entry->size);
+      list_del(&entry->link);
+      list_add(&entry->link, &server->lru);
+   }
+   client->reply_size = sizeof(hdr) + hdr.size;
+   client->reply_sent = 0;
+   return true;
+}
+
+/* Receives whatever the client has sent so far and acts on each request
+ * that is complete.  Returns false when the connection should be dropped.
+ */
+static bool
+dcs_client_read(struct dcs_server *server, struct dcs_client *client, int fd)
+{
+   while (!client->reply) {
+      uint8_t *buf;
+      size_t size;
+
+      if (client->hdr_received < sizeof(client->hdr)) {
+         buf = (uint8_t *)&client->hdr + client->hdr_received;
+         size = sizeof(client->hdr) - client->hdr_received;
+      } else {
+         buf = client->put->data + client->put_received;
+         size = client->put->size - client->put_received;
+      }
+
+      ssize_t ret = os_socket_recv(fd, buf, size, MSG_DONTWAIT);
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+         return true;
+      if (ret <= 0)
+         return false;
+
+      if (client->hdr_received < sizeof(client->hdr)) {
+         client->hdr_received += ret;
+         if (client->hdr_received < sizeof(client->hdr))
+            continue;
+
+         switch (client->hdr.op) {
+         case DCS_OP_GET:
+            client->hdr_received = 0;
+            if (!dcs_queue_get_reply(server, client))
+               return false;
+            break;
+         case DCS_OP_PUT:
+            if (client->hdr.size == 0 ||
+                client->hdr.size > DISK_CACHE_SERVER_MAX_ITEM_SIZE)
+               return false;
+
+            client->put = malloc(sizeof(*client->put) + client->hdr.size);
+            if (!client->put)
+               return false;
+            memcpy(client->put->key, client->hdr.key, CACHE_KEY_SIZE);
+            client->put->size = client->hdr.size;
+            client->put_received = 0;
+            break;
+         default:
+            return false;
+         }
+      } else {
+         client->put_received += ret;
+         if (client->put_received < client->put->size)
+            continue;
+
+         if (client->put->size > server->max_size)
+            free(client->put);
+         else
+            dcs_insert_entry(server, client->put);
+         client->put = NULL;
+         client->hdr_received = 0;
+      }
+   }
+
+   return true;
+}
+
+/* Sends as much of the pending reply as the socket takes.  Returns false
+ * when the connection should be dropped.
+ */
+static bool
+dcs_client_write(struct dcs_client *client, int fd)
+{
+   while (client->reply_sent < client->reply_size) {
+      ssize_t ret = os_socket_send(fd, client->reply + client->reply_sent,
+                                   client->reply_size - client->reply_sent,
+                                   MSG_NOSIGNAL | MSG_DONTWAIT);
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+         return true;
+      if (ret <= 0)
+         return false;
+      client->reply_sent += ret;
+   }
+
+   free(client->reply);
+   client->reply = NULL;
+   return true;
+}
+
+int
+disk_cache_server_run(const char *name, uint64_t max_size,
+                      volatile bool *quit)
+{
+   if (!name || !*name)
+      name = DISK_CACHE_SERVER_DEFAULT_NAME;
+
+   int listen_fd = os_socket_listen_abstract(name, 16);
+   if (listen_fd < 0)
+      return -1;
+
+   struct dcs_server server = {
+      .max_size = max_size,
+   };
+   list_inithead(&server.lru);
+   server.entries = _mesa_hash_table_create(NULL, dcs_key_hash,
+                                            dcs_key_equal);
+   if (!server.entries) {
+      os_socket_close(listen_fd);
+      return -1;
+   }
+
+   /* Slot 0 is the listening socket, the rest are client connections, with
+    * their state at the same index in clients.
+    */
+   unsigned num_fds = 1, max_fds = 16;
+   struct pollfd *fds = malloc(max_fds * sizeof(*fds));
+   struct dcs_client *clients = calloc(max_fds, sizeof(*clients));
+   if (!fds || !clients) {
+      free(fds);
+      free(clients);
+      _mesa_hash_table_destroy(server.entries, NULL);
+      os_socket_close(listen_fd);
+      return -1;
+   }
+   fds[0].fd = listen_fd;
+   fds[0].events = POLLIN;
+
+   while (!*quit) {
+      int ret = poll(fds, num_fds, 100);
+      if (ret < 0 && errno != EINTR)
+         break;
+      if (ret <= 0)
+         continue;
+
+      for (unsigned i = num_fds; i-- > 1;) {
+         struct dcs_client *client = &clients[i];
+         short revents = fds[i].revents;
+         bool ok = true;
+
+         if (!revents)
+            continue;
+
+         if (revents & (POLLERR | POLLNVAL))
+            ok = false;
+         if (ok && (revents & POLLOUT))
+            ok = dcs_client_write(client, fds[i].fd);
+         if (ok && (revents & (POLLIN | POLLHUP)))
+            ok = dcs_client_read(&server, client, fds[i].fd);
+         /* Most replies fit in the socket buffer right away. */
+         if (ok && client->reply)
+            ok = dcs_client_write(client, fds[i].fd);
+
+         if (ok) {
+            fds[i].events = client->reply ? POLLOUT : POLLIN;
+            continue;
+         }
+
+         /* Error, hang-up or malformed request: drop the client. */
+         os_socket_close(fds[i].fd);
+         dcs_client_fini(client);
+         num_fds--;
+         fds[i] = fds[num_fds];
+         clients[i] = clients[num_fds];
+      }
+
+      if (fds[0].revents & POLLIN) {
+         int fd = os_socket_accept(listen_fd);
+         if (fd < 0)
+            continue;
+
+         if (!dcs_peer_is_same_user(fd)) {
+            os_socket_close(fd);
+            continue;
+         }
+
+         if (num_fds == max_fds) {
+            struct pollfd *new_fds = realloc(fds, 2 * max_fds * sizeof(*fds));
+            if (new_fds)
+               fds = new_fds;
+            struct dcs_client *new_clients =
+               realloc(clients, 2 * max_fds * sizeof(*clients));
+            if (new_clients)
+               clients = new_clients;
+            if (!new_fds || !new_clients) {
+               os_socket_close(fd);
+               continue;
+            }
+            max_fds *= 2;
+         }
+
+         fds[num_fds].fd = fd;
+         fds[num_fds].events = POLLIN;
+         fds[num_fds].revents = 0;
+         memset(&clients[num_fds], 0, sizeof(clients[num_fds]));
+         num_fds++;
+      }
+   }
+
+   for (unsigned i = 0; i < num_fds; i++) {
+      os_socket_close(fds[i].fd);
+      if (i)
+         dcs_client_fini(&clients[i]);
+   }
+   free(fds);
+   free(clients);
+
+   list_for_each_entry_safe(struct dcs_entry, entry, &server.lru, link)
+      free(entry);
+   _mesa_hash_table_destroy(server.entries, NULL);
+
+   return 0;
+}
+
+#else
+
+int
+disk_cache_server_connect(const char *name)
+{
+   errno = ENOSYS;
+   return -1;
+}
+
+void
+disk_cache_server_disconnect(int fd)
+{
+}
+
+bool
+disk_cache_server_get(int fd, const cache_key key, void **data, size_t *size)
+{
+   *data = NULL;
+   *size = 0;
+   return false;
+}
+
+bool
+disk_cache_server_put(int fd, const cache_key key,
+                      const void *data, size_t size)
+{
+   return false;
+}
+
+int
+disk_cache_server_run(const char *name, uint64_t max_size,
+                      volatile bool *quit)
+{
+   errno = ENOSYS;
+   return -1;
+}
+
+#endif
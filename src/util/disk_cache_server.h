@@ -0,0 +1,70 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ * SPDX-License-Identifier: MIT
+ *
+ * Host-local shader cache server.
+ *
+ * A single server process keeps recently used cache entries in memory and
+ * shares them between every process on the host that sets
+ * MESA_DISK_CACHE_SERVER to the server's abstract socket name.  This lets
+ * many short-lived processes (test runners, render farms, CI jobs) reuse
+ * each other's compiled shaders without each of them going back to the
+ * on-disk cache.
+ */
+
+#ifndef DISK_CACHE_SERVER_H
+#define DISK_CACHE_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util/disk_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISK_CACHE_SERVER_DEFAULT_NAME "mesa-shader-cache"
+
+/* Entries larger than this are neither sent to nor accepted by the server. */
+#define DISK_CACHE_SERVER_MAX_ITEM_SIZE (64 * 1024 * 1024)
+
+/* A send or receive on a client connection that makes no progress for this
+ * long fails.
+ */
+#define DISK_CACHE_SERVER_TIMEOUT_MS 250
+
+/* Client side.  All calls on one connection must be serialized by the
+ * caller.  On any I/O error or timeout the functions return failure and the
+ * caller is expected to close the connection and fall back to the local
+ * cache.  Connecting fails if the server runs as another user.
+ */
+int
+disk_cache_server_connect(const char *name);
+
+void
+disk_cache_server_disconnect(int fd);
+
+bool
+disk_cache_server_get(int fd, const cache_key key, void **data, size_t *size);
+
+bool
+disk_cache_server_put(int fd, const cache_key key,
+                      const void *data, size_t size);
+
+/* Server side.  Serves requests from processes of the same user on the
+ * abstract socket \p name, keeping at most \p max_size bytes of payload
+ * resident and evicting the least recently used entries beyond that.
+ * Returns when *quit becomes true, or -1 if the socket could not be
+ * created.
+ */
+int
+disk_cache_server_run(const char *name, uint64_t max_size,
+                      volatile bool *quit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_SERVER_H */
@@ -0,0 +1,67 @@
+/*
+ * Copyright © 2026 agent <agent@local>
+ * SPDX-License-Identifier: MIT
+ */
+
+/* mesa-cache-server: keeps compiled shaders in memory for every Mesa
+ * process on the host that runs with MESA_DISK_CACHE_SERVER set to the same
+ * socket name.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/disk_cache_server.h"
+
+static volatile bool quit;
+
+static void
+handle_signal(int sig)
+{
+   quit = true;
+}
+
+static void
+print_usage(const char *prog)
+{
+   fprintf(stderr,
+           "Usage: %s [-n NAME] [-s SIZE_MB]\n"
+           "  -n NAME     abstract socket name (default: %s)\n"
+           "  -s SIZE_MB  memory budget for cached entries (default: 1024)\n",
+           prog, DISK_CACHE_SERVER_DEFAULT_NAME);
+}
+
+int
+main(int argc, char **argv)
+{
+   const char *name = DISK_CACHE_SERVER_DEFAULT_NAME;
+   uint64_t max_size = 1024ull * 1024 * 1024;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "n:s:h")) != -1) {
+      switch (opt) {
+      case 'n':
+         name = optarg;
+         break;
+      case 's':
+         max_size = strtoull(optarg, NULL, 10) * 1024 * 1024;
+         break;
+      default:
+         print_usage(argv[0]);
+         return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+   }
+
+   struct sigaction sa = { .sa_handler = handle_signal };
+   sigaction(SIGINT, &sa, NULL);
+   sigaction(SIGTERM, &sa, NULL);
+
+   if (disk_cache_server_run(name, max_size, &quit) < 0) {
+      fprintf(stderr, "%s: failed to listen on @%s\n", argv[0], name);
+      return EXIT_FAILURE;
+   }
+
+   return EXIT_SUCCESS;
+}
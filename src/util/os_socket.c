@@ -46,6 +46,29 @@ os_socket_listen_abstract(const char *path, int count)
    return s;
 }
 
+int
+os_socket_connect_abstract(const char *path)
+{
+   int s = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+   if (s < 0)
+      return -1;
+
+   struct sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strncpy(addr.sun_path + 1, path, sizeof(addr.sun_path) - 2);
+
+   int ret = connect(s, (struct sockaddr*)&addr,
+                     offsetof(struct sockaddr_un, sun_path) +
+                     strlen(path) + 1);
+   if (ret < 0) {
+      close(s);
+      return -1;
+   }
+
+   return s;
+}
+
 int
 os_socket_accept(int s)
 {
@@ -93,6 +116,13 @@ os_socket_listen_abstract(const char *path, int count)
    return -1;
 }
 
+int
+os_socket_connect_abstract(const char *path)
+{
+   errno = -ENOSYS;
+   return -1;
+}
+
 int
 os_socket_accept(int s)
 {
@@ -24,6 +24,7 @@ extern "C" {
 int os_socket_accept(int s);
 
 int os_socket_listen_abstract(const char *path, int count);
+int os_socket_connect_abstract(const char *path);
 
 ssize_t os_socket_recv(int socket, void *buffer, size_t length, int flags);
 ssize_t os_socket_send(int socket, const void *buffer, size_t length, int flags);
@@ -35,8 +35,11 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "c11/threads.h"
 #include "util/mesa-sha1.h"
 #include "util/disk_cache.h"
+#include "util/disk_cache_server.h"
+#include "util/os_socket.h"
 
 bool error = false;
 
@@ -517,6 +520,128 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+#ifdef __linux__
+struct server_args {
+   char name[64];
+   uint64_t max_size;
+   volatile bool quit;
+};
+
+static int
+server_thread(void *data)
+{
+   struct server_args *args = data;
+   return disk_cache_server_run(args->name, args->max_size, &args->quit);
+}
+
+static void
+test_server_put_and_get(void)
+{
+   struct server_args args = { .max_size = 2 * 1024 };
+   snprintf(args.name, sizeof(args.name), "mesa-cache-test-%d", (int)getpid());
+
+   uint8_t key_a[20] = { 1 }, key_b[20] = { 2 }, key_c[20] = { 3 };
+   uint8_t blob_a[1000], blob_b[1000], blob_c[1000];
+   memset(blob_a, 0xa, sizeof(blob_a));
+   memset(blob_b, 0xb, sizeof(blob_b));
+   memset(blob_c, 0xc, sizeof(blob_c));
+
+   thrd_t thread;
+   if (thrd_create(&thread, server_thread, &args) != thrd_success) {
+      expect_true(false, "cache server thread creation");
+      return;
+   }
+
+   int fd = -1;
+   for (unsigned i = 0; i < 100 && fd < 0; i++) {
+      fd = disk_cache_server_connect(args.name);
+      if (fd < 0)
+         usleep(10000);
+   }
+   expect_true(fd >= 0, "cache server connect");
+   if (fd < 0)
+      goto done;
+
+   void *result;
+   size_t size;
+
+   bool ok = disk_cache_server_get(fd, key_a, &result, &size);
+   expect_true(ok, "cache server get before put");
+   expect_null(result, "cache server get before put");
+
+   /* A client that stops halfway through a request must not hold up the
+    * others.
+    */
+   int stalled_fd = disk_cache_server_connect(args.name);
+   expect_true(stalled_fd >= 0, "cache server second connection");
+   if (stalled_fd >= 0) {
+      ssize_t sent = write(stalled_fd, key_a, 4);
+      expect_true(sent == 4, "cache server partial request");
+   }
+
+   disk_cache_server_put(fd, key_a, blob_a, sizeof(blob_a));
+   disk_cache_server_put(fd, key_b, blob_b, sizeof(blob_b));
+
+   ok = disk_cache_server_get(fd, key_a, &result, &size);
+   expect_true(ok && result && size == sizeof(blob_a) &&
+               memcmp(result, blob_a, size) == 0,
+               "cache server get after put");
+   free(result);
+
+   /* Going over budget evicts the least recently used entry, which is B
+    * since A was just looked up.
+    */
+   disk_cache_server_put(fd, key_c, blob_c, sizeof(blob_c));
+
+   disk_cache_server_get(fd, key_b, &result, &size);
+   expect_null(result, "cache server evicts least recently used entry");
+   free(result);
+
+   disk_cache_server_get(fd, key_a, &result, &size);
+   expect_non_null(result, "cache server keeps recently used entry");
+   free(result);
+
+   disk_cache_server_get(fd, key_c, &result, &size);
+   expect_non_null(result, "cache server keeps newest entry");
+   free(result);
+
+   disk_cache_server_disconnect(stalled_fd);
+   disk_cache_server_disconnect(fd);
+
+done:
+   args.quit = true;
+   thrd_join(thread, NULL);
+}
+
+static void
+test_server_timeout(void)
+{
+   char name[64];
+   snprintf(name, sizeof(name), "mesa-cache-test-stuck-%d", (int)getpid());
+
+   /* A server that accepts connections but never answers. */
+   int listen_fd = os_socket_listen_abstract(name, 1);
+   expect_true(listen_fd >= 0, "stuck cache server listen");
+   if (listen_fd < 0)
+      return;
+
+   int fd = disk_cache_server_connect(name);
+   expect_true(fd >= 0, "stuck cache server connect");
+   if (fd >= 0) {
+      uint8_t key[20] = { 1 };
+      void *result;
+      size_t size;
+
+      bool ok = disk_cache_server_get(fd, key, &result, &size);
+      expect_false(ok, "cache server get times out");
+      expect_null(result, "cache server get times out");
+      disk_cache_server_disconnect(fd);
+   }
+
+   os_socket_close(listen_fd);
+}
+#endif /* __linux__ */
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -531,6 +656,12 @@ main(void)
 
    test_put_key_and_get_key();
 
+#ifdef __linux__
+   test_server_put_and_get();
+
+   test_server_timeout();
+#endif
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
@@ -57,6 +57,11 @@ struct wsi_swapchain {
 
    bool use_prime_blit;
 
+   /* Set when the swapchain waits for the present fence on its own
+    * thread, so vkQueuePresentKHR doesn't have to block on it.
+    */
+   bool present_waits_fence;
+
    /* Command pools, one per queue family */
    VkCommandPool *cmd_pools;
 
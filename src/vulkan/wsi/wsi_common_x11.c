@@ -38,6 +38,7 @@
 #include <xf86drm.h>
 #include "drm-uapi/drm_fourcc.h"
 #include "util/hash_table.h"
+#include "util/debug.h"
 #include "util/u_thread.h"
 #include "util/xmlconfig.h"
 
@@ -790,6 +791,7 @@ struct x11_image {
    xcb_pixmap_t                              pixmap;
    bool                                      busy;
    bool                                      present_queued;
+   uint64_t                                  queued_ns;
    struct xshmfence *                        shm_fence;
    uint32_t                                  sync_fence;
    uint32_t                                  serial;
@@ -815,6 +817,8 @@ struct x11_swapchain {
 
    bool                                         has_present_queue;
    bool                                         has_acquire_queue;
+   bool                                         print_latency;
+   uint32_t                                     frame;
    VkResult                                     status;
    bool                                         copy_is_suboptimal;
    struct wsi_queue                             present_queue;
@@ -1061,7 +1065,8 @@ x11_acquire_next_image_from_queue(struct x11_swapchain *chain,
    }
 
    assert(image_index < chain->base.image_count);
-   xshmfence_await(chain->images[image_index].shm_fence);
+   if (!chain->base.wsi->sw)
+      xshmfence_await(chain->images[image_index].shm_fence);
 
    *image_index_out = image_index;
 
@@ -1190,10 +1195,6 @@ x11_acquire_next_image(struct wsi_swapchain *anv_chain,
    if (chain->status < 0)
       return chain->status;
 
-   if (chain->base.wsi->sw) {
-      *image_index = 0;
-      return VK_SUCCESS;
-   }
    if (chain->has_acquire_queue) {
       return x11_acquire_next_image_from_queue(chain, image_index, timeout);
    } else {
@@ -1214,6 +1215,8 @@ x11_queue_present(struct wsi_swapchain *anv_chain,
 
    chain->images[image_index].busy = true;
    if (chain->has_present_queue) {
+      if (chain->print_latency)
+         chain->images[image_index].queued_ns = wsi_common_get_current_time();
       wsi_queue_push(&chain->present_queue, image_index);
       return chain->status;
    } else {
@@ -1302,6 +1305,72 @@ fail:
    return NULL;
 }
 
+/**
+ * Present thread for software swapchains.  Waits for rendering to finish
+ * and uploads the image to the window, so that neither the application
+ * nor the driver's queue stall on the copy and the next frame can render
+ * while the previous one is being presented.  Presented images go back on
+ * the acquire queue.
+ */
+static void *
+x11_manage_sw_queue(void *state)
+{
+   struct x11_swapchain *chain = state;
+   VkResult result = VK_SUCCESS;
+
+   assert(chain->has_present_queue && chain->has_acquire_queue);
+
+   u_thread_setname("WSI sw present");
+
+   while (chain->status >= 0) {
+      uint32_t image_index = 0;
+      result = wsi_queue_pull(&chain->present_queue, &image_index, INT64_MAX);
+      assert(result != VK_TIMEOUT);
+      if (result < 0) {
+         goto fail;
+      } else if (chain->status < 0) {
+         /* The swapchain is being destroyed. */
+         return NULL;
+      }
+
+      result = chain->base.wsi->WaitForFences(chain->base.device, 1,
+                                              &chain->base.fences[image_index],
+                                              true, UINT64_MAX);
+      if (result != VK_SUCCESS) {
+         result = VK_ERROR_OUT_OF_DATE_KHR;
+         goto fail;
+      }
+
+      uint64_t ready_ns = chain->print_latency ? wsi_common_get_current_time() : 0;
+
+      result = x11_present_to_x11_sw(chain, image_index, 0);
+      if (result < 0)
+         goto fail;
+
+      if (chain->print_latency) {
+         struct x11_image *image = &chain->images[image_index];
+         uint64_t done_ns = wsi_common_get_current_time();
+
+         fprintf(stderr, "WSI: frame %u image %u: render wait %.3f ms, "
+                 "present %.3f ms, total %.3f ms\n",
+                 chain->frame, image_index,
+                 (ready_ns - image->queued_ns) / 1000000.0,
+                 (done_ns - ready_ns) / 1000000.0,
+                 (done_ns - image->queued_ns) / 1000000.0);
+      }
+      chain->frame++;
+
+      chain->images[image_index].busy = false;
+      wsi_queue_push(&chain->acquire_queue, image_index);
+   }
+
+fail:
+   x11_swapchain_result(chain, result);
+   wsi_queue_push(&chain->acquire_queue, UINT32_MAX);
+
+   return NULL;
+}
+
 static VkResult
 x11_image_init(VkDevice device_h, struct x11_swapchain *chain,
                const VkSwapchainCreateInfoKHR *pCreateInfo,
@@ -1635,6 +1704,8 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
    chain->last_present_msc = 0;
    chain->has_acquire_queue = false;
    chain->has_present_queue = false;
+   chain->print_latency = env_var_as_boolean("MESA_VK_WSI_PRINT_LATENCY", false);
+   chain->frame = 0;
    chain->status = VK_SUCCESS;
    chain->has_dri3_modifiers = wsi_conn->has_dri3_modifiers;
 
@@ -1743,6 +1814,39 @@ x11_surface_create_swapchain(VkIcdSurfaceBase *icd_surface,
       }
    }
 
+   if (chain->base.wsi->sw) {
+      /* Software presents are copied out on a thread of their own, with
+       * every image cycling through the acquire queue.
+       */
+      int ret = wsi_queue_init(&chain->present_queue, chain->base.image_count + 1);
+      if (ret)
+         goto fail_init_images;
+
+      ret = wsi_queue_init(&chain->acquire_queue, chain->base.image_count + 1);
+      if (ret) {
+         wsi_queue_destroy(&chain->present_queue);
+         goto fail_init_images;
+      }
+
+      for (unsigned i = 0; i < chain->base.image_count; i++)
+         wsi_queue_push(&chain->acquire_queue, i);
+
+      chain->has_present_queue = true;
+      chain->has_acquire_queue = true;
+      chain->base.present_waits_fence = true;
+
+      ret = pthread_create(&chain->queue_manager, NULL,
+                           x11_manage_sw_queue, chain);
+      if (ret) {
+         wsi_queue_destroy(&chain->present_queue);
+         wsi_queue_destroy(&chain->acquire_queue);
+         chain->has_present_queue = false;
+         chain->has_acquire_queue = false;
+         chain->base.present_waits_fence = false;
+         goto fail_init_images;
+      }
+   }
+
    assert(chain->has_present_queue || !chain->has_acquire_queue);
 
    for (int i = 0; i < ARRAY_SIZE(modifiers); i++)